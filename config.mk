@@ -24,6 +24,14 @@ USELOCALLIBLLAD = no
 USELOCALLIBRUA = no
 USELOCALLIBDCC = no
 
+# yes for building RUAReceiveData(), which is used by section filters and
+# demux recorders. Its ioctl is not verified against the em8xxx driver, with
+# no the functions return RM_NOT_SUPPORTED.
+RUARECEIVE = no
+ifeq ($(RUARECEIVE),yes)
+CPPFLAGS += -DRUA_RECEIVE_DATA
+endif
+
 # IP address of the dma-2500
 CLIENTIP=$(shell dig +short dma-2500 | awk '{ print ; exit }')
 
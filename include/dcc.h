@@ -22,6 +22,10 @@
 
 #define EMhwlibSamplingMode_444 1
 
+#define EMhwlibColorMode_LUT_1BPP 1
+#define EMhwlibColorMode_LUT_2BPP 2
+#define EMhwlibColorMode_LUT_4BPP 3
+#define EMhwlibColorMode_LUT_8BPP 4
 #define EMhwlibColorMode_TrueColor 5
 
 #define EMhwlibColorFormat_24BPP_565 1
@@ -38,6 +42,14 @@ struct DCC;
 struct DCCVideoSource;
 struct DCCAudioSource;
 struct DCCDemuxTask;
+struct DCCSectionFilter;
+struct DCCDemuxRecorder;
+struct DCCPacketizer;
+struct DCCCursor;
+struct DCCMosaic;
+
+/** Number of windows of DispVCRMultiScaler and DispGFXMultiScaler (TBD: verify). */
+#define DCC_MULTISCALER_WINDOW_COUNT 8
 
 enum DCCRoute {
 	DCCRoute_Main = 0,
@@ -55,12 +67,46 @@ enum DCCInitMode {
 };
 
 struct DCCSTCSource;
+struct DCCSTCClock;
+struct DCCClockRecovery;
+struct DCCTrickPlay;
+struct DCCSeekIndex;
+
+/** Maximum number of audio decoders started by DCCPlaySynchronized(). */
+#define DCC_MAX_AUDIO_SOURCES 8
 
 struct EMhwlibAspectRatio {
 	RMuint32 X;
 	RMuint32 Y;
 };
 
+enum EMhwlibDisplayWindowPositionMode {
+	EMhwlibDisplayWindowPositionMode_LeftEdge = 0,
+	EMhwlibDisplayWindowPositionMode_Center = 1,
+	EMhwlibDisplayWindowPositionMode_RightEdge = 2,
+};
+
+enum EMhwlibDisplayWindowValueMode {
+	EMhwlibDisplayWindowValueMode_Fixed = 0,
+	EMhwlibDisplayWindowValueMode_Relative = 1,
+};
+
+/** Relative window values are in units of 1/4096 of the output. */
+#define EMHWLIB_WINDOW_RELATIVE_MAX 4096
+
+struct EMhwlibWindow {
+	RMint32 X;
+	RMint32 Y;
+	RMuint32 Width;
+	RMuint32 Height;
+	enum EMhwlibDisplayWindowPositionMode XPositionMode;
+	enum EMhwlibDisplayWindowPositionMode YPositionMode;
+	enum EMhwlibDisplayWindowValueMode XMode;
+	enum EMhwlibDisplayWindowValueMode YMode;
+	enum EMhwlibDisplayWindowValueMode WidthMode;
+	enum EMhwlibDisplayWindowValueMode HeightMode;
+};
+
 struct DCCOSDProfile {
 	RMuint32 SamplingMode;
 	RMuint32 ColorMode;
@@ -76,6 +122,19 @@ enum Master_type {
 	Master_Audio = 1,
 };
 
+struct DCCClockRecoveryProfile {
+	/** FIFO fullness in bytes which should be held. */
+	RMuint32 target_fullness;
+	/** Proportional gain: trim in ppm at an error of 100 % of target_fullness. */
+	RMuint32 kp;
+	/** Integral gain: trim in ppm per second at an error of 100 %. */
+	RMuint32 ki;
+	/** Maximum trim in ppm. */
+	RMuint32 max_ppm;
+	/** Minimum change in ppm before the STC speed is changed. */
+	RMuint32 min_step_ppm;
+};
+
 struct DCCStcProfile {
 	RMuint32 STCID;
 	enum Master_type master;
@@ -195,12 +254,54 @@ enum DCCStreamType {
 	DCC_Audio = 2,
 };
 
+/** Flag in emhwlib_info.ValidFields when TimeStamp is set. TBD: not verified. */
+#define TIME_STAMP_INFO 0x1
+/** Flag in emhwlib_info.ValidFields when FirstAccessUnitPointer is set. TBD: not verified. */
+#define FIRST_ACCESS_UNIT_POINTER_INFO 0x2
+
 struct emhwlib_info {
 	RMuint32 ValidFields;
 	RMuint64 TimeStamp;
 	RMuint32 FirstAccessUnitPointer;
 };
 
+/** Fill level of the bitstream and PTS FIFO of a decoder. */
+struct DCCFIFOLevel {
+	/** Size of bitstream FIFO in bytes. */
+	RMuint32 BitstreamSize;
+	/** Bytes in bitstream FIFO not yet decoded. */
+	RMuint32 BitstreamFullness;
+	/** Number of entries in PTS FIFO. */
+	RMuint32 PtsSize;
+	/** Entries in PTS FIFO not yet decoded. */
+	RMuint32 PtsFullness;
+	/** Estimated play time of the bitstream FIFO, 0 when the bitrate is unknown. */
+	RMuint64 PlayTime;
+};
+
+/** Key frame in the index used for trick play and seeking. */
+struct DCCTrickPlayEntry {
+	/** Presentation time of the key frame. */
+	RMuint64 pts;
+	/** Position of the key frame in the file. */
+	RMuint64 offset;
+	RMuint32 size;
+};
+
+/** Appended to the name of the media file to get the name of the saved seek index. */
+#define DCC_SEEKINDEX_SUFFIX ".idx"
+
+/** Maximum number of key frames shown per second in trick play. */
+#define DCC_TRICKPLAY_MAX_FPS 8
+
+/**
+ * Read a key frame for trick play.
+ *
+ * @param data Returns the access unit in byte stream format (Annex B). It
+ * must stay valid until the next call.
+ */
+typedef RMstatus DCCTrickPlayReadFunc(void *opaque, struct DCCTrickPlayEntry *entry, RMuint8 **data, RMuint32 *size);
+
 enum DCCVideoPlayCommand {
 	DCCVideoPlayFwd = 3,
 	DCCVideoPlayIFrame = 5,
@@ -227,6 +328,115 @@ struct DCCDemuxTaskProfile {
 	RMuint32 reserved2c; // 0x2c
 };
 
+/** Number of DemuxOutput modules which can be connected to decoders. */
+#define DCC_DEMUX_MAX_OUTPUTS 8
+
+/** Layout of RMDemuxTaskPropertyID_PesEntry. TBD: Meaning of the fields is not verified. */
+struct DCCDemuxPesEntry {
+	RMuint32 Index; // 0x00
+	RMuint32 StreamID; // 0x04
+	RMuint32 SubStreamID; // 0x08
+	RMuint32 Input; // 0x0c
+	RMuint32 Enable; // 0x10
+	RMuint32 CipherMask; // 0x14
+	RMuint32 CipherIndex; // 0x18
+};
+
+/** Number of PID entries managed by DCCAddDemuxTaskPidOutputs(). TBD: Hardware limit is not verified. */
+#define DCC_DEMUX_MAX_PID_ENTRIES 32
+/** PID value selecting all packets of the transport stream. TBD: not verified. */
+#define DCC_DEMUX_PID_ALL 0x2000
+
+struct DCCDemuxPidEntry {
+	RMuint32 Index;
+	RMuint32 PID;
+	/** Bit mask of the DemuxOutput modules which receive the packets. */
+	RMuint32 OutputMask;
+	/** 1 to descramble the packets with the cipher CipherIndex, 0 for clear packets. */
+	RMuint32 CipherMask;
+	RMuint32 CipherIndex;
+};
+
+/** Number of cipher entries which can hold an even/odd key pair. */
+#define DCC_DEMUX_MAX_CIPHERS 16
+
+enum DCCDemuxKeyParity {
+	DCCDemuxKeyParity_Even = 0,
+	DCCDemuxKeyParity_Odd = 1,
+};
+
+/** TBD: Values of the AES modes are not verified. */
+enum DCCDemuxAESMode {
+	DCCDemuxAESMode_ECB = 0,
+	DCCDemuxAESMode_CBC = 1,
+};
+
+struct DCCDemuxAESKey {
+	enum DCCDemuxAESMode Mode;
+	RMuint8 Key[16];
+	RMuint8 IV[16];
+};
+
+/** Data delivered by a DemuxOutput. TBD: Values are not verified, the original software uses 7 for the video decoder. */
+enum DCCDemuxDataType {
+	DCCDemuxDataType_Section = 2,
+	DCCDemuxDataType_TS = 3,
+	DCCDemuxDataType_ES = 7,
+};
+
+struct DCCDemuxRecorderProfile {
+	/** DemuxOutput which delivers the data, must not be connected to a decoder. */
+	RMuint32 Output;
+	enum DCCDemuxDataType DataType;
+	/** Receive pool for the output. */
+	RMuint32 BufferCount;
+	RMuint32 log2BufferSize;
+};
+
+/** Metadata of a received buffer. */
+struct DCCDemuxReceiveInfo {
+	RMuint32 Size;
+	/** Time stamp of the first packet in 90 kHz, valid if TimestampValid is TRUE. */
+	RMuint64 Timestamp;
+	RMbool TimestampValid;
+	/** PID of the first packet. */
+	RMuint32 PID;
+};
+
+/** Number of section header bytes compared by a section filter. */
+#define DCC_SECTION_FILTER_LENGTH 8
+
+struct DCCSectionFilterProfile {
+	RMuint32 PID;
+	/** Index of the PID entry used for the filter, not used for PID 0. */
+	RMuint32 PidEntry;
+	/** DemuxOutput which delivers the sections, must not be connected to a decoder. */
+	RMuint32 Output;
+	RMuint8 Match[DCC_SECTION_FILTER_LENGTH];
+	RMuint8 Mask[DCC_SECTION_FILTER_LENGTH];
+	/** Receive pool for the output. */
+	RMuint32 BufferCount;
+	RMuint32 log2BufferSize;
+};
+
+struct DCCPacketizerProfile {
+	/** Decoder which receives the data. */
+	RMuint32 ModuleID;
+	/** Send pool opened for the decoder. */
+	struct RUABufferPool *pPool;
+	RMuint32 BufferSize;
+	/** Time base of the timestamps passed to DCCPacketizerStartUnit(). */
+	RMuint32 TimeBaseNum;
+	RMuint32 TimeBaseDen;
+	/** Time resolution of the decoder timer, see DCCSTCSetTimeResolution(). */
+	RMuint32 TimeResolution;
+	/**
+	 * Put several access units into one buffer, only the first one gets a
+	 * timestamp. Used for small units like audio frames.
+	 */
+	RMbool PackUnits;
+};
+
 enum AudioOutputChannels_type {
 	Audio_Out_Ch_C = 1,
 	Audio_Out_Ch_LR = 2,
@@ -262,12 +472,27 @@ RMstatus DCCOpenOSDVideoSource(struct DCC *pDCC, struct DCCOSDProfile *profile,
 RMstatus DCCGetOSDSurfaceInfo(struct DCC *pDCC, struct DCCVideoSource *pVideoSource, struct DCCOSDProfile *profile, RMuint32 *SurfaceAddr, RMuint32 *SurfaceSize);
 RMstatus DCCGetOSDPictureInfo(struct DCCVideoSource *pVideoSource, RMuint32 index, RMuint32 *PictureAddr,  RMuint32 *LumaAddr, RMuint32 *LumaSize, RMuint32 *ChromaAddr, RMuint32 *ChromaSize);
 RMstatus DCCGetOSDVideoSourceInfo(struct DCCVideoSource *pVideoSource, RMuint32 *LumaAddr, RMuint32 *LumaSize, RMuint32 *ChromaAddr, RMuint32 *ChromaSize);
+RMstatus DCCGetOSDPaletteInfo(struct DCCVideoSource *pVideoSource, RMuint32 index, RMuint32 *PaletteAddr, RMuint32 *PaletteSize);
+RMstatus DCCSetOSDPalette(struct DCCVideoSource *pVideoSource, RMuint32 index, RMuint32 *palette, RMuint32 first, RMuint32 count);
 RMstatus DCCClearOSDPicture(struct DCCVideoSource *pVideoSource, RMuint32 index);
 RMstatus DCCClearOSDVideoSource(struct DCCVideoSource *pVideoSource);
 RMstatus DCCInsertPictureInMultiplePictureOSDVideoSource(struct DCCVideoSource *pVideoSource, RMuint32 index, RMuint64 Pts);
 RMstatus DCCEnableVideoSource(struct DCCVideoSource *pVideoSource, RMbool enable);
+RMstatus DCCSetVideoSourceWindows(struct DCCVideoSource *pVideoSource, struct EMhwlibWindow *input, struct EMhwlibWindow *output);
 RMstatus DCCSetMemoryManager(struct DCC *pDCC, RMuint8 dram);
 
+RMstatus DCCOpenCursor(struct DCC *pDCC, struct DCCOSDProfile *profile, struct DCCCursor **ppCursor);
+RMstatus DCCCloseCursor(struct DCCCursor *pCursor);
+RMstatus DCCSetCursorImage(struct DCCCursor *pCursor, RMuint8 *image, RMuint32 size, RMuint32 *palette, RMuint32 palette_count, RMint32 hotspot_x, RMint32 hotspot_y);
+RMstatus DCCMoveCursor(struct DCCCursor *pCursor, RMint32 x, RMint32 y);
+RMstatus DCCEnableCursor(struct DCCCursor *pCursor, RMbool enable);
+
+RMstatus DCCOpenMosaic(struct DCC *pDCC, enum DCCSurface surface, RMuint32 window_count, struct DCCMosaic **ppMosaic);
+RMstatus DCCCloseMosaic(struct DCCMosaic *pMosaic);
+RMstatus DCCSetMosaicWindow(struct DCCMosaic *pMosaic, RMuint32 index, struct DCCVideoSource *pVideoSource, struct EMhwlibWindow *input, struct EMhwlibWindow *output, RMuint32 zorder);
+RMstatus DCCValidateMosaic(struct DCCMosaic *pMosaic);
+RMstatus DCCEnableMosaic(struct DCCMosaic *pMosaic, RMbool enable);
+
 RMstatus DCCSTCOpen(struct DCC *pDCC, struct DCCStcProfile *stc_profile, struct DCCSTCSource **ppStcSource);
 RMstatus DCCSTCClose(struct DCCSTCSource *pStcSource);
 RMstatus DCCSTCGetModuleId(struct DCCSTCSource *pStcSource, RMuint32 *stc_id);
@@ -280,12 +505,46 @@ RMstatus DCCSTCGetTime(struct DCCSTCSource *pStcSource, RMuint64 *ptime, RMuint3
 RMstatus DCCSTCPlay(struct DCCSTCSource *pStcSource);
 RMstatus DCCSTCStop(struct DCCSTCSource *pStcSource);
 
+RMstatus DCCSTCClockOpen(struct DCCSTCSource *pStcSource, RMuint32 time_resolution, RMuint32 resync_interval_ms, RMuint32 max_drift, struct DCCSTCClock **ppClock);
+RMstatus DCCSTCClockClose(struct DCCSTCClock *pClock);
+RMstatus DCCSTCClockResync(struct DCCSTCClock *pClock);
+RMstatus DCCSTCClockGetTime(struct DCCSTCClock *pClock, RMuint64 *ptime, RMuint32 time_resolution);
+
+RMstatus DCCClockRecoveryOpen(struct DCCSTCSource *pStcSource, struct DCCClockRecoveryProfile *profile, struct DCCClockRecovery **ppRecovery);
+RMstatus DCCClockRecoveryClose(struct DCCClockRecovery *pRecovery);
+RMstatus DCCClockRecoveryReset(struct DCCClockRecovery *pRecovery);
+RMstatus DCCClockRecoverySetSpeed(struct DCCClockRecovery *pRecovery, RMint32 numerator, RMuint32 denominator);
+RMstatus DCCClockRecoveryAddPCR(struct DCCClockRecovery *pRecovery, RMuint64 pcr, RMuint32 time_resolution, RMuint64 arrival_us);
+RMstatus DCCClockRecoveryUpdate(struct DCCClockRecovery *pRecovery, RMuint32 fullness);
+RMstatus DCCClockRecoveryGetTrim(struct DCCClockRecovery *pRecovery, RMint32 *ppm);
+
+RMstatus DCCTrickPlayOpen(struct RUA *pRua, struct DCCVideoSource *pVideoSource, struct RUABufferPool *pDMA, RMuint32 buffer_size, struct DCCTrickPlayEntry *index, RMuint32 count, RMuint32 time_resolution, DCCTrickPlayReadFunc *read, void *opaque, struct DCCTrickPlay **ppTrick);
+RMstatus DCCTrickPlayClose(struct DCCTrickPlay *pTrick);
+RMstatus DCCTrickPlayStart(struct DCCTrickPlay *pTrick, RMint32 speed, RMuint64 pts);
+RMstatus DCCTrickPlayFeed(struct DCCTrickPlay *pTrick);
+RMstatus DCCTrickPlayGetPosition(struct DCCTrickPlay *pTrick, RMuint64 *pts);
+RMstatus DCCTrickPlayStop(struct DCCTrickPlay *pTrick);
+
+RMstatus DCCSeekIndexOpen(RMuint32 time_resolution, struct DCCSeekIndex **ppIndex);
+RMstatus DCCSeekIndexClose(struct DCCSeekIndex *pIndex);
+RMstatus DCCSeekIndexAdd(struct DCCSeekIndex *pIndex, RMuint64 pts, RMuint64 offset, RMuint32 size);
+RMstatus DCCSeekIndexScanAnnexB(struct DCCSeekIndex *pIndex, const RMuint8 *data, RMuint32 size, RMuint64 frame_duration);
+RMstatus DCCSeekIndexScanEnd(struct DCCSeekIndex *pIndex);
+RMstatus DCCSeekIndexLoad(struct DCCSeekIndex *pIndex, const char *mediafile);
+RMstatus DCCSeekIndexSave(struct DCCSeekIndex *pIndex, const char *mediafile);
+RMstatus DCCSeekIndexFind(struct DCCSeekIndex *pIndex, RMuint64 pts, struct DCCTrickPlayEntry *entry);
+RMstatus DCCSeekIndexGetEntries(struct DCCSeekIndex *pIndex, struct DCCTrickPlayEntry **entries, RMuint32 *count);
+
+RMstatus DCCGetVideoDecoderSourceDRAMSize(struct DCC *pDCC, struct DCCXVideoProfile *dcc_profile, RMuint32 *size);
 RMstatus DCCXOpenVideoDecoderSource(struct DCC *pDCC, struct DCCXVideoProfile *dcc_profile, struct DCCVideoSource **ppVideoSource);
 RMstatus DCCCloseVideoSource(struct DCCVideoSource *pVideoSource);
 RMstatus DCCXSetVideoDecoderSourceCodec(struct DCCVideoSource *pVideoSource, enum EMhwlibVideoCodec Codec);
 RMstatus DCCGetVideoDecoderSourceInfo(struct DCCVideoSource *pVideoSource, RMuint32 *video_decoder, RMuint32 *spu_decoder, RMuint32 *timer);
 RMstatus DCCPlayVideoSource(struct DCCVideoSource *pVideoSource, enum DCCVideoPlayCommand cmd);
 RMstatus DCCStopVideoSource(struct DCCVideoSource *pVideoSource, enum DCCStopMode stop_mode);
+RMstatus DCCSetVideoSourceBitrate(struct DCCVideoSource *pVideoSource, RMuint32 bitrate);
+RMstatus DCCGetVideoFIFOLevel(struct DCCVideoSource *pVideoSource, RMuint32 time_resolution, struct DCCFIFOLevel *level);
+RMstatus DCCWaitVideoFIFOLevel(struct DCCVideoSource *pVideoSource, RMuint32 level, RMuint32 TimeOut_us);
 RMstatus DCCSetRouteDisplayAspectRatio(struct DCC *pDCC, enum DCCRoute route, RMuint8 ar_x, RMuint8 ar_y);
 
 RMstatus DCCOpenAudioDecoderSource(struct DCC *pDCC, struct DCCAudioProfile *dcc_profile, struct DCCAudioSource **ppAudioSource);
@@ -294,9 +553,14 @@ RMstatus DCCGetAudioDecoderSourceInfo(struct DCCAudioSource *pAudioSource, RMuin
 RMstatus DCCSetAudioAACFormat(struct DCCAudioSource *pAudioSource, struct AudioDecoder_AACParameters_type *pFormat);
 RMstatus DCCSetAudioSourceVolume(struct DCCAudioSource *pAudioSource, RMuint32 volume);
 RMstatus DCCPlayAudioSource(struct DCCAudioSource *pAudioSource);
+RMstatus DCCPlayMultipleAudioSource(struct DCCAudioSource **ppAudioSource, RMuint32 count);
+RMstatus DCCPlaySynchronized(struct DCCSTCSource *pStcSource, struct DCCVideoSource *pVideoSource, enum DCCVideoPlayCommand cmd, struct DCCAudioSource **ppAudioSource, RMuint32 audio_count);
 RMstatus DCCPauseAudioSource(struct DCCAudioSource *pAudioSource);
 RMstatus DCCStopAudioSource(struct DCCAudioSource *pAudioSource);
 RMstatus DCCSetAudioBtsThreshold(struct DCCAudioSource *pAudioSource, RMuint32 level);
+RMstatus DCCSetAudioSourceBitrate(struct DCCAudioSource *pAudioSource, RMuint32 bitrate);
+RMstatus DCCGetAudioFIFOLevel(struct DCCAudioSource *pAudioSource, RMuint32 time_resolution, struct DCCFIFOLevel *level);
+RMstatus DCCWaitAudioFIFOLevel(struct DCCAudioSource *pAudioSource, RMuint32 level, RMuint32 TimeOut_us);
 
 RMstatus DCCOpenDemuxTask(struct DCC *pDCC, struct DCCDemuxTaskProfile *dcc_profile, struct DCCDemuxTask **ppDemuxTask);
 RMstatus DCCCloseDemuxTask(struct DCCDemuxTask *pDemuxTask);
@@ -304,5 +568,42 @@ RMstatus DCCSetAudioMpegFormat(struct DCCAudioSource *pAudioSource, struct Audio
 RMstatus DCCPlayDemuxTask(struct DCCDemuxTask *pDemuxTask);
 RMstatus DCCStopDemuxTask(struct DCCDemuxTask *pDemuxTask);
 RMstatus DCCGetDemuxTaskInfo(struct DCCDemuxTask *pDemuxTask, RMuint32 *demux_task);
+RMstatus DCCSetDemuxTaskPesEntry(struct DCCDemuxTask *pDemuxTask, struct DCCDemuxPesEntry *entry);
+RMstatus DCCSetDemuxTaskPidEntry(struct DCCDemuxTask *pDemuxTask, struct DCCDemuxPidEntry *entry);
+RMstatus DCCFreeDemuxTaskPidEntry(struct DCCDemuxTask *pDemuxTask, RMuint32 index);
+RMstatus DCCAddDemuxTaskPidOutputs(struct DCCDemuxTask *pDemuxTask, RMuint32 pid, RMuint32 output_mask);
+RMstatus DCCRemoveDemuxTaskPidOutputs(struct DCCDemuxTask *pDemuxTask, RMuint32 pid, RMuint32 output_mask);
+RMstatus DCCAddDemuxTaskProgram(struct DCCDemuxTask *pDemuxTask, RMuint32 *pids, RMuint32 count, RMuint32 output_mask);
+RMstatus DCCRemoveDemuxTaskProgram(struct DCCDemuxTask *pDemuxTask, RMuint32 *pids, RMuint32 count, RMuint32 output_mask);
+RMstatus DCCAllocateDemuxTaskCipherEntry(struct DCCDemuxTask *pDemuxTask, RMuint32 *cipher);
+RMstatus DCCFreeDemuxTaskCipherEntry(struct DCCDemuxTask *pDemuxTask, RMuint32 cipher);
+RMstatus DCCAllocateDemuxTaskKeyEntry(struct DCCDemuxTask *pDemuxTask, RMuint32 *key);
+RMstatus DCCFreeDemuxTaskKeyEntry(struct DCCDemuxTask *pDemuxTask, RMuint32 key);
+RMstatus DCCSetDemuxTaskAESKey(struct DCCDemuxTask *pDemuxTask, RMuint32 key, struct DCCDemuxAESKey *aes);
+RMstatus DCCSetDemuxTaskInbandKeyChange(struct DCCDemuxTask *pDemuxTask, RMuint32 cipher, RMuint32 even_key, RMuint32 odd_key);
+RMstatus DCCSetDemuxTaskOutbandKeyChange(struct DCCDemuxTask *pDemuxTask, RMuint32 cipher, RMuint32 key);
+RMstatus DCCRotateDemuxTaskAESKey(struct DCCDemuxTask *pDemuxTask, RMuint32 cipher, enum DCCDemuxKeyParity parity, struct DCCDemuxAESKey *aes);
+RMstatus DCCConnectDemuxOutputToVideoSource(struct DCCDemuxTask *pDemuxTask, RMuint32 output, struct DCCVideoSource *pVideoSource);
+RMstatus DCCConnectDemuxOutputToAudioSource(struct DCCDemuxTask *pDemuxTask, RMuint32 output, struct DCCAudioSource *pAudioSource);
+RMstatus DCCDisconnectDemuxOutput(struct DCCDemuxTask *pDemuxTask, RMuint32 output);
+
+RMstatus DCCOpenSectionFilter(struct RUA *pRua, struct DCCDemuxTask *pDemuxTask, struct DCCSectionFilterProfile *profile, struct DCCSectionFilter **ppFilter);
+RMstatus DCCCloseSectionFilter(struct DCCSectionFilter *pFilter);
+RMstatus DCCSectionFilterRead(struct DCCSectionFilter *pFilter, RMuint8 **section, RMuint32 *size, RMuint32 TimeOut_us);
+
+RMstatus DCCOpenDemuxRecorder(struct RUA *pRua, struct DCCDemuxTask *pDemuxTask, struct DCCDemuxRecorderProfile *profile, struct DCCDemuxRecorder **ppRecorder);
+RMstatus DCCCloseDemuxRecorder(struct DCCDemuxRecorder *pRecorder);
+RMstatus DCCDemuxRecorderReceive(struct DCCDemuxRecorder *pRecorder, RMuint8 **data, struct DCCDemuxReceiveInfo *info, RMuint32 TimeOut_us);
+RMstatus DCCDemuxRecorderRelease(struct DCCDemuxRecorder *pRecorder, RMuint8 *data);
+RMstatus DCCDemuxRecorderWrite(struct DCCDemuxRecorder *pRecorder, int fd, RMuint32 TimeOut_us, struct DCCDemuxReceiveInfo *info);
+
+RMstatus DCCOpenPacketizer(struct RUA *pRua, struct DCCPacketizerProfile *profile, struct DCCPacketizer **ppPacketizer);
+RMstatus DCCClosePacketizer(struct DCCPacketizer *pPacketizer);
+RMstatus DCCPacketizerStartUnit(struct DCCPacketizer *pPacketizer, RMbool pts_valid, RMint64 pts);
+RMstatus DCCPacketizerWrite(struct DCCPacketizer *pPacketizer, const RMuint8 *data, RMuint32 size, RMuint32 *written);
+RMstatus DCCPacketizerGetBuffer(struct DCCPacketizer *pPacketizer, RMuint8 **data, RMuint32 *size);
+RMstatus DCCPacketizerCommit(struct DCCPacketizer *pPacketizer, RMuint32 size);
+RMstatus DCCPacketizerFlush(struct DCCPacketizer *pPacketizer);
+RMstatus DCCPacketizerReset(struct DCCPacketizer *pPacketizer);
 
 #endif
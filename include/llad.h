@@ -40,6 +40,7 @@ RMuint32 dmapool_get_id(struct dmapool *h);
 void dmapool_get_info(struct dmapool *h, RMuint32 *size);
 RMuint8 *dmapool_get_buffer(struct dmapool *h, RMuint32 *timeout_microsecond);
 RMuint32 dmapool_get_physical_address(struct dmapool *h, RMuint8 *ptr, RMuint32 size);
+RMuint8 *dmapool_get_virtual_address(struct dmapool *h, RMuint32 physical_address);
 RMstatus dmapool_release(struct dmapool *h, RMuint32 physical_address);
 RMstatus dmapool_acquire(struct dmapool *h, RMuint32 physical_address);
 void dmapool_flush_cache(struct dmapool *h, RMuint32 physical_address, RMuint32 size);
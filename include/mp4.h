@@ -0,0 +1,131 @@
+#ifndef _MP4_H_
+#define _MP4_H_
+
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+#include "rua_common.h"
+
+/** Maximum number of tracks handled in a file. */
+#define MP4_MAX_TRACKS 8
+
+#define MP4_FOURCC(a, b, c, d) ((((RMuint32) (a)) << 24) | (((RMuint32) (b)) << 16) | (((RMuint32) (c)) << 8) | ((RMuint32) (d)))
+
+/** Maximum size of SPS and PPS in byte stream format. */
+#define MP4_MAX_AVC_PARAMETER_SETS_SIZE 1024
+
+/** Size of the ADTS header without CRC. */
+#define MP4_ADTS_HEADER_SIZE 7
+
+struct MP4Reader;
+
+/** Read size bytes at offset, returns RM_ERRORENDOFFILE when the file is shorter. */
+typedef RMstatus MP4ReadFunc(void *opaque, RMuint64 offset, RMuint8 *buffer, RMuint32 size);
+
+/** Where MP4OpenSource() reads the file from, e.g. a network stream. */
+struct MP4Source {
+	void *opaque;
+	MP4ReadFunc *Read;
+	/** Size of the file. */
+	RMuint64 Size;
+};
+
+enum MP4TrackType {
+	MP4TrackType_Other = 0,
+	MP4TrackType_Video = 1,
+	MP4TrackType_Audio = 2,
+};
+
+struct MP4TrackInfo {
+	RMuint32 TrackID;
+	enum MP4TrackType Type;
+	/** Type of the sample entry, e.g. MP4_FOURCC('a', 'v', 'c', '1'). */
+	RMuint32 Codec;
+	/** Ticks per second of the timestamps. */
+	RMuint32 TimeScale;
+	RMuint64 Duration;
+	RMuint32 SampleCount;
+	/** Average bits per second of the samples, 0 if unknown. */
+	RMuint32 Bitrate;
+	RMuint32 Width;
+	RMuint32 Height;
+	RMuint32 SampleRate;
+	RMuint32 ChannelCount;
+	/** objectTypeIndication of the esds box, e.g. 0x40 for AAC. */
+	RMuint32 ObjectType;
+	/** Payload of avcC or the DecoderSpecificInfo of esds, valid until MP4Close(). */
+	const RMuint8 *DecoderConfig;
+	RMuint32 DecoderConfigSize;
+};
+
+struct MP4Sample {
+	/** Index of the track. */
+	RMuint32 Track;
+	/** Position of the sample data in the file. */
+	RMuint64 Offset;
+	RMuint32 Size;
+	/** Timestamps in the TimeScale of the track. */
+	RMint64 PTS;
+	RMint64 DTS;
+	RMuint32 Duration;
+	RMbool KeyFrame;
+};
+
+struct MP4AVCConfig {
+	/** Size of the NAL unit length fields in the samples. */
+	RMuint32 LengthSize;
+	/** SPS and PPS with start codes. */
+	RMuint8 ParameterSets[MP4_MAX_AVC_PARAMETER_SETS_SIZE];
+	RMuint32 ParameterSetsSize;
+};
+
+/** State of a sample which is converted in pieces, e.g. while it is read into DMA buffers. */
+struct MP4AVCConversion {
+	/** Bytes of the sample which are not converted yet. */
+	RMuint32 SampleLeft;
+	/** Bytes of the current NAL unit which follow, 0 while in a length field. */
+	RMuint32 NALLeft;
+	/** Bytes of the length field which were converted already. */
+	RMuint32 LengthPos;
+	RMuint32 Length;
+};
+
+struct MP4AACConfig {
+	/** Audio object type of the AAC core, 2 is AAC LC. */
+	RMuint32 ObjectType;
+	RMuint32 SamplingIndex;
+	RMuint32 ChannelConfig;
+};
+
+RMstatus MP4Open(const char *filename, struct MP4Reader **ppReader);
+RMstatus MP4OpenSource(struct MP4Source *source, struct MP4Reader **ppReader);
+RMstatus MP4Close(struct MP4Reader *pReader);
+RMuint32 MP4GetTrackCount(struct MP4Reader *pReader);
+RMstatus MP4GetTrackInfo(struct MP4Reader *pReader, RMuint32 track, struct MP4TrackInfo *info);
+RMstatus MP4SetTrackEnabled(struct MP4Reader *pReader, RMuint32 track, RMbool enabled);
+RMstatus MP4NextSample(struct MP4Reader *pReader, struct MP4Sample *sample);
+RMstatus MP4Seek(struct MP4Reader *pReader, RMuint64 time, RMuint32 time_resolution);
+RMstatus MP4Read(struct MP4Reader *pReader, RMuint64 offset, RMuint8 *buffer, RMuint32 size);
+
+RMstatus MP4ParseAVCConfig(const RMuint8 *avcc, RMuint32 size, struct MP4AVCConfig *config);
+RMstatus MP4ConvertAVCSample(const struct MP4AVCConfig *config, RMuint8 *data, RMuint32 size, RMbool *needs_parameter_sets);
+RMstatus MP4StartAVCConversion(const struct MP4AVCConfig *config, RMuint32 size, struct MP4AVCConversion *conversion);
+RMstatus MP4ConvertAVCData(const struct MP4AVCConfig *config, struct MP4AVCConversion *conversion, RMuint8 *data, RMuint32 size);
+RMstatus MP4ParseAACConfig(const RMuint8 *asc, RMuint32 size, struct MP4AACConfig *config);
+RMstatus MP4MakeADTSHeader(const struct MP4AACConfig *config, RMuint32 size, RMuint8 *header);
+
+#endif
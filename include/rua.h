@@ -68,6 +68,7 @@ RMstatus RUASetAddressID(struct RUA *pRua, RMuint32 address, RMuint32 ID);
 RMuint32 RUAGetAddressID(struct RUA *pRua, RMuint32 ID);
 RMstatus RUAGetBuffer(struct RUABufferPool *pBufferPool, RMuint8 **ppBuffer, RMuint32 TimeOut_us);
 RMstatus RUASendData(struct RUA *pRua, RMuint32 ModuleID, struct RUABufferPool *pBufferPool, RMuint8 *pData, RMuint32 DataSize, void *pInfo, RMuint32 InfoSize);
+RMstatus RUAReceiveData(struct RUA *pRua, RMuint32 ModuleID, struct RUABufferPool *pBufferPool, RMuint8 **ppData, RMuint32 *pDataSize, void *pInfo, RMuint32 *pInfoSize);
 RMstatus RUAReleaseBuffer(struct RUABufferPool *pBufferPool, RMuint8 *pBuffer);
 RMuint32 RUAGetAvailableBufferCount(struct RUABufferPool *pBufferPool);
 
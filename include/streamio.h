@@ -0,0 +1,95 @@
+#ifndef _STREAMIO_H_
+#define _STREAMIO_H_
+
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+#include "rua_common.h"
+
+struct StreamIO;
+struct StreamIOMap;
+
+/** Read up to size bytes, returns the number of bytes, 0 at the end or a negative value on error. */
+typedef RMint32 StreamIOReadFunc(void *opaque, RMuint8 *buffer, RMuint32 size);
+/** Set the position of the next read. */
+typedef RMstatus StreamIOSeekFunc(void *opaque, RMuint64 offset);
+/** Release the source, called by StreamIOClose(). */
+typedef void StreamIOCloseFunc(void *opaque);
+/** Tell the source how much of the read-ahead window is filled, called before each read. */
+typedef void StreamIOLevelFunc(void *opaque, RMuint64 buffered, RMuint64 window);
+
+/** Where the reader thread gets the data from. */
+struct StreamIOSource {
+	void *opaque;
+	StreamIOReadFunc *Read;
+	/** NULL if the source can't seek. */
+	StreamIOSeekFunc *Seek;
+	StreamIOCloseFunc *Close;
+	/** NULL if the source doesn't depend on the buffer level. */
+	StreamIOLevelFunc *Level;
+	/** Size of the stream, 0 if unknown. */
+	RMuint64 Size;
+};
+
+struct StreamIOProfile {
+	/** Size of each buffer in the ring, one read of the source fills one buffer. */
+	RMuint32 BufferSize;
+	/** Number of buffers, BufferSize * BufferCount is the read-ahead window. */
+	RMuint32 BufferCount;
+};
+
+struct StreamIOHTTPProfile {
+	/** Size of each range request, 0 for the default. */
+	RMuint32 ChunkSize;
+	/** Maximum number of persistent connections which fetch ranges in parallel. */
+	RMuint32 Connections;
+	/** Time without data after which a request is sent again, 0 for the default. */
+	RMuint32 Timeout_ms;
+};
+
+struct StreamIOStatistics {
+	/** Bytes read from the source. */
+	RMuint64 BytesRead;
+	/** Bytes read ahead and not yet consumed. */
+	RMuint64 BytesBuffered;
+	/** Number of times StreamIORead() had to wait for the reader thread, the initial fill is not counted. */
+	RMuint32 Stalls;
+	/** Time spent waiting in StreamIORead(). */
+	RMuint64 StallTime_us;
+	RMuint64 MaxStallTime_us;
+	/** Number of seeks which were outside of the buffered data. */
+	RMuint32 Seeks;
+};
+
+RMstatus StreamIOOpen(struct StreamIOSource *source, struct StreamIOProfile *profile, struct StreamIO **ppStream);
+RMstatus StreamIOOpenFile(const char *filename, struct StreamIOProfile *profile, struct StreamIO **ppStream);
+RMstatus StreamIOOpenHTTP(const char *url, struct StreamIOHTTPProfile *http, struct StreamIOProfile *profile, struct StreamIO **ppStream);
+RMstatus StreamIOClose(struct StreamIO *pStream);
+RMstatus StreamIORead(struct StreamIO *pStream, RMuint8 *buffer, RMuint32 size, RMuint32 *read);
+RMstatus StreamIOSeek(struct StreamIO *pStream, RMuint64 offset);
+RMuint64 StreamIOTell(struct StreamIO *pStream);
+RMuint64 StreamIOGetSize(struct StreamIO *pStream);
+RMstatus StreamIOGetStatistics(struct StreamIO *pStream, struct StreamIOStatistics *stats);
+
+RMstatus StreamIOHTTPOpen(const char *url, struct StreamIOHTTPProfile *http, struct StreamIOSource *source);
+
+RMstatus StreamIOMapOpen(const char *filename, RMuint32 window_size, struct StreamIOMap **ppMap);
+RMstatus StreamIOMapClose(struct StreamIOMap *pMap);
+RMuint64 StreamIOMapGetSize(struct StreamIOMap *pMap);
+RMstatus StreamIOMapGet(struct StreamIOMap *pMap, RMuint64 offset, RMuint32 size, RMuint8 **data);
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef _TSDEMUX_H_
+#define _TSDEMUX_H_
+
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+#include "rua.h"
+
+/** Maximum number of elementary streams sent to decoders. */
+#define TSDEMUX_MAX_STREAMS 8
+/** Maximum number of programs in the PAT. */
+#define TSDEMUX_MAX_PROGRAMS 16
+/** Maximum number of elementary streams in a PMT. */
+#define TSDEMUX_MAX_PROGRAM_STREAMS 16
+/** Bytes needed by TSDemuxProbe() and the first TSDemuxFeed() to detect the packet size. */
+#define TSDEMUX_PROBE_SIZE (3 * 192)
+
+struct TSDemux;
+
+struct TSDemuxStreamInfo {
+	/** stream_type from the PMT, e.g. 0x02 for MPEG-2 video. */
+	RMuint32 StreamType;
+	RMuint32 PID;
+};
+
+struct TSDemuxProgram {
+	RMuint32 ProgramNumber;
+	RMuint32 PmtPID;
+	RMuint32 PcrPID;
+	RMuint32 StreamCount;
+	struct TSDemuxStreamInfo Streams[TSDEMUX_MAX_PROGRAM_STREAMS];
+};
+
+/** Where the payload of an elementary stream is sent to. */
+struct TSDemuxOutput {
+	struct RUA *pRua;
+	/** Decoder module. */
+	RMuint32 ModuleID;
+	/** Send pool opened on the decoder. */
+	struct RUABufferPool *pPool;
+	/** Size of the buffers in pPool. */
+	RMuint32 BufferSize;
+};
+
+/** Time stamps of a PES header of a stream added with TSDemuxAddStream(), in 90 kHz. */
+struct TSDemuxPESInfo {
+	RMuint32 PID;
+	RMbool PTSValid;
+	RMuint64 PTS;
+	/** Only set when the DTS differs from the PTS, e.g. for reordered video frames. */
+	RMbool DTSValid;
+	RMuint64 DTS;
+};
+
+/** Called when a PMT was received or changed. */
+typedef void TSDemuxProgramFunc(void *opaque, struct TSDemuxProgram *program);
+/** Called for each PCR, pcr is in 27 MHz. */
+typedef void TSDemuxPCRFunc(void *opaque, RMuint32 pid, RMuint64 pcr);
+/** Called for each PES header with a time stamp. */
+typedef void TSDemuxPESFunc(void *opaque, struct TSDemuxPESInfo *info);
+
+RMbool TSDemuxProbe(const RMuint8 *data, RMuint32 size, RMuint32 *packet_size);
+RMstatus TSDemuxOpen(struct TSDemux **ppDemux);
+RMstatus TSDemuxClose(struct TSDemux *pDemux);
+RMstatus TSDemuxSetCallbacks(struct TSDemux *pDemux, TSDemuxProgramFunc *program, TSDemuxPCRFunc *pcr, void *opaque);
+RMstatus TSDemuxSetPESCallback(struct TSDemux *pDemux, TSDemuxPESFunc *pes);
+RMstatus TSDemuxAddStream(struct TSDemux *pDemux, RMuint32 pid, struct TSDemuxOutput *output);
+RMstatus TSDemuxRemoveStream(struct TSDemux *pDemux, RMuint32 pid);
+RMstatus TSDemuxFeed(struct TSDemux *pDemux, const RMuint8 *data, RMuint32 size, RMuint32 *consumed);
+RMstatus TSDemuxFlush(struct TSDemux *pDemux);
+
+#endif
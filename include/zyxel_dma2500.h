@@ -68,6 +68,8 @@ typedef enum {
 	RMVideoDecoderPropertyID_OpenX = 4135,
 	RMVideoDecoderPropertyID_CodecX = 4136,
 	RMVideoDecoderPropertyID_BtsFIFO = 4137,
+	/* TBD: Guessed as the ID after BtsFIFO, not verified with the firmware. */
+	RMVideoDecoderPropertyID_PtsFIFO = 4138,
 	RMVideoDecoderPropertyID_CommandStatus = 4140,
 	RMGenericPropertyID_ReadBufferCompletion = 4148,
 
@@ -82,6 +84,10 @@ typedef enum {
 	RMAudioDecoderPropertyID_State = 4194,
 	RMAudioDecoderPropertyID_Codec = 4196,
 	RMAudioDecoderPropertyID_AudioBtsThreshold = 4197,
+	/* TBD: Guessed as the ID after AudioBtsThreshold, not verified with the firmware. */
+	RMAudioDecoderPropertyID_BtsFIFO = 4198,
+	/* TBD: Guessed as the ID after BtsFIFO, not verified with the firmware. */
+	RMAudioDecoderPropertyID_PtsFIFO = 4199,
 	RMAudioDecoderPropertyID_AACParameters = 4201,
 	RMAudioDecoderPropertyID_MpegParameters = 4212,
 
@@ -137,6 +143,7 @@ typedef enum {
 	RMDemuxTaskPropertyID_PcrDiscontinuity = 4494,
 	RMDemuxTaskPropertyID_AllocateCipherEntry = 4496,
 	RMDemuxTaskPropertyID_FreeCipherEntry = 4497,
+	/* TBD: Layouts of the key properties are guessed. */
 	RMDemuxTaskPropertyID_OutbandKeyChange = 4506,
 	RMDemuxTaskPropertyID_AllocateKeyEntry = 4508,
 	RMDemuxTaskPropertyID_FreeKeyEntry = 4509,
@@ -172,6 +179,10 @@ typedef enum {
 	RMGenericPropertyID_Validate = 6018,
 	RMGenericPropertyID_Surface = 6019,
 	RMGenericPropertyID_PersistentSurface = 6021,
+	/* TBD: Guessed from the order of the generic properties, not verified with the firmware. */
+	RMGenericPropertyID_ScalerInputWindow = 6022,
+	/* TBD: Guessed from the order of the generic properties, not verified with the firmware. */
+	RMGenericPropertyID_ScalerOutputWindow = 6023,
 	RMGenericPropertyID_Stop = 6042,
 	RMGenericPropertyID_Flush = 6043,
 	RMGenericPropertyID_Step = 6044,
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * Clock recovery for live streams.
+ *
+ * The STC speed is trimmed by a few ppm, so that the decoder consumes the
+ * stream as fast as the encoder produces it. Two inputs are used:
+ * - PCRs (or other stream time stamps) with their arrival time give the
+ *   drift of the encoder clock against the local clock (feed forward).
+ * - A PI controller on the FIFO fullness removes the remaining error and
+ *   holds the FIFO at the target level.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rua.h"
+#include "dcc.h"
+#include "dcc_internal.h"
+
+/** Print debug message. */
+#if 0
+#define DPRINTF(args...) printf(args)
+#else
+#define DPRINTF(args...) do { } while(0)
+#endif
+
+/** The trim is calculated in milli ppm. */
+#define MPPM_PER_PPM 1000LL
+/** Denominator for the speed trim. */
+#define PPM_DENOMINATOR 1000000
+/** Minimum time between first and last PCR to estimate the drift. */
+#define DRIFT_MIN_WINDOW_US 10000000ULL
+/** Time after which the PCR reference is restarted. */
+#define DRIFT_MAX_WINDOW_US 600000000ULL
+/** PCR jumps larger than this are handled as discontinuity. */
+#define PCR_MAX_JUMP_US 1000000LL
+
+struct DCCClockRecovery {
+	struct DCCSTCSource *pStcSource;
+	struct DCCClockRecoveryProfile profile;
+
+	/** Speed without trim, e.g. set by the user for fast forward. */
+	RMint32 speed_numerator;
+	RMuint32 speed_denominator;
+
+	/** Trim currently set in the STC. */
+	RMint32 applied_ppm;
+	/** Integral part of the PI controller. */
+	RMint64 integral_mppm;
+	/** Time of the last DCCClockRecoveryUpdate(). */
+	RMuint64 last_update_us;
+
+	/** First PCR of the drift measurement. */
+	RMbool pcr_valid;
+	RMuint64 first_pcr_us;
+	RMuint64 first_arrival_us;
+	/** Last PCR to detect discontinuities. */
+	RMuint64 last_pcr_us;
+	RMuint64 last_arrival_us;
+	/** Estimated drift of the encoder clock. */
+	RMbool drift_valid;
+	RMint64 drift_mppm;
+};
+
+static RMint64 clamp_mppm(RMint64 value, RMuint32 max_ppm)
+{
+	RMint64 max = max_ppm * MPPM_PER_PPM;
+
+	if (value > max) {
+		return max;
+	}
+	if (value < -max) {
+		return -max;
+	}
+	return value;
+}
+
+static RMstatus apply_trim(struct DCCClockRecovery *pRecovery, RMint32 ppm)
+{
+	RMstatus rv;
+
+	rv = DCCSTCSetSpeed(pRecovery->pStcSource,
+		pRecovery->speed_numerator * (PPM_DENOMINATOR + ppm),
+		pRecovery->speed_denominator * PPM_DENOMINATOR);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	DPRINTF("Clock recovery trim %d ppm\n", ppm);
+	pRecovery->applied_ppm = ppm;
+	return RM_OK;
+}
+
+RMstatus DCCClockRecoveryOpen(struct DCCSTCSource *pStcSource, struct DCCClockRecoveryProfile *profile, struct DCCClockRecovery **ppRecovery)
+{
+	struct DCCClockRecovery *pRecovery;
+
+	if ((pStcSource == NULL) || (profile == NULL) || (ppRecovery == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if ((profile->target_fullness == 0) || (profile->max_ppm >= PPM_DENOMINATOR)) {
+		return RM_INVALID_PARAMETER;
+	}
+
+	pRecovery = malloc(sizeof(*pRecovery));
+	if (pRecovery == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pRecovery, 0, sizeof(*pRecovery));
+	pRecovery->pStcSource = pStcSource;
+	pRecovery->profile = *profile;
+	pRecovery->speed_numerator = 1;
+	pRecovery->speed_denominator = 1;
+
+	*ppRecovery = pRecovery;
+	return RM_OK;
+}
+
+RMstatus DCCClockRecoveryClose(struct DCCClockRecovery *pRecovery)
+{
+	if (pRecovery == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	free(pRecovery);
+	return RM_OK;
+}
+
+/** Forget all measurements, e.g. after a channel change, and remove the trim. */
+RMstatus DCCClockRecoveryReset(struct DCCClockRecovery *pRecovery)
+{
+	if (pRecovery == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	pRecovery->integral_mppm = 0;
+	pRecovery->last_update_us = 0;
+	pRecovery->pcr_valid = FALSE;
+	pRecovery->drift_valid = FALSE;
+	pRecovery->drift_mppm = 0;
+
+	return apply_trim(pRecovery, 0);
+}
+
+/** Set the speed requested by the user, the trim is applied on top of it. */
+RMstatus DCCClockRecoverySetSpeed(struct DCCClockRecovery *pRecovery, RMint32 numerator, RMuint32 denominator)
+{
+	if (pRecovery == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if ((denominator == 0) || (denominator > (0xFFFFFFFFU / PPM_DENOMINATOR))) {
+		return RM_INVALID_PARAMETER;
+	}
+	pRecovery->speed_numerator = numerator;
+	pRecovery->speed_denominator = denominator;
+
+	return apply_trim(pRecovery, pRecovery->applied_ppm);
+}
+
+/**
+ * Add a PCR or other stream time stamp.
+ *
+ * @param pcr Stream time in units of time_resolution.
+ * @param arrival_us CLOCK_MONOTONIC time when the data arrived, 0 for now.
+ */
+RMstatus DCCClockRecoveryAddPCR(struct DCCClockRecovery *pRecovery, RMuint64 pcr, RMuint32 time_resolution, RMuint64 arrival_us)
+{
+	RMuint64 pcr_us;
+	RMint64 elapsed_local;
+	RMint64 elapsed_stream;
+	RMint64 jump;
+	RMint64 drift;
+
+	if (pRecovery == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (time_resolution == 0) {
+		return RM_INVALID_PARAMETER;
+	}
+	if (arrival_us == 0) {
+		arrival_us = DCCGetMonotonicUs();
+	}
+	pcr_us = pcr * 1000000ULL / time_resolution;
+
+	if (pRecovery->pcr_valid) {
+		/* Compare the PCR progress with the local time to detect jumps. */
+		jump = ((RMint64) (pcr_us - pRecovery->last_pcr_us)) - ((RMint64) (arrival_us - pRecovery->last_arrival_us));
+		if ((pcr_us < pRecovery->last_pcr_us) || (jump > PCR_MAX_JUMP_US) || (jump < -PCR_MAX_JUMP_US)) {
+			DPRINTF("Clock recovery PCR discontinuity\n");
+			pRecovery->pcr_valid = FALSE;
+		} else if ((arrival_us - pRecovery->first_arrival_us) > DRIFT_MAX_WINDOW_US) {
+			/* Restart measurement, so that a changing drift is followed. */
+			pRecovery->pcr_valid = FALSE;
+		}
+	}
+	pRecovery->last_pcr_us = pcr_us;
+	pRecovery->last_arrival_us = arrival_us;
+	if (!pRecovery->pcr_valid) {
+		pRecovery->first_pcr_us = pcr_us;
+		pRecovery->first_arrival_us = arrival_us;
+		pRecovery->pcr_valid = TRUE;
+		return RM_OK;
+	}
+
+	elapsed_local = arrival_us - pRecovery->first_arrival_us;
+	if (elapsed_local < (RMint64) DRIFT_MIN_WINDOW_US) {
+		return RM_OK;
+	}
+	elapsed_stream = pcr_us - pRecovery->first_pcr_us;
+
+	/* Positive when the encoder clock is faster than the local clock. */
+	drift = (elapsed_stream - elapsed_local) * (PPM_DENOMINATOR * MPPM_PER_PPM) / elapsed_local;
+	drift = clamp_mppm(drift, pRecovery->profile.max_ppm);
+	if (pRecovery->drift_valid) {
+		/* Low pass to suppress network jitter. */
+		pRecovery->drift_mppm = (pRecovery->drift_mppm * 7 + drift) / 8;
+	} else {
+		pRecovery->drift_mppm = drift;
+		pRecovery->drift_valid = TRUE;
+	}
+	return RM_OK;
+}
+
+/**
+ * Run the controller with the current FIFO fullness and update the STC speed.
+ * Should be called regularly, e.g. every 100 ms.
+ */
+RMstatus DCCClockRecoveryUpdate(struct DCCClockRecovery *pRecovery, RMuint32 fullness)
+{
+	struct DCCClockRecoveryProfile *profile;
+	RMuint64 now;
+	RMint64 error;
+	RMint64 total;
+	RMint32 ppm;
+	RMint32 diff;
+
+	if (pRecovery == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	profile = &pRecovery->profile;
+	now = DCCGetMonotonicUs();
+
+	/* Error in per mille of the target, positive when the FIFO is too full. */
+	error = (((RMint64) fullness) - profile->target_fullness) * 1000 / profile->target_fullness;
+
+	if (pRecovery->last_update_us != 0) {
+		RMint64 dt = now - pRecovery->last_update_us;
+
+		pRecovery->integral_mppm += ((RMint64) profile->ki) * error * dt / 1000000;
+		pRecovery->integral_mppm = clamp_mppm(pRecovery->integral_mppm, profile->max_ppm);
+	}
+	pRecovery->last_update_us = now;
+
+	total = pRecovery->drift_mppm + ((RMint64) profile->kp) * error + pRecovery->integral_mppm;
+	total = clamp_mppm(total, profile->max_ppm);
+	ppm = total / MPPM_PER_PPM;
+
+	diff = ppm - pRecovery->applied_ppm;
+	if (diff < 0) {
+		diff = -diff;
+	}
+	if ((diff == 0) || (((RMuint32) diff) < profile->min_step_ppm)) {
+		/* Avoid changing the STC for tiny corrections. */
+		return RM_OK;
+	}
+	return apply_trim(pRecovery, ppm);
+}
+
+RMstatus DCCClockRecoveryGetTrim(struct DCCClockRecovery *pRecovery, RMint32 *ppm)
+{
+	if ((pRecovery == NULL) || (ppm == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	*ppm = pRecovery->applied_ppm;
+	return RM_OK;
+}
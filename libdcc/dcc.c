@@ -15,11 +15,14 @@
  *      License along with this library.
  */
 
+#define _GNU_SOURCE
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <time.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -27,6 +30,7 @@
 
 #include "rua.h"
 #include "dcc.h"
+#include "dcc_internal.h"
 
 /** Print debug message. */
 #if 0
@@ -82,11 +86,76 @@ struct DCCVideoSource {
 	RMuint32 STCID; // 0x54
 	RMuint32 surface; // 0x58
 	struct SPUDecoderSource *spu_decoder; // 0x6c
+	RMuint32 colormode;
+	RMuint32 colorformat;
+	RMuint32 width;
+	RMuint32 height;
+	struct EMhwlibWindow input_window;
+	struct EMhwlibWindow output_window;
+	/** True after the windows were configured, only then the scaler window properties are written. */
+	RMbool windows_set;
+	/** Bits per second, used to estimate the play time of the FIFO. */
+	RMuint32 bitrate;
+};
+
+struct DCCCursor {
+	struct DCC *pDCC;
+	struct DCCVideoSource *pVideoSource;
+	RMuint32 scalermoduleid;
+	RMint32 hotspot_x;
+	RMint32 hotspot_y;
+};
+
+struct DCCMosaicWindow {
+	struct DCCVideoSource *pVideoSource;
+	struct EMhwlibWindow input;
+	struct EMhwlibWindow output;
+	RMuint32 zorder;
+};
+
+struct DCCMosaic {
+	struct DCC *pDCC;
+	RMuint32 scalermoduleid;
+	RMuint32 mixermoduleid;
+	RMuint32 window_count;
+	struct DCCMosaicWindow *windows;
 };
 
 struct DCCSTCSource {
 	struct RUA *pRua;
 	RMuint32 StcModuleId;
+	/** Speed set by DCCSTCSetSpeed(). */
+	RMint32 speed_numerator;
+	RMuint32 speed_denominator;
+	/** True after DCCSTCPlay(). */
+	RMbool running;
+	/** Incremented whenever the time base is changed by the caller. */
+	RMuint32 generation;
+};
+
+/** Minimum time between two hardware samples of a DCCSTCClock. */
+#define STC_CLOCK_MIN_RESYNC_US 10000
+
+struct DCCSTCClock {
+	struct DCCSTCSource *pStcSource;
+	/** Resolution of the sampled STC value. */
+	RMuint32 time_resolution;
+	/** Configured time between hardware samples. */
+	RMuint64 resync_interval_us;
+	/** Current time between hardware samples, shortened when drifting. */
+	RMuint64 interval_us;
+	/** Allowed difference between interpolated and hardware time. */
+	RMuint32 max_drift;
+	/** Generation of pStcSource when sampled. */
+	RMuint32 generation;
+	RMbool valid;
+	/** Last hardware sample. */
+	RMuint64 stc_time;
+	/** CLOCK_MONOTONIC when stc_time was sampled. */
+	RMuint64 sample_us;
+	RMint32 speed_numerator;
+	RMuint32 speed_denominator;
+	RMbool running;
 };
 
 struct DCCResource {
@@ -113,8 +182,62 @@ struct DCCAudioSource {
 	RMuint32 reserved1C; // 0x1c
 	RMuint32 mem1; // 0x20
 	RMuint32 mem2; // 0x2c
+	/** Bits per second, used to estimate the play time of the FIFO. */
+	RMuint32 bitrate;
+};
+
+struct DemuxPidEntryState {
+	RMbool used;
+	RMuint32 pid;
+	/** Bit mask of the DemuxOutput modules. */
+	RMuint32 outputs;
 };
 
+struct DemuxCipherKeys {
+	RMbool valid;
+	RMuint32 key[2];
+};
+
+struct DCCDemuxTask {
+	struct RUA *pRua;
+	struct DCC *pDCC;
+	RMuint32 demuxtaskmoduleid;
+	RMbool opened;
+	RMuint32 mem1;
+	RMuint32 mem2;
+	/** Decoder connected to each DemuxOutput, 0 when not connected. */
+	RMuint32 outputs[DCC_DEMUX_MAX_OUTPUTS];
+	/** Key entries set with DCCSetDemuxTaskInbandKeyChange(). */
+	struct DemuxCipherKeys cipher_keys[DCC_DEMUX_MAX_CIPHERS];
+	/** PID entries set with DCCSetDemuxTaskPidEntry(). */
+	struct DemuxPidEntryState pid_entries[DCC_DEMUX_MAX_PID_ENTRIES];
+};
+
+/** Layout of RMDemuxTaskPropertyID_AESKey. TBD: Guessed, not verified with the firmware. */
+struct AESKeyEntry {
+	RMuint32 Index;
+	RMuint32 Mode;
+	RMuint8 Key[16];
+	RMuint8 IV[16];
+};
+
+/* TBD: Demux task commands are not verified, same as for the audio decoder. */
+#define DEMUX_TASK_COMMAND_PLAY 1
+#define DEMUX_TASK_COMMAND_STOP 3
+
+/** Layout of the BtsFIFO and PtsFIFO properties. TBD: not verified. */
+struct DataFIFOInfo {
+	RMuint32 StartAddress;
+	RMuint32 Size;
+	RMuint32 RdPtr;
+	RMuint32 WrPtr;
+};
+
+/** Event signalled by a decoder when it consumed bitstream data. TBD: not verified. */
+#define DECODER_BTS_EVENT_MASK 0x4
+/** Maximum time to sleep before the FIFO level is checked again. */
+#define FIFO_WAIT_SLICE_US 20000
+
 static RMuint32 default_rua_malloc(struct RUA *pRua, RMuint32 ModuleID, RMuint32 dramIndex, enum RUADramType dramtype, RMuint32 size)
 {
 	(void) ModuleID;
@@ -195,6 +318,164 @@ static RMstatus send_audio_command(struct RUA *pRua, RMuint32 decodermoduleid, R
 	return RM_OK;
 }
 
+static RMstatus send_demux_command(struct RUA *pRua, RMuint32 demuxtaskmoduleid, RMuint32 cmd)
+{
+	RMstatus rv;
+	RMuint32 state;
+
+	rv = RUASetProperty(pRua, demuxtaskmoduleid, RMDemuxTaskPropertyID_Command, &cmd, sizeof(cmd), 0);
+	if (rv != RM_OK) {
+		return rv;
+	}
+
+	return RUAGetProperty(pRua, demuxtaskmoduleid, RMDemuxTaskPropertyID_State, &state, sizeof(state));
+}
+
+static RMuint32 get_fifo_fullness(struct DataFIFOInfo *info)
+{
+	if (info->Size == 0) {
+		return 0;
+	}
+	if (info->WrPtr >= info->RdPtr) {
+		return info->WrPtr - info->RdPtr;
+	} else {
+		return info->Size - (info->RdPtr - info->WrPtr);
+	}
+}
+
+static RMstatus get_fifo_level(struct RUA *pRua, RMuint32 decodermoduleid, RMuint32 bts_property, RMuint32 pts_property, RMuint32 bitrate, RMuint32 time_resolution, struct DCCFIFOLevel *level)
+{
+	struct DataFIFOInfo info;
+	RMstatus rv;
+
+	if (level == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	memset(level, 0, sizeof(*level));
+
+	memset(&info, 0, sizeof(info));
+	rv = RUAGetProperty(pRua, decodermoduleid, bts_property, &info, sizeof(info));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	level->BitstreamSize = info.Size;
+	level->BitstreamFullness = get_fifo_fullness(&info);
+
+	/* The PTS FIFO is optional, data may be sent without time stamps. */
+	memset(&info, 0, sizeof(info));
+	rv = RUAGetProperty(pRua, decodermoduleid, pts_property, &info, sizeof(info));
+	if (rv == RM_OK) {
+		level->PtsSize = info.Size;
+		level->PtsFullness = get_fifo_fullness(&info);
+	}
+
+	if (bitrate != 0) {
+		level->PlayTime = ((RMuint64) level->BitstreamFullness) * 8 * time_resolution / bitrate;
+	}
+	return RM_OK;
+}
+
+/**
+ * Sleep until the bitstream FIFO of the decoder contains at most level bytes.
+ * Returns RM_PENDING when the level was not reached within TimeOut_us.
+ */
+static RMstatus wait_fifo_level(struct RUA *pRua, RMuint32 decodermoduleid, RMuint32 bts_property, RMuint32 pts_property, RMuint32 level, RMuint32 TimeOut_us)
+{
+	struct DCCFIFOLevel fifo;
+	struct RUAEvent event;
+	RMuint32 index;
+	RMuint64 start;
+	RMuint64 waited = 0;
+	RMstatus rv;
+
+	event.ModuleID = decodermoduleid;
+	event.Mask = DECODER_BTS_EVENT_MASK;
+	start = DCCGetMonotonicUs();
+
+	while (1) {
+		RMuint32 slice;
+
+		rv = RUAResetEvent(pRua, &event);
+		if (rv != RM_OK) {
+			return rv;
+		}
+
+		rv = get_fifo_level(pRua, decodermoduleid, bts_property, pts_property, 0, 1, &fifo);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		if (fifo.BitstreamFullness <= level) {
+			return RM_OK;
+		}
+		if (waited >= TimeOut_us) {
+			return RM_PENDING;
+		}
+
+		/* Recheck periodically, the event is only a hint. */
+		slice = TimeOut_us - waited;
+		if (slice > FIFO_WAIT_SLICE_US) {
+			slice = FIFO_WAIT_SLICE_US;
+		}
+		rv = RUAWaitForMultipleEvents(pRua, &event, 1, slice, &index);
+		if ((rv != RM_OK) && (rv != RM_PENDING)) {
+			return rv;
+		}
+		/* The event can end the wait before the slice is over. */
+		waited = DCCGetMonotonicUs() - start;
+	}
+}
+
+/** Command sent by send_multiple_commands(). */
+struct decoder_command {
+	RMuint32 decodermoduleid;
+	RMuint32 propertyid;
+	RMuint32 cmd;
+};
+
+/**
+ * Send commands to several decoders and wait for all of them at once,
+ * instead of waiting 1 second for each decoder one after another.
+ */
+static RMstatus send_multiple_commands(struct RUA *pRua, struct decoder_command *cmds, RMuint32 count)
+{
+	struct RUAEvent events[DCC_MAX_AUDIO_SOURCES + 1];
+	RMuint32 remaining;
+	RMuint32 index;
+	RMuint32 i;
+	RMstatus rv;
+
+	if (count > (sizeof(events) / sizeof(events[0]))) {
+		return RM_INVALID_PARAMETER;
+	}
+
+	for (i = 0; i < count; i++) {
+		events[i].ModuleID = cmds[i].decodermoduleid;
+		events[i].Mask = 1;
+		rv = RUAResetEvent(pRua, &events[i]);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		rv = RUASetProperty(pRua, cmds[i].decodermoduleid, cmds[i].propertyid, &cmds[i].cmd, sizeof(cmds[i].cmd), 0);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+
+	remaining = count;
+	while (remaining > 0) {
+		rv = RUAWaitForMultipleEvents(pRua, events, remaining, 1000000, &index);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		remaining--;
+		events[index] = events[remaining];
+	}
+	return RM_OK;
+}
+
 RMstatus DCCOpen(struct RUA *pRua, struct DCC **ppDCC)
 {
 	struct DCC *pDCC = NULL;
@@ -368,6 +649,14 @@ static void get_event_mask(RMuint32 ModuleID, struct RUAEvent *evt)
 			evt->Mask = 0;
 			break;
 
+		case DemuxTask:
+			evt->Mask = 0;
+			break;
+
+		case DemuxOutput:
+			evt->Mask = 0;
+			break;
+
 		case MpegEngine:
 			evt->Mask = 0;
 			break;
@@ -474,6 +763,85 @@ static RMstatus set_property(struct RUA *pRua, RMuint32 ModuleID, RMuint32 Prope
 	return rv;
 }
 
+/** Get bits per pixel of an OSD format, 0 if the format is not supported. */
+static RMuint32 get_osd_bits_per_pixel(RMuint32 ColorMode, RMuint32 ColorFormat)
+{
+	switch (ColorMode) {
+		case EMhwlibColorMode_LUT_1BPP:
+			return 1;
+
+		case EMhwlibColorMode_LUT_2BPP:
+			return 2;
+
+		case EMhwlibColorMode_LUT_4BPP:
+			return 4;
+
+		case EMhwlibColorMode_LUT_8BPP:
+			return 8;
+
+		case EMhwlibColorMode_TrueColor:
+			switch (ColorFormat) {
+				case EMhwlibColorFormat_16BPP_565:
+				case EMhwlibColorFormat_16BPP_1555:
+				case EMhwlibColorFormat_16BPP_4444:
+					return 16;
+
+				case EMhwlibColorFormat_24BPP_565:
+				case EMhwlibColorFormat_24BPP:
+					return 24;
+
+				case EMhwlibColorFormat_32BPP_4444:
+				case EMhwlibColorFormat_32BPP:
+					return 32;
+
+				default:
+					return 0;
+			}
+
+		default:
+			return 0;
+	}
+}
+
+/** Palette size in bytes for LUT modes, each entry is stored as 32 bit value in ColorFormat. */
+static RMuint32 get_osd_palette_size(RMuint32 ColorMode, RMuint32 ColorFormat)
+{
+	if (ColorMode == EMhwlibColorMode_TrueColor) {
+		return 0;
+	}
+	return (1 << get_osd_bits_per_pixel(ColorMode, ColorFormat)) * sizeof(RMuint32);
+}
+
+/**
+ * Apply the windows configured by DCCSetVideoSourceWindows(), windows with size 0 are not used.
+ *
+ * TBD: The property IDs of the scaler windows are not verified, so nothing
+ * is written for sources which don't use windows.
+ */
+static RMstatus set_scaler_windows(struct DCCVideoSource *pVideoSource)
+{
+	RMstatus rv;
+
+	if (!pVideoSource->windows_set) {
+		return RM_OK;
+	}
+	if ((pVideoSource->input_window.Width != 0) && (pVideoSource->input_window.Height != 0)) {
+		rv = set_property(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_ScalerInputWindow, &pVideoSource->input_window, sizeof(pVideoSource->input_window));
+		if (rv != RM_OK) {
+			fprintf(stderr, "Error: Failed to set scaler input window.\n");
+			return rv;
+		}
+	}
+	if ((pVideoSource->output_window.Width != 0) && (pVideoSource->output_window.Height != 0)) {
+		rv = set_property(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_ScalerOutputWindow, &pVideoSource->output_window, sizeof(pVideoSource->output_window));
+		if (rv != RM_OK) {
+			fprintf(stderr, "Error: Failed to set scaler output window.\n");
+			return rv;
+		}
+	}
+	return RM_OK;
+}
+
 RMstatus DCCSetSurfaceSource(struct DCC *pDCC, RMuint32 surfaceID, struct DCCVideoSource *pVideoSource)
 {
 	RMuint32 surface;
@@ -495,10 +863,13 @@ RMstatus DCCSetSurfaceSource(struct DCC *pDCC, RMuint32 surfaceID, struct DCCVid
 
 		pVideoSource->scalermoduleid = surfaceID;
 
-		switch (surfaceID) {
+		switch (surfaceID & 0xFF) {
 			case DispMainVideoScaler:
 			case DispSubPictureScaler:
 			case DispOSDScaler:
+			case DispHardwareCursor:
+			case DispVCRMultiScaler:
+			case DispGFXMultiScaler:
 				pVideoSource->mixermoduleid = EMHWLIB_MODULE(DispMainMixer, 0);
 				break;
 			default:
@@ -518,6 +889,10 @@ RMstatus DCCSetSurfaceSource(struct DCC *pDCC, RMuint32 surfaceID, struct DCCVid
 		if (rv != RM_OK) {
 			return rv;
 		}
+		rv = set_scaler_windows(pVideoSource);
+		if (rv != RM_OK) {
+			return rv;
+		}
 		rv = set_property(pDCC->pRua, surfaceID, RMGenericPropertyID_Validate, NULL, 0);
 		if (rv != RM_OK) {
 			return rv;
@@ -540,6 +915,10 @@ RMstatus DCCOpenMultiplePictureOSDVideoSource(struct DCC *pDCC, struct DCCOSDPro
 	if (pDCC->pRua == NULL) {
 		return RM_INVALIDMODE;
 	}
+	if (get_osd_bits_per_pixel(profile->ColorMode, profile->ColorFormat) == 0) {
+		fprintf(stderr, "Error: OSD color mode %d with format %d is not supported.\n", profile->ColorMode, profile->ColorFormat);
+		return RM_INVALID_PARAMETER;
+	}
 
 	pVideoSource = malloc(sizeof(*pVideoSource));
 	if (pVideoSource == NULL) {
@@ -551,6 +930,10 @@ RMstatus DCCOpenMultiplePictureOSDVideoSource(struct DCC *pDCC, struct DCCOSDPro
 	*ppVideoSource = pVideoSource;
 	pVideoSource->pRua = pDCC->pRua;
 	pVideoSource->pDCC = pDCC;
+	pVideoSource->colormode = profile->ColorMode;
+	pVideoSource->colorformat = profile->ColorFormat;
+	pVideoSource->width = profile->Width;
+	pVideoSource->height = profile->Height;
 
 	pVideoSource->pic_info = malloc(sizeof(*pVideoSource->pic_info) * picture_count);
 	if (pVideoSource->pic_info == NULL) {
@@ -676,6 +1059,11 @@ RMstatus DCCOpenOSDVideoSource(struct DCC *pDCC, struct DCCOSDProfile *profile,
 	RMuint32 addr;
 	pic_info_t *pic;
 
+	if (get_osd_bits_per_pixel(profile->ColorMode, profile->ColorFormat) == 0) {
+		fprintf(stderr, "Error: OSD color mode %d with format %d is not supported.\n", profile->ColorMode, profile->ColorFormat);
+		return RM_INVALID_PARAMETER;
+	}
+
 	pVideoSource = malloc(sizeof(*pVideoSource));
 	if (pVideoSource == NULL) {
 		fprintf(stderr, "Error: out of memory\n");
@@ -685,6 +1073,10 @@ RMstatus DCCOpenOSDVideoSource(struct DCC *pDCC, struct DCCOSDProfile *profile,
 	memset(pVideoSource, 0, sizeof(*pVideoSource));
 	pVideoSource->pRua = pDCC->pRua;
 	pVideoSource->pDCC = pDCC;
+	pVideoSource->colormode = profile->ColorMode;
+	pVideoSource->colorformat = profile->ColorFormat;
+	pVideoSource->width = profile->Width;
+	pVideoSource->height = profile->Height;
 	*ppVideoSource = pVideoSource;
 
 	memset(pic_in, 0, sizeof(pic_in));
@@ -744,8 +1136,14 @@ RMstatus DCCOpenOSDVideoSource(struct DCC *pDCC, struct DCCOSDProfile *profile,
 	pic->LumaSize = pic_out[1];
 	pic->ChromaAddress = result_init[1];
 	pic->ChromaSize = pic_out[2];
-	pic->PaletteAddress = 0;
-	pic->PaletteSize = 0;
+	/* The palette is part of the surface for the LUT modes. */
+	pic->PaletteAddress = result_init[2];
+	if (pic->PaletteAddress != 0) {
+		pic->PaletteSize = get_osd_palette_size(profile->ColorMode, profile->ColorFormat);
+	} else {
+		pic->PaletteSize = 0;
+	}
+	DPRINTF("PaletteAddress 0x%08x\n", pic->PaletteAddress);
 
 	return RM_OK;
 }
@@ -821,6 +1219,27 @@ RMstatus DCCGetOSDVideoSourceInfo(struct DCCVideoSource *pVideoSource, RMuint32
 	return DCCGetOSDPictureInfo(pVideoSource, 0 , NULL, LumaAddr, LumaSize, ChromaAddr, ChromaSize);
 }
 
+RMstatus DCCGetOSDPaletteInfo(struct DCCVideoSource *pVideoSource, RMuint32 index, RMuint32 *PaletteAddr, RMuint32 *PaletteSize)
+{
+	if (pVideoSource == NULL) {
+		return RM_INVALID_PARAMETER;
+	}
+	if (pVideoSource->pRua == NULL) {
+		return RM_INVALIDMODE;
+	}
+	if (index >= pVideoSource->picture_count) {
+		return RM_ERROR;
+	}
+
+	if (PaletteAddr != NULL) {
+		*PaletteAddr = pVideoSource->pic_info[index].PaletteAddress;
+	}
+	if (PaletteSize != NULL) {
+		*PaletteSize = pVideoSource->pic_info[index].PaletteSize;
+	}
+	return RM_OK;
+}
+
 RMstatus DCCGetScalerModuleID(struct DCC *pDCC, enum DCCRoute route, enum DCCSurface surface, RMuint32 index, RMuint32 *scalermoduleid)
 {
 	if (pDCC == NULL) {
@@ -837,9 +1256,12 @@ RMstatus DCCGetScalerModuleID(struct DCC *pDCC, enum DCCRoute route, enum DCCSur
 					if (index == 0) {
 						*scalermoduleid = EMHWLIB_MODULE(DispOSDScaler, 0);
 						return RM_OK;
+					} else if (index <= DCC_MULTISCALER_WINDOW_COUNT) {
+						/* Windows of the graphic multi scaler. */
+						*scalermoduleid = EMHWLIB_TARGET_MODULE(DispGFXMultiScaler, 0, index - 1);
+						return RM_OK;
 					} else {
-						fprintf(stderr, "Error: %s is not implemented.\n", __FUNCTION__);
-						return RM_NOTIMPLEMENTED;
+						return RM_PARAMETER_OUT_OF_RANGE;
 					}
 					break;
 
@@ -847,9 +1269,12 @@ RMstatus DCCGetScalerModuleID(struct DCC *pDCC, enum DCCRoute route, enum DCCSur
 					if (index == 0) {
 						*scalermoduleid = EMHWLIB_MODULE(DispMainVideoScaler, 0);
 						return RM_OK;
+					} else if (index <= DCC_MULTISCALER_WINDOW_COUNT) {
+						/* Windows of the video multi scaler. */
+						*scalermoduleid = EMHWLIB_TARGET_MODULE(DispVCRMultiScaler, 0, index - 1);
+						return RM_OK;
 					} else {
-						fprintf(stderr, "Error: %s is not implemented.\n", __FUNCTION__);
-						return RM_NOTIMPLEMENTED;
+						return RM_PARAMETER_OUT_OF_RANGE;
 					}
 					break;
 				default:
@@ -857,6 +1282,15 @@ RMstatus DCCGetScalerModuleID(struct DCC *pDCC, enum DCCRoute route, enum DCCSur
 					return RM_NOTIMPLEMENTED;
 			}
 			break;
+
+		case DCCRoute_Secondary:
+			/*
+			 * TBD: The module of the secondary mixer is not known. The
+			 * multi scalers are mixed into DispMainMixer, use them with
+			 * DCCRoute_Main and an index > 0.
+			 */
+			return RM_NOT_SUPPORTED;
+
 		default:
 			fprintf(stderr, "Error: %s is not implemented.\n", __FUNCTION__);
 			return RM_NOTIMPLEMENTED;
@@ -905,6 +1339,42 @@ static RMstatus set_memory(struct RUA *pRua, RMuint32 addr, RMuint32 size, RMuin
 	return RM_OK;
 }
 
+/**
+ * Upload palette entries of a LUT picture.
+ * @param palette count entries in the color format of the picture.
+ * @param first First palette entry which is overwritten.
+ */
+RMstatus DCCSetOSDPalette(struct DCCVideoSource *pVideoSource, RMuint32 index, RMuint32 *palette, RMuint32 first, RMuint32 count)
+{
+	RMstatus rv;
+	RMuint32 PaletteAddr;
+	RMuint32 PaletteSize;
+	RMuint32 entries;
+
+	if ((pVideoSource == NULL) || (palette == NULL)) {
+		return RM_INVALID_PARAMETER;
+	}
+	if (pVideoSource->pRua == NULL) {
+		return RM_INVALIDMODE;
+	}
+
+	rv = DCCGetOSDPaletteInfo(pVideoSource, index, &PaletteAddr, &PaletteSize);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	if ((PaletteAddr == 0) || (PaletteSize == 0)) {
+		fprintf(stderr, "Error: %s picture %d has no palette.\n", __FUNCTION__, index);
+		return RM_INVALIDMODE;
+	}
+	/* Compare in entries, first + count can wrap around. */
+	entries = PaletteSize / sizeof(*palette);
+	if ((first >= entries) || (count > (entries - first))) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+
+	return set_memory(pVideoSource->pRua, PaletteAddr + first * sizeof(*palette), count * sizeof(*palette), (RMuint8 *) palette, FALSE, 0);
+}
+
 RMstatus DCCClearOSDPicture(struct DCCVideoSource *pVideoSource, RMuint32 index)
 {
 	RMstatus rv;
@@ -912,6 +1382,8 @@ RMstatus DCCClearOSDPicture(struct DCCVideoSource *pVideoSource, RMuint32 index)
 	RMuint32 LumaSize;
 	RMuint32 ChromaAddr;
 	RMuint32 ChromaSize;
+	RMuint32 bpp;
+	RMint32 initvalue;
 
 	if (pVideoSource == NULL) {
 		return RM_INVALID_PARAMETER;
@@ -920,6 +1392,14 @@ RMstatus DCCClearOSDPicture(struct DCCVideoSource *pVideoSource, RMuint32 index)
 		return RM_INVALIDMODE;
 	}
 
+	/* LUT pictures are cleared to palette entry 0, 16 bpp pictures to black. */
+	bpp = get_osd_bits_per_pixel(pVideoSource->colormode, pVideoSource->colorformat);
+	if ((bpp != 0) && (bpp <= 16)) {
+		initvalue = 0;
+	} else {
+		initvalue = 128;
+	}
+
 	rv = DCCGetOSDPictureInfo(pVideoSource, index, NULL,  &LumaAddr, &LumaSize, &ChromaAddr, &ChromaSize);
 	if (rv != RM_OK) {
 		return rv;
@@ -929,7 +1409,7 @@ RMstatus DCCClearOSDPicture(struct DCCVideoSource *pVideoSource, RMuint32 index)
 		return rv;
 	}
 	if ((LumaAddr != 0) && (LumaSize != 0)) {
-		rv = set_memory(pVideoSource->pRua, LumaAddr, LumaSize, NULL, TRUE, 128);
+		rv = set_memory(pVideoSource->pRua, LumaAddr, LumaSize, NULL, TRUE, initvalue);
 		if (rv != RM_OK) {
 			return rv;
 		}
@@ -965,30 +1445,18 @@ RMstatus DCCInsertPictureInMultiplePictureOSDVideoSource(struct DCCVideoSource *
 	return rv;
 }
 
-RMstatus DCCEnableVideoSource(struct DCCVideoSource *pVideoSource, RMbool enable)
+/** Enable or disable the scaler in the mixer. */
+static RMstatus set_mixer_source_state(struct RUA *pRua, RMuint32 mixermoduleid, RMuint32 scalermoduleid, RMbool enable)
 {
 	RMstatus rv;
 	RMuint32 idx;
 	RMuint32 state;
 	RMuint32 mixer;
 
-	if (pVideoSource == NULL) {
-		return RM_INVALID_PARAMETER;
-	}
-	if (pVideoSource->pRua == NULL) {
-		return RM_INVALIDMODE;
-	}
-
-	if (pVideoSource->mixermoduleid == 0) {
-		fprintf(stderr, "Error: %s no mixermoduleid defined.\n", __FUNCTION__);
-		return RM_ERROR;
-	}
-	if (pVideoSource->scalermoduleid == 0) {
-		fprintf(stderr, "Error: %s no scalermoduleid defined.\n", __FUNCTION__);
-		return RM_ERROR;
-	}
+	/* Windows of multi scalers share the mixer source of the scaler. */
+	scalermoduleid = EMHWLIB_MODULE(scalermoduleid, scalermoduleid >> 8);
 
-	rv = RUAExchangeProperty(pVideoSource->pRua, pVideoSource->mixermoduleid, RMGenericPropertyID_MixerSourceIndex, &pVideoSource->scalermoduleid, sizeof(pVideoSource->scalermoduleid), &idx, sizeof(idx));
+	rv = RUAExchangeProperty(pRua, mixermoduleid, RMGenericPropertyID_MixerSourceIndex, &scalermoduleid, sizeof(scalermoduleid), &idx, sizeof(idx));
 	if (rv != RM_OK) {
 		fprintf(stderr, "Error: %s getting index failed.\n", __FUNCTION__);
 		return rv;
@@ -998,678 +1466,1841 @@ RMstatus DCCEnableVideoSource(struct DCCVideoSource *pVideoSource, RMbool enable
 	} else {
 		state = 1;
 	}
-	mixer = EMHWLIB_TARGET_MODULE(pVideoSource->mixermoduleid, 0, idx);
-	rv = set_property(pVideoSource->pRua, mixer, RMGenericPropertyID_MixerSourceState, &state, sizeof(state));
+	mixer = EMHWLIB_TARGET_MODULE(mixermoduleid, 0, idx);
+	rv = set_property(pRua, mixer, RMGenericPropertyID_MixerSourceState, &state, sizeof(state));
 	if (rv != RM_OK) {
 		return rv;
 	}
-	rv = set_property(pVideoSource->pRua, mixer, RMGenericPropertyID_Validate, NULL, 0);
+	rv = set_property(pRua, mixer, RMGenericPropertyID_Validate, NULL, 0);
 	if (rv != RM_OK) {
 		return rv;
 	}
 	return RM_OK;
 }
 
-RMstatus DCCSetMemoryManager(struct DCC *pDCC, RMuint8 dram)
+RMstatus DCCEnableVideoSource(struct DCCVideoSource *pVideoSource, RMbool enable)
 {
-	RMstatus rv;
-	struct RUA *pRua;
-	RMuint32 buffer[1];
-	RMuint32 result[1];
-	
-	if (pDCC == NULL) {
+	if (pVideoSource == NULL) {
 		return RM_INVALID_PARAMETER;
 	}
-	if (pDCC->pRua == NULL) {
+	if (pVideoSource->pRua == NULL) {
 		return RM_INVALIDMODE;
 	}
-	pRua = pDCC->pRua;
 
-	memset(buffer, 0, sizeof(buffer));
-	memset(result, 0, sizeof(result));
-	buffer[0] = MM;
-	rv = RUAExchangeProperty(pDCC->pRua, EMHWLIB_MODULE(Enumerator, 0), RMEnumeratorPropertyID_CategoryIDToNumberOfInstances, buffer, sizeof(buffer), &result, sizeof(result));
-	if (rv != RM_OK) {
+	if (pVideoSource->mixermoduleid == 0) {
+		fprintf(stderr, "Error: %s no mixermoduleid defined.\n", __FUNCTION__);
 		return RM_ERROR;
 	}
-	if (dram >= result[0]) {
+	if (pVideoSource->scalermoduleid == 0) {
+		fprintf(stderr, "Error: %s no scalermoduleid defined.\n", __FUNCTION__);
 		return RM_ERROR;
 	}
-	pDCC->dram = dram;
-	return RM_OK;
 
+	return set_mixer_source_state(pVideoSource->pRua, pVideoSource->mixermoduleid, pVideoSource->scalermoduleid, enable);
 }
 
-RMstatus DCCSTCOpen(struct DCC *pDCC, struct DCCStcProfile *stc_profile, struct DCCSTCSource **ppStcSource)
+/**
+ * Set the part of the picture which is shown (input) and where it is shown
+ * on the output (output). The scaler scales between both windows, e.g. an OSD
+ * picture with a lower resolution can be scaled up to the full screen.
+ * @param input Window in pixels of the picture, NULL to keep the current one.
+ * @param output Window on the output, NULL to keep the current one.
+ */
+RMstatus DCCSetVideoSourceWindows(struct DCCVideoSource *pVideoSource, struct EMhwlibWindow *input, struct EMhwlibWindow *output)
 {
 	RMstatus rv;
-	RMuint32 buffer[9];
-	struct DCCSTCSource *pStcSource;
-	
-	if (pDCC == NULL) {
+
+	if (pVideoSource == NULL) {
 		return RM_INVALID_PARAMETER;
 	}
-	if (pDCC->pRua == NULL) {
+	if (pVideoSource->pRua == NULL) {
 		return RM_INVALIDMODE;
 	}
 
-	pStcSource = malloc(sizeof(*pStcSource));
-
-	pStcSource->pRua = pDCC->pRua;
-	pStcSource->StcModuleId = EMHWLIB_MODULE(STC, stc_profile->STCID);
+	if (input != NULL) {
+		if ((input->X < 0) || (input->Y < 0)) {
+			return RM_PARAMETER_OUT_OF_RANGE;
+		}
+		if ((pVideoSource->width != 0) && ((input->X + input->Width) > pVideoSource->width)) {
+			return RM_PARAMETER_OUT_OF_RANGE;
+		}
+		if ((pVideoSource->height != 0) && ((input->Y + input->Height) > pVideoSource->height)) {
+			return RM_PARAMETER_OUT_OF_RANGE;
+		}
+		pVideoSource->input_window = *input;
+	}
+	if (output != NULL) {
+		pVideoSource->output_window = *output;
+	}
+	pVideoSource->windows_set = TRUE;
 
-	memset(buffer, 0, sizeof(buffer));
-	buffer[0] = stc_profile->master;
-	buffer[1] = stc_profile->stc_timer_id;
-	buffer[2] = stc_profile->stc_time_resolution;
-	buffer[3] = stc_profile->video_timer_id;
-	buffer[4] = stc_profile->video_time_resolution;
-	buffer[5] = stc_profile->video_offset;
-	buffer[6] = stc_profile->audio_timer_id;
-	buffer[7] = stc_profile->audio_time_resolution;
-	buffer[8] = stc_profile->audio_offset;
+	if (pVideoSource->scalermoduleid == 0) {
+		/* Windows are set when the surface is connected to the scaler. */
+		return RM_OK;
+	}
 
-	rv = RUASetProperty(pDCC->pRua, pStcSource->StcModuleId, RMSTCPropertyID_Open, buffer, sizeof(buffer), 0);
+	rv = set_scaler_windows(pVideoSource);
 	if (rv != RM_OK) {
-		free(pStcSource);
-		pStcSource = NULL;
-		*ppStcSource = NULL;
 		return rv;
 	}
-	*ppStcSource = pStcSource;
-	return RM_OK;
+	return set_property(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_Validate, NULL, 0);
 }
 
-RMstatus DCCSTCClose(struct DCCSTCSource *pStcSource)
+/**
+ * Open the hardware cursor. The cursor is an OSD surface on the hardware
+ * cursor scaler and is moved by changing the output window of the scaler.
+ * @param profile Format and size of the cursor image, e.g. LUT 4 bpp 32x32.
+ */
+RMstatus DCCOpenCursor(struct DCC *pDCC, struct DCCOSDProfile *profile, struct DCCCursor **ppCursor)
 {
+	struct DCCCursor *pCursor;
+	struct EMhwlibWindow input;
+	struct EMhwlibWindow output;
+	RMuint32 PaletteAddr;
+	RMuint32 PaletteSize;
 	RMstatus rv;
-	RMuint32 buffer[9];
-	
-	if (pStcSource == NULL) {
+
+	if ((pDCC == NULL) || (profile == NULL) || (ppCursor == NULL)) {
 		return RM_INVALID_PARAMETER;
 	}
-	if (pStcSource->pRua == NULL) {
+	if (pDCC->pRua == NULL) {
 		return RM_INVALIDMODE;
 	}
 
-	memset(buffer, 0, sizeof(buffer));
-	buffer[0] = 0;
-
-	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_Close, buffer, sizeof(buffer), 0);
-
-	free(pStcSource);
-	pStcSource = NULL;
-
-	return rv;
-}
-
-RMstatus DCCSTCGetModuleId(struct DCCSTCSource *pStcSource, RMuint32 *stc_id)
-{
-	*stc_id = pStcSource->StcModuleId;
+	pCursor = malloc(sizeof(*pCursor));
+	if (pCursor == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
 
-	return RM_OK;
-}
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pCursor, 0, sizeof(*pCursor));
+	pCursor->pDCC = pDCC;
+	pCursor->scalermoduleid = EMHWLIB_MODULE(DispHardwareCursor, 0);
 
-RMstatus DCCSTCSetTimeResolution(struct DCCSTCSource *pStcSource, enum DCCStreamType type, RMuint32 time_resolution)
-{
-	RMstatus rv = RM_ERROR;
+	rv = DCCOpenOSDVideoSource(pDCC, profile, &pCursor->pVideoSource);
+	if (rv != RM_OK) {
+		free(pCursor);
+		return rv;
+	}
 
-	switch(type) {
-		case DCC_Stc:
-			rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_StcTimeResolution, &time_resolution, sizeof(time_resolution), 0);
-			break;
+	/* Start with a transparent cursor. */
+	rv = DCCClearOSDVideoSource(pCursor->pVideoSource);
+	if (rv != RM_OK) {
+		DCCCloseCursor(pCursor);
+		return rv;
+	}
+	rv = DCCGetOSDPaletteInfo(pCursor->pVideoSource, 0, &PaletteAddr, &PaletteSize);
+	if ((rv == RM_OK) && (PaletteAddr != 0)) {
+		rv = set_memory(pDCC->pRua, PaletteAddr, PaletteSize, NULL, TRUE, 0);
+	}
+	if (rv != RM_OK) {
+		DCCCloseCursor(pCursor);
+		return rv;
+	}
 
-		case DCC_Video:
-			rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_VideoTimeResolution, &time_resolution, sizeof(time_resolution), 0);
-			break;
+	memset(&input, 0, sizeof(input));
+	input.Width = profile->Width;
+	input.Height = profile->Height;
+	memset(&output, 0, sizeof(output));
+	output.Width = profile->Width;
+	output.Height = profile->Height;
+	rv = DCCSetVideoSourceWindows(pCursor->pVideoSource, &input, &output);
+	if (rv != RM_OK) {
+		DCCCloseCursor(pCursor);
+		return rv;
+	}
 
-		case DCC_Audio:
-			rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_AudioTimeResolution, &time_resolution, sizeof(time_resolution), 0);
-			break;
+	rv = DCCSetSurfaceSource(pDCC, pCursor->scalermoduleid, pCursor->pVideoSource);
+	if (rv != RM_OK) {
+		DCCCloseCursor(pCursor);
+		return rv;
 	}
-	return rv;
+
+	*ppCursor = pCursor;
+	return RM_OK;
 }
 
-RMstatus DCCSTCSetVideoOffset(struct DCCSTCSource *pStcSource, RMint32 time, RMuint32 time_resolution)
+RMstatus DCCCloseCursor(struct DCCCursor *pCursor)
 {
 	RMstatus rv;
-	RMuint32 buffer[2];
 
-	buffer[0] = time_resolution;
-	buffer[1] = time;
+	if (pCursor == NULL) {
+		return RM_INVALID_PARAMETER;
+	}
 
-	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_VideoOffset, &buffer, sizeof(buffer), 0);
+	if (pCursor->pVideoSource != NULL) {
+		if (pCursor->pVideoSource->mixermoduleid != 0) {
+			DCCEnableVideoSource(pCursor->pVideoSource, FALSE);
+		}
+		rv = DCCCloseVideoSource(pCursor->pVideoSource);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		pCursor->pVideoSource = NULL;
+	}
+	free(pCursor);
 
-	return rv;
+	return RM_OK;
 }
 
-RMstatus DCCSTCSetAudioOffset(struct DCCSTCSource *pStcSource, RMint32 time, RMuint32 time_resolution)
+/**
+ * Set the cursor image.
+ * @param image Pixel data in the format given to DCCOpenCursor().
+ * @param palette Palette for LUT cursors, can be NULL.
+ * @param hotspot_x Position in the image which is moved to the cursor position.
+ */
+RMstatus DCCSetCursorImage(struct DCCCursor *pCursor, RMuint8 *image, RMuint32 size, RMuint32 *palette, RMuint32 palette_count, RMint32 hotspot_x, RMint32 hotspot_y)
 {
 	RMstatus rv;
-	RMuint32 buffer[2];
+	RMuint32 LumaAddr;
+	RMuint32 LumaSize;
 
-	buffer[0] = time_resolution;
-	buffer[1] = time;
+	if ((pCursor == NULL) || (pCursor->pVideoSource == NULL)) {
+		return RM_INVALID_PARAMETER;
+	}
 
-	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_AudioOffset, &buffer, sizeof(buffer), 0);
+	if (image != NULL) {
+		rv = DCCGetOSDVideoSourceInfo(pCursor->pVideoSource, &LumaAddr, &LumaSize, NULL, NULL);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		if (size > LumaSize) {
+			return RM_PARAMETER_OUT_OF_RANGE;
+		}
+		rv = set_memory(pCursor->pDCC->pRua, LumaAddr, size, image, FALSE, 0);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+	if (palette != NULL) {
+		rv = DCCSetOSDPalette(pCursor->pVideoSource, 0, palette, 0, palette_count);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+	pCursor->hotspot_x = hotspot_x;
+	pCursor->hotspot_y = hotspot_y;
 
-	return rv;
+	return RM_OK;
 }
 
-RMstatus DCCSTCSetTime(struct DCCSTCSource *pStcSource, RMuint64 time, RMuint32 time_resolution)
+/** Move the hot spot of the cursor to the position x, y of the output. */
+RMstatus DCCMoveCursor(struct DCCCursor *pCursor, RMint32 x, RMint32 y)
 {
+	struct DCCVideoSource *pVideoSource;
 	RMstatus rv;
-	RMuint32 buffer[4];
 
-	if (pStcSource == NULL) {
-		return RM_FATALINVALIDPOINTER;
+	if ((pCursor == NULL) || (pCursor->pVideoSource == NULL)) {
+		return RM_INVALID_PARAMETER;
 	}
-	if (time_resolution == 0) {
-		return RM_ERROR;
+	pVideoSource = pCursor->pVideoSource;
+	if (!pVideoSource->windows_set) {
+		return RM_INVALIDMODE;
 	}
 
-	memset(buffer, 0, sizeof(buffer));
-	buffer[0] = time_resolution;
-	*((RMuint64 *) &buffer[2]) = time;
-
-	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_Time, &buffer, sizeof(buffer), 0);
+	pVideoSource->output_window.X = x - pCursor->hotspot_x;
+	pVideoSource->output_window.Y = y - pCursor->hotspot_y;
 
-	return rv;
+	rv = set_property(pVideoSource->pRua, pCursor->scalermoduleid, RMGenericPropertyID_ScalerOutputWindow, &pVideoSource->output_window, sizeof(pVideoSource->output_window));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	return set_property(pVideoSource->pRua, pCursor->scalermoduleid, RMGenericPropertyID_Validate, NULL, 0);
 }
 
-RMstatus DCCSTCSetSpeed(struct DCCSTCSource *pStcSource, RMint32 numerator, RMuint32 denominator)
+RMstatus DCCEnableCursor(struct DCCCursor *pCursor, RMbool enable)
 {
-	RMstatus rv;
-	RMuint32 buffer[6];
-
-	memset(buffer, 0, sizeof(buffer));
-	buffer[0] = numerator;
-	buffer[1] = denominator;
-	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_Speed, &buffer, sizeof(buffer), 0);
+	if (pCursor == NULL) {
+		return RM_INVALID_PARAMETER;
+	}
 
-	return rv;
+	return DCCEnableVideoSource(pCursor->pVideoSource, enable);
 }
 
-RMstatus DCCSTCGetTime(struct DCCSTCSource *pStcSource, RMuint64 *ptime, RMuint32 time_resolution)
+/**
+ * Open a mosaic of windows on a multi scaler. Each window shows the surface
+ * of a video source. The hardware scales the surfaces and places them on the
+ * output.
+ * @param surface DCCSurface_Video uses DispVCRMultiScaler and
+ *                DCCSurface_OSD uses DispGFXMultiScaler.
+ * @param window_count Number of windows, maximum DCC_MULTISCALER_WINDOW_COUNT.
+ */
+RMstatus DCCOpenMosaic(struct DCC *pDCC, enum DCCSurface surface, RMuint32 window_count, struct DCCMosaic **ppMosaic)
 {
-	RMstatus rv;
+	struct DCCMosaic *pMosaic;
 
-	if (pStcSource == NULL) {
-		return RM_FATALINVALIDPOINTER;
+	if ((pDCC == NULL) || (ppMosaic == NULL)) {
+		return RM_INVALID_PARAMETER;
+	}
+	if (pDCC->pRua == NULL) {
+		return RM_INVALIDMODE;
+	}
+	if ((window_count == 0) || (window_count > DCC_MULTISCALER_WINDOW_COUNT)) {
+		return RM_PARAMETER_OUT_OF_RANGE;
 	}
 
-	rv = RUAExchangeProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_TimeInfo, &time_resolution, sizeof(time_resolution), ptime, sizeof(*ptime));
+	pMosaic = malloc(sizeof(*pMosaic));
+	if (pMosaic == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
 
-	return rv;
-}
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pMosaic, 0, sizeof(*pMosaic));
+	pMosaic->pDCC = pDCC;
+	pMosaic->mixermoduleid = EMHWLIB_MODULE(DispMainMixer, 0);
+	pMosaic->window_count = window_count;
 
-RMstatus DCCSTCPlay(struct DCCSTCSource *pStcSource)
-{
-	RMstatus rv;
+	switch (surface) {
+		case DCCSurface_Video:
+			pMosaic->scalermoduleid = EMHWLIB_MODULE(DispVCRMultiScaler, 0);
+			break;
 
-	if (pStcSource == NULL) {
-		return RM_FATALINVALIDPOINTER;
+		case DCCSurface_OSD:
+			pMosaic->scalermoduleid = EMHWLIB_MODULE(DispGFXMultiScaler, 0);
+			break;
+
+		default:
+			free(pMosaic);
+			fprintf(stderr, "Error: %s is not implemented for surface %d.\n", __FUNCTION__, surface);
+			return RM_NOTIMPLEMENTED;
 	}
 
-	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_Play, NULL, 0, 0);
+	pMosaic->windows = malloc(sizeof(*pMosaic->windows) * window_count);
+	if (pMosaic->windows == NULL) {
+		free(pMosaic);
 
-	return rv;
+		fprintf(stderr, "Error: out of memory\n");
+
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pMosaic->windows, 0, sizeof(*pMosaic->windows) * window_count);
+
+	*ppMosaic = pMosaic;
+	return RM_OK;
 }
 
-RMstatus DCCSTCStop(struct DCCSTCSource *pStcSource)
+RMstatus DCCCloseMosaic(struct DCCMosaic *pMosaic)
 {
 	RMstatus rv;
+	RMuint32 i;
 
-	if (pStcSource == NULL) {
-		return RM_FATALINVALIDPOINTER;
+	if (pMosaic == NULL) {
+		return RM_INVALID_PARAMETER;
 	}
 
-	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_Stop, NULL, 0, 0);
+	for (i = 0; i < pMosaic->window_count; i++) {
+		struct DCCVideoSource *pVideoSource;
 
-	return rv;
+		pVideoSource = pMosaic->windows[i].pVideoSource;
+		if ((pVideoSource != NULL) && (pVideoSource->scalermoduleid != 0)) {
+			rv = DCCSetSurfaceSource(pMosaic->pDCC, pVideoSource->scalermoduleid, NULL);
+			if (rv != RM_OK) {
+				return rv;
+			}
+			pVideoSource->scalermoduleid = 0;
+			pVideoSource->mixermoduleid = 0;
+		}
+	}
+	free(pMosaic->windows);
+	free(pMosaic);
+
+	return RM_OK;
 }
 
-RMstatus DCCGetVideoModuleIDsFromIndexes(struct DCC *pDCC, RMuint32 MpegEngineID, RMuint32 VideoDecoderID, RMuint32 *MpegModuleID, RMuint32 *DecoderModuleID)
+/**
+ * Configure a window of the mosaic. Changes are shown after DCCValidateMosaic().
+ * @param pVideoSource Surface shown in the window, NULL to remove the window.
+ * @param input Part of the surface which is shown, NULL for the full surface.
+ * @param output Position and size on the output.
+ * @param zorder Windows with a higher value are shown above windows with a lower value.
+ */
+RMstatus DCCSetMosaicWindow(struct DCCMosaic *pMosaic, RMuint32 index, struct DCCVideoSource *pVideoSource, struct EMhwlibWindow *input, struct EMhwlibWindow *output, RMuint32 zorder)
 {
-	RMuint32 buffer[1];
-	RMuint32 number_of_engines;
-	RMuint32 number_of_decoders;
-	RMstatus rv;
+	struct DCCMosaicWindow *window;
 
-	number_of_engines = 0;
-	buffer[0] = MpegEngine;
-	rv = RUAExchangeProperty(pDCC->pRua, EMHWLIB_MODULE(Enumerator, 0), RMEnumeratorPropertyID_CategoryIDToNumberOfInstances, buffer, sizeof(buffer), &number_of_engines, sizeof(number_of_engines));
-	if (rv != RM_OK) {
-		return rv;
+	if (pMosaic == NULL) {
+		return RM_INVALID_PARAMETER;
 	}
-	if (MpegEngineID >= number_of_engines) {
-		EPRINTF("MpegEngineID %u is larger or equal to %u.\n", MpegEngineID, number_of_engines);
+	if (index >= pMosaic->window_count) {
 		return RM_PARAMETER_OUT_OF_RANGE;
 	}
-
-	buffer[0] = VideoDecoder;
-	rv = RUAExchangeProperty(pDCC->pRua, EMHWLIB_MODULE(Enumerator, 0), RMEnumeratorPropertyID_CategoryIDToNumberOfInstances, buffer, sizeof(buffer), &number_of_decoders, sizeof(number_of_decoders));
-	if (rv != RM_OK) {
-		return rv;
-	}
-	if (VideoDecoderID >= (number_of_decoders / number_of_engines)) {
-		EPRINTF("VideoDecoderID %u is larger or equal to %u.\n", VideoDecoderID, (number_of_decoders / number_of_engines));
-		return RM_PARAMETER_OUT_OF_RANGE;
+	if ((pVideoSource != NULL) && (output == NULL)) {
+		return RM_INVALID_PARAMETER;
 	}
-	if (MpegModuleID != NULL) {
-		*MpegModuleID = EMHWLIB_MODULE(MpegEngine, MpegEngineID);
+
+	window = &pMosaic->windows[index];
+	memset(window, 0, sizeof(*window));
+	if (pVideoSource == NULL) {
+		return RM_OK;
 	}
-	if (DecoderModuleID != NULL) {
-		*DecoderModuleID = EMHWLIB_MODULE(VideoDecoder, (MpegEngineID * (number_of_decoders / number_of_engines)) + VideoDecoderID);
+
+	window->pVideoSource = pVideoSource;
+	if (input != NULL) {
+		window->input = *input;
+	} else {
+		window->input.Width = pVideoSource->width;
+		window->input.Height = pVideoSource->height;
 	}
+	window->output = *output;
+	window->zorder = zorder;
+
 	return RM_OK;
 }
 
-RMstatus DCCGetVideoSourceRequired(struct DCC *pDCC, struct DCCXVideoProfile *dcc_profile, struct DCCResource *resource)
+/**
+ * Show the configured windows. Windows are assigned to the hardware windows
+ * of the multi scaler sorted by z-order, later hardware windows are shown
+ * above earlier ones.
+ */
+RMstatus DCCValidateMosaic(struct DCCMosaic *pMosaic)
 {
+	RMuint32 order[DCC_MULTISCALER_WINDOW_COUNT];
+	RMuint32 count;
+	RMuint32 slot;
+	RMuint32 i;
 	RMstatus rv;
-	RMuint32 MpegModuleID;
-	RMuint32 DecoderModuleID;
-	RMuint32 result_shm[2];
-	RMuint32 buffer_mem[6];
-	RMuint32 result_mem[3];
-	RMuint32 result_decmem[2];
-	RMuint32 buffer_dramx[8];
-	RMuint32 result_dramx[3];
 
-	memset(resource, 0, sizeof(*resource));
+	if (pMosaic == NULL) {
+		return RM_INVALID_PARAMETER;
+	}
 
-	rv = DCCGetVideoModuleIDsFromIndexes(pDCC, dcc_profile->MpegEngineID, dcc_profile->VideoDecoderID, &MpegModuleID, &DecoderModuleID);
+	/* Insertion sort of the used windows by z-order, keeps the order of equal windows. */
+	count = 0;
+	for (i = 0; i < pMosaic->window_count; i++) {
+		RMuint32 n;
+
+		if (pMosaic->windows[i].pVideoSource == NULL) {
+			continue;
+		}
+		n = count;
+		while ((n > 0) && (pMosaic->windows[order[n - 1]].zorder > pMosaic->windows[i].zorder)) {
+			order[n] = order[n - 1];
+			n--;
+		}
+		order[n] = i;
+		count++;
+	}
+
+	for (slot = 0; slot < pMosaic->window_count; slot++) {
+		RMuint32 scalermoduleid;
+
+		scalermoduleid = EMHWLIB_TARGET_MODULE(pMosaic->scalermoduleid, 0, slot);
+		if (slot < count) {
+			struct DCCMosaicWindow *window;
+
+			window = &pMosaic->windows[order[slot]];
+			window->pVideoSource->input_window = window->input;
+			window->pVideoSource->output_window = window->output;
+			window->pVideoSource->windows_set = TRUE;
+			rv = DCCSetSurfaceSource(pMosaic->pDCC, scalermoduleid, window->pVideoSource);
+		} else {
+			rv = DCCSetSurfaceSource(pMosaic->pDCC, scalermoduleid, NULL);
+		}
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+	return RM_OK;
+}
+
+RMstatus DCCEnableMosaic(struct DCCMosaic *pMosaic, RMbool enable)
+{
+	if (pMosaic == NULL) {
+		return RM_INVALID_PARAMETER;
+	}
+
+	return set_mixer_source_state(pMosaic->pDCC->pRua, pMosaic->mixermoduleid, pMosaic->scalermoduleid, enable);
+}
+
+RMstatus DCCSetMemoryManager(struct DCC *pDCC, RMuint8 dram)
+{
+	RMstatus rv;
+	struct RUA *pRua;
+	RMuint32 buffer[1];
+	RMuint32 result[1];
+	
+	if (pDCC == NULL) {
+		return RM_INVALID_PARAMETER;
+	}
+	if (pDCC->pRua == NULL) {
+		return RM_INVALIDMODE;
+	}
+	pRua = pDCC->pRua;
+
+	memset(buffer, 0, sizeof(buffer));
+	memset(result, 0, sizeof(result));
+	buffer[0] = MM;
+	rv = RUAExchangeProperty(pDCC->pRua, EMHWLIB_MODULE(Enumerator, 0), RMEnumeratorPropertyID_CategoryIDToNumberOfInstances, buffer, sizeof(buffer), &result, sizeof(result));
+	if (rv != RM_OK) {
+		return RM_ERROR;
+	}
+	if (dram >= result[0]) {
+		return RM_ERROR;
+	}
+	pDCC->dram = dram;
+	return RM_OK;
+
+}
+
+RMstatus DCCSTCOpen(struct DCC *pDCC, struct DCCStcProfile *stc_profile, struct DCCSTCSource **ppStcSource)
+{
+	RMstatus rv;
+	RMuint32 buffer[9];
+	struct DCCSTCSource *pStcSource;
+	
+	if (pDCC == NULL) {
+		return RM_INVALID_PARAMETER;
+	}
+	if (pDCC->pRua == NULL) {
+		return RM_INVALIDMODE;
+	}
+
+	pStcSource = malloc(sizeof(*pStcSource));
+
+	pStcSource->pRua = pDCC->pRua;
+	pStcSource->StcModuleId = EMHWLIB_MODULE(STC, stc_profile->STCID);
+	pStcSource->speed_numerator = 1;
+	pStcSource->speed_denominator = 1;
+	pStcSource->running = FALSE;
+	pStcSource->generation = 0;
+
+	memset(buffer, 0, sizeof(buffer));
+	buffer[0] = stc_profile->master;
+	buffer[1] = stc_profile->stc_timer_id;
+	buffer[2] = stc_profile->stc_time_resolution;
+	buffer[3] = stc_profile->video_timer_id;
+	buffer[4] = stc_profile->video_time_resolution;
+	buffer[5] = stc_profile->video_offset;
+	buffer[6] = stc_profile->audio_timer_id;
+	buffer[7] = stc_profile->audio_time_resolution;
+	buffer[8] = stc_profile->audio_offset;
+
+	rv = RUASetProperty(pDCC->pRua, pStcSource->StcModuleId, RMSTCPropertyID_Open, buffer, sizeof(buffer), 0);
+	if (rv != RM_OK) {
+		free(pStcSource);
+		pStcSource = NULL;
+		*ppStcSource = NULL;
+		return rv;
+	}
+	*ppStcSource = pStcSource;
+	return RM_OK;
+}
+
+RMstatus DCCSTCClose(struct DCCSTCSource *pStcSource)
+{
+	RMstatus rv;
+	RMuint32 buffer[9];
+	
+	if (pStcSource == NULL) {
+		return RM_INVALID_PARAMETER;
+	}
+	if (pStcSource->pRua == NULL) {
+		return RM_INVALIDMODE;
+	}
+
+	memset(buffer, 0, sizeof(buffer));
+	buffer[0] = 0;
+
+	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_Close, buffer, sizeof(buffer), 0);
+
+	free(pStcSource);
+	pStcSource = NULL;
+
+	return rv;
+}
+
+RMstatus DCCSTCGetModuleId(struct DCCSTCSource *pStcSource, RMuint32 *stc_id)
+{
+	*stc_id = pStcSource->StcModuleId;
+
+	return RM_OK;
+}
+
+RMstatus DCCSTCSetTimeResolution(struct DCCSTCSource *pStcSource, enum DCCStreamType type, RMuint32 time_resolution)
+{
+	RMstatus rv = RM_ERROR;
+
+	switch(type) {
+		case DCC_Stc:
+			rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_StcTimeResolution, &time_resolution, sizeof(time_resolution), 0);
+			break;
+
+		case DCC_Video:
+			rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_VideoTimeResolution, &time_resolution, sizeof(time_resolution), 0);
+			break;
+
+		case DCC_Audio:
+			rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_AudioTimeResolution, &time_resolution, sizeof(time_resolution), 0);
+			break;
+	}
+	return rv;
+}
+
+RMstatus DCCSTCSetVideoOffset(struct DCCSTCSource *pStcSource, RMint32 time, RMuint32 time_resolution)
+{
+	RMstatus rv;
+	RMuint32 buffer[2];
+
+	buffer[0] = time_resolution;
+	buffer[1] = time;
+
+	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_VideoOffset, &buffer, sizeof(buffer), 0);
+
+	return rv;
+}
+
+RMstatus DCCSTCSetAudioOffset(struct DCCSTCSource *pStcSource, RMint32 time, RMuint32 time_resolution)
+{
+	RMstatus rv;
+	RMuint32 buffer[2];
+
+	buffer[0] = time_resolution;
+	buffer[1] = time;
+
+	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_AudioOffset, &buffer, sizeof(buffer), 0);
+
+	return rv;
+}
+
+RMstatus DCCSTCSetTime(struct DCCSTCSource *pStcSource, RMuint64 time, RMuint32 time_resolution)
+{
+	RMstatus rv;
+	RMuint32 buffer[4];
+
+	if (pStcSource == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (time_resolution == 0) {
+		return RM_ERROR;
+	}
+
+	memset(buffer, 0, sizeof(buffer));
+	buffer[0] = time_resolution;
+	*((RMuint64 *) &buffer[2]) = time;
+
+	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_Time, &buffer, sizeof(buffer), 0);
+	pStcSource->generation++;
+
+	return rv;
+}
+
+RMstatus DCCSTCSetSpeed(struct DCCSTCSource *pStcSource, RMint32 numerator, RMuint32 denominator)
+{
+	RMstatus rv;
+	RMuint32 buffer[6];
+
+	memset(buffer, 0, sizeof(buffer));
+	buffer[0] = numerator;
+	buffer[1] = denominator;
+	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_Speed, &buffer, sizeof(buffer), 0);
+	if (rv == RM_OK) {
+		pStcSource->speed_numerator = numerator;
+		pStcSource->speed_denominator = denominator;
+	}
+	pStcSource->generation++;
+
+	return rv;
+}
+
+RMstatus DCCSTCGetTime(struct DCCSTCSource *pStcSource, RMuint64 *ptime, RMuint32 time_resolution)
+{
+	RMstatus rv;
+
+	if (pStcSource == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+
+	rv = RUAExchangeProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_TimeInfo, &time_resolution, sizeof(time_resolution), ptime, sizeof(*ptime));
+
+	return rv;
+}
+
+RMstatus DCCSTCPlay(struct DCCSTCSource *pStcSource)
+{
+	RMstatus rv;
+
+	if (pStcSource == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+
+	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_Play, NULL, 0, 0);
+	if (rv == RM_OK) {
+		pStcSource->running = TRUE;
+	}
+	pStcSource->generation++;
+
+	return rv;
+}
+
+RMstatus DCCSTCStop(struct DCCSTCSource *pStcSource)
+{
+	RMstatus rv;
+
+	if (pStcSource == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+
+	rv = RUASetProperty(pStcSource->pRua, pStcSource->StcModuleId, RMSTCPropertyID_Stop, NULL, 0, 0);
+	if (rv == RM_OK) {
+		pStcSource->running = FALSE;
+	}
+	pStcSource->generation++;
+
+	return rv;
+}
+
+RMuint64 DCCGetMonotonicUs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((RMuint64) ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/** Interpolate the STC at the monotonic time now_us in the given time resolution. */
+static RMuint64 interpolate_stc_clock(struct DCCSTCClock *pClock, RMuint64 now_us, RMuint32 time_resolution)
+{
+	RMuint64 base;
+	RMuint64 ticks;
+
+	base = pClock->stc_time;
+	if (time_resolution != pClock->time_resolution) {
+		base = base * time_resolution / pClock->time_resolution;
+	}
+	if (!pClock->running || (pClock->speed_numerator == 0) || (pClock->speed_denominator == 0)) {
+		return base;
+	}
+	ticks = (now_us - pClock->sample_us) * time_resolution / 1000000ULL;
+	if (pClock->speed_numerator > 0) {
+		ticks = ticks * pClock->speed_numerator / pClock->speed_denominator;
+		return base + ticks;
+	} else {
+		ticks = ticks * -pClock->speed_numerator / pClock->speed_denominator;
+		if (ticks > base) {
+			return 0;
+		}
+		return base - ticks;
+	}
+}
+
+RMstatus DCCSTCClockOpen(struct DCCSTCSource *pStcSource, RMuint32 time_resolution, RMuint32 resync_interval_ms, RMuint32 max_drift, struct DCCSTCClock **ppClock)
+{
+	struct DCCSTCClock *pClock;
+
+	if ((pStcSource == NULL) || (ppClock == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (time_resolution == 0) {
+		return RM_INVALID_PARAMETER;
+	}
+
+	pClock = malloc(sizeof(*pClock));
+	if (pClock == NULL) {
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pClock, 0, sizeof(*pClock));
+	pClock->pStcSource = pStcSource;
+	pClock->time_resolution = time_resolution;
+	pClock->resync_interval_us = ((RMuint64) resync_interval_ms) * 1000;
+	if (pClock->resync_interval_us < STC_CLOCK_MIN_RESYNC_US) {
+		pClock->resync_interval_us = STC_CLOCK_MIN_RESYNC_US;
+	}
+	pClock->interval_us = pClock->resync_interval_us;
+	pClock->max_drift = max_drift;
+	pClock->valid = FALSE;
+
+	*ppClock = pClock;
+	return RM_OK;
+}
+
+RMstatus DCCSTCClockClose(struct DCCSTCClock *pClock)
+{
+	if (pClock == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	free(pClock);
+	return RM_OK;
+}
+
+/**
+ * Sample the hardware STC. When the interpolated time drifted more than
+ * max_drift from the hardware, the resync interval is shortened, otherwise
+ * it grows back to the configured value.
+ */
+RMstatus DCCSTCClockResync(struct DCCSTCClock *pClock)
+{
+	struct DCCSTCSource *pStcSource;
+	RMuint64 time;
+	RMuint64 now;
+	RMstatus rv;
+
+	if (pClock == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	pStcSource = pClock->pStcSource;
+
+	rv = DCCSTCGetTime(pStcSource, &time, pClock->time_resolution);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	now = DCCGetMonotonicUs();
+
+	if (pClock->valid && (pClock->generation == pStcSource->generation)) {
+		RMuint64 expected;
+		RMuint64 drift;
+
+		expected = interpolate_stc_clock(pClock, now, pClock->time_resolution);
+		drift = (expected > time) ? (expected - time) : (time - expected);
+		if (drift > pClock->max_drift) {
+			pClock->interval_us /= 2;
+			if (pClock->interval_us < STC_CLOCK_MIN_RESYNC_US) {
+				pClock->interval_us = STC_CLOCK_MIN_RESYNC_US;
+			}
+		} else if (pClock->interval_us < pClock->resync_interval_us) {
+			pClock->interval_us *= 2;
+			if (pClock->interval_us > pClock->resync_interval_us) {
+				pClock->interval_us = pClock->resync_interval_us;
+			}
+		}
+	}
+
+	pClock->stc_time = time;
+	pClock->sample_us = now;
+	pClock->speed_numerator = pStcSource->speed_numerator;
+	pClock->speed_denominator = pStcSource->speed_denominator;
+	pClock->running = pStcSource->running;
+	pClock->generation = pStcSource->generation;
+	pClock->valid = TRUE;
+
+	return RM_OK;
+}
+
+/**
+ * Get the STC without accessing the hardware on every call. The hardware is
+ * only sampled when the resync interval elapsed or when the STC was changed
+ * by DCCSTCSetTime(), DCCSTCSetSpeed(), DCCSTCPlay() or DCCSTCStop().
+ */
+RMstatus DCCSTCClockGetTime(struct DCCSTCClock *pClock, RMuint64 *ptime, RMuint32 time_resolution)
+{
+	RMuint64 now;
+	RMstatus rv;
+
+	if ((pClock == NULL) || (ptime == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (time_resolution == 0) {
+		return RM_INVALID_PARAMETER;
+	}
+
+	now = DCCGetMonotonicUs();
+	if (!pClock->valid
+		|| (pClock->generation != pClock->pStcSource->generation)
+		|| ((now - pClock->sample_us) >= pClock->interval_us)) {
+		rv = DCCSTCClockResync(pClock);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		now = pClock->sample_us;
+	}
+
+	*ptime = interpolate_stc_clock(pClock, now, time_resolution);
+
+	return RM_OK;
+}
+
+RMstatus DCCGetVideoModuleIDsFromIndexes(struct DCC *pDCC, RMuint32 MpegEngineID, RMuint32 VideoDecoderID, RMuint32 *MpegModuleID, RMuint32 *DecoderModuleID)
+{
+	RMuint32 buffer[1];
+	RMuint32 number_of_engines;
+	RMuint32 number_of_decoders;
+	RMstatus rv;
+
+	number_of_engines = 0;
+	buffer[0] = MpegEngine;
+	rv = RUAExchangeProperty(pDCC->pRua, EMHWLIB_MODULE(Enumerator, 0), RMEnumeratorPropertyID_CategoryIDToNumberOfInstances, buffer, sizeof(buffer), &number_of_engines, sizeof(number_of_engines));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	if (MpegEngineID >= number_of_engines) {
+		EPRINTF("MpegEngineID %u is larger or equal to %u.\n", MpegEngineID, number_of_engines);
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+
+	buffer[0] = VideoDecoder;
+	rv = RUAExchangeProperty(pDCC->pRua, EMHWLIB_MODULE(Enumerator, 0), RMEnumeratorPropertyID_CategoryIDToNumberOfInstances, buffer, sizeof(buffer), &number_of_decoders, sizeof(number_of_decoders));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	if (VideoDecoderID >= (number_of_decoders / number_of_engines)) {
+		EPRINTF("VideoDecoderID %u is larger or equal to %u.\n", VideoDecoderID, (number_of_decoders / number_of_engines));
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+	if (MpegModuleID != NULL) {
+		*MpegModuleID = EMHWLIB_MODULE(MpegEngine, MpegEngineID);
+	}
+	if (DecoderModuleID != NULL) {
+		*DecoderModuleID = EMHWLIB_MODULE(VideoDecoder, (MpegEngineID * (number_of_decoders / number_of_engines)) + VideoDecoderID);
+	}
+	return RM_OK;
+}
+
+RMstatus DCCGetVideoSourceRequired(struct DCC *pDCC, struct DCCXVideoProfile *dcc_profile, struct DCCResource *resource)
+{
+	RMstatus rv;
+	RMuint32 MpegModuleID;
+	RMuint32 DecoderModuleID;
+	RMuint32 result_shm[2];
+	RMuint32 buffer_mem[6];
+	RMuint32 result_mem[3];
+	RMuint32 result_decmem[2];
+	RMuint32 buffer_dramx[8];
+	RMuint32 result_dramx[3];
+
+	memset(resource, 0, sizeof(*resource));
+
+	rv = DCCGetVideoModuleIDsFromIndexes(pDCC, dcc_profile->MpegEngineID, dcc_profile->VideoDecoderID, &MpegModuleID, &DecoderModuleID);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	rv = RUAGetProperty(pDCC->pRua, MpegModuleID, RMMpegEnginePropertyID_SchedulerSharedMemory, &result_shm, sizeof(result_shm));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	if (result_shm[0] == 0) {
+		resource->schedmemsize = result_shm[1];
+	} else {
+		resource->schedmemsize = 0;
+	}
+
+	buffer_mem[0] = dcc_profile->Codec;
+	buffer_mem[1] = dcc_profile->Profile;
+	buffer_mem[2] = dcc_profile->Level;
+	buffer_mem[3] = dcc_profile->ExtraPictureBufferCount;
+	buffer_mem[4] = dcc_profile->MaxWidth;
+	buffer_mem[5] = dcc_profile->MaxHeight;
+	memset(&result_mem, 0, sizeof(result_mem));
+	rv = RUAExchangeProperty(pDCC->pRua, DecoderModuleID, RMVideoDecoderPropertyID_DecoderDataMemory, buffer_mem, sizeof(buffer_mem), &result_mem, sizeof(result_mem));
+	if (rv != RM_OK) {
+		return rv;
+	}
+
+	rv = RUAGetProperty(pDCC->pRua, MpegModuleID, RMMpegEnginePropertyID_DecoderSharedMemory, &result_decmem, sizeof(result_decmem));
+	if (rv != RM_OK) {
+		return rv;
+	}
+
+	if (result_mem[0] == 0) {
+		resource->decodershmemsize = result_mem[2];
+	} else {
+		if (result_mem[1] < result_mem[2]) {
+			return RM_ERROR;
+		}
+	}
+
+	memset(&result_dramx, 0, sizeof(result_dramx));
+	buffer_dramx[0] = dcc_profile->ProtectedFlags;
+	buffer_dramx[1] = dcc_profile->BitstreamFIFOSize;
+	buffer_dramx[2] = USER_DATA_SIZE;
+	buffer_dramx[3] = result_mem[0];
+	buffer_dramx[4] = dcc_profile->XferFIFOCount;
+	buffer_dramx[5] = dcc_profile->PtsFIFOCount;
+	buffer_dramx[6] = dcc_profile->InbandFIFOCount;
+	buffer_dramx[7] = dcc_profile->XtaskInbandFIFOCount;
+	rv = RUAExchangeProperty(pDCC->pRua, DecoderModuleID, RMVideoDecoderPropertyID_DRAMSizeX, buffer_dramx, sizeof(buffer_dramx), &result_dramx, sizeof(result_dramx));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	resource->picprotsize = result_dramx[0];
+	resource->bitprotsize = result_dramx[1];
+	resource->unprotsize = result_dramx[2];
+
+	if (dcc_profile->reserved1 != 0) {
+		return RM_NOT_SUPPORTED;
+	}
+	resource->reservedsize = 0;
+
+	return RM_OK;
+}
+
+/**
+ * Get the DRAM needed by a video decoder. MaxWidth and MaxHeight of the
+ * profile should be the resolution of the stream, the memory for the
+ * pictures depends on it.
+ */
+RMstatus DCCGetVideoDecoderSourceDRAMSize(struct DCC *pDCC, struct DCCXVideoProfile *dcc_profile, RMuint32 *size)
+{
+	struct DCCResource resource;
+	RMstatus rv;
+
+	if ((pDCC == NULL) || (dcc_profile == NULL) || (size == NULL)) {
+		return RM_INVALID_PARAMETER;
+	}
+	if (pDCC->pRua == NULL) {
+		return RM_INVALIDMODE;
+	}
+
+	rv = DCCGetVideoSourceRequired(pDCC, dcc_profile, &resource);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	*size = resource.schedmemsize + resource.decodershmemsize + resource.picprotsize
+		+ resource.bitprotsize + resource.unprotsize + resource.reservedsize;
+
+	return RM_OK;
+}
+
+/** Free resources allocated by DCCXOpenVideoDecoderSource(). */
+static void free_video_resources(struct DCC *pDCC, struct DCCResource *resource)
+{
+	RMuint32 *addr[6];
+	unsigned int i;
+
+	addr[0] = &resource->schedmem;
+	addr[1] = &resource->decodershmem;
+	addr[2] = &resource->picprot;
+	addr[3] = &resource->bitprot;
+	addr[4] = &resource->unprot;
+	addr[5] = &resource->reserveddata;
+
+	for (i = 0; i < sizeof(addr) / sizeof(addr[0]); i++) {
+		if (*addr[i] != 0) {
+			pDCC->rua_free(pDCC->pRua, *addr[i]);
+			*addr[i] = 0;
+		}
+	}
+}
+
+RMstatus DCCXOpenVideoDecoderSourceWithResources(struct DCC *pDCC, struct DCCXVideoProfile *dcc_profile, struct DCCResource *resource, struct DCCVideoSource **ppVideoSource)
+{
+	RMstatus rv;
+	RMuint32 MpegModuleID;
+	RMuint32 DecoderModuleID;
+	struct DCCVideoSource *pVideoSource;
+	RMuint32 buffer_mem[6];
+	RMuint32 result_mem[3];
+	RMuint32 buffer_open[18];
+	RMuint32 buffer_surface[1];
+
+	pVideoSource = malloc(sizeof(*pVideoSource));
+	if (pVideoSource == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pVideoSource, 0, sizeof(*pVideoSource));
+	pVideoSource->pRua = pDCC->pRua;
+	pVideoSource->pDCC = pDCC;
+	*ppVideoSource = pVideoSource;
+
+	rv = DCCGetVideoModuleIDsFromIndexes(pDCC, dcc_profile->MpegEngineID, dcc_profile->VideoDecoderID, &MpegModuleID, &DecoderModuleID);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	pVideoSource->enginemoduleid = MpegModuleID;
+	pVideoSource->decodermoduleid = DecoderModuleID;
+
+	pVideoSource->STCID = dcc_profile->STCID;
+
+	if (resource->schedmemsize != 0) {
+		RMuint32 buffer[2];
+
+		buffer[0] = resource->schedmem;
+		buffer[1] = resource->schedmemsize;
+		rv = set_property(pDCC->pRua, MpegModuleID, RMMpegEnginePropertyID_SchedulerSharedMemory, &buffer, sizeof(buffer));
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+
+	if (resource->decodershmemsize != 0) {
+		RMuint32 buffer[2];
+
+		buffer[0] = resource->decodershmem;
+		buffer[1] = resource->decodershmemsize;
+		rv = set_property(pDCC->pRua, MpegModuleID, RMMpegEnginePropertyID_DecoderSharedMemory, &buffer, sizeof(buffer));
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+
+	pVideoSource->picprot = resource->picprot;
+	pVideoSource->bitprot = resource->bitprot;
+	pVideoSource->unprot = resource->unprot;
+
+	buffer_mem[0] = dcc_profile->Codec;
+	buffer_mem[1] = dcc_profile->Profile;
+	buffer_mem[2] = dcc_profile->Level;
+	buffer_mem[3] = dcc_profile->ExtraPictureBufferCount;
+	buffer_mem[4] = dcc_profile->MaxWidth;
+	buffer_mem[5] = dcc_profile->MaxHeight;
+	memset(&result_mem, 0, sizeof(result_mem));
+	rv = RUAExchangeProperty(pDCC->pRua, DecoderModuleID, RMVideoDecoderPropertyID_DecoderDataMemory, buffer_mem, sizeof(buffer_mem), &result_mem, sizeof(result_mem));
+	if (rv != RM_OK) {
+		return rv;
+	}
+
+	memset(buffer_open, 0, sizeof(*buffer_open));
+	buffer_open[0] = dcc_profile->ProtectedFlags;
+	buffer_open[1] = dcc_profile->BitstreamFIFOSize;
+	buffer_open[2] = USER_DATA_SIZE;
+	buffer_open[3] = result_mem[0]; /* decoder data size. */
+	buffer_open[4] = result_mem[1]; /* decoder context size. */
+	buffer_open[5] = dcc_profile->ExtraPictureBufferCount;
+	buffer_open[6] = dcc_profile->XferFIFOCount;
+	buffer_open[7] = dcc_profile->PtsFIFOCount;
+	buffer_open[8] = dcc_profile->InbandFIFOCount;
+	buffer_open[9] = dcc_profile->XtaskInbandFIFOCount;
+	buffer_open[10] = dcc_profile->STCID;
+	buffer_open[11] = dcc_profile->XtaskID;
+	buffer_open[12] = resource->picprot;
+	buffer_open[13] = resource->picprotsize;
+	buffer_open[14] = resource->bitprot;
+	buffer_open[15] = resource->bitprotsize;
+	buffer_open[16] = resource->unprot;
+	buffer_open[17] = resource->unprotsize;
+	rv = set_property(pDCC->pRua, DecoderModuleID, RMVideoDecoderPropertyID_OpenX, &buffer_open, sizeof(buffer_open));
+	if (rv != RM_OK) {
+		return rv;
+	}
+
+	rv = RUAGetProperty(pDCC->pRua, DecoderModuleID, RMGenericPropertyID_Surface, &buffer_surface, sizeof(buffer_surface));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	pVideoSource->surface = buffer_surface[0];
+	return rv;
+}
+
+RMstatus DCCXOpenVideoDecoderSource(struct DCC *pDCC, struct DCCXVideoProfile *dcc_profile, struct DCCVideoSource **ppVideoSource)
+{
+	RMstatus rv;
+	struct DCCResource resource;
+	RMuint32 dram;
+
+	if (pDCC == NULL) {
+		return RM_INVALID_PARAMETER;
+	}
+	if (pDCC->pRua == NULL) {
+		return RM_INVALIDMODE;
+	}
+
+	/* Each MPEG engine uses the DRAM controller with the same index. */
+	dram = dcc_profile->MpegEngineID;
+
+	rv = DCCGetVideoSourceRequired(pDCC, dcc_profile, &resource);
 	if (rv != RM_OK) {
 		return rv;
 	}
-	rv = RUAGetProperty(pDCC->pRua, MpegModuleID, RMMpegEnginePropertyID_SchedulerSharedMemory, &result_shm, sizeof(result_shm));
+	if (resource.schedmemsize != 0) {
+		resource.schedmem = pDCC->rua_malloc(pDCC->pRua, 0, dram, RUA_DRAM_UNPROTECTED, resource.schedmemsize);
+		if (resource.schedmem == 0) {
+			EPRINTF("Failed to allocate %u bytes in DRAM %u.\n", resource.schedmemsize, dram);
+			free_video_resources(pDCC, &resource);
+			return RM_FATALOUTOFMEMORY;
+		}
+	}
+	if (resource.decodershmemsize != 0) {
+		resource.decodershmem = pDCC->rua_malloc(pDCC->pRua, 0, dram, RUA_DRAM_UNPROTECTED, resource.decodershmemsize);
+		if (resource.decodershmem == 0) {
+			EPRINTF("Failed to allocate %u bytes in DRAM %u.\n", resource.decodershmemsize, dram);
+			free_video_resources(pDCC, &resource);
+			return RM_FATALOUTOFMEMORY;
+		}
+	}
+	if (resource.picprotsize != 0) {
+		resource.picprot = pDCC->rua_malloc(pDCC->pRua, 0, dram, RUA_DRAM_UNPROTECTED, resource.picprotsize);
+		if (resource.picprot == 0) {
+			EPRINTF("Failed to allocate %u bytes in DRAM %u.\n", resource.picprotsize, dram);
+			free_video_resources(pDCC, &resource);
+			return RM_FATALOUTOFMEMORY;
+		}
+	}
+	if (resource.bitprotsize != 0) {
+		resource.bitprot = pDCC->rua_malloc(pDCC->pRua, 0, dram, RUA_DRAM_UNPROTECTED, resource.bitprotsize);
+		if (resource.bitprot == 0) {
+			EPRINTF("Failed to allocate %u bytes in DRAM %u.\n", resource.bitprotsize, dram);
+			free_video_resources(pDCC, &resource);
+			return RM_FATALOUTOFMEMORY;
+		}
+	}
+	if (resource.unprotsize != 0) {
+		resource.unprot = pDCC->rua_malloc(pDCC->pRua, 0, dram, RUA_DRAM_UNPROTECTED, resource.unprotsize);
+		if (resource.unprot == 0) {
+			EPRINTF("Failed to allocate %u bytes in DRAM %u.\n", resource.unprotsize, dram);
+			free_video_resources(pDCC, &resource);
+			return RM_FATALOUTOFMEMORY;
+		}
+	}
+	if (resource.reservedsize != 0) {
+		resource.reserveddata = pDCC->rua_malloc(pDCC->pRua, 0, dram, RUA_DRAM_UNPROTECTED, resource.reservedsize);
+		if (resource.reserveddata == 0) {
+			EPRINTF("Failed to allocate %u bytes in DRAM %u.\n", resource.reservedsize, dram);
+			free_video_resources(pDCC, &resource);
+			return RM_FATALOUTOFMEMORY;
+		}
+	}
+
+	rv = DCCXOpenVideoDecoderSourceWithResources(pDCC, dcc_profile, &resource, ppVideoSource);
 	if (rv != RM_OK) {
 		return rv;
 	}
-	if (result_shm[0] == 0) {
-		resource->schedmemsize = result_shm[1];
-	} else {
-		resource->schedmemsize = 0;
+
+	if (dcc_profile->SPUBitstreamFIFOSize != 0) {
+		EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
+
+		/* TBD: Implement DCCOpenSPUDecoderSource. */
+
+		return RM_NOTIMPLEMENTED;
 	}
+	return RM_OK;
+}
 
-	buffer_mem[0] = dcc_profile->Codec;
-	buffer_mem[1] = dcc_profile->Profile;
-	buffer_mem[2] = dcc_profile->Level;
-	buffer_mem[3] = dcc_profile->ExtraPictureBufferCount;
-	buffer_mem[4] = dcc_profile->MaxWidth;
-	buffer_mem[5] = dcc_profile->MaxHeight;
-	memset(&result_mem, 0, sizeof(result_mem));
-	rv = RUAExchangeProperty(pDCC->pRua, DecoderModuleID, RMVideoDecoderPropertyID_DecoderDataMemory, buffer_mem, sizeof(buffer_mem), &result_mem, sizeof(result_mem));
+RMstatus DCCCloseVideoSource(struct DCCVideoSource *pVideoSource)
+{
+	RMstatus rv;
+
+	if (pVideoSource->spu_decoder != NULL) {
+		EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
+
+		/* TBD: Implement SPUDisconnectSPUFromScaler(). */
+		return RM_NOTIMPLEMENTED;
+	} else if (pVideoSource->spudecodermoduleid != 0) {
+		EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
+
+		return RM_NOTIMPLEMENTED;
+	}
+	if (pVideoSource->scalermoduleid != 0) {
+		RMuint32 surface;
+		rv = RUAGetProperty(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_Surface, &surface, sizeof(surface));
+		if (rv != RM_OK) {
+			return rv;
+		}
+		if (surface != 0) {
+			surface = 0;
+			rv = set_property(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_Surface, &surface, sizeof(surface));
+			if (rv != RM_OK) {
+				return rv;
+			}
+		}
+	}
+
+	// TBD: Implement SPU stuff.
+
+	if (pVideoSource->decodermoduleid != 0) {
+		RMuint32 buffer[1];
+		memset(buffer, 0, sizeof(buffer));
+
+		switch(pVideoSource->decodermoduleid & 0xFF) {
+			case DispVideoInput:
+				rv = set_property(pVideoSource->pRua, pVideoSource->decodermoduleid, RMDispVideoInputPropertyID_Close, &buffer, sizeof(buffer));
+				break;
+
+			case DispGraphicInput:
+				rv = set_property(pVideoSource->pRua, pVideoSource->decodermoduleid, RMDispGraphicInputPropertyID_Close, &buffer, sizeof(buffer));
+				break;
+
+			default:
+				rv = set_property(pVideoSource->pRua, pVideoSource->decodermoduleid, RMVideoDecoderPropertyID_Close, &buffer, sizeof(buffer));
+				break;
+		}
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+
+	if (pVideoSource->picprot != 0) {
+		pVideoSource->pDCC->rua_free(pVideoSource->pRua, pVideoSource->picprot);
+		pVideoSource->picprot = 0;
+	}
+	if (pVideoSource->bitprot != 0) {
+		pVideoSource->pDCC->rua_free(pVideoSource->pRua, pVideoSource->bitprot);
+		pVideoSource->bitprot = 0;
+	}
+	if (pVideoSource->unprot != 0) {
+		pVideoSource->pDCC->rua_free(pVideoSource->pRua, pVideoSource->unprot);
+		pVideoSource->unprot = 0;
+	}
+	if (pVideoSource->enginemoduleid != 0) {
+		RMuint32 count;
+
+		rv = RUAGetProperty(pVideoSource->pRua, pVideoSource->enginemoduleid, RMMpegEnginePropertyID_ConnectedTaskCount, &count, sizeof(count));
+		if (rv != RM_OK) {
+			return rv;
+		}
+		if (count == 0) {
+			RMuint32 result_decmem[2];
+
+			rv = RUAGetProperty(pVideoSource->pRua, pVideoSource->enginemoduleid, RMMpegEnginePropertyID_DecoderSharedMemory, &result_decmem, sizeof(result_decmem));
+			if (rv != RM_OK) {
+				return rv;
+			}
+			if (result_decmem[0] != 0) {
+				RMuint32 address;
+
+				address = result_decmem[0];
+				result_decmem[0] = 0;
+				result_decmem[1] = 0;
+
+				rv = set_property(pVideoSource->pRua, pVideoSource->enginemoduleid, RMMpegEnginePropertyID_DecoderSharedMemory, &result_decmem, sizeof(result_decmem));
+				if (rv != RM_OK) {
+					return rv;
+				}
+
+				RUAFree(pVideoSource->pRua, address);
+			}
+
+			rv = RUAGetProperty(pVideoSource->pRua, pVideoSource->enginemoduleid, RMMpegEnginePropertyID_SchedulerSharedMemory, &result_decmem, sizeof(result_decmem));
+			if (rv != RM_OK) {
+				return rv;
+			}
+			if (result_decmem[0] != 0) {
+				RMuint32 address;
+
+				address = result_decmem[0];
+				result_decmem[0] = 0;
+				result_decmem[1] = 0;
+
+				rv = set_property(pVideoSource->pRua, pVideoSource->enginemoduleid, RMMpegEnginePropertyID_SchedulerSharedMemory, &result_decmem, sizeof(result_decmem));
+				if (rv != RM_OK) {
+					return rv;
+				}
+
+				rv = RUASetAddressID(pVideoSource->pRua, address, 0);
+				if (rv != RM_OK) {
+					return rv;
+				}
+
+				RUAFree(pVideoSource->pRua, address);
+			}
+		}
+	}
+	if ((pVideoSource->decodermoduleid == 0) && (pVideoSource->surface != 0)) {
+		/* Surface of OSD video source. */
+		pVideoSource->pDCC->rua_free(pVideoSource->pRua, pVideoSource->surface);
+		pVideoSource->surface = 0;
+	}
+	if (pVideoSource->pic_info != NULL) {
+		free(pVideoSource->pic_info);
+		pVideoSource->pic_info = NULL;
+	}
+	free(pVideoSource);
+	pVideoSource = NULL;
+
+	return RM_OK;
+}
+
+RMstatus DCCXSetVideoDecoderSourceCodec(struct DCCVideoSource *pVideoSource, enum EMhwlibVideoCodec Codec)
+{
+	RMstatus rv;
+
+	rv = send_video_command(pVideoSource->pRua, pVideoSource->decodermoduleid, 0);
 	if (rv != RM_OK) {
 		return rv;
 	}
-
-	rv = RUAGetProperty(pDCC->pRua, MpegModuleID, RMMpegEnginePropertyID_DecoderSharedMemory, &result_decmem, sizeof(result_decmem));
+	rv = set_property(pVideoSource->pRua, pVideoSource->decodermoduleid, RMVideoDecoderPropertyID_CodecX, &Codec, sizeof(Codec));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	rv = send_video_command(pVideoSource->pRua, pVideoSource->decodermoduleid, 1);
 	if (rv != RM_OK) {
 		return rv;
 	}
+	if (pVideoSource->spu_decoder != NULL) {
+		EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
 
-	if (result_mem[0] == 0) {
-		resource->decodershmemsize = result_mem[2];
-	} else {
-		if (result_mem[1] < result_mem[2]) {
-			return RM_ERROR;
+		/* TBD: Implement DCCResetSPUDecoderSource(). */
+
+		return RM_NOTIMPLEMENTED;
+	} else if (pVideoSource->spudecodermoduleid != 0) {
+		rv = send_video_command(pVideoSource->pRua, pVideoSource->spudecodermoduleid, 0);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		Codec = EMhwlibDVDSpuCodec;
+		rv = set_property(pVideoSource->pRua, pVideoSource->spudecodermoduleid, RMSpuDecoderPropertyID_CodecX, &Codec, sizeof(Codec));
+		if (rv != RM_OK) {
+			return rv;
 		}
 	}
+	return RM_OK;
+}
 
-	memset(&result_dramx, 0, sizeof(result_dramx));
-	buffer_dramx[0] = dcc_profile->ProtectedFlags;
-	buffer_dramx[1] = dcc_profile->BitstreamFIFOSize;
-	buffer_dramx[2] = USER_DATA_SIZE;
-	buffer_dramx[3] = result_mem[0];
-	buffer_dramx[4] = dcc_profile->XferFIFOCount;
-	buffer_dramx[5] = dcc_profile->PtsFIFOCount;
-	buffer_dramx[6] = dcc_profile->InbandFIFOCount;
-	buffer_dramx[7] = dcc_profile->XtaskInbandFIFOCount;
-	rv = RUAExchangeProperty(pDCC->pRua, DecoderModuleID, RMVideoDecoderPropertyID_DRAMSizeX, buffer_dramx, sizeof(buffer_dramx), &result_dramx, sizeof(result_dramx));
-	if (rv != RM_OK) {
-		return rv;
+RMstatus DCCGetVideoDecoderSourceInfo(struct DCCVideoSource *pVideoSource, RMuint32 *video_decoder, RMuint32 *spu_decoder, RMuint32 *timer)
+{
+	if (video_decoder != NULL) {
+		*video_decoder = pVideoSource->decodermoduleid;
 	}
-	resource->picprotsize = result_dramx[0];
-	resource->bitprotsize = result_dramx[1];
-	resource->unprotsize = result_dramx[2];
+	if (timer != NULL) {
+		*timer = pVideoSource->STCID;
+	}
+	if (spu_decoder != NULL) {
+		*spu_decoder = pVideoSource->spudecodermoduleid;
+	}
+	return RM_OK;
+}
 
-	if (dcc_profile->reserved1 != 0) {
-		return RM_NOT_SUPPORTED;
+RMstatus DCCPlayVideoSource(struct DCCVideoSource *pVideoSource, enum DCCVideoPlayCommand cmd)
+{
+	RMstatus rv;
+
+	if (cmd == DCCVideoPlayNextFrame) {
+		if (pVideoSource->scalermoduleid != 0) {
+			rv = set_property(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_Step, NULL, 0);
+			if (rv != RM_OK) {
+				return rv;
+			}
+		}
+	} else {
+		rv = send_video_command(pVideoSource->pRua, pVideoSource->decodermoduleid, cmd);
+		if (rv != RM_OK) {
+			return rv;
+		}
 	}
-	resource->reservedsize = 0;
+	if (pVideoSource->spu_decoder != NULL) {
+		EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
+		/* TBD: Implement DCCPlaySPUSource(). */
+
+		return RM_NOTIMPLEMENTED;
+	} else {
+		if (pVideoSource->spudecodermoduleid != 0) {
+			EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
+			/* TBD: Implement send_spu_command(pVideoSource->pRua, pVideoSource->spudecodermoduleid, 3). */
 
+			return RM_NOTIMPLEMENTED;
+		}
+	}
 	return RM_OK;
 }
 
-RMstatus DCCXOpenVideoDecoderSourceWithResources(struct DCC *pDCC, struct DCCXVideoProfile *dcc_profile, struct DCCResource *resource, struct DCCVideoSource **ppVideoSource)
+RMstatus DCCStopVideoSource(struct DCCVideoSource *pVideoSource, enum DCCStopMode stop_mode)
 {
 	RMstatus rv;
-	RMuint32 MpegModuleID;
-	RMuint32 DecoderModuleID;
-	struct DCCVideoSource *pVideoSource;
-	RMuint32 buffer_mem[6];
-	RMuint32 result_mem[3];
-	RMuint32 buffer_open[18];
-	RMuint32 buffer_surface[1];
-
-	pVideoSource = malloc(sizeof(*pVideoSource));
-	if (pVideoSource == NULL) {
-		fprintf(stderr, "Error: out of memory\n");
-
-		return RM_FATALOUTOFMEMORY;
-	}
-	memset(pVideoSource, 0, sizeof(*pVideoSource));
-	pVideoSource->pRua = pDCC->pRua;
-	pVideoSource->pDCC = pDCC;
-	*ppVideoSource = pVideoSource;
 
-	rv = DCCGetVideoModuleIDsFromIndexes(pDCC, dcc_profile->MpegEngineID, dcc_profile->VideoDecoderID, &MpegModuleID, &DecoderModuleID);
+	rv = send_video_command(pVideoSource->pRua, pVideoSource->decodermoduleid, 2);
 	if (rv != RM_OK) {
-		return rv;
+		return RM_OK;
 	}
-	pVideoSource->enginemoduleid = MpegModuleID;
-	pVideoSource->decodermoduleid = DecoderModuleID;
-
-	pVideoSource->STCID = dcc_profile->STCID;
+	if (pVideoSource->spu_decoder != NULL) {
+		EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
+		/* TBD: Implement DCCPlaySPUSource(). */
 
-	if (resource->schedmemsize != 0) {
-		RMuint32 buffer[2];
+		return RM_NOTIMPLEMENTED;
+	} else {
+		if (pVideoSource->spudecodermoduleid != 0) {
+			EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
+			/* TBD: Implement send_spu_command(pVideoSource->pRua, pVideoSource->spudecodermoduleid, 3). */
 
-		buffer[0] = resource->schedmem;
-		buffer[1] = resource->schedmemsize;
-		rv = set_property(pDCC->pRua, MpegModuleID, RMMpegEnginePropertyID_SchedulerSharedMemory, &buffer, sizeof(buffer));
-		if (rv != RM_OK) {
-			return rv;
+			return RM_NOTIMPLEMENTED;
 		}
 	}
+	if (pVideoSource->scalermoduleid != 0) {
+		struct RUAEvent evt;
+		RMuint32 ModuleID;
+		RMuint32 index;
 
-	if (resource->decodershmemsize != 0) {
-		RMuint32 buffer[2];
+		switch (stop_mode) {
+			case DCCStopMode_BlackFrame:
+				rv = set_property(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_Stop, NULL, 0);
+				if (rv != RM_OK) {
+					return rv;
+				}
+				break;
 
-		buffer[0] = resource->decodershmem;
-		buffer[1] = resource->decodershmemsize;
-		rv = set_property(pDCC->pRua, MpegModuleID, RMMpegEnginePropertyID_DecoderSharedMemory, &buffer, sizeof(buffer));
+			case DCCStopMode_LastFrame:
+				rv = set_property(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_Flush, NULL, 0);
+				if (rv != RM_OK) {
+					return rv;
+				}
+				break;
+		}
+		ModuleID = EMHWLIB_MODULE(DisplayBlock, 0);
+		get_event_mask(pVideoSource->scalermoduleid, &evt);
+		if (evt.Mask != 0) {
+			rv = RUAResetEvent(pVideoSource->pRua, &evt);
+			if (rv != RM_OK) {
+				fprintf(stderr, "reset_event failed for ModuleID %d\n", ModuleID & 0xFF);
+				return rv;
+			}
+		}
+		rv = RUAWaitForMultipleEvents(pVideoSource->pRua, &evt, 1, 1000000, &index);
 		if (rv != RM_OK) {
 			return rv;
 		}
 	}
 
-	pVideoSource->picprot = resource->picprot;
-	pVideoSource->bitprot = resource->bitprot;
-	pVideoSource->unprot = resource->unprot;
+	return RM_OK;
+}
 
-	buffer_mem[0] = dcc_profile->Codec;
-	buffer_mem[1] = dcc_profile->Profile;
-	buffer_mem[2] = dcc_profile->Level;
-	buffer_mem[3] = dcc_profile->ExtraPictureBufferCount;
-	buffer_mem[4] = dcc_profile->MaxWidth;
-	buffer_mem[5] = dcc_profile->MaxHeight;
-	memset(&result_mem, 0, sizeof(result_mem));
-	rv = RUAExchangeProperty(pDCC->pRua, DecoderModuleID, RMVideoDecoderPropertyID_DecoderDataMemory, buffer_mem, sizeof(buffer_mem), &result_mem, sizeof(result_mem));
-	if (rv != RM_OK) {
-		return rv;
+RMstatus DCCSetVideoSourceBitrate(struct DCCVideoSource *pVideoSource, RMuint32 bitrate)
+{
+	if (pVideoSource == NULL) {
+		return RM_FATALINVALIDPOINTER;
 	}
+	pVideoSource->bitrate = bitrate;
+	return RM_OK;
+}
 
-	memset(buffer_open, 0, sizeof(*buffer_open));
-	buffer_open[0] = dcc_profile->ProtectedFlags;
-	buffer_open[1] = dcc_profile->BitstreamFIFOSize;
-	buffer_open[2] = USER_DATA_SIZE;
-	buffer_open[3] = result_mem[0]; /* decoder data size. */
-	buffer_open[4] = result_mem[1]; /* decoder context size. */
-	buffer_open[5] = dcc_profile->ExtraPictureBufferCount;
-	buffer_open[6] = dcc_profile->XferFIFOCount;
-	buffer_open[7] = dcc_profile->PtsFIFOCount;
-	buffer_open[8] = dcc_profile->InbandFIFOCount;
-	buffer_open[9] = dcc_profile->XtaskInbandFIFOCount;
-	buffer_open[10] = dcc_profile->STCID;
-	buffer_open[11] = dcc_profile->XtaskID;
-	buffer_open[12] = resource->picprot;
-	buffer_open[13] = resource->picprotsize;
-	buffer_open[14] = resource->bitprot;
-	buffer_open[15] = resource->bitprotsize;
-	buffer_open[16] = resource->unprot;
-	buffer_open[17] = resource->unprotsize;
-	rv = set_property(pDCC->pRua, DecoderModuleID, RMVideoDecoderPropertyID_OpenX, &buffer_open, sizeof(buffer_open));
-	if (rv != RM_OK) {
-		return rv;
+RMstatus DCCGetVideoFIFOLevel(struct DCCVideoSource *pVideoSource, RMuint32 time_resolution, struct DCCFIFOLevel *level)
+{
+	if (pVideoSource == NULL) {
+		return RM_FATALINVALIDPOINTER;
 	}
-
-	rv = RUAGetProperty(pDCC->pRua, DecoderModuleID, RMGenericPropertyID_Surface, &buffer_surface, sizeof(buffer_surface));
-	if (rv != RM_OK) {
-		return rv;
+	if (pVideoSource->decodermoduleid == 0) {
+		return RM_INVALIDMODE;
 	}
-	pVideoSource->surface = buffer_surface[0];
-	return rv;
+	return get_fifo_level(pVideoSource->pRua, pVideoSource->decodermoduleid, RMVideoDecoderPropertyID_BtsFIFO, RMVideoDecoderPropertyID_PtsFIFO, pVideoSource->bitrate, time_resolution, level);
 }
 
-RMstatus DCCXOpenVideoDecoderSource(struct DCC *pDCC, struct DCCXVideoProfile *dcc_profile, struct DCCVideoSource **ppVideoSource)
+RMstatus DCCWaitVideoFIFOLevel(struct DCCVideoSource *pVideoSource, RMuint32 level, RMuint32 TimeOut_us)
 {
-	RMstatus rv;
-	struct DCCResource resource;
-
-	if (pDCC == NULL) {
-		return RM_INVALID_PARAMETER;
+	if (pVideoSource == NULL) {
+		return RM_FATALINVALIDPOINTER;
 	}
-	if (pDCC->pRua == NULL) {
+	if (pVideoSource->decodermoduleid == 0) {
 		return RM_INVALIDMODE;
 	}
+	return wait_fifo_level(pVideoSource->pRua, pVideoSource->decodermoduleid, RMVideoDecoderPropertyID_BtsFIFO, RMVideoDecoderPropertyID_PtsFIFO, level, TimeOut_us);
+}
 
-	if (pDCC->dram != dcc_profile->MpegEngineID) {
-		return RM_ERROR;
+RMstatus DCCOpenAudioDecoderSource(struct DCC *pDCC, struct DCCAudioProfile *dcc_profile, struct DCCAudioSource **ppAudioSource)
+{
+	struct DCCAudioSource *pAudioSource;
+	RMstatus rv;
+	RMuint32 audioengineid = AudioEngine;
+	RMuint32 audiodecoderid = AudioDecoder;
+	RMuint32 number_of_engines;
+	RMuint32 number_of_decoders;
+	RMuint32 buffer_info[2];
+	RMuint32 result_info[1];
+	RMuint32 result_shm[2];
+	RMuint32 buffer_dram[4];
+	RMuint32 result_dram[2];
+	RMuint32 buffer_shared[10];
+
+	pAudioSource = malloc(sizeof(*pAudioSource));
+	if (pAudioSource == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+
+		return RM_FATALOUTOFMEMORY;
 	}
+	memset(pAudioSource, 0, sizeof(*pAudioSource));
+	pAudioSource->pRua = pDCC->pRua;
+	pAudioSource->pDCC = pDCC;
+	pAudioSource->STCID = dcc_profile->STCID;
 
-	rv = DCCGetVideoSourceRequired(pDCC, dcc_profile, &resource);
+	rv = RUAExchangeProperty(pDCC->pRua, EMHWLIB_MODULE(Enumerator, 0), RMEnumeratorPropertyID_CategoryIDToNumberOfInstances, &audioengineid, sizeof(audioengineid), &number_of_engines, sizeof(number_of_engines));
 	if (rv != RM_OK) {
 		return rv;
 	}
-	if (resource.schedmemsize != 0) {
-		resource.schedmem = pDCC->rua_malloc(pDCC->pRua, 0, pDCC->dram, RUA_DRAM_UNPROTECTED, resource.schedmemsize);
-		if (resource.schedmem == 0) {
-			return RM_FATALOUTOFMEMORY;
-		}
+	if (dcc_profile->AudioEngineID >= number_of_engines) {
+		return RM_PARAMETER_OUT_OF_RANGE;
 	}
-	if (resource.decodershmemsize != 0) {
-		resource.decodershmem = pDCC->rua_malloc(pDCC->pRua, 0, pDCC->dram, RUA_DRAM_UNPROTECTED, resource.decodershmemsize);
-		if (resource.decodershmem == 0) {
-			return RM_FATALOUTOFMEMORY;
-		}
+	rv = RUAExchangeProperty(pDCC->pRua, EMHWLIB_MODULE(Enumerator, 0), RMEnumeratorPropertyID_CategoryIDToNumberOfInstances, &audiodecoderid, sizeof(audiodecoderid), &number_of_decoders, sizeof(number_of_decoders));
+	if (rv != RM_OK) {
+		return rv;
 	}
-	if (resource.picprotsize != 0) {
-		resource.picprot = pDCC->rua_malloc(pDCC->pRua, 0, pDCC->dram, RUA_DRAM_UNPROTECTED, resource.picprotsize);
-		if (resource.picprot == 0) {
-			return RM_FATALOUTOFMEMORY;
-		}
+	if (dcc_profile->AudioDecoderID >= number_of_decoders/number_of_engines) {
+		return RM_PARAMETER_OUT_OF_RANGE;
 	}
-	if (resource.bitprotsize != 0) {
-		resource.bitprot = pDCC->rua_malloc(pDCC->pRua, 0, pDCC->dram, RUA_DRAM_UNPROTECTED, resource.bitprotsize);
-		if (resource.bitprot == 0) {
-			return RM_FATALOUTOFMEMORY;
+	pAudioSource->enginemoduleid = EMHWLIB_MODULE(AudioEngine, dcc_profile->AudioEngineID);
+	pAudioSource->decodermoduleid = EMHWLIB_MODULE(AudioDecoder, dcc_profile->AudioDecoderID);
+	memset(buffer_info, 0, sizeof(buffer_info));
+	rv = RUAExchangeProperty(pDCC->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_DecoderSharedMemoryInfo, buffer_info, sizeof(buffer_info), result_info, sizeof(result_info));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	rv = RUAGetProperty(pDCC->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_DecoderSharedMemory, &result_shm, sizeof(result_shm));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	if (result_shm[0] == 0) {
+		result_shm[0] = pDCC->rua_malloc(pDCC->pRua, pAudioSource->enginemoduleid, pDCC->dram, RUA_DRAM_UNPROTECTED, result_info[0]);
+		result_shm[1] = result_info[0];
+		rv = set_property(pDCC->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_DecoderSharedMemory, &result_shm, sizeof(result_shm));
+		if (rv != RM_OK) {
+			return rv;
 		}
+		pAudioSource->reserved1C = 1;
+	} else {
+		pAudioSource->reserved1C = 1;
 	}
-	if (resource.unprotsize != 0) {
-		resource.unprot = pDCC->rua_malloc(pDCC->pRua, 0, pDCC->dram, RUA_DRAM_UNPROTECTED, resource.unprotsize);
-		if (resource.unprot == 0) {
+	memset(buffer_dram, 0, sizeof(buffer_dram));
+	buffer_dram[0] = 12;
+	buffer_dram[1] = 0x00000F00;
+	buffer_dram[2] = dcc_profile->BitstreamFIFOSize;
+	buffer_dram[3] = dcc_profile->XferFIFOCount;
+	rv = RUAExchangeProperty(pDCC->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_DRAMSize, buffer_dram, sizeof(buffer_dram), result_dram, sizeof(result_dram));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	memset(buffer_shared, 0, sizeof(buffer_shared));
+	buffer_shared[0] = buffer_dram[0]; // 0x00
+	buffer_shared[1] = buffer_dram[1]; // 0x04
+	buffer_shared[2] = dcc_profile->BitstreamFIFOSize; // 0x08
+	buffer_shared[3] = dcc_profile->XferFIFOCount; // 0x0c
+	buffer_shared[4] = 0; // 0x10
+	buffer_shared[5] = result_dram[0]; // 0x14
+	buffer_shared[6] = 0; // 0x18
+	buffer_shared[7] = result_dram[1]; // 0x1c
+	buffer_shared[8] = dcc_profile->DemuxProgramID; // 0x20
+	buffer_shared[9] = dcc_profile->STCID; //0x24
+	if (result_dram[0] != 0) {
+		buffer_shared[4] = pDCC->rua_malloc(pDCC->pRua, pAudioSource->enginemoduleid, pDCC->dram, RUA_DRAM_UNPROTECTED, result_dram[0]);
+		if (buffer_shared[4] == 0) {
 			return RM_FATALOUTOFMEMORY;
 		}
+		pAudioSource->mem1 = buffer_shared[4];
 	}
-	if (resource.reservedsize != 0) {
-		resource.reserveddata = pDCC->rua_malloc(pDCC->pRua, 0, pDCC->dram, RUA_DRAM_UNPROTECTED, resource.reservedsize);
-		if (resource.reserveddata == 0) {
+	if (result_dram[1] != 0) {
+		buffer_shared[6] = pDCC->rua_malloc(pDCC->pRua, pAudioSource->enginemoduleid, pDCC->dram, RUA_DRAM_UNPROTECTED, result_dram[1]);
+		if (buffer_shared[6] == 0) {
 			return RM_FATALOUTOFMEMORY;
 		}
-	}
-
-	rv = DCCXOpenVideoDecoderSourceWithResources(pDCC, dcc_profile, &resource, ppVideoSource);
+		pAudioSource->mem2 = buffer_shared[6];
+	}
+	rv = set_property(pDCC->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_Open, &buffer_shared, sizeof(buffer_shared));
 	if (rv != RM_OK) {
 		return rv;
 	}
+	*ppAudioSource = pAudioSource;
 
-	if (dcc_profile->SPUBitstreamFIFOSize != 0) {
-		EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
-
-		/* TBD: Implement DCCOpenSPUDecoderSource. */
-
-		return RM_NOTIMPLEMENTED;
-	}
 	return RM_OK;
 }
 
-RMstatus DCCCloseVideoSource(struct DCCVideoSource *pVideoSource)
+RMstatus DCCCloseAudioSource(struct DCCAudioSource *pAudioSource)
 {
 	RMstatus rv;
+	RMuint32 buffer[1];
+	RMuint32 taskcount;
+	RMuint32 result_shm[2];
 
-	if (pVideoSource->spu_decoder != NULL) {
-		EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
+	memset(buffer, 0, sizeof(buffer));
+	rv = set_property(pAudioSource->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_Close, &buffer, sizeof(buffer));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	rv = RUAGetProperty(pAudioSource->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_ConnectedTaskCount, &taskcount, sizeof(taskcount));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	rv = RUAGetProperty(pAudioSource->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_DecoderSharedMemory, &result_shm, sizeof(result_shm));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	if ((result_shm[0] != 0) && (pAudioSource->reserved1C == 1)) {
+		RMuint32 address;
 
-		/* TBD: Implement SPUDisconnectSPUFromScaler(). */
-		return RM_NOTIMPLEMENTED;
-	} else if (pVideoSource->spudecodermoduleid != 0) {
-		EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
+		address = result_shm[0];
 
-		return RM_NOTIMPLEMENTED;
-	}
-	if (pVideoSource->scalermoduleid != 0) {
-		RMuint32 surface;
-		rv = RUAGetProperty(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_Surface, &surface, sizeof(surface));
+		result_shm[0] = 0;
+		result_shm[1] = 0;
+		rv = set_property(pAudioSource->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_DecoderSharedMemory, &result_shm, sizeof(result_shm));
 		if (rv != RM_OK) {
 			return rv;
 		}
-		if (surface != 0) {
-			surface = 0;
-			rv = set_property(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_Surface, &surface, sizeof(surface));
-			if (rv != RM_OK) {
-				return rv;
-			}
-		}
-	}
-
-	// TBD: Implement SPU stuff.
-
-	if (pVideoSource->decodermoduleid != 0) {
-		RMuint32 buffer[1];
-		memset(buffer, 0, sizeof(buffer));
-
-		switch(pVideoSource->decodermoduleid & 0xFF) {
-			case DispVideoInput:
-				rv = set_property(pVideoSource->pRua, pVideoSource->decodermoduleid, RMDispVideoInputPropertyID_Close, &buffer, sizeof(buffer));
-				break;
 
-			case DispGraphicInput:
-				rv = set_property(pVideoSource->pRua, pVideoSource->decodermoduleid, RMDispGraphicInputPropertyID_Close, &buffer, sizeof(buffer));
-				break;
-
-			default:
-				rv = set_property(pVideoSource->pRua, pVideoSource->decodermoduleid, RMVideoDecoderPropertyID_Close, &buffer, sizeof(buffer));
-				break;
-		}
+		rv = RUASetAddressID(pAudioSource->pRua, address, 0);
 		if (rv != RM_OK) {
 			return rv;
 		}
+		pAudioSource->pDCC->rua_free(pAudioSource->pRua, address);
+		pAudioSource->reserved1C = 0;
 	}
-
-	if (pVideoSource->picprot != 0) {
-		pVideoSource->pDCC->rua_free(pVideoSource->pRua, pVideoSource->picprot);
-		pVideoSource->picprot = 0;
-	}
-	if (pVideoSource->bitprot != 0) {
-		pVideoSource->pDCC->rua_free(pVideoSource->pRua, pVideoSource->bitprot);
-		pVideoSource->bitprot = 0;
+	if (pAudioSource->mem1 != 0) {
+		pAudioSource->pDCC->rua_free(pAudioSource->pRua, pAudioSource->mem1);
+		pAudioSource->mem1 = 0;
 	}
-	if (pVideoSource->unprot != 0) {
-		pVideoSource->pDCC->rua_free(pVideoSource->pRua, pVideoSource->unprot);
-		pVideoSource->unprot = 0;
+	if (pAudioSource->mem2 != 0) {
+		pAudioSource->pDCC->rua_free(pAudioSource->pRua, pAudioSource->mem2);
+		pAudioSource->mem2 = 0;
 	}
-	if (pVideoSource->enginemoduleid != 0) {
-		RMuint32 count;
-
-		rv = RUAGetProperty(pVideoSource->pRua, pVideoSource->enginemoduleid, RMMpegEnginePropertyID_ConnectedTaskCount, &count, sizeof(count));
-		if (rv != RM_OK) {
-			return rv;
-		}
-		if (count == 0) {
-			RMuint32 result_decmem[2];
 
-			rv = RUAGetProperty(pVideoSource->pRua, pVideoSource->enginemoduleid, RMMpegEnginePropertyID_DecoderSharedMemory, &result_decmem, sizeof(result_decmem));
-			if (rv != RM_OK) {
-				return rv;
-			}
-			if (result_decmem[0] != 0) {
-				RMuint32 address;
+	return RM_OK;
+}
 
-				address = result_decmem[0];
-				result_decmem[0] = 0;
-				result_decmem[1] = 0;
+RMstatus DCCGetAudioDecoderSourceInfo(struct DCCAudioSource *pAudioSource, RMuint32 *decoder, RMuint32 *engine, RMuint32 *timer)
+{
+	if (pAudioSource == NULL) {
+		return RM_INVALID_PARAMETER;
+	}
 
-				rv = set_property(pVideoSource->pRua, pVideoSource->enginemoduleid, RMMpegEnginePropertyID_DecoderSharedMemory, &result_decmem, sizeof(result_decmem));
-				if (rv != RM_OK) {
-					return rv;
-				}
+	if (decoder != NULL) {
+		*decoder = pAudioSource->decodermoduleid;
+	}
+	if (timer != NULL) {
+		*timer = pAudioSource->STCID;
+	}
+	if (engine != NULL) {
+		*engine = pAudioSource->enginemoduleid;
+	}
 
-				RUAFree(pVideoSource->pRua, address);
-			}
+	return RM_OK;
+}
 
-			rv = RUAGetProperty(pVideoSource->pRua, pVideoSource->enginemoduleid, RMMpegEnginePropertyID_SchedulerSharedMemory, &result_decmem, sizeof(result_decmem));
-			if (rv != RM_OK) {
-				return rv;
-			}
-			if (result_decmem[0] != 0) {
-				RMuint32 address;
+RMstatus DCCSetAudioAACFormat(struct DCCAudioSource *pAudioSource, struct AudioDecoder_AACParameters_type *pFormat)
+{
+	RMstatus rv;
+	RMuint32 buffer[1];
+	
+	rv = send_audio_command(pAudioSource->pRua, pAudioSource->decodermoduleid, 7);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	/* Set codec to AAC. */
+	buffer[0] = 3;
+	rv = set_property(pAudioSource->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_Codec, &buffer, sizeof(buffer));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	rv = set_property(pAudioSource->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_AACParameters, pFormat, sizeof(*pFormat));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	rv = send_audio_command(pAudioSource->pRua, pAudioSource->decodermoduleid, 6);
+	if (rv != RM_OK) {
+		return rv;
+	}
 
-				address = result_decmem[0];
-				result_decmem[0] = 0;
-				result_decmem[1] = 0;
+	return RM_OK;
+}
 
-				rv = set_property(pVideoSource->pRua, pVideoSource->enginemoduleid, RMMpegEnginePropertyID_SchedulerSharedMemory, &result_decmem, sizeof(result_decmem));
-				if (rv != RM_OK) {
-					return rv;
-				}
+RMstatus DCCSetAudioSourceVolume(struct DCCAudioSource *pAudioSource, RMuint32 volume)
+{
+	RMstatus rv;
+	int i;
 
-				rv = RUASetAddressID(pVideoSource->pRua, address, 0);
-				if (rv != RM_OK) {
-					return rv;
-				}
+	for (i = 0; i < 12; i++) {
+		RMuint32 buffervol[2];
 
-				RUAFree(pVideoSource->pRua, address);
-			}
+		buffervol[0] = i;
+		buffervol[1] = volume;
+		rv = set_property(pAudioSource->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_Volume, &buffervol, sizeof(buffervol));
+		if (rv != RM_OK) {
+			return rv;
 		}
 	}
-	free(pVideoSource);
-	pVideoSource = NULL;
 
 	return RM_OK;
 }
 
-RMstatus DCCXSetVideoDecoderSourceCodec(struct DCCVideoSource *pVideoSource, enum EMhwlibVideoCodec Codec)
+static RMstatus set_audio_codec_threshold(struct DCCAudioSource *pAudioSource)
 {
 	RMstatus rv;
+	RMuint32 codec;
+	RMuint32 level = 256;
 
-	rv = send_video_command(pVideoSource->pRua, pVideoSource->decodermoduleid, 0);
+	rv = RUAGetProperty(pAudioSource->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_Codec, &codec, sizeof(codec));
 	if (rv != RM_OK) {
 		return rv;
 	}
-	rv = set_property(pVideoSource->pRua, pVideoSource->decodermoduleid, RMVideoDecoderPropertyID_CodecX, &Codec, sizeof(Codec));
+
+	switch (codec) {
+		case 2:
+			level = 512;
+			break;
+
+		case 7:
+			level = 1024;
+			break;
+
+		case 14:
+			level = 0;
+			break;
+	}
+	rv = DCCSetAudioBtsThreshold(pAudioSource, level);
 	if (rv != RM_OK) {
+		EPRINTF("DCCSetAudioBtsThreshold() failed with rv = %u.\n", rv);
 		return rv;
 	}
-	rv = send_video_command(pVideoSource->pRua, pVideoSource->decodermoduleid, 1);
+	return RM_OK;
+}
+
+RMstatus DCCPlayAudioSource(struct DCCAudioSource *pAudioSource)
+{
+	RMstatus rv;
+
+	rv = set_audio_codec_threshold(pAudioSource);
 	if (rv != RM_OK) {
 		return rv;
 	}
-	if (pVideoSource->spu_decoder != NULL) {
-		EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
+	
+	return send_audio_command(pAudioSource->pRua, pAudioSource->decodermoduleid, 1);
+}
 
-		/* TBD: Implement DCCResetSPUDecoderSource(). */
+RMstatus DCCPlayMultipleAudioSource(struct DCCAudioSource **ppAudioSource, RMuint32 count)
+{
+	return DCCPlaySynchronized(NULL, NULL, DCCVideoPlayFwd, ppAudioSource, count);
+}
+
+/**
+ * Start video and audio decoders together. All decoders are commanded
+ * before waiting for any of them. When pStcSource is not NULL, the STC is
+ * stopped first and started as the last step, so that all decoders begin
+ * with the same STC.
+ */
+RMstatus DCCPlaySynchronized(struct DCCSTCSource *pStcSource, struct DCCVideoSource *pVideoSource, enum DCCVideoPlayCommand cmd, struct DCCAudioSource **ppAudioSource, RMuint32 audio_count)
+{
+	struct decoder_command cmds[DCC_MAX_AUDIO_SOURCES + 1];
+	struct RUA *pRua = NULL;
+	RMuint32 count = 0;
+	RMuint32 i;
+	RMstatus rv;
+
+	if (audio_count > DCC_MAX_AUDIO_SOURCES) {
+		return RM_INVALID_PARAMETER;
+	}
+	if ((audio_count > 0) && (ppAudioSource == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+
+	if (pVideoSource != NULL) {
+		if (cmd == DCCVideoPlayNextFrame) {
+			return RM_INVALID_PARAMETER;
+		}
+		if ((pVideoSource->spu_decoder != NULL) || (pVideoSource->spudecodermoduleid != 0)) {
+			EPRINTF("Function %s is not implemented for SPU.\n", __FUNCTION__);
+			return RM_NOTIMPLEMENTED;
+		}
+		pRua = pVideoSource->pRua;
+		cmds[count].decodermoduleid = pVideoSource->decodermoduleid;
+		cmds[count].propertyid = RMVideoDecoderPropertyID_Command;
+		cmds[count].cmd = cmd;
+		count++;
+	}
+
+	for (i = 0; i < audio_count; i++) {
+		struct DCCAudioSource *pAudioSource = ppAudioSource[i];
+
+		if (pAudioSource == NULL) {
+			return RM_FATALINVALIDPOINTER;
+		}
+		rv = set_audio_codec_threshold(pAudioSource);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		pRua = pAudioSource->pRua;
+		cmds[count].decodermoduleid = pAudioSource->decodermoduleid;
+		cmds[count].propertyid = RMAudioDecoderPropertyID_Command;
+		cmds[count].cmd = 1;
+		count++;
+	}
+
+	if (pStcSource != NULL) {
+		rv = DCCSTCStop(pStcSource);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
 
-		return RM_NOTIMPLEMENTED;
-	} else if (pVideoSource->spudecodermoduleid != 0) {
-		rv = send_video_command(pVideoSource->pRua, pVideoSource->spudecodermoduleid, 0);
+	if (count > 0) {
+		rv = send_multiple_commands(pRua, cmds, count);
 		if (rv != RM_OK) {
 			return rv;
 		}
-		Codec = EMhwlibDVDSpuCodec;
-		rv = set_property(pVideoSource->pRua, pVideoSource->spudecodermoduleid, RMSpuDecoderPropertyID_CodecX, &Codec, sizeof(Codec));
+	}
+
+	if (pStcSource != NULL) {
+		rv = DCCSTCPlay(pStcSource);
 		if (rv != RM_OK) {
 			return rv;
 		}
@@ -1677,415 +3308,635 @@ RMstatus DCCXSetVideoDecoderSourceCodec(struct DCCVideoSource *pVideoSource, enu
 	return RM_OK;
 }
 
-RMstatus DCCGetVideoDecoderSourceInfo(struct DCCVideoSource *pVideoSource, RMuint32 *video_decoder, RMuint32 *spu_decoder, RMuint32 *timer)
+RMstatus DCCPauseAudioSource(struct DCCAudioSource *pAudioSource)
 {
-	if (video_decoder != NULL) {
-		*video_decoder = pVideoSource->decodermoduleid;
-	}
-	if (timer != NULL) {
-		*timer = pVideoSource->STCID;
-	}
-	if (spu_decoder != NULL) {
-		*spu_decoder = pVideoSource->spudecodermoduleid;
-	}
-	return RM_OK;
+	return send_audio_command(pAudioSource->pRua, pAudioSource->decodermoduleid, 2);
 }
 
-RMstatus DCCPlayVideoSource(struct DCCVideoSource *pVideoSource, enum DCCVideoPlayCommand cmd)
+RMstatus DCCStopAudioSource(struct DCCAudioSource *pAudioSource)
 {
-	RMstatus rv;
-
-	if (cmd == DCCVideoPlayNextFrame) {
-		if (pVideoSource->scalermoduleid != 0) {
-			rv = set_property(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_Step, NULL, 0);
-			if (rv != RM_OK) {
-				return rv;
-			}
-		}
-	} else {
-		rv = send_video_command(pVideoSource->pRua, pVideoSource->decodermoduleid, cmd);
-		if (rv != RM_OK) {
-			return rv;
-		}
-	}
-	if (pVideoSource->spu_decoder != NULL) {
-		EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
-		/* TBD: Implement DCCPlaySPUSource(). */
+	return send_audio_command(pAudioSource->pRua, pAudioSource->decodermoduleid, 3);
+}
 
-		return RM_NOTIMPLEMENTED;
-	} else {
-		if (pVideoSource->spudecodermoduleid != 0) {
-			EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
-			/* TBD: Implement send_spu_command(pVideoSource->pRua, pVideoSource->spudecodermoduleid, 3). */
+RMstatus DCCSetAudioBtsThreshold(struct DCCAudioSource *pAudioSource, RMuint32 level)
+{
+	return set_property(pAudioSource->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_AudioBtsThreshold, &level, sizeof(level));
+}
 
-			return RM_NOTIMPLEMENTED;
-		}
+RMstatus DCCSetAudioSourceBitrate(struct DCCAudioSource *pAudioSource, RMuint32 bitrate)
+{
+	if (pAudioSource == NULL) {
+		return RM_FATALINVALIDPOINTER;
 	}
+	pAudioSource->bitrate = bitrate;
 	return RM_OK;
 }
 
-RMstatus DCCStopVideoSource(struct DCCVideoSource *pVideoSource, enum DCCStopMode stop_mode)
+RMstatus DCCGetAudioFIFOLevel(struct DCCAudioSource *pAudioSource, RMuint32 time_resolution, struct DCCFIFOLevel *level)
 {
-	RMstatus rv;
-
-	rv = send_video_command(pVideoSource->pRua, pVideoSource->decodermoduleid, 2);
-	if (rv != RM_OK) {
-		return RM_OK;
+	if (pAudioSource == NULL) {
+		return RM_FATALINVALIDPOINTER;
 	}
-	if (pVideoSource->spu_decoder != NULL) {
-		EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
-		/* TBD: Implement DCCPlaySPUSource(). */
-
-		return RM_NOTIMPLEMENTED;
-	} else {
-		if (pVideoSource->spudecodermoduleid != 0) {
-			EPRINTF("Function %s is not implemented.\n", __FUNCTION__);
-			/* TBD: Implement send_spu_command(pVideoSource->pRua, pVideoSource->spudecodermoduleid, 3). */
-
-			return RM_NOTIMPLEMENTED;
-		}
+	if (pAudioSource->decodermoduleid == 0) {
+		return RM_INVALIDMODE;
 	}
-	if (pVideoSource->scalermoduleid != 0) {
-		struct RUAEvent evt;
-		RMuint32 ModuleID;
-		RMuint32 index;
-
-		switch (stop_mode) {
-			case DCCStopMode_BlackFrame:
-				rv = set_property(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_Stop, NULL, 0);
-				if (rv != RM_OK) {
-					return rv;
-				}
-				break;
+	return get_fifo_level(pAudioSource->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_BtsFIFO, RMAudioDecoderPropertyID_PtsFIFO, pAudioSource->bitrate, time_resolution, level);
+}
 
-			case DCCStopMode_LastFrame:
-				rv = set_property(pVideoSource->pRua, pVideoSource->scalermoduleid, RMGenericPropertyID_Flush, NULL, 0);
-				if (rv != RM_OK) {
-					return rv;
-				}
-				break;
-		}
-		ModuleID = EMHWLIB_MODULE(DisplayBlock, 0);
-		get_event_mask(pVideoSource->scalermoduleid, &evt);
-		if (evt.Mask != 0) {
-			rv = RUAResetEvent(pVideoSource->pRua, &evt);
-			if (rv != RM_OK) {
-				fprintf(stderr, "reset_event failed for ModuleID %d\n", ModuleID & 0xFF);
-				return rv;
-			}
-		}
-		rv = RUAWaitForMultipleEvents(pVideoSource->pRua, &evt, 1, 1000000, &index);
-		if (rv != RM_OK) {
-			return rv;
-		}
+RMstatus DCCWaitAudioFIFOLevel(struct DCCAudioSource *pAudioSource, RMuint32 level, RMuint32 TimeOut_us)
+{
+	if (pAudioSource == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pAudioSource->decodermoduleid == 0) {
+		return RM_INVALIDMODE;
 	}
+	return wait_fifo_level(pAudioSource->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_BtsFIFO, RMAudioDecoderPropertyID_PtsFIFO, level, TimeOut_us);
+}
 
-	return RM_OK;
+RMstatus DCCSetAudioMpegFormat(struct DCCAudioSource *pAudioSource, struct AudioDecoder_MpegParameters_type *pFormat)
+{
+	fprintf(stderr, "Error: %s is not implemented.\n", __FUNCTION__);
+	return RM_NOTIMPLEMENTED;
 }
 
-RMstatus DCCOpenAudioDecoderSource(struct DCC *pDCC, struct DCCAudioProfile *dcc_profile, struct DCCAudioSource **ppAudioSource)
+RMstatus DCCOpenDemuxTask(struct DCC *pDCC, struct DCCDemuxTaskProfile *dcc_profile, struct DCCDemuxTask **ppDemuxTask)
 {
-	struct DCCAudioSource *pAudioSource;
+	struct DCCDemuxTask *pDemuxTask;
 	RMstatus rv;
-	RMuint32 audioengineid = AudioEngine;
-	RMuint32 audiodecoderid = AudioDecoder;
-	RMuint32 number_of_engines;
-	RMuint32 number_of_decoders;
-	RMuint32 buffer_info[2];
-	RMuint32 result_info[1];
-	RMuint32 result_shm[2];
+	RMuint32 demuxtaskid = DemuxTask;
+	RMuint32 number_of_tasks;
 	RMuint32 buffer_dram[4];
 	RMuint32 result_dram[2];
-	RMuint32 buffer_shared[10];
-
-	pAudioSource = malloc(sizeof(*pAudioSource));
-	if (pAudioSource == NULL) {
-		fprintf(stderr, "Error: out of memory\n");
+	RMuint32 buffer_open[16];
 
-		return RM_FATALOUTOFMEMORY;
+	if ((pDCC == NULL) || (dcc_profile == NULL) || (ppDemuxTask == NULL)) {
+		return RM_FATALINVALIDPOINTER;
 	}
-	memset(pAudioSource, 0, sizeof(*pAudioSource));
-	pAudioSource->pRua = pDCC->pRua;
-	pAudioSource->pDCC = pDCC;
-	pAudioSource->STCID = dcc_profile->STCID;
 
-	rv = RUAExchangeProperty(pDCC->pRua, EMHWLIB_MODULE(Enumerator, 0), RMEnumeratorPropertyID_CategoryIDToNumberOfInstances, &audioengineid, sizeof(audioengineid), &number_of_engines, sizeof(number_of_engines));
-	if (rv != RM_OK) {
-		return rv;
-	}
-	if (dcc_profile->AudioEngineID >= number_of_engines) {
-		return RM_PARAMETER_OUT_OF_RANGE;
-	}
-	rv = RUAExchangeProperty(pDCC->pRua, EMHWLIB_MODULE(Enumerator, 0), RMEnumeratorPropertyID_CategoryIDToNumberOfInstances, &audiodecoderid, sizeof(audiodecoderid), &number_of_decoders, sizeof(number_of_decoders));
+	rv = RUAExchangeProperty(pDCC->pRua, EMHWLIB_MODULE(Enumerator, 0), RMEnumeratorPropertyID_CategoryIDToNumberOfInstances, &demuxtaskid, sizeof(demuxtaskid), &number_of_tasks, sizeof(number_of_tasks));
 	if (rv != RM_OK) {
 		return rv;
 	}
-	if (dcc_profile->AudioDecoderID >= number_of_decoders/number_of_engines) {
+	if (dcc_profile->DemuxTaskID >= number_of_tasks) {
 		return RM_PARAMETER_OUT_OF_RANGE;
 	}
-	pAudioSource->enginemoduleid = EMHWLIB_MODULE(AudioEngine, dcc_profile->AudioEngineID);
-	pAudioSource->decodermoduleid = EMHWLIB_MODULE(AudioDecoder, dcc_profile->AudioDecoderID);
-	memset(buffer_info, 0, sizeof(buffer_info));
-	rv = RUAExchangeProperty(pDCC->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_DecoderSharedMemoryInfo, buffer_info, sizeof(buffer_info), result_info, sizeof(result_info));
-	if (rv != RM_OK) {
-		return rv;
-	}
-	rv = RUAGetProperty(pDCC->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_DecoderSharedMemory, &result_shm, sizeof(result_shm));
-	if (rv != RM_OK) {
-		return rv;
-	}
-	if (result_shm[0] == 0) {
-		result_shm[0] = pDCC->rua_malloc(pDCC->pRua, pAudioSource->enginemoduleid, pDCC->dram, RUA_DRAM_UNPROTECTED, result_info[0]);
-		result_shm[1] = result_info[0];
-		rv = set_property(pDCC->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_DecoderSharedMemory, &result_shm, sizeof(result_shm));
-		if (rv != RM_OK) {
-			return rv;
-		}
-		pAudioSource->reserved1C = 1;
-	} else {
-		pAudioSource->reserved1C = 1;
+
+	pDemuxTask = malloc(sizeof(*pDemuxTask));
+	if (pDemuxTask == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+
+		return RM_FATALOUTOFMEMORY;
 	}
+	memset(pDemuxTask, 0, sizeof(*pDemuxTask));
+	pDemuxTask->pRua = pDCC->pRua;
+	pDemuxTask->pDCC = pDCC;
+	pDemuxTask->demuxtaskmoduleid = EMHWLIB_MODULE(DemuxTask, dcc_profile->DemuxTaskID);
+
+	/* TBD: Layout of DRAMSize and Open is not verified. */
 	memset(buffer_dram, 0, sizeof(buffer_dram));
-	buffer_dram[0] = 12;
-	buffer_dram[1] = 0x00000F00;
-	buffer_dram[2] = dcc_profile->BitstreamFIFOSize;
-	buffer_dram[3] = dcc_profile->XferFIFOCount;
-	rv = RUAExchangeProperty(pDCC->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_DRAMSize, buffer_dram, sizeof(buffer_dram), result_dram, sizeof(result_dram));
+	buffer_dram[0] = dcc_profile->ProtectedFlags;
+	buffer_dram[1] = dcc_profile->BitstreamFIFOSize;
+	buffer_dram[2] = dcc_profile->XferFIFOCount;
+	buffer_dram[3] = dcc_profile->InbandFIFOCount;
+	rv = RUAExchangeProperty(pDCC->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_DRAMSize, buffer_dram, sizeof(buffer_dram), result_dram, sizeof(result_dram));
 	if (rv != RM_OK) {
+		free(pDemuxTask);
 		return rv;
 	}
-	memset(buffer_shared, 0, sizeof(buffer_shared));
-	buffer_shared[0] = buffer_dram[0]; // 0x00
-	buffer_shared[1] = buffer_dram[1]; // 0x04
-	buffer_shared[2] = dcc_profile->BitstreamFIFOSize; // 0x08
-	buffer_shared[3] = dcc_profile->XferFIFOCount; // 0x0c
-	buffer_shared[4] = 0; // 0x10
-	buffer_shared[5] = result_dram[0]; // 0x14
-	buffer_shared[6] = 0; // 0x18
-	buffer_shared[7] = result_dram[1]; // 0x1c
-	buffer_shared[8] = dcc_profile->DemuxProgramID; // 0x20
-	buffer_shared[9] = dcc_profile->STCID; //0x24
+
+	memset(buffer_open, 0, sizeof(buffer_open));
+	memcpy(buffer_open, dcc_profile, sizeof(*dcc_profile)); // 0x00 - 0x2c
+	buffer_open[13] = result_dram[0]; // 0x34
+	buffer_open[15] = result_dram[1]; // 0x3c
 	if (result_dram[0] != 0) {
-		buffer_shared[4] = pDCC->rua_malloc(pDCC->pRua, pAudioSource->enginemoduleid, pDCC->dram, RUA_DRAM_UNPROTECTED, result_dram[0]);
-		if (buffer_shared[4] == 0) {
+		buffer_open[12] = pDCC->rua_malloc(pDCC->pRua, pDemuxTask->demuxtaskmoduleid, pDCC->dram, RUA_DRAM_UNPROTECTED, result_dram[0]);
+		if (buffer_open[12] == 0) {
+			DCCCloseDemuxTask(pDemuxTask);
 			return RM_FATALOUTOFMEMORY;
 		}
-		pAudioSource->mem1 = buffer_shared[4];
+		pDemuxTask->mem1 = buffer_open[12];
 	}
 	if (result_dram[1] != 0) {
-		buffer_shared[6] = pDCC->rua_malloc(pDCC->pRua, pAudioSource->enginemoduleid, pDCC->dram, RUA_DRAM_UNPROTECTED, result_dram[1]);
-		if (buffer_shared[6] == 0) {
+		buffer_open[14] = pDCC->rua_malloc(pDCC->pRua, pDemuxTask->demuxtaskmoduleid, pDCC->dram, RUA_DRAM_UNPROTECTED, result_dram[1]);
+		if (buffer_open[14] == 0) {
+			DCCCloseDemuxTask(pDemuxTask);
 			return RM_FATALOUTOFMEMORY;
 		}
-		pAudioSource->mem2 = buffer_shared[6];
+		pDemuxTask->mem2 = buffer_open[14];
 	}
-	rv = set_property(pDCC->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_Open, &buffer_shared, sizeof(buffer_shared));
+	rv = set_property(pDCC->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_Open, buffer_open, sizeof(buffer_open));
 	if (rv != RM_OK) {
+		DCCCloseDemuxTask(pDemuxTask);
 		return rv;
 	}
-	*ppAudioSource = pAudioSource;
-
-	return RM_OK;
+	pDemuxTask->opened = TRUE;
+	*ppDemuxTask = pDemuxTask;
+
+	return RM_OK;
+}
+
+RMstatus DCCCloseDemuxTask(struct DCCDemuxTask *pDemuxTask)
+{
+	RMstatus rv;
+	RMuint32 buffer[1];
+	RMuint32 i;
+
+	if (pDemuxTask == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+
+	for (i = 0; i < DCC_DEMUX_MAX_OUTPUTS; i++) {
+		if (pDemuxTask->outputs[i] != 0) {
+			rv = DCCDisconnectDemuxOutput(pDemuxTask, i);
+			if (rv != RM_OK) {
+				return rv;
+			}
+		}
+	}
+
+	if (pDemuxTask->opened) {
+		memset(buffer, 0, sizeof(buffer));
+		rv = set_property(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_Close, buffer, sizeof(buffer));
+		if (rv != RM_OK) {
+			return rv;
+		}
+		pDemuxTask->opened = FALSE;
+	}
+	if (pDemuxTask->mem1 != 0) {
+		pDemuxTask->pDCC->rua_free(pDemuxTask->pRua, pDemuxTask->mem1);
+		pDemuxTask->mem1 = 0;
+	}
+	if (pDemuxTask->mem2 != 0) {
+		pDemuxTask->pDCC->rua_free(pDemuxTask->pRua, pDemuxTask->mem2);
+		pDemuxTask->mem2 = 0;
+	}
+	free(pDemuxTask);
+
+	return RM_OK;
+}
+
+RMstatus DCCPlayDemuxTask(struct DCCDemuxTask *pDemuxTask)
+{
+	if (pDemuxTask == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	return send_demux_command(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, DEMUX_TASK_COMMAND_PLAY);
+}
+
+RMstatus DCCStopDemuxTask(struct DCCDemuxTask *pDemuxTask)
+{
+	if (pDemuxTask == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	return send_demux_command(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, DEMUX_TASK_COMMAND_STOP);
+}
+
+RMstatus DCCGetDemuxTaskInfo(struct DCCDemuxTask *pDemuxTask, RMuint32 *demux_task)
+{
+	if (pDemuxTask == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (demux_task != NULL) {
+		*demux_task = pDemuxTask->demuxtaskmoduleid;
+	}
+	return RM_OK;
+}
+
+/** Configure which PES packets are extracted from the input. */
+RMstatus DCCSetDemuxTaskPesEntry(struct DCCDemuxTask *pDemuxTask, struct DCCDemuxPesEntry *entry)
+{
+	if ((pDemuxTask == NULL) || (entry == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	return RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_PesEntry, entry, sizeof(*entry), 0);
 }
 
-RMstatus DCCCloseAudioSource(struct DCCAudioSource *pAudioSource)
+/** Set a PID filter, route it to the outputs in entry->OutputMask and enable it. */
+RMstatus DCCSetDemuxTaskPidEntry(struct DCCDemuxTask *pDemuxTask, struct DCCDemuxPidEntry *entry)
 {
 	RMstatus rv;
-	RMuint32 buffer[1];
-	RMuint32 taskcount;
-	RMuint32 result_shm[2];
+	RMuint32 buffer_param[2];
+	RMuint32 buffer_pid[4];
+	RMuint32 size;
 
-	memset(buffer, 0, sizeof(buffer));
-	rv = set_property(pAudioSource->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_Close, &buffer, sizeof(buffer));
+	if ((pDemuxTask == NULL) || (entry == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (entry->PID > DCC_DEMUX_PID_ALL) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+
+	/* TBD: Layout of the PidEntry properties is not verified. */
+	buffer_pid[0] = entry->Index;
+	buffer_pid[1] = entry->PID;
+	size = 2 * sizeof(buffer_pid[0]);
+	if (entry->CipherMask != 0) {
+		/* TBD: Guessed extension for scrambled PIDs, clear PIDs keep the 2 word form. */
+		buffer_pid[2] = entry->CipherMask;
+		buffer_pid[3] = entry->CipherIndex;
+		size = sizeof(buffer_pid);
+	}
+	rv = RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_PidEntry, buffer_pid, size, 0);
 	if (rv != RM_OK) {
 		return rv;
 	}
-	rv = RUAGetProperty(pAudioSource->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_ConnectedTaskCount, &taskcount, sizeof(taskcount));
+
+	buffer_param[0] = entry->Index;
+	buffer_param[1] = entry->OutputMask;
+	rv = RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_PidEntryAddOutputs, buffer_param, sizeof(buffer_param), 0);
 	if (rv != RM_OK) {
 		return rv;
 	}
-	rv = RUAGetProperty(pAudioSource->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_DecoderSharedMemory, &result_shm, sizeof(result_shm));
+
+	rv = RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_PidEntryEnable, &entry->Index, sizeof(entry->Index), 0);
 	if (rv != RM_OK) {
 		return rv;
 	}
-	if ((result_shm[0] != 0) && (pAudioSource->reserved1C == 1)) {
-		RMuint32 address;
+	if (entry->Index < DCC_DEMUX_MAX_PID_ENTRIES) {
+		struct DemuxPidEntryState *state = &pDemuxTask->pid_entries[entry->Index];
 
-		address = result_shm[0];
+		state->used = TRUE;
+		state->pid = entry->PID;
+		state->outputs = entry->OutputMask;
+	}
+	return RM_OK;
+}
 
-		result_shm[0] = 0;
-		result_shm[1] = 0;
-		rv = set_property(pAudioSource->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_DecoderSharedMemory, &result_shm, sizeof(result_shm));
-		if (rv != RM_OK) {
-			return rv;
-		}
+RMstatus DCCFreeDemuxTaskPidEntry(struct DCCDemuxTask *pDemuxTask, RMuint32 index)
+{
+	RMstatus rv;
 
-		rv = RUASetAddressID(pAudioSource->pRua, address, 0);
-		if (rv != RM_OK) {
-			return rv;
-		}
-		pAudioSource->pDCC->rua_free(pAudioSource->pRua, address);
-		pAudioSource->reserved1C = 0;
+	if (pDemuxTask == NULL) {
+		return RM_FATALINVALIDPOINTER;
 	}
-	if (pAudioSource->mem1 != 0) {
-		pAudioSource->pDCC->rua_free(pAudioSource->pRua, pAudioSource->mem1);
-		pAudioSource->mem1 = 0;
+	rv = RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_PidEntryDisable, &index, sizeof(index), 0);
+	if (rv != RM_OK) {
+		return rv;
 	}
-	if (pAudioSource->mem2 != 0) {
-		pAudioSource->pDCC->rua_free(pAudioSource->pRua, pAudioSource->mem2);
-		pAudioSource->mem2 = 0;
+	rv = RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_FreePidEntry, &index, sizeof(index), 0);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	if (index < DCC_DEMUX_MAX_PID_ENTRIES) {
+		memset(&pDemuxTask->pid_entries[index], 0, sizeof(pDemuxTask->pid_entries[index]));
 	}
-
 	return RM_OK;
 }
 
-RMstatus DCCGetAudioDecoderSourceInfo(struct DCCAudioSource *pAudioSource, RMuint32 *decoder, RMuint32 *engine, RMuint32 *timer)
+static struct DemuxPidEntryState *find_pid_entry(struct DCCDemuxTask *pDemuxTask, RMuint32 pid, RMuint32 *index)
 {
-	if (pAudioSource == NULL) {
-		return RM_INVALID_PARAMETER;
+	RMuint32 i;
+
+	for (i = 0; i < DCC_DEMUX_MAX_PID_ENTRIES; i++) {
+		if (pDemuxTask->pid_entries[i].used && (pDemuxTask->pid_entries[i].pid == pid)) {
+			*index = i;
+			return &pDemuxTask->pid_entries[i];
+		}
 	}
+	return NULL;
+}
 
-	if (decoder != NULL) {
-		*decoder = pAudioSource->decodermoduleid;
+/**
+ * Route a PID to more outputs. A PID which is already used gets the new
+ * outputs added to its entry, so the packets are demuxed only once, e.g. for
+ * the decoders and a recording at the same time.
+ *
+ * @param pid PID or DCC_DEMUX_PID_ALL for the complete transport stream.
+ */
+RMstatus DCCAddDemuxTaskPidOutputs(struct DCCDemuxTask *pDemuxTask, RMuint32 pid, RMuint32 output_mask)
+{
+	struct DemuxPidEntryState *state;
+	struct DCCDemuxPidEntry entry;
+	RMuint32 buffer_param[2];
+	RMuint32 index;
+	RMstatus rv;
+
+	if (pDemuxTask == NULL) {
+		return RM_FATALINVALIDPOINTER;
 	}
-	if (timer != NULL) {
-		*timer = pAudioSource->STCID;
+	if (pid > DCC_DEMUX_PID_ALL) {
+		return RM_PARAMETER_OUT_OF_RANGE;
 	}
-	if (engine != NULL) {
-		*engine = pAudioSource->enginemoduleid;
+
+	state = find_pid_entry(pDemuxTask, pid, &index);
+	if (state != NULL) {
+		buffer_param[0] = index;
+		buffer_param[1] = output_mask & ~state->outputs;
+		if (buffer_param[1] == 0) {
+			return RM_OK;
+		}
+		rv = RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_PidEntryAddOutputs, buffer_param, sizeof(buffer_param), 0);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		state->outputs |= output_mask;
+		return RM_OK;
 	}
 
-	return RM_OK;
+	for (index = 0; index < DCC_DEMUX_MAX_PID_ENTRIES; index++) {
+		if (!pDemuxTask->pid_entries[index].used) {
+			break;
+		}
+	}
+	if (index >= DCC_DEMUX_MAX_PID_ENTRIES) {
+		fprintf(stderr, "Error: No free PID entry in %s.\n", __FUNCTION__);
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(&entry, 0, sizeof(entry));
+	entry.Index = index;
+	entry.PID = pid;
+	entry.OutputMask = output_mask;
+	return DCCSetDemuxTaskPidEntry(pDemuxTask, &entry);
 }
 
-RMstatus DCCSetAudioAACFormat(struct DCCAudioSource *pAudioSource, struct AudioDecoder_AACParameters_type *pFormat)
+/** Stop routing a PID to outputs, the entry is freed when no output is left. */
+RMstatus DCCRemoveDemuxTaskPidOutputs(struct DCCDemuxTask *pDemuxTask, RMuint32 pid, RMuint32 output_mask)
 {
+	struct DemuxPidEntryState *state;
+	RMuint32 buffer_param[2];
+	RMuint32 index;
 	RMstatus rv;
-	RMuint32 buffer[1];
-	
-	rv = send_audio_command(pAudioSource->pRua, pAudioSource->decodermoduleid, 7);
-	if (rv != RM_OK) {
-		return rv;
+
+	if (pDemuxTask == NULL) {
+		return RM_FATALINVALIDPOINTER;
 	}
-	/* Set codec to AAC. */
-	buffer[0] = 3;
-	rv = set_property(pAudioSource->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_Codec, &buffer, sizeof(buffer));
-	if (rv != RM_OK) {
-		return rv;
+	state = find_pid_entry(pDemuxTask, pid, &index);
+	if (state == NULL) {
+		return RM_NOT_FOUND;
 	}
-	rv = set_property(pAudioSource->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_AACParameters, pFormat, sizeof(*pFormat));
-	if (rv != RM_OK) {
-		return rv;
+	if ((state->outputs & ~output_mask) == 0) {
+		return DCCFreeDemuxTaskPidEntry(pDemuxTask, index);
 	}
-	rv = send_audio_command(pAudioSource->pRua, pAudioSource->decodermoduleid, 6);
+
+	buffer_param[0] = index;
+	buffer_param[1] = output_mask & state->outputs;
+	rv = RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_PidEntryRemoveOutputs, buffer_param, sizeof(buffer_param), 0);
 	if (rv != RM_OK) {
 		return rv;
 	}
-
+	state->outputs &= ~output_mask;
 	return RM_OK;
 }
 
-RMstatus DCCSetAudioSourceVolume(struct DCCAudioSource *pAudioSource, RMuint32 volume)
+/** Route all PIDs of a program, e.g. video, audio and PCR, to the outputs. */
+RMstatus DCCAddDemuxTaskProgram(struct DCCDemuxTask *pDemuxTask, RMuint32 *pids, RMuint32 count, RMuint32 output_mask)
 {
+	RMuint32 i;
 	RMstatus rv;
-	int i;
 
-	for (i = 0; i < 12; i++) {
-		RMuint32 buffervol[2];
-
-		buffervol[0] = i;
-		buffervol[1] = volume;
-		rv = set_property(pAudioSource->pRua, pAudioSource->enginemoduleid, RMAudioEnginePropertyID_Volume, &buffervol, sizeof(buffervol));
+	if ((pDemuxTask == NULL) || (pids == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	for (i = 0; i < count; i++) {
+		rv = DCCAddDemuxTaskPidOutputs(pDemuxTask, pids[i], output_mask);
 		if (rv != RM_OK) {
+			while (i > 0) {
+				i--;
+				DCCRemoveDemuxTaskPidOutputs(pDemuxTask, pids[i], output_mask);
+			}
 			return rv;
 		}
 	}
-
 	return RM_OK;
 }
 
-RMstatus DCCPlayAudioSource(struct DCCAudioSource *pAudioSource)
+RMstatus DCCRemoveDemuxTaskProgram(struct DCCDemuxTask *pDemuxTask, RMuint32 *pids, RMuint32 count, RMuint32 output_mask)
 {
+	RMstatus result = RM_OK;
+	RMuint32 i;
 	RMstatus rv;
-	RMuint32 codec;
-	RMuint32 level = 256;
 
-	rv = RUAGetProperty(pAudioSource->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_Codec, &codec, sizeof(codec));
-	if (rv != RM_OK) {
-		return rv;
+	if ((pDemuxTask == NULL) || (pids == NULL)) {
+		return RM_FATALINVALIDPOINTER;
 	}
+	for (i = 0; i < count; i++) {
+		rv = DCCRemoveDemuxTaskPidOutputs(pDemuxTask, pids[i], output_mask);
+		if ((rv != RM_OK) && (rv != RM_NOT_FOUND)) {
+			result = rv;
+		}
+	}
+	return result;
+}
 
-	switch (codec) {
-		case 2:
-			level = 512;
-			break;
-
-		case 7:
-			level = 1024;
-			break;
+RMstatus DCCAllocateDemuxTaskCipherEntry(struct DCCDemuxTask *pDemuxTask, RMuint32 *cipher)
+{
+	if ((pDemuxTask == NULL) || (cipher == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	*cipher = 0;
+	return RUAGetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_AllocateCipherEntry, cipher, sizeof(*cipher));
+}
 
-		case 14:
-			level = 0;
-			break;
+RMstatus DCCFreeDemuxTaskCipherEntry(struct DCCDemuxTask *pDemuxTask, RMuint32 cipher)
+{
+	if (pDemuxTask == NULL) {
+		return RM_FATALINVALIDPOINTER;
 	}
-	rv = DCCSetAudioBtsThreshold(pAudioSource, level);
-	if (rv != RM_OK) {
-		EPRINTF("DCCSetAudioBtsThreshold() failed with rv = %u.\n", rv);
-		return rv;
+	return RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_FreeCipherEntry, &cipher, sizeof(cipher), 0);
+}
+
+RMstatus DCCAllocateDemuxTaskKeyEntry(struct DCCDemuxTask *pDemuxTask, RMuint32 *key)
+{
+	if ((pDemuxTask == NULL) || (key == NULL)) {
+		return RM_FATALINVALIDPOINTER;
 	}
-	
-	return send_audio_command(pAudioSource->pRua, pAudioSource->decodermoduleid, 1);
+	*key = 0;
+	/* TBD: Layout of AllocateKeyEntry is not verified, assumed to be like AllocateCipherEntry. */
+	return RUAGetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_AllocateKeyEntry, key, sizeof(*key));
 }
 
-RMstatus DCCPauseAudioSource(struct DCCAudioSource *pAudioSource)
+RMstatus DCCFreeDemuxTaskKeyEntry(struct DCCDemuxTask *pDemuxTask, RMuint32 key)
 {
-	return send_audio_command(pAudioSource->pRua, pAudioSource->decodermoduleid, 2);
+	RMuint32 i;
+
+	if (pDemuxTask == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	for (i = 0; i < DCC_DEMUX_MAX_CIPHERS; i++) {
+		struct DemuxCipherKeys *keys = &pDemuxTask->cipher_keys[i];
+
+		if (keys->valid && ((keys->key[DCCDemuxKeyParity_Even] == key) || (keys->key[DCCDemuxKeyParity_Odd] == key))) {
+			/* The cipher would use a freed key. */
+			keys->valid = FALSE;
+		}
+	}
+	/* TBD: Layout of FreeKeyEntry is not verified, assumed to be like FreeCipherEntry. */
+	return RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_FreeKeyEntry, &key, sizeof(key), 0);
 }
 
-RMstatus DCCStopAudioSource(struct DCCAudioSource *pAudioSource)
+/** Load an AES key into a key entry. */
+RMstatus DCCSetDemuxTaskAESKey(struct DCCDemuxTask *pDemuxTask, RMuint32 key, struct DCCDemuxAESKey *aes)
 {
-	return send_audio_command(pAudioSource->pRua, pAudioSource->decodermoduleid, 3);
+	struct AESKeyEntry entry;
+
+	if ((pDemuxTask == NULL) || (aes == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	memset(&entry, 0, sizeof(entry));
+	entry.Index = key;
+	entry.Mode = aes->Mode;
+	memcpy(entry.Key, aes->Key, sizeof(entry.Key));
+	memcpy(entry.IV, aes->IV, sizeof(entry.IV));
+	return RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_AESKey, &entry, sizeof(entry), 0);
 }
 
-RMstatus DCCSetAudioBtsThreshold(struct DCCAudioSource *pAudioSource, RMuint32 level)
+/**
+ * Select the key of a cipher by the transport_scrambling_control bits of
+ * each packet (even/odd key).
+ */
+RMstatus DCCSetDemuxTaskInbandKeyChange(struct DCCDemuxTask *pDemuxTask, RMuint32 cipher, RMuint32 even_key, RMuint32 odd_key)
 {
-	return set_property(pAudioSource->pRua, pAudioSource->decodermoduleid, RMAudioDecoderPropertyID_AudioBtsThreshold, &level, sizeof(level));
+	struct DemuxCipherKeys *keys;
+	RMuint32 buffer[3];
+	RMstatus rv;
+
+	if (pDemuxTask == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (cipher >= DCC_DEMUX_MAX_CIPHERS) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+
+	/* TBD: Layout of InbandKeyChange is not verified. */
+	buffer[0] = cipher;
+	buffer[1] = even_key;
+	buffer[2] = odd_key;
+	rv = RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_InbandKeyChange, buffer, sizeof(buffer), 0);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	keys = &pDemuxTask->cipher_keys[cipher];
+	keys->key[DCCDemuxKeyParity_Even] = even_key;
+	keys->key[DCCDemuxKeyParity_Odd] = odd_key;
+	keys->valid = TRUE;
+	return RM_OK;
 }
 
-RMstatus DCCOpenDemuxTask(struct DCC *pDCC, struct DCCDemuxTaskProfile *dcc_profile, struct DCCDemuxTask **ppDemuxTask)
+/** Switch a cipher to another key immediately, independent of the stream. */
+RMstatus DCCSetDemuxTaskOutbandKeyChange(struct DCCDemuxTask *pDemuxTask, RMuint32 cipher, RMuint32 key)
 {
-	fprintf(stderr, "Error: %s is not implemented.\n", __FUNCTION__);
-	return RM_NOTIMPLEMENTED;
+	RMuint32 buffer[2];
+
+	if (pDemuxTask == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (cipher >= DCC_DEMUX_MAX_CIPHERS) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+
+	/* TBD: Layout of OutbandKeyChange is not verified. */
+	buffer[0] = cipher;
+	buffer[1] = key;
+	pDemuxTask->cipher_keys[cipher].valid = FALSE;
+	return RUASetProperty(pDemuxTask->pRua, pDemuxTask->demuxtaskmoduleid, RMDemuxTaskPropertyID_OutbandKeyChange, buffer, sizeof(buffer), 0);
 }
 
-RMstatus DCCCloseDemuxTask(struct DCCDemuxTask *pDemuxTask)
+/**
+ * Key rotation with inband key change: load the next key into the key entry
+ * of the parity which is not used by the stream at the moment. The hardware
+ * switches when the scrambling control bits change.
+ */
+RMstatus DCCRotateDemuxTaskAESKey(struct DCCDemuxTask *pDemuxTask, RMuint32 cipher, enum DCCDemuxKeyParity parity, struct DCCDemuxAESKey *aes)
 {
-	fprintf(stderr, "Error: %s is not implemented.\n", __FUNCTION__);
-	return RM_NOTIMPLEMENTED;
+	struct DemuxCipherKeys *keys;
+
+	if ((pDemuxTask == NULL) || (aes == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if ((cipher >= DCC_DEMUX_MAX_CIPHERS) || (parity > DCCDemuxKeyParity_Odd)) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+	keys = &pDemuxTask->cipher_keys[cipher];
+	if (!keys->valid) {
+		/* DCCSetDemuxTaskInbandKeyChange() must be called first. */
+		return RM_INVALIDMODE;
+	}
+	return DCCSetDemuxTaskAESKey(pDemuxTask, keys->key[parity], aes);
 }
 
-RMstatus DCCSetAudioMpegFormat(struct DCCAudioSource *pAudioSource, struct AudioDecoder_MpegParameters_type *pFormat)
+static RMstatus connect_demux_output(struct DCCDemuxTask *pDemuxTask, RMuint32 output, RMuint32 decodermoduleid)
 {
-	fprintf(stderr, "Error: %s is not implemented.\n", __FUNCTION__);
-	return RM_NOTIMPLEMENTED;
+	RMstatus rv;
+	RMuint32 outputmoduleid;
+	RMuint32 buffer_param[2];
+	RMuint32 buffer[1];
+
+	if (output >= DCC_DEMUX_MAX_OUTPUTS) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+	if (pDemuxTask->outputs[output] != 0) {
+		rv = DCCDisconnectDemuxOutput(pDemuxTask, output);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+	outputmoduleid = EMHWLIB_MODULE(DemuxOutput, output);
+
+	buffer_param[0] = pDemuxTask->demuxtaskmoduleid;
+	buffer_param[1] = decodermoduleid;
+	rv = RUASetProperty(pDemuxTask->pRua, outputmoduleid, RMDemuxOutputPropertyID_Connect, buffer_param, sizeof(buffer_param), 0);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	pDemuxTask->outputs[output] = decodermoduleid;
+
+	/* Same sequence as used by the original software. */
+	buffer[0] = 0;
+	rv = RUASetProperty(pDemuxTask->pRua, outputmoduleid, RMDemuxOutputPropertyID_Trigger, buffer, sizeof(buffer), 0);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	buffer[0] = 0;
+	rv = RUASetProperty(pDemuxTask->pRua, outputmoduleid, RMDemuxOutputPropertyID_TransportPriority, buffer, sizeof(buffer), 0);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	buffer[0] = 1;
+	return RUASetProperty(pDemuxTask->pRua, outputmoduleid, RMDemuxOutputPropertyID_Trigger, buffer, sizeof(buffer), 0);
 }
 
-RMstatus DCCPlayDemuxTask(struct DCCDemuxTask *pDemuxTask)
+/** Send the data of a DemuxOutput to the video decoder. */
+RMstatus DCCConnectDemuxOutputToVideoSource(struct DCCDemuxTask *pDemuxTask, RMuint32 output, struct DCCVideoSource *pVideoSource)
 {
-	fprintf(stderr, "Error: %s is not implemented.\n", __FUNCTION__);
-	return RM_NOTIMPLEMENTED;
+	if ((pDemuxTask == NULL) || (pVideoSource == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	return connect_demux_output(pDemuxTask, output, pVideoSource->decodermoduleid);
 }
 
-RMstatus DCCStopDemuxTask(struct DCCDemuxTask *pDemuxTask)
+/** Send the data of a DemuxOutput to the audio decoder. */
+RMstatus DCCConnectDemuxOutputToAudioSource(struct DCCDemuxTask *pDemuxTask, RMuint32 output, struct DCCAudioSource *pAudioSource)
 {
-	fprintf(stderr, "Error: %s is not implemented.\n", __FUNCTION__);
-	return RM_NOTIMPLEMENTED;
+	if ((pDemuxTask == NULL) || (pAudioSource == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	return connect_demux_output(pDemuxTask, output, pAudioSource->decodermoduleid);
 }
 
-RMstatus DCCGetDemuxTaskInfo(struct DCCDemuxTask *pDemuxTask, RMuint32 *demux_task)
+RMstatus DCCDisconnectDemuxOutput(struct DCCDemuxTask *pDemuxTask, RMuint32 output)
 {
-	fprintf(stderr, "Error: %s is not implemented.\n", __FUNCTION__);
-	return RM_NOTIMPLEMENTED;
+	RMstatus rv;
+	RMuint32 buffer_param[2];
+
+	if (pDemuxTask == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (output >= DCC_DEMUX_MAX_OUTPUTS) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+	if (pDemuxTask->outputs[output] == 0) {
+		return RM_OK;
+	}
+
+	buffer_param[0] = pDemuxTask->demuxtaskmoduleid;
+	buffer_param[1] = pDemuxTask->outputs[output];
+	rv = RUASetProperty(pDemuxTask->pRua, EMHWLIB_MODULE(DemuxOutput, output), RMDemuxOutputPropertyID_Disconnect, buffer_param, sizeof(buffer_param), 0);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	pDemuxTask->outputs[output] = 0;
+	return RM_OK;
 }
 
 RMstatus DCCSetRouteDisplayAspectRatio(struct DCC *pDCC, enum DCCRoute route, RMuint8 ar_x, RMuint8 ar_y)
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * Helpers shared by the modules of libdcc, not part of the API.
+ */
+
+#ifndef _DCC_INTERNAL_H_
+#define _DCC_INTERNAL_H_
+
+#include "rua.h"
+
+/** Return the time of CLOCK_MONOTONIC in microseconds. */
+RMuint64 DCCGetMonotonicUs(void);
+
+#endif
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * Recording from a DemuxOutput.
+ *
+ * The demux writes into the buffers of a receive pool. The buffers are
+ * handed out as they are and can be written to a file directly from the DMA
+ * mapping, so the CPU never copies the stream in userspace.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "rua.h"
+#include "dcc.h"
+
+/** Print debug message. */
+#if 0
+#define DPRINTF(args...) printf(args)
+#else
+#define DPRINTF(args...) do { } while(0)
+#endif
+
+/** Maximum time to sleep before checking for new data. */
+#define RECEIVE_SLICE_US 10000
+
+/** Info returned with a received buffer. TBD: Layout is not verified. */
+struct DemuxReceiveInfo {
+	RMuint32 Flags;
+	RMuint32 PID;
+	RMuint64 Timestamp;
+};
+
+/** Flag in DemuxReceiveInfo when Timestamp is valid. TBD: not verified. */
+#define DEMUX_RECEIVE_TIMESTAMP_VALID 0x1
+
+struct DCCDemuxRecorder {
+	struct RUA *pRua;
+	struct DCCDemuxTask *pDemuxTask;
+	RMuint32 outputmoduleid;
+	struct RUABufferPool *pPool;
+	struct DCCDemuxRecorderProfile profile;
+};
+
+RMstatus DCCOpenDemuxRecorder(struct RUA *pRua, struct DCCDemuxTask *pDemuxTask, struct DCCDemuxRecorderProfile *profile, struct DCCDemuxRecorder **ppRecorder)
+{
+	struct DCCDemuxRecorder *pRecorder;
+	RMuint32 buffer[1];
+	RMstatus rv;
+
+	if ((pRua == NULL) || (pDemuxTask == NULL) || (profile == NULL) || (ppRecorder == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (profile->Output >= DCC_DEMUX_MAX_OUTPUTS) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+	if ((profile->BufferCount == 0) || (profile->log2BufferSize == 0)) {
+		return RM_INVALID_PARAMETER;
+	}
+#ifndef RUA_RECEIVE_DATA
+	/* Data can't be received, RUAReceiveData() isn't built. */
+	return RM_NOT_SUPPORTED;
+#endif
+
+	pRecorder = malloc(sizeof(*pRecorder));
+	if (pRecorder == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pRecorder, 0, sizeof(*pRecorder));
+	pRecorder->pRua = pRua;
+	pRecorder->pDemuxTask = pDemuxTask;
+	pRecorder->profile = *profile;
+	pRecorder->outputmoduleid = EMHWLIB_MODULE(DemuxOutput, profile->Output);
+
+	buffer[0] = profile->DataType;
+	rv = RUASetProperty(pRua, pRecorder->outputmoduleid, RMDemuxOutputPropertyID_DataType, buffer, sizeof(buffer), 0);
+	if (rv != RM_OK) {
+		free(pRecorder);
+		return rv;
+	}
+
+	rv = RUAOpenPool(pRua, pRecorder->outputmoduleid, profile->BufferCount, profile->log2BufferSize, RUA_POOL_DIRECTION_RECEIVE, &pRecorder->pPool);
+	if (rv != RM_OK) {
+		free(pRecorder);
+		return rv;
+	}
+
+	buffer[0] = 1;
+	rv = RUASetProperty(pRua, pRecorder->outputmoduleid, RMDemuxOutputPropertyID_Enable, buffer, sizeof(buffer), 0);
+	if (rv != RM_OK) {
+		DCCCloseDemuxRecorder(pRecorder);
+		return rv;
+	}
+
+	*ppRecorder = pRecorder;
+	return RM_OK;
+}
+
+RMstatus DCCCloseDemuxRecorder(struct DCCDemuxRecorder *pRecorder)
+{
+	RMuint32 buffer[1];
+
+	if (pRecorder == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pRecorder->pPool != NULL) {
+		buffer[0] = 0;
+		RUASetProperty(pRecorder->pRua, pRecorder->outputmoduleid, RMDemuxOutputPropertyID_Enable, buffer, sizeof(buffer), 0);
+		RUASetProperty(pRecorder->pRua, pRecorder->outputmoduleid, RMDemuxOutputPropertyID_Flush, NULL, 0, 0);
+		RUAClosePool(pRecorder->pPool);
+		pRecorder->pPool = NULL;
+	}
+	free(pRecorder);
+	return RM_OK;
+}
+
+/**
+ * Wait for the next filled buffer.
+ *
+ * @param data Points into the DMA buffer, must be given back with
+ *             DCCDemuxRecorderRelease().
+ * @retval RM_PENDING No data was received within TimeOut_us.
+ */
+RMstatus DCCDemuxRecorderReceive(struct DCCDemuxRecorder *pRecorder, RMuint8 **data, struct DCCDemuxReceiveInfo *info, RMuint32 TimeOut_us)
+{
+	struct DemuxReceiveInfo receive_info;
+	RMuint32 info_size;
+	RMuint32 size;
+	RMuint32 waited = 0;
+	RMstatus rv;
+
+	if ((pRecorder == NULL) || (data == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+
+	do {
+		memset(&receive_info, 0, sizeof(receive_info));
+		info_size = sizeof(receive_info);
+		rv = RUAReceiveData(pRecorder->pRua, pRecorder->outputmoduleid, pRecorder->pPool, data, &size, &receive_info, &info_size);
+		if (rv != RM_PENDING) {
+			break;
+		}
+		if (waited >= TimeOut_us) {
+			return RM_PENDING;
+		}
+		usleep(RECEIVE_SLICE_US);
+		waited += RECEIVE_SLICE_US;
+	} while (1);
+	if (rv != RM_OK) {
+		return rv;
+	}
+
+	if (info != NULL) {
+		memset(info, 0, sizeof(*info));
+		info->Size = size;
+		if (info_size >= sizeof(receive_info)) {
+			info->PID = receive_info.PID;
+			info->Timestamp = receive_info.Timestamp;
+			info->TimestampValid = (receive_info.Flags & DEMUX_RECEIVE_TIMESTAMP_VALID) ? TRUE : FALSE;
+		}
+	}
+	return RM_OK;
+}
+
+RMstatus DCCDemuxRecorderRelease(struct DCCDemuxRecorder *pRecorder, RMuint8 *data)
+{
+	if ((pRecorder == NULL) || (data == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	return RUAReleaseBuffer(pRecorder->pPool, data);
+}
+
+/**
+ * Receive the next buffer and write it to fd directly from the DMA buffer.
+ *
+ * @param info Optional metadata of the written buffer.
+ * @retval RM_PENDING No data was received within TimeOut_us.
+ */
+RMstatus DCCDemuxRecorderWrite(struct DCCDemuxRecorder *pRecorder, int fd, RMuint32 TimeOut_us, struct DCCDemuxReceiveInfo *info)
+{
+	struct DCCDemuxReceiveInfo receive_info;
+	RMuint8 *data;
+	RMuint32 pos = 0;
+	RMstatus rv;
+
+	rv = DCCDemuxRecorderReceive(pRecorder, &data, &receive_info, TimeOut_us);
+	if (rv != RM_OK) {
+		return rv;
+	}
+
+	while (pos < receive_info.Size) {
+		ssize_t written;
+
+		written = write(fd, &data[pos], receive_info.Size - pos);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "Error: Failed to write recorded data (%s).\n", strerror(errno));
+			DCCDemuxRecorderRelease(pRecorder, data);
+			return RM_ERROR;
+		}
+		pos += written;
+	}
+	DPRINTF("Recorded %u bytes PID 0x%04x\n", receive_info.Size, receive_info.PID);
+
+	if (info != NULL) {
+		*info = receive_info;
+	}
+	return DCCDemuxRecorderRelease(pRecorder, data);
+}
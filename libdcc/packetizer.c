@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * Packing of access units into DMA buffers with timestamps.
+ *
+ * The data of a decoder is collected in the buffers of a send pool. The
+ * buffer which holds the start of an access unit carries the PTS of the unit
+ * in emhwlib_info together with the offset of the unit in the buffer, so
+ * the decoder doesn't need to interpolate the time after a jump.
+ *
+ * emhwlib_info can describe only one access unit, so a buffer which already
+ * has a timestamp is sent before the next access unit with a timestamp
+ * starts. With PackUnits the following units are appended without timestamp
+ * and the decoder interpolates their time.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rua.h"
+#include "dcc.h"
+
+/** Print debug message. */
+#if 0
+#define DPRINTF(args...) printf(args)
+#else
+#define DPRINTF(args...) do { } while(0)
+#endif
+
+struct DCCPacketizer {
+	struct RUA *pRua;
+	struct DCCPacketizerProfile profile;
+
+	/** Buffer which is filled at the moment, NULL if none. */
+	RMuint8 *buffer;
+	RMuint32 pos;
+	struct emhwlib_info info;
+
+	/** Set by DCCPacketizerStartUnit(), the next written byte starts an access unit. */
+	RMbool unit_pending;
+	RMbool unit_pts_valid;
+	RMuint64 unit_pts;
+};
+
+/** Convert pts from the time base of the profile into the decoder time resolution. */
+static RMuint64 convert_time(struct DCCPacketizer *pPacketizer, RMuint64 pts)
+{
+	RMuint64 num = ((RMuint64) pPacketizer->profile.TimeBaseNum) * pPacketizer->profile.TimeResolution;
+	RMuint64 den = pPacketizer->profile.TimeBaseDen;
+
+	/* Split to avoid an overflow of pts * num. */
+	return (pts / den) * num + ((pts % den) * num) / den;
+}
+
+RMstatus DCCOpenPacketizer(struct RUA *pRua, struct DCCPacketizerProfile *profile, struct DCCPacketizer **ppPacketizer)
+{
+	struct DCCPacketizer *pPacketizer;
+
+	if ((pRua == NULL) || (profile == NULL) || (profile->pPool == NULL) || (ppPacketizer == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if ((profile->BufferSize == 0) || (profile->TimeBaseNum == 0) || (profile->TimeBaseDen == 0) || (profile->TimeResolution == 0)) {
+		return RM_INVALID_PARAMETER;
+	}
+
+	pPacketizer = malloc(sizeof(*pPacketizer));
+	if (pPacketizer == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pPacketizer, 0, sizeof(*pPacketizer));
+	pPacketizer->pRua = pRua;
+	pPacketizer->profile = *profile;
+
+	*ppPacketizer = pPacketizer;
+	return RM_OK;
+}
+
+RMstatus DCCClosePacketizer(struct DCCPacketizer *pPacketizer)
+{
+	if (pPacketizer == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	DCCPacketizerReset(pPacketizer);
+	free(pPacketizer);
+	return RM_OK;
+}
+
+/**
+ * The data written next starts a new access unit.
+ *
+ * @param pts_valid FALSE when the unit has no timestamp.
+ * @param pts Timestamp in the time base of the profile, negative values are
+ *            not sent to the decoder.
+ */
+RMstatus DCCPacketizerStartUnit(struct DCCPacketizer *pPacketizer, RMbool pts_valid, RMint64 pts)
+{
+	if (pPacketizer == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	pPacketizer->unit_pending = TRUE;
+	pPacketizer->unit_pts_valid = (pts_valid && (pts >= 0)) ? TRUE : FALSE;
+	if (pPacketizer->unit_pts_valid) {
+		pPacketizer->unit_pts = convert_time(pPacketizer, pts);
+	}
+	return RM_OK;
+}
+
+static RMstatus send_buffer(struct DCCPacketizer *pPacketizer)
+{
+	RMstatus rv;
+
+	DPRINTF("Send %u bytes to 0x%08x, ValidFields 0x%x TimeStamp %llu FirstAccessUnitPointer %u\n",
+		pPacketizer->pos, pPacketizer->profile.ModuleID, pPacketizer->info.ValidFields,
+		pPacketizer->info.TimeStamp, pPacketizer->info.FirstAccessUnitPointer);
+	rv = RUASendData(pPacketizer->pRua, pPacketizer->profile.ModuleID, pPacketizer->profile.pPool, pPacketizer->buffer, pPacketizer->pos, &pPacketizer->info, sizeof(pPacketizer->info));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	do {
+		rv = RUAReleaseBuffer(pPacketizer->profile.pPool, pPacketizer->buffer);
+	} while (rv == RM_PENDING);
+	pPacketizer->buffer = NULL;
+	pPacketizer->pos = 0;
+	return rv;
+}
+
+/**
+ * Get the free space of the buffer which is filled at the moment, so data
+ * can be read directly into the DMA buffer. A full buffer is sent to the
+ * decoder first.
+ *
+ * @param data Set to the free space, DCCPacketizerCommit() adds the bytes
+ *             which were filled.
+ * @param size Set to the number of free bytes.
+ * @retval RM_PENDING No free buffer or the decoder FIFO is full, try again
+ *                    later.
+ */
+RMstatus DCCPacketizerGetBuffer(struct DCCPacketizer *pPacketizer, RMuint8 **data, RMuint32 *size)
+{
+	RMstatus rv;
+
+	if ((pPacketizer == NULL) || (data == NULL) || (size == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if ((pPacketizer->buffer != NULL) && (pPacketizer->pos >= pPacketizer->profile.BufferSize)) {
+		rv = send_buffer(pPacketizer);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+	if ((pPacketizer->buffer != NULL) && pPacketizer->unit_pending && pPacketizer->unit_pts_valid
+		&& (pPacketizer->info.ValidFields & TIME_STAMP_INFO) && !pPacketizer->profile.PackUnits) {
+		/* The buffer can't describe a second access unit. */
+		rv = send_buffer(pPacketizer);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+	if (pPacketizer->buffer == NULL) {
+		rv = RUAGetBuffer(pPacketizer->profile.pPool, &pPacketizer->buffer, 0);
+		if (rv != RM_OK) {
+			pPacketizer->buffer = NULL;
+			return rv;
+		}
+		pPacketizer->pos = 0;
+		memset(&pPacketizer->info, 0, sizeof(pPacketizer->info));
+	}
+	if (pPacketizer->unit_pending) {
+		if (pPacketizer->unit_pts_valid && !(pPacketizer->info.ValidFields & TIME_STAMP_INFO)) {
+			pPacketizer->info.ValidFields = TIME_STAMP_INFO | FIRST_ACCESS_UNIT_POINTER_INFO;
+			pPacketizer->info.TimeStamp = pPacketizer->unit_pts;
+			pPacketizer->info.FirstAccessUnitPointer = pPacketizer->pos;
+		}
+		pPacketizer->unit_pending = FALSE;
+	}
+
+	*data = &pPacketizer->buffer[pPacketizer->pos];
+	*size = pPacketizer->profile.BufferSize - pPacketizer->pos;
+	return RM_OK;
+}
+
+/** Add size bytes which were filled into the space from DCCPacketizerGetBuffer(). */
+RMstatus DCCPacketizerCommit(struct DCCPacketizer *pPacketizer, RMuint32 size)
+{
+	if (pPacketizer == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if ((pPacketizer->buffer == NULL) || (size > (pPacketizer->profile.BufferSize - pPacketizer->pos))) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+	pPacketizer->pos += size;
+	return RM_OK;
+}
+
+/**
+ * Copy data into the DMA buffers, full buffers are sent to the decoder.
+ *
+ * @param written Number of bytes taken, also set when RM_PENDING is returned.
+ * @retval RM_PENDING No free buffer or the decoder FIFO is full, the rest
+ *                    must be written again later.
+ */
+RMstatus DCCPacketizerWrite(struct DCCPacketizer *pPacketizer, const RMuint8 *data, RMuint32 size, RMuint32 *written)
+{
+	RMstatus rv;
+
+	if ((pPacketizer == NULL) || ((data == NULL) && (size > 0)) || (written == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	*written = 0;
+
+	while (*written < size) {
+		RMuint8 *buffer;
+		RMuint32 len;
+
+		rv = DCCPacketizerGetBuffer(pPacketizer, &buffer, &len);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		if (len > (size - *written)) {
+			len = size - *written;
+		}
+		memcpy(buffer, &data[*written], len);
+		pPacketizer->pos += len;
+		*written += len;
+	}
+	return RM_OK;
+}
+
+/**
+ * Send the partially filled buffer, e.g. at the end of the stream.
+ *
+ * @retval RM_PENDING Decoder FIFO is full, try again later.
+ */
+RMstatus DCCPacketizerFlush(struct DCCPacketizer *pPacketizer)
+{
+	if (pPacketizer == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if ((pPacketizer->buffer == NULL) || (pPacketizer->pos == 0)) {
+		return RM_OK;
+	}
+	return send_buffer(pPacketizer);
+}
+
+/** Drop data which was not sent yet, e.g. after a jump. */
+RMstatus DCCPacketizerReset(struct DCCPacketizer *pPacketizer)
+{
+	if (pPacketizer == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pPacketizer->buffer != NULL) {
+		RUAReleaseBuffer(pPacketizer->profile.pPool, pPacketizer->buffer);
+		pPacketizer->buffer = NULL;
+	}
+	pPacketizer->pos = 0;
+	pPacketizer->unit_pending = FALSE;
+	return RM_OK;
+}
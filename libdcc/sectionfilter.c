@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * PSI section filtering with the demux task.
+ *
+ * The demux hardware compares the section header with a match entry and
+ * writes only matching sections to a DemuxOutput. The sections are received
+ * through a receive pool, so the CPU does not need to look at the other
+ * transport stream packets.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rua.h"
+#include "dcc.h"
+
+/** Print debug message. */
+#if 0
+#define DPRINTF(args...) printf(args)
+#else
+#define DPRINTF(args...) do { } while(0)
+#endif
+
+/** Maximum size of a private section including the header. */
+#define SECTION_MAX_SIZE (4096 + 3)
+/** Maximum time to sleep before checking for new data. */
+#define RECEIVE_SLICE_US 10000
+
+/** Layout of RMDemuxTaskPropertyID_MatchSectionEntry. TBD: not verified. */
+struct MatchSectionEntry {
+	RMuint32 Index;
+	RMuint32 PidEntry;
+	RMuint8 Match[DCC_SECTION_FILTER_LENGTH];
+	RMuint8 Mask[DCC_SECTION_FILTER_LENGTH];
+	RMuint32 OutputMask;
+};
+
+struct DCCSectionFilter {
+	struct RUA *pRua;
+	struct DCCDemuxTask *pDemuxTask;
+	RMuint32 demuxtaskmoduleid;
+	RMuint32 outputmoduleid;
+	struct RUABufferPool *pPool;
+	struct DCCSectionFilterProfile profile;
+	/** Match entry allocated by the demux task. */
+	RMuint32 match_entry;
+	RMbool match_allocated;
+	RMbool pid_enabled;
+
+	/** Received data which is not yet returned as section. */
+	RMuint8 *data;
+	RMuint32 size;
+	/** Size of the section returned by the last DCCSectionFilterRead(). */
+	RMuint32 consumed;
+};
+
+static RMstatus enable_pid(struct DCCSectionFilter *pFilter)
+{
+	struct DCCDemuxPidEntry entry;
+	RMuint32 mask = 1 << pFilter->profile.Output;
+	RMstatus rv;
+
+	if (pFilter->profile.PID == 0) {
+		rv = RUASetProperty(pFilter->pRua, pFilter->demuxtaskmoduleid, RMDemuxTaskPropertyID_PATPidEntryAddOutputs, &mask, sizeof(mask), 0);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		return RUASetProperty(pFilter->pRua, pFilter->demuxtaskmoduleid, RMDemuxTaskPropertyID_PATPidEntryEnable, NULL, 0, 0);
+	}
+
+	memset(&entry, 0, sizeof(entry));
+	entry.Index = pFilter->profile.PidEntry;
+	entry.PID = pFilter->profile.PID;
+	entry.OutputMask = mask;
+	return DCCSetDemuxTaskPidEntry(pFilter->pDemuxTask, &entry);
+}
+
+static RMstatus disable_pid(struct DCCSectionFilter *pFilter)
+{
+	if (pFilter->profile.PID == 0) {
+		return RUASetProperty(pFilter->pRua, pFilter->demuxtaskmoduleid, RMDemuxTaskPropertyID_PATPidEntryDisable, NULL, 0, 0);
+	}
+	return DCCFreeDemuxTaskPidEntry(pFilter->pDemuxTask, pFilter->profile.PidEntry);
+}
+
+/**
+ * Start a section filter.
+ *
+ * Match and Mask are compared with the section header, byte 0 is the
+ * table_id, the following bytes start after section_length (DVB style).
+ *
+ * @retval RM_NOT_SUPPORTED Built without RUARECEIVE = yes in config.mk.
+ */
+RMstatus DCCOpenSectionFilter(struct RUA *pRua, struct DCCDemuxTask *pDemuxTask, struct DCCSectionFilterProfile *profile, struct DCCSectionFilter **ppFilter)
+{
+	struct DCCSectionFilter *pFilter;
+	struct MatchSectionEntry match;
+	RMuint32 buffer[1];
+	RMstatus rv;
+
+	if ((pRua == NULL) || (pDemuxTask == NULL) || (profile == NULL) || (ppFilter == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if ((profile->PID > 0x1FFF) || (profile->Output >= DCC_DEMUX_MAX_OUTPUTS)) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+	if ((profile->BufferCount == 0) || (profile->log2BufferSize == 0)) {
+		return RM_INVALID_PARAMETER;
+	}
+#ifndef RUA_RECEIVE_DATA
+	/* Sections can't be received, RUAReceiveData() isn't built. */
+	return RM_NOT_SUPPORTED;
+#endif
+
+	pFilter = malloc(sizeof(*pFilter));
+	if (pFilter == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pFilter, 0, sizeof(*pFilter));
+	pFilter->pRua = pRua;
+	pFilter->pDemuxTask = pDemuxTask;
+	pFilter->profile = *profile;
+	pFilter->outputmoduleid = EMHWLIB_MODULE(DemuxOutput, profile->Output);
+
+	pFilter->data = malloc(2 * SECTION_MAX_SIZE + (1 << profile->log2BufferSize));
+	if (pFilter->data == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+
+		free(pFilter);
+		return RM_FATALOUTOFMEMORY;
+	}
+
+	rv = DCCGetDemuxTaskInfo(pDemuxTask, &pFilter->demuxtaskmoduleid);
+	if (rv != RM_OK) {
+		DCCCloseSectionFilter(pFilter);
+		return rv;
+	}
+
+	rv = RUAGetProperty(pRua, pFilter->demuxtaskmoduleid, RMDemuxTaskPropertyID_AllocateMatchSectionEntry, &pFilter->match_entry, sizeof(pFilter->match_entry));
+	if (rv != RM_OK) {
+		DCCCloseSectionFilter(pFilter);
+		return rv;
+	}
+	pFilter->match_allocated = TRUE;
+
+	memset(&match, 0, sizeof(match));
+	match.Index = pFilter->match_entry;
+	match.PidEntry = profile->PidEntry;
+	memcpy(match.Match, profile->Match, sizeof(match.Match));
+	memcpy(match.Mask, profile->Mask, sizeof(match.Mask));
+	match.OutputMask = 1 << profile->Output;
+	rv = RUASetProperty(pRua, pFilter->demuxtaskmoduleid, RMDemuxTaskPropertyID_MatchSectionEntry, &match, sizeof(match), 0);
+	if (rv != RM_OK) {
+		DCCCloseSectionFilter(pFilter);
+		return rv;
+	}
+
+	buffer[0] = DCCDemuxDataType_Section;
+	rv = RUASetProperty(pRua, pFilter->outputmoduleid, RMDemuxOutputPropertyID_DataType, buffer, sizeof(buffer), 0);
+	if (rv != RM_OK) {
+		DCCCloseSectionFilter(pFilter);
+		return rv;
+	}
+
+	rv = RUAOpenPool(pRua, pFilter->outputmoduleid, profile->BufferCount, profile->log2BufferSize, RUA_POOL_DIRECTION_RECEIVE, &pFilter->pPool);
+	if (rv != RM_OK) {
+		DCCCloseSectionFilter(pFilter);
+		return rv;
+	}
+
+	buffer[0] = 1;
+	rv = RUASetProperty(pRua, pFilter->outputmoduleid, RMDemuxOutputPropertyID_Enable, buffer, sizeof(buffer), 0);
+	if (rv != RM_OK) {
+		DCCCloseSectionFilter(pFilter);
+		return rv;
+	}
+
+	rv = enable_pid(pFilter);
+	if (rv != RM_OK) {
+		DCCCloseSectionFilter(pFilter);
+		return rv;
+	}
+	pFilter->pid_enabled = TRUE;
+
+	*ppFilter = pFilter;
+	return RM_OK;
+}
+
+RMstatus DCCCloseSectionFilter(struct DCCSectionFilter *pFilter)
+{
+	RMuint32 buffer[1];
+
+	if (pFilter == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pFilter->pid_enabled) {
+		disable_pid(pFilter);
+		pFilter->pid_enabled = FALSE;
+	}
+	if (pFilter->pPool != NULL) {
+		buffer[0] = 0;
+		RUASetProperty(pFilter->pRua, pFilter->outputmoduleid, RMDemuxOutputPropertyID_Enable, buffer, sizeof(buffer), 0);
+		RUASetProperty(pFilter->pRua, pFilter->outputmoduleid, RMDemuxOutputPropertyID_Flush, NULL, 0, 0);
+		RUAClosePool(pFilter->pPool);
+		pFilter->pPool = NULL;
+	}
+	if (pFilter->match_allocated) {
+		RUASetProperty(pFilter->pRua, pFilter->demuxtaskmoduleid, RMDemuxTaskPropertyID_FreeMatchSectionEntry, &pFilter->match_entry, sizeof(pFilter->match_entry), 0);
+		pFilter->match_allocated = FALSE;
+	}
+	if (pFilter->data != NULL) {
+		free(pFilter->data);
+		pFilter->data = NULL;
+	}
+	free(pFilter);
+	return RM_OK;
+}
+
+/** Return the size of the first complete section in the data, 0 when incomplete. */
+static RMuint32 find_section(struct DCCSectionFilter *pFilter)
+{
+	RMuint32 length;
+	RMuint32 stuffing = 0;
+
+	/* Skip stuffing between sections. */
+	while ((stuffing < pFilter->size) && (pFilter->data[stuffing] == 0xFF)) {
+		stuffing++;
+	}
+	if (stuffing > 0) {
+		pFilter->size -= stuffing;
+		memmove(pFilter->data, &pFilter->data[stuffing], pFilter->size);
+	}
+	if (pFilter->size < 3) {
+		return 0;
+	}
+	length = 3 + (((pFilter->data[1] & 0x0F) << 8) | pFilter->data[2]);
+	if (length > pFilter->size) {
+		return 0;
+	}
+	return length;
+}
+
+/**
+ * Wait for the next complete section.
+ *
+ * @param section Points to the section, valid until the next call.
+ * @retval RM_PENDING No section was received within TimeOut_us.
+ */
+RMstatus DCCSectionFilterRead(struct DCCSectionFilter *pFilter, RMuint8 **section, RMuint32 *size, RMuint32 TimeOut_us)
+{
+	RMuint32 waited = 0;
+	RMuint32 length;
+	RMstatus rv;
+
+	if ((pFilter == NULL) || (section == NULL) || (size == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+
+	if (pFilter->consumed != 0) {
+		pFilter->size -= pFilter->consumed;
+		memmove(pFilter->data, &pFilter->data[pFilter->consumed], pFilter->size);
+		pFilter->consumed = 0;
+	}
+
+	while ((length = find_section(pFilter)) == 0) {
+		RMuint8 *data;
+		RMuint32 datasize;
+
+		rv = RUAReceiveData(pFilter->pRua, pFilter->outputmoduleid, pFilter->pPool, &data, &datasize, NULL, NULL);
+		if (rv == RM_PENDING) {
+			if (waited >= TimeOut_us) {
+				return RM_PENDING;
+			}
+			usleep(RECEIVE_SLICE_US);
+			waited += RECEIVE_SLICE_US;
+			continue;
+		}
+		if (rv != RM_OK) {
+			return rv;
+		}
+
+		if ((pFilter->size + datasize) > (2 * SECTION_MAX_SIZE + (1U << pFilter->profile.log2BufferSize))) {
+			/* Lost synchronisation, start again with the new data. */
+			DPRINTF("Section filter dropped %u bytes\n", pFilter->size);
+			pFilter->size = 0;
+		}
+		memcpy(&pFilter->data[pFilter->size], data, datasize);
+		pFilter->size += datasize;
+
+		rv = RUAReleaseBuffer(pFilter->pPool, data);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+
+	pFilter->consumed = length;
+	*section = pFilter->data;
+	*size = length;
+	return RM_OK;
+}
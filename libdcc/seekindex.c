@@ -0,0 +1,885 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * Key frame index for seeking.
+ *
+ * The index maps the PTS of each key frame to its position in the file, so a
+ * jump reads from the key frame before the target instead of streaming all
+ * data up to it. It is built from the index of the container or by scanning
+ * an H.264 byte stream and saved next to the media file, so it only needs to
+ * be built once per file.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "rua.h"
+#include "dcc.h"
+
+/** Print debug message. */
+#if 0
+#define DPRINTF(args...) printf(args)
+#else
+#define DPRINTF(args...) do { } while(0)
+#endif
+
+#define SEEKINDEX_MAGIC 0x58444953 /* "SIDX" */
+/** Version 2 counts the two fields of a frame as one frame. */
+#define SEEKINDEX_VERSION 2
+#define SEEKINDEX_HEADER_SIZE 32
+#define SEEKINDEX_ENTRY_SIZE 20
+/** Entries allocated at first use of the index. */
+#define SEEKINDEX_INITIAL_COUNT 256
+
+#define NAL_SLICE 1
+#define NAL_IDR 5
+#define NAL_SEI 6
+#define NAL_SPS 7
+#define NAL_PPS 8
+#define NAL_AUD 9
+
+/** Bytes of a NAL unit kept for parsing, enough for a SPS with scaling lists. */
+#define SCAN_NAL_SIZE 256
+#define MAX_SPS_COUNT 32
+#define MAX_PPS_COUNT 256
+
+enum scan_state {
+	SCAN_START_CODE = 0,
+	SCAN_NAL_HEADER,
+	SCAN_NAL_DATA,
+};
+
+/** Fields of a SPS needed to parse the slice header up to bottom_field_flag. */
+struct scan_sps {
+	RMbool valid;
+	RMbool separate_colour_plane;
+	RMbool frame_mbs_only;
+	RMuint32 log2_max_frame_num;
+};
+
+struct bit_reader {
+	const RMuint8 *data;
+	RMuint32 size;
+	/** Position in bits. */
+	RMuint32 pos;
+	/** Set when data was read behind the end. */
+	RMbool error;
+};
+
+struct DCCSeekIndex {
+	RMuint32 time_resolution;
+	struct DCCTrickPlayEntry *entries;
+	RMuint32 count;
+	RMuint32 allocated;
+	/** True when entries were added out of order. */
+	RMbool unsorted;
+
+	/* State of DCCSeekIndexScanAnnexB(). */
+	enum scan_state state;
+	/** File offset of the next byte passed to the scanner. */
+	RMuint64 scan_offset;
+	RMuint32 zeros;
+	RMuint32 nal_type;
+	RMuint64 nal_offset;
+	/** Start of the NAL unit after the header, without emulation prevention bytes. */
+	RMuint8 nal[SCAN_NAL_SIZE];
+	RMuint32 nal_size;
+	/** SEI, SPS, PPS or AUD in front of the next picture. */
+	RMbool prefix_valid;
+	RMuint64 prefix_offset;
+	struct scan_sps sps[MAX_SPS_COUNT];
+	/** seq_parameter_set_id + 1 of each PPS, 0 when the PPS wasn't seen. */
+	RMuint8 pps_sps[MAX_PPS_COUNT];
+	/** A field was seen and its second field may follow. */
+	RMbool field_pending;
+	RMbool field_bottom;
+	RMuint32 field_frame_num;
+	/** Number of frames, a field pair counts once. */
+	RMuint64 frames;
+	RMuint64 frame_duration;
+	/** Key frame which size is not yet known. */
+	RMbool open_entry;
+};
+
+static void put_u32(RMuint8 *p, RMuint32 value)
+{
+	p[0] = value;
+	p[1] = value >> 8;
+	p[2] = value >> 16;
+	p[3] = value >> 24;
+}
+
+static void put_u64(RMuint8 *p, RMuint64 value)
+{
+	put_u32(p, value);
+	put_u32(&p[4], value >> 32);
+}
+
+static RMuint32 get_u32(const RMuint8 *p)
+{
+	return ((RMuint32) p[0]) | (((RMuint32) p[1]) << 8) | (((RMuint32) p[2]) << 16) | (((RMuint32) p[3]) << 24);
+}
+
+static RMuint64 get_u64(const RMuint8 *p)
+{
+	return ((RMuint64) get_u32(p)) | (((RMuint64) get_u32(&p[4])) << 32);
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+	const struct DCCTrickPlayEntry *ea = a;
+	const struct DCCTrickPlayEntry *eb = b;
+
+	if (ea->pts < eb->pts) {
+		return -1;
+	}
+	return (ea->pts > eb->pts) ? 1 : 0;
+}
+
+static void sort_entries(struct DCCSeekIndex *pIndex)
+{
+	if (pIndex->unsorted) {
+		qsort(pIndex->entries, pIndex->count, sizeof(pIndex->entries[0]), compare_entries);
+		pIndex->unsorted = FALSE;
+	}
+}
+
+static char *get_index_filename(const char *mediafile, const char *suffix)
+{
+	char *filename;
+
+	filename = malloc(strlen(mediafile) + strlen(DCC_SEEKINDEX_SUFFIX) + strlen(suffix) + 1);
+	if (filename == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+		return NULL;
+	}
+	strcpy(filename, mediafile);
+	strcat(filename, DCC_SEEKINDEX_SUFFIX);
+	strcat(filename, suffix);
+	return filename;
+}
+
+RMstatus DCCSeekIndexOpen(RMuint32 time_resolution, struct DCCSeekIndex **ppIndex)
+{
+	struct DCCSeekIndex *pIndex;
+
+	if (ppIndex == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (time_resolution == 0) {
+		return RM_INVALID_PARAMETER;
+	}
+	pIndex = malloc(sizeof(*pIndex));
+	if (pIndex == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pIndex, 0, sizeof(*pIndex));
+	pIndex->time_resolution = time_resolution;
+	pIndex->state = SCAN_START_CODE;
+
+	*ppIndex = pIndex;
+	return RM_OK;
+}
+
+RMstatus DCCSeekIndexClose(struct DCCSeekIndex *pIndex)
+{
+	if (pIndex == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pIndex->entries != NULL) {
+		free(pIndex->entries);
+	}
+	free(pIndex);
+	return RM_OK;
+}
+
+/**
+ * Add a key frame.
+ *
+ * @param pts Presentation time in the time resolution of the index.
+ * @param offset Position of the key frame in the media file.
+ * @param size Size of the key frame, 0 if unknown.
+ */
+RMstatus DCCSeekIndexAdd(struct DCCSeekIndex *pIndex, RMuint64 pts, RMuint64 offset, RMuint32 size)
+{
+	struct DCCTrickPlayEntry *entry;
+
+	if (pIndex == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pIndex->count >= pIndex->allocated) {
+		struct DCCTrickPlayEntry *entries;
+		RMuint32 allocated;
+
+		allocated = (pIndex->allocated == 0) ? SEEKINDEX_INITIAL_COUNT : (pIndex->allocated * 2);
+		entries = realloc(pIndex->entries, allocated * sizeof(entries[0]));
+		if (entries == NULL) {
+			fprintf(stderr, "Error: out of memory\n");
+			return RM_FATALOUTOFMEMORY;
+		}
+		pIndex->entries = entries;
+		pIndex->allocated = allocated;
+	}
+	if ((pIndex->count > 0) && (pts < pIndex->entries[pIndex->count - 1].pts)) {
+		pIndex->unsorted = TRUE;
+	}
+	entry = &pIndex->entries[pIndex->count];
+	entry->pts = pts;
+	entry->offset = offset;
+	entry->size = size;
+	pIndex->count++;
+	return RM_OK;
+}
+
+/** A new picture starts at offset, which also ends the previous key frame. */
+static RMstatus scan_picture(struct DCCSeekIndex *pIndex, RMuint64 offset, RMbool idr)
+{
+	RMstatus rv;
+
+	if (pIndex->open_entry) {
+		struct DCCTrickPlayEntry *entry = &pIndex->entries[pIndex->count - 1];
+
+		entry->size = offset - entry->offset;
+		pIndex->open_entry = FALSE;
+	}
+	if (idr) {
+		DPRINTF("Key frame %llu at %llu\n", pIndex->frames, offset);
+		rv = DCCSeekIndexAdd(pIndex, pIndex->frames * pIndex->frame_duration, offset, 0);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		pIndex->open_entry = TRUE;
+	}
+	pIndex->frames++;
+	return RM_OK;
+}
+
+static RMuint32 read_bits(struct bit_reader *br, RMuint32 n)
+{
+	RMuint32 value = 0;
+
+	while (n-- > 0) {
+		if (br->pos >= (br->size * 8)) {
+			br->error = TRUE;
+			return 0;
+		}
+		value = (value << 1) | ((br->data[br->pos / 8] >> (7 - (br->pos % 8))) & 1);
+		br->pos++;
+	}
+	return value;
+}
+
+/** Read Exp-Golomb code ue(v). */
+static RMuint32 read_ue(struct bit_reader *br)
+{
+	RMuint32 zeros = 0;
+
+	while (read_bits(br, 1) == 0) {
+		if (br->error || (zeros >= 31)) {
+			br->error = TRUE;
+			return 0;
+		}
+		zeros++;
+	}
+	return ((((RMuint32) 1) << zeros) - 1) + read_bits(br, zeros);
+}
+
+/** Read Exp-Golomb code se(v). */
+static RMint32 read_se(struct bit_reader *br)
+{
+	RMuint32 value = read_ue(br);
+
+	if (value & 1) {
+		return (value + 1) / 2;
+	}
+	return -((RMint32) (value / 2));
+}
+
+static void skip_scaling_list(struct bit_reader *br, RMuint32 size)
+{
+	RMint32 last = 8;
+	RMint32 next = 8;
+	RMuint32 i;
+
+	for (i = 0; (i < size) && !br->error; i++) {
+		if (next != 0) {
+			next = (last + read_se(br) + 256) % 256;
+		}
+		if (next != 0) {
+			last = next;
+		}
+	}
+}
+
+static void scan_sps(struct DCCSeekIndex *pIndex, struct bit_reader *br)
+{
+	struct scan_sps sps;
+	RMuint32 profile_idc;
+	RMuint32 id;
+	RMuint32 poc_type;
+
+	memset(&sps, 0, sizeof(sps));
+	profile_idc = read_bits(br, 8);
+	/* Constraint flags and level_idc. */
+	read_bits(br, 16);
+	id = read_ue(br);
+	switch (profile_idc) {
+		case 44:
+		case 83:
+		case 86:
+		case 100:
+		case 110:
+		case 118:
+		case 122:
+		case 128:
+		case 134:
+		case 135:
+		case 138:
+		case 139:
+		case 244: {
+			RMuint32 chroma_format_idc = read_ue(br);
+
+			if (chroma_format_idc == 3) {
+				sps.separate_colour_plane = read_bits(br, 1);
+			}
+			/* bit_depth_luma_minus8, bit_depth_chroma_minus8 and qpprime_y_zero_transform_bypass_flag. */
+			read_ue(br);
+			read_ue(br);
+			read_bits(br, 1);
+			if (read_bits(br, 1)) {
+				RMuint32 i;
+
+				for (i = 0; i < ((chroma_format_idc != 3) ? 8 : 12); i++) {
+					if (read_bits(br, 1)) {
+						skip_scaling_list(br, (i < 6) ? 16 : 64);
+					}
+				}
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+	sps.log2_max_frame_num = read_ue(br) + 4;
+	poc_type = read_ue(br);
+	if (poc_type == 0) {
+		/* log2_max_pic_order_cnt_lsb_minus4 */
+		read_ue(br);
+	} else if (poc_type == 1) {
+		RMuint32 count;
+		RMuint32 i;
+
+		read_bits(br, 1);
+		read_se(br);
+		read_se(br);
+		count = read_ue(br);
+		for (i = 0; (i < count) && !br->error; i++) {
+			read_se(br);
+		}
+	}
+	/* max_num_ref_frames, gaps_in_frame_num_value_allowed_flag and size. */
+	read_ue(br);
+	read_bits(br, 1);
+	read_ue(br);
+	read_ue(br);
+	sps.frame_mbs_only = read_bits(br, 1);
+	if (br->error || (id >= MAX_SPS_COUNT) || (sps.log2_max_frame_num > 16)) {
+		DPRINTF("Invalid SPS at %llu\n", pIndex->nal_offset);
+		return;
+	}
+	sps.valid = TRUE;
+	pIndex->sps[id] = sps;
+}
+
+static void scan_pps(struct DCCSeekIndex *pIndex, struct bit_reader *br)
+{
+	RMuint32 pps_id;
+	RMuint32 sps_id;
+
+	pps_id = read_ue(br);
+	sps_id = read_ue(br);
+	if (br->error || (pps_id >= MAX_PPS_COUNT) || (sps_id >= MAX_SPS_COUNT)) {
+		DPRINTF("Invalid PPS at %llu\n", pIndex->nal_offset);
+		return;
+	}
+	pIndex->pps_sps[pps_id] = sps_id + 1;
+}
+
+/**
+ * Check whether a slice starts a new frame. The second field of a field
+ * pair belongs to the frame of the first field.
+ */
+static RMstatus scan_slice(struct DCCSeekIndex *pIndex, struct bit_reader *br)
+{
+	RMuint32 first_mb_in_slice;
+	RMuint32 pps_id;
+	RMbool field = FALSE;
+	RMbool bottom = FALSE;
+	RMuint32 frame_num = 0;
+	RMuint64 offset;
+
+	first_mb_in_slice = read_ue(br);
+	if (br->error || (first_mb_in_slice != 0)) {
+		return RM_OK;
+	}
+	/* slice_type */
+	read_ue(br);
+	pps_id = read_ue(br);
+	if (!br->error && (pps_id < MAX_PPS_COUNT) && (pIndex->pps_sps[pps_id] != 0)) {
+		struct scan_sps *sps = &pIndex->sps[pIndex->pps_sps[pps_id] - 1];
+
+		if (sps->valid) {
+			if (sps->separate_colour_plane) {
+				read_bits(br, 2);
+			}
+			frame_num = read_bits(br, sps->log2_max_frame_num);
+			if (!sps->frame_mbs_only) {
+				field = read_bits(br, 1);
+				if (field) {
+					bottom = read_bits(br, 1);
+				}
+			}
+			if (br->error) {
+				field = FALSE;
+			}
+		}
+	}
+
+	if (field && pIndex->field_pending && (bottom != pIndex->field_bottom) && (frame_num == pIndex->field_frame_num)) {
+		/* Second field, the key frame includes it. */
+		pIndex->field_pending = FALSE;
+		pIndex->prefix_valid = FALSE;
+		return RM_OK;
+	}
+	pIndex->field_pending = field;
+	pIndex->field_bottom = bottom;
+	pIndex->field_frame_num = frame_num;
+
+	offset = pIndex->prefix_valid ? pIndex->prefix_offset : pIndex->nal_offset;
+	pIndex->prefix_valid = FALSE;
+	return scan_picture(pIndex, offset, pIndex->nal_type == NAL_IDR);
+}
+
+/** Handle a NAL unit, the start of its payload is in pIndex->nal. */
+static RMstatus scan_nal(struct DCCSeekIndex *pIndex)
+{
+	struct bit_reader br;
+
+	br.data = pIndex->nal;
+	br.size = pIndex->nal_size;
+	br.pos = 0;
+	br.error = FALSE;
+
+	switch (pIndex->nal_type) {
+		case NAL_SPS:
+			scan_sps(pIndex, &br);
+			break;
+
+		case NAL_PPS:
+			scan_pps(pIndex, &br);
+			break;
+
+		case NAL_SEI:
+		case NAL_AUD:
+			break;
+
+		case NAL_SLICE:
+		case NAL_IDR:
+			return scan_slice(pIndex, &br);
+
+		default:
+			return RM_OK;
+	}
+	/* Belongs to the next picture, which must be read with it. */
+	if (!pIndex->prefix_valid) {
+		pIndex->prefix_valid = TRUE;
+		pIndex->prefix_offset = pIndex->nal_offset;
+	}
+	return RM_OK;
+}
+
+/** Keep a byte of the NAL unit for parsing. */
+static void scan_append(struct DCCSeekIndex *pIndex, RMuint8 b)
+{
+	if (pIndex->nal_size < SCAN_NAL_SIZE) {
+		pIndex->nal[pIndex->nal_size] = b;
+		pIndex->nal_size++;
+	}
+}
+
+/**
+ * Add the IDR pictures of an H.264 byte stream (Annex B).
+ *
+ * The stream is passed in consecutive pieces of any size, starting at the
+ * beginning of the file. The byte stream has no timestamps, so the PTS is
+ * counted from 0 with one frame per frame_duration, the two fields of a
+ * field pair count as one frame. The offset of a key frame includes the SPS
+ * and PPS in front of it.
+ */
+RMstatus DCCSeekIndexScanAnnexB(struct DCCSeekIndex *pIndex, const RMuint8 *data, RMuint32 size, RMuint64 frame_duration)
+{
+	RMuint32 i;
+	RMstatus rv;
+
+	if ((pIndex == NULL) || ((data == NULL) && (size > 0))) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	pIndex->frame_duration = frame_duration;
+
+	for (i = 0; i < size; i++) {
+		RMuint8 b = data[i];
+		RMbool escape;
+
+		switch (pIndex->state) {
+			case SCAN_START_CODE:
+				if (b == 0) {
+					pIndex->zeros++;
+					break;
+				}
+				if ((b == 1) && (pIndex->zeros >= 2)) {
+					/* Start code with 3 or 4 bytes. */
+					pIndex->nal_offset = pIndex->scan_offset + i - ((pIndex->zeros > 3) ? 3 : pIndex->zeros);
+					pIndex->state = SCAN_NAL_HEADER;
+				}
+				pIndex->zeros = 0;
+				break;
+
+			case SCAN_NAL_HEADER:
+				pIndex->nal_type = b & 0x1F;
+				pIndex->nal_size = 0;
+				pIndex->zeros = 0;
+				switch (pIndex->nal_type) {
+					case NAL_SLICE:
+					case NAL_IDR:
+					case NAL_SPS:
+					case NAL_PPS:
+						/* Parsed when the payload is read. */
+						pIndex->state = SCAN_NAL_DATA;
+						break;
+
+					default:
+						rv = scan_nal(pIndex);
+						if (rv != RM_OK) {
+							return rv;
+						}
+						pIndex->state = SCAN_START_CODE;
+						break;
+				}
+				break;
+
+			case SCAN_NAL_DATA:
+				if (b == 0) {
+					pIndex->zeros++;
+					break;
+				}
+				if ((b == 1) && (pIndex->zeros >= 2)) {
+					/* The NAL unit ends before a start code. */
+					rv = scan_nal(pIndex);
+					if (rv != RM_OK) {
+						return rv;
+					}
+					pIndex->nal_offset = pIndex->scan_offset + i - ((pIndex->zeros > 3) ? 3 : pIndex->zeros);
+					pIndex->zeros = 0;
+					pIndex->state = SCAN_NAL_HEADER;
+					break;
+				}
+				/* 3 after 2 zeros is an emulation prevention byte. */
+				escape = (b == 3) && (pIndex->zeros >= 2);
+				for (; pIndex->zeros > 0; pIndex->zeros--) {
+					scan_append(pIndex, 0);
+				}
+				if (!escape) {
+					scan_append(pIndex, b);
+				}
+				if (pIndex->nal_size >= SCAN_NAL_SIZE) {
+					/* The rest of the NAL unit isn't needed. */
+					rv = scan_nal(pIndex);
+					if (rv != RM_OK) {
+						return rv;
+					}
+					pIndex->state = SCAN_START_CODE;
+				}
+				break;
+		}
+	}
+	pIndex->scan_offset += size;
+	return RM_OK;
+}
+
+/** Call after the last data was passed to DCCSeekIndexScanAnnexB(). */
+RMstatus DCCSeekIndexScanEnd(struct DCCSeekIndex *pIndex)
+{
+	if (pIndex == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pIndex->state == SCAN_NAL_DATA) {
+		RMstatus rv;
+
+		rv = scan_nal(pIndex);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+	if (pIndex->open_entry) {
+		struct DCCTrickPlayEntry *entry = &pIndex->entries[pIndex->count - 1];
+
+		entry->size = pIndex->scan_offset - entry->offset;
+		pIndex->open_entry = FALSE;
+	}
+	pIndex->state = SCAN_START_CODE;
+	pIndex->zeros = 0;
+	pIndex->prefix_valid = FALSE;
+	pIndex->field_pending = FALSE;
+	return RM_OK;
+}
+
+/**
+ * Load the index saved next to mediafile by DCCSeekIndexSave().
+ *
+ * @return RM_NOT_FOUND when there is no index or it doesn't match the media
+ * file, e.g. because the file was changed.
+ */
+RMstatus DCCSeekIndexLoad(struct DCCSeekIndex *pIndex, const char *mediafile)
+{
+	RMuint8 header[SEEKINDEX_HEADER_SIZE];
+	RMuint8 *data = NULL;
+	char *filename;
+	struct stat st;
+	RMuint32 count;
+	RMuint32 i;
+	ssize_t len;
+	RMstatus rv;
+	int fd;
+
+	if ((pIndex == NULL) || (mediafile == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (stat(mediafile, &st) != 0) {
+		return RM_NOT_FOUND;
+	}
+	filename = get_index_filename(mediafile, "");
+	if (filename == NULL) {
+		return RM_FATALOUTOFMEMORY;
+	}
+	fd = open(filename, O_RDONLY);
+	free(filename);
+	if (fd < 0) {
+		return RM_NOT_FOUND;
+	}
+
+	rv = RM_NOT_FOUND;
+	len = read(fd, header, sizeof(header));
+	if ((len != sizeof(header))
+		|| (get_u32(&header[0]) != SEEKINDEX_MAGIC)
+		|| (get_u32(&header[4]) != SEEKINDEX_VERSION)
+		|| (get_u32(&header[8]) != pIndex->time_resolution)
+		|| (get_u64(&header[16]) != (RMuint64) st.st_size)
+		|| (get_u64(&header[24]) != (RMuint64) st.st_mtime)) {
+		DPRINTF("Seek index of %s is outdated\n", mediafile);
+		goto out;
+	}
+	count = get_u32(&header[12]);
+	if ((count == 0) || (count > (0xFFFFFFFF / SEEKINDEX_ENTRY_SIZE))) {
+		goto out;
+	}
+	data = malloc(count * SEEKINDEX_ENTRY_SIZE);
+	if (data == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+		rv = RM_FATALOUTOFMEMORY;
+		goto out;
+	}
+	len = read(fd, data, count * SEEKINDEX_ENTRY_SIZE);
+	if ((len < 0) || (((RMuint32) len) != (count * SEEKINDEX_ENTRY_SIZE))) {
+		goto out;
+	}
+
+	pIndex->count = 0;
+	for (i = 0; i < count; i++) {
+		const RMuint8 *p = &data[i * SEEKINDEX_ENTRY_SIZE];
+		RMuint64 offset = get_u64(&p[8]);
+		RMuint32 size = get_u32(&p[16]);
+
+		if ((offset > (RMuint64) st.st_size) || (size > ((RMuint64) st.st_size - offset))) {
+			pIndex->count = 0;
+			goto out;
+		}
+		rv = DCCSeekIndexAdd(pIndex, get_u64(&p[0]), offset, size);
+		if (rv != RM_OK) {
+			pIndex->count = 0;
+			goto out;
+		}
+	}
+	sort_entries(pIndex);
+	rv = RM_OK;
+out:
+	if (data != NULL) {
+		free(data);
+	}
+	close(fd);
+	return rv;
+}
+
+/**
+ * Save the index next to mediafile, the name has DCC_SEEKINDEX_SUFFIX
+ * appended.
+ *
+ * The size and modification time of the media file are stored, so an index
+ * which doesn't belong to the file anymore isn't used. The index is written
+ * to a temporary file first, so a removed USB stick leaves no broken index.
+ */
+RMstatus DCCSeekIndexSave(struct DCCSeekIndex *pIndex, const char *mediafile)
+{
+	RMuint8 header[SEEKINDEX_HEADER_SIZE];
+	RMuint8 *data;
+	char *filename;
+	char *tmpname;
+	struct stat st;
+	RMuint32 i;
+	ssize_t len;
+	RMstatus rv;
+	int fd;
+
+	if ((pIndex == NULL) || (mediafile == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pIndex->count == 0) {
+		return RM_INVALID_PARAMETER;
+	}
+	if (stat(mediafile, &st) != 0) {
+		return RM_ERROR;
+	}
+	sort_entries(pIndex);
+
+	data = malloc(pIndex->count * SEEKINDEX_ENTRY_SIZE);
+	if (data == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+		return RM_FATALOUTOFMEMORY;
+	}
+	for (i = 0; i < pIndex->count; i++) {
+		RMuint8 *p = &data[i * SEEKINDEX_ENTRY_SIZE];
+
+		put_u64(&p[0], pIndex->entries[i].pts);
+		put_u64(&p[8], pIndex->entries[i].offset);
+		put_u32(&p[16], pIndex->entries[i].size);
+	}
+	put_u32(&header[0], SEEKINDEX_MAGIC);
+	put_u32(&header[4], SEEKINDEX_VERSION);
+	put_u32(&header[8], pIndex->time_resolution);
+	put_u32(&header[12], pIndex->count);
+	put_u64(&header[16], st.st_size);
+	put_u64(&header[24], st.st_mtime);
+
+	filename = get_index_filename(mediafile, "");
+	tmpname = get_index_filename(mediafile, ".tmp");
+	if ((filename == NULL) || (tmpname == NULL)) {
+		rv = RM_FATALOUTOFMEMORY;
+		goto out;
+	}
+	fd = open(tmpname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		rv = RM_ERROR;
+		goto out;
+	}
+	rv = RM_OK;
+	len = write(fd, header, sizeof(header));
+	if (len != sizeof(header)) {
+		rv = RM_ERROR;
+	}
+	if (rv == RM_OK) {
+		len = write(fd, data, pIndex->count * SEEKINDEX_ENTRY_SIZE);
+		if ((len < 0) || (((RMuint32) len) != (pIndex->count * SEEKINDEX_ENTRY_SIZE))) {
+			rv = RM_ERROR;
+		}
+	}
+	if ((rv == RM_OK) && (fsync(fd) != 0)) {
+		rv = RM_ERROR;
+	}
+	close(fd);
+	if ((rv == RM_OK) && (rename(tmpname, filename) != 0)) {
+		rv = RM_ERROR;
+	}
+	if (rv != RM_OK) {
+		fprintf(stderr, "Error: Cannot write seek index \"%s\".\n", filename);
+		unlink(tmpname);
+	}
+out:
+	if (filename != NULL) {
+		free(filename);
+	}
+	if (tmpname != NULL) {
+		free(tmpname);
+	}
+	free(data);
+	return rv;
+}
+
+/**
+ * Find the key frame to start playback at pts.
+ *
+ * This is the last key frame with a PTS not larger than pts, or the first
+ * key frame when pts is before all of them.
+ */
+RMstatus DCCSeekIndexFind(struct DCCSeekIndex *pIndex, RMuint64 pts, struct DCCTrickPlayEntry *entry)
+{
+	RMuint32 low = 0;
+	RMuint32 high;
+
+	if ((pIndex == NULL) || (entry == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pIndex->count == 0) {
+		return RM_NOT_FOUND;
+	}
+	sort_entries(pIndex);
+
+	high = pIndex->count;
+	while ((high - low) > 1) {
+		RMuint32 mid = low + (high - low) / 2;
+
+		if (pIndex->entries[mid].pts <= pts) {
+			low = mid;
+		} else {
+			high = mid;
+		}
+	}
+	*entry = pIndex->entries[low];
+	return RM_OK;
+}
+
+/** Get the key frames sorted by PTS, e.g. for DCCTrickPlayOpen(). Valid until the index is changed. */
+RMstatus DCCSeekIndexGetEntries(struct DCCSeekIndex *pIndex, struct DCCTrickPlayEntry **entries, RMuint32 *count)
+{
+	if ((pIndex == NULL) || (entries == NULL) || (count == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	sort_entries(pIndex);
+	*entries = pIndex->entries;
+	*count = pIndex->count;
+	return RM_OK;
+}
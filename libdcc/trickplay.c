@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * Trick play with I-frame only decoding.
+ *
+ * Only the key frames from an index are sent to the video decoder, which is
+ * switched to DCCVideoPlayIFrame. The key frames are selected by the time
+ * which passed since the start, so the shown position moves with the
+ * requested speed independent of the GOP size.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rua.h"
+#include "dcc.h"
+#include "dcc_internal.h"
+
+/** Print debug message. */
+#if 0
+#define DPRINTF(args...) printf(args)
+#else
+#define DPRINTF(args...) do { } while(0)
+#endif
+
+/** Time to wait for a free DMA buffer. */
+#define BUFFER_TIMEOUT_US 100000
+
+struct DCCTrickPlay {
+	struct RUA *pRua;
+	struct DCCVideoSource *pVideoSource;
+	struct RUABufferPool *pDMA;
+	RMuint32 buffer_size;
+	RMuint32 video_decoder;
+
+	struct DCCTrickPlayEntry *index;
+	RMuint32 count;
+	DCCTrickPlayReadFunc *read;
+	void *opaque;
+	RMuint32 time_resolution;
+
+	/** True between DCCTrickPlayStart() and DCCTrickPlayStop(). */
+	RMbool active;
+	RMint32 speed;
+	RMuint64 start_pts;
+	RMuint64 start_us;
+	/** Minimum time between two shown frames. */
+	RMuint32 frame_interval_us;
+	RMuint64 last_frame_us;
+	/** Index of the last key frame sent, count when none was sent. */
+	RMuint32 current;
+};
+
+/** Return the last index entry with a PTS not larger than pts. */
+static RMuint32 find_entry(struct DCCTrickPlay *pTrick, RMuint64 pts)
+{
+	RMuint32 low = 0;
+	RMuint32 high = pTrick->count;
+
+	while ((high - low) > 1) {
+		RMuint32 mid = low + (high - low) / 2;
+
+		if (pTrick->index[mid].pts <= pts) {
+			low = mid;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+static RMstatus send_access_unit(struct DCCTrickPlay *pTrick, RMuint8 *data, RMuint32 size)
+{
+	RMuint32 pos = 0;
+	RMstatus rv;
+
+	while (pos < size) {
+		struct emhwlib_info info;
+		RMuint8 *buffer;
+		RMuint32 len;
+
+		len = size - pos;
+		if (len > pTrick->buffer_size) {
+			len = pTrick->buffer_size;
+		}
+
+		rv = RUAGetBuffer(pTrick->pDMA, &buffer, BUFFER_TIMEOUT_US);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		memcpy(buffer, &data[pos], len);
+
+		memset(&info, 0, sizeof(info));
+		do {
+			rv = RUASendData(pTrick->pRua, pTrick->video_decoder, pTrick->pDMA, buffer, len, &info, sizeof(info));
+			if (rv == RM_PENDING) {
+				usleep(1000);
+			}
+		} while (rv == RM_PENDING);
+		if (rv != RM_OK) {
+			RUAReleaseBuffer(pTrick->pDMA, buffer);
+			return rv;
+		}
+
+		do {
+			rv = RUAReleaseBuffer(pTrick->pDMA, buffer);
+		} while (rv == RM_PENDING);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		pos += len;
+	}
+	return RM_OK;
+}
+
+RMstatus DCCTrickPlayOpen(struct RUA *pRua, struct DCCVideoSource *pVideoSource, struct RUABufferPool *pDMA, RMuint32 buffer_size, struct DCCTrickPlayEntry *index, RMuint32 count, RMuint32 time_resolution, DCCTrickPlayReadFunc *read, void *opaque, struct DCCTrickPlay **ppTrick)
+{
+	struct DCCTrickPlay *pTrick;
+	RMstatus rv;
+
+	if ((pRua == NULL) || (pVideoSource == NULL) || (pDMA == NULL) || (index == NULL) || (read == NULL) || (ppTrick == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if ((count == 0) || (buffer_size == 0) || (time_resolution == 0)) {
+		return RM_INVALID_PARAMETER;
+	}
+
+	pTrick = malloc(sizeof(*pTrick));
+	if (pTrick == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pTrick, 0, sizeof(*pTrick));
+	pTrick->pRua = pRua;
+	pTrick->pVideoSource = pVideoSource;
+	pTrick->pDMA = pDMA;
+	pTrick->buffer_size = buffer_size;
+	pTrick->index = index;
+	pTrick->count = count;
+	pTrick->time_resolution = time_resolution;
+	pTrick->read = read;
+	pTrick->opaque = opaque;
+	pTrick->frame_interval_us = 1000000 / DCC_TRICKPLAY_MAX_FPS;
+
+	rv = DCCGetVideoDecoderSourceInfo(pVideoSource, &pTrick->video_decoder, NULL, NULL);
+	if (rv != RM_OK) {
+		free(pTrick);
+		return rv;
+	}
+
+	*ppTrick = pTrick;
+	return RM_OK;
+}
+
+RMstatus DCCTrickPlayClose(struct DCCTrickPlay *pTrick)
+{
+	if (pTrick == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pTrick->active) {
+		DCCTrickPlayStop(pTrick);
+	}
+	free(pTrick);
+	return RM_OK;
+}
+
+/**
+ * Start trick play or change the speed.
+ *
+ * @param speed Multiple of the normal speed, negative for rewind.
+ * @param pts Position where trick play starts.
+ */
+RMstatus DCCTrickPlayStart(struct DCCTrickPlay *pTrick, RMint32 speed, RMuint64 pts)
+{
+	RMstatus rv;
+
+	if (pTrick == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (speed == 0) {
+		return RM_INVALID_PARAMETER;
+	}
+
+	if (!pTrick->active) {
+		/* Drop data queued for normal playback. */
+		rv = DCCStopVideoSource(pTrick->pVideoSource, DCCStopMode_LastFrame);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		rv = DCCPlayVideoSource(pTrick->pVideoSource, DCCVideoPlayIFrame);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		pTrick->current = pTrick->count;
+		pTrick->active = TRUE;
+	} else if (pTrick->current < pTrick->count) {
+		/* Continue from the shown frame with the new speed. */
+		pts = pTrick->index[pTrick->current].pts;
+	}
+
+	pTrick->speed = speed;
+	pTrick->start_pts = pts;
+	pTrick->start_us = DCCGetMonotonicUs();
+	pTrick->last_frame_us = 0;
+	DPRINTF("Trick play speed %d from %llu\n", speed, pts);
+
+	return RM_OK;
+}
+
+/**
+ * Send the next key frame when it is due.
+ *
+ * @retval RM_OK A key frame was sent.
+ * @retval RM_PENDING No key frame is due yet.
+ * @retval RM_EOS Start or end of the index was reached.
+ */
+RMstatus DCCTrickPlayFeed(struct DCCTrickPlay *pTrick)
+{
+	RMuint64 now;
+	RMint64 offset;
+	RMuint64 target;
+	RMuint32 next;
+	RMuint8 *data;
+	RMuint32 size;
+	RMstatus rv;
+
+	if (pTrick == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (!pTrick->active) {
+		return RM_INVALIDMODE;
+	}
+
+	now = DCCGetMonotonicUs();
+	if ((pTrick->last_frame_us != 0) && ((now - pTrick->last_frame_us) < pTrick->frame_interval_us)) {
+		return RM_PENDING;
+	}
+
+	offset = ((RMint64) (now - pTrick->start_us)) * pTrick->speed * pTrick->time_resolution / 1000000;
+	if ((offset < 0) && (((RMuint64) -offset) > pTrick->start_pts)) {
+		target = 0;
+	} else {
+		target = pTrick->start_pts + offset;
+	}
+
+	next = find_entry(pTrick, target);
+	if (pTrick->current < pTrick->count) {
+		if (next == pTrick->current) {
+			if ((pTrick->speed > 0) && (next == (pTrick->count - 1)) && (target > pTrick->index[next].pts)) {
+				return RM_EOS;
+			}
+			if ((pTrick->speed < 0) && (next == 0)) {
+				return RM_EOS;
+			}
+			return RM_PENDING;
+		}
+		if ((pTrick->speed > 0) && (next < pTrick->current)) {
+			return RM_PENDING;
+		}
+		if ((pTrick->speed < 0) && (next > pTrick->current)) {
+			return RM_PENDING;
+		}
+	}
+
+	rv = pTrick->read(pTrick->opaque, &pTrick->index[next], &data, &size);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	rv = send_access_unit(pTrick, data, size);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	pTrick->current = next;
+	pTrick->last_frame_us = now;
+
+	return RM_OK;
+}
+
+/** Get the PTS of the shown key frame, e.g. to continue normal playback there. */
+RMstatus DCCTrickPlayGetPosition(struct DCCTrickPlay *pTrick, RMuint64 *pts)
+{
+	if ((pTrick == NULL) || (pts == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pTrick->current < pTrick->count) {
+		*pts = pTrick->index[pTrick->current].pts;
+	} else {
+		*pts = pTrick->start_pts;
+	}
+	return RM_OK;
+}
+
+/** Leave trick play, the last key frame stays on screen. */
+RMstatus DCCTrickPlayStop(struct DCCTrickPlay *pTrick)
+{
+	if (pTrick == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (!pTrick->active) {
+		return RM_OK;
+	}
+	pTrick->active = FALSE;
+
+	return DCCStopVideoSource(pTrick->pVideoSource, DCCStopMode_LastFrame);
+}
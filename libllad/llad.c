@@ -81,6 +81,10 @@ struct dmapool {
 	void *addr;
 	RMuint32 id;
 	RMuint32 buffersize;
+	RMuint32 buffercount;
+	RMuint32 log2_buffersize;
+	/** Physical address of each buffer, filled on first use. */
+	RMuint32 *physical_addresses;
 };
 
 struct LLAD *llad_open(const char *chipname)
@@ -361,6 +365,8 @@ struct dmapool *dmapool_open(struct LLAD *h, void *area, RMuint32 buffercount, R
 
 			pDmapool->id = buffer[3];
 			pDmapool->buffersize = buffercount << log2_buffersize;
+			pDmapool->buffercount = buffercount;
+			pDmapool->log2_buffersize = log2_buffersize;
 
 			addr = 0x02000000 + pDmapool->id;
 
@@ -392,6 +398,10 @@ void dmapool_close(struct dmapool *h)
 	if (rv != 0) {
 		perror("dmapool_close() failed");
 	}
+	if (h->physical_addresses != NULL) {
+		free(h->physical_addresses);
+		h->physical_addresses = NULL;
+	}
 	free(h);
 	h = NULL;
 }
@@ -440,6 +450,29 @@ RMuint32 dmapool_get_physical_address(struct dmapool *h, RMuint8 *ptr, RMuint32
 	return 0;
 }
 
+/** Get the mapped address of the buffer containing physical_address, e.g. for a received buffer. */
+RMuint8 *dmapool_get_virtual_address(struct dmapool *h, RMuint32 physical_address)
+{
+	RMuint32 size = 1 << h->log2_buffersize;
+	RMuint32 i;
+
+	if (h->physical_addresses == NULL) {
+		h->physical_addresses = malloc(h->buffercount * sizeof(h->physical_addresses[0]));
+		if (h->physical_addresses == NULL) {
+			return NULL;
+		}
+		for (i = 0; i < h->buffercount; i++) {
+			h->physical_addresses[i] = dmapool_get_physical_address(h, ((RMuint8 *) h->addr) + (i << h->log2_buffersize), 0);
+		}
+	}
+	for (i = 0; i < h->buffercount; i++) {
+		if ((physical_address >= h->physical_addresses[i]) && (physical_address < (h->physical_addresses[i] + size))) {
+			return ((RMuint8 *) h->addr) + (i << h->log2_buffersize) + (physical_address - h->physical_addresses[i]);
+		}
+	}
+	return NULL;
+}
+
 RMstatus dmapool_acquire(struct dmapool *h, RMuint32 physical_address)
 {
 	RMuint32 buffer[2];
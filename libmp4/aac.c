@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * ADTS framing of raw AAC frames from MP4 files.
+ *
+ * The decoder expects AAC with ADTS headers. The header only depends on the
+ * AudioSpecificConfig and the frame size, so it is built here instead of
+ * running the frames through a muxer.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mp4.h"
+
+#define AOT_ESCAPE 31
+#define AOT_SBR 5
+#define AOT_PS 29
+
+/** Largest frame length which fits in the 13 bit field of the header. */
+#define ADTS_MAX_FRAME_LENGTH 0x1FFF
+
+struct bit_reader {
+	const RMuint8 *data;
+	RMuint32 size;
+	RMuint32 pos;
+};
+
+static const RMuint32 sampling_frequencies[] = {
+	96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+};
+
+static RMstatus get_bits(struct bit_reader *reader, RMuint32 count, RMuint32 *value)
+{
+	*value = 0;
+	while (count > 0) {
+		if ((reader->pos >> 3) >= reader->size) {
+			return RM_ERROR;
+		}
+		*value = (*value << 1) | ((reader->data[reader->pos >> 3] >> (7 - (reader->pos & 7))) & 1);
+		reader->pos++;
+		count--;
+	}
+	return RM_OK;
+}
+
+static RMstatus get_object_type(struct bit_reader *reader, RMuint32 *type)
+{
+	RMstatus rv;
+
+	rv = get_bits(reader, 5, type);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	if (*type == AOT_ESCAPE) {
+		rv = get_bits(reader, 6, type);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		*type += 32;
+	}
+	return RM_OK;
+}
+
+/** Read the sampling frequency and convert an explicit frequency into the index. */
+static RMstatus get_sampling_index(struct bit_reader *reader, RMuint32 *index)
+{
+	RMuint32 frequency;
+	RMuint32 i;
+	RMstatus rv;
+
+	rv = get_bits(reader, 4, index);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	if (*index != 0xF) {
+		return RM_OK;
+	}
+	rv = get_bits(reader, 24, &frequency);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	for (i = 0; i < (sizeof(sampling_frequencies) / sizeof(sampling_frequencies[0])); i++) {
+		if (sampling_frequencies[i] == frequency) {
+			*index = i;
+			return RM_OK;
+		}
+	}
+	fprintf(stderr, "Error: Sampling frequency %u can't be signalled in ADTS.\n", frequency);
+	return RM_NOT_SUPPORTED;
+}
+
+/**
+ * Parse the AudioSpecificConfig, see MP4TrackInfo.DecoderConfig.
+ *
+ * For HE-AAC the AAC core is signalled, the decoder finds SBR and PS in the
+ * frames.
+ */
+RMstatus MP4ParseAACConfig(const RMuint8 *asc, RMuint32 size, struct MP4AACConfig *config)
+{
+	struct bit_reader reader;
+	RMuint32 index;
+	RMstatus rv;
+
+	if ((asc == NULL) || (config == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	memset(config, 0, sizeof(*config));
+	reader.data = asc;
+	reader.size = size;
+	reader.pos = 0;
+
+	rv = get_object_type(&reader, &config->ObjectType);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	rv = get_sampling_index(&reader, &config->SamplingIndex);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	rv = get_bits(&reader, 4, &config->ChannelConfig);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	if ((config->ObjectType == AOT_SBR) || (config->ObjectType == AOT_PS)) {
+		/* Extension sampling frequency, then the type of the core. */
+		rv = get_sampling_index(&reader, &index);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		rv = get_object_type(&reader, &config->ObjectType);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+
+	if ((config->ObjectType < 1) || (config->ObjectType > 4)) {
+		fprintf(stderr, "Error: AAC object type %u can't be signalled in ADTS.\n", config->ObjectType);
+		return RM_NOT_SUPPORTED;
+	}
+	if (config->ChannelConfig == 0) {
+		fprintf(stderr, "Error: AAC channel configuration in PCE is not supported.\n");
+		return RM_NOT_SUPPORTED;
+	}
+	return RM_OK;
+}
+
+/**
+ * Build the ADTS header for a raw AAC frame.
+ *
+ * @param header Receives MP4_ADTS_HEADER_SIZE bytes, sent in front of the frame.
+ */
+RMstatus MP4MakeADTSHeader(const struct MP4AACConfig *config, RMuint32 size, RMuint8 *header)
+{
+	RMuint32 length = size + MP4_ADTS_HEADER_SIZE;
+
+	if ((config == NULL) || (header == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (length > ADTS_MAX_FRAME_LENGTH) {
+		return RM_INSUFFICIENT_SIZE;
+	}
+
+	/* Syncword, MPEG-4, no CRC. */
+	header[0] = 0xFF;
+	header[1] = 0xF1;
+	header[2] = ((config->ObjectType - 1) << 6) | (config->SamplingIndex << 2) | (config->ChannelConfig >> 2);
+	header[3] = ((config->ChannelConfig & 3) << 6) | (length >> 11);
+	header[4] = (length >> 3) & 0xFF;
+	/* Buffer fullness 0x7FF means variable bitrate, one raw data block. */
+	header[5] = ((length & 7) << 5) | 0x1F;
+	header[6] = 0xFC;
+	return RM_OK;
+}
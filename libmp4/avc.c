@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * Conversion of H.264 samples from MP4 (length prefixed NAL units) to the
+ * byte stream format with start codes, which is needed by the decoder.
+ *
+ * The length fields are overwritten with start codes, so the sample is
+ * converted where it was read to. SPS and PPS from avcC are kept as byte
+ * stream and only need to be sent in front of IDR pictures.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mp4.h"
+
+#define NAL_TYPE_IDR 5
+#define NAL_TYPE_SPS 7
+
+/** Append NAL units from avcC with start code. */
+static RMstatus append_parameter_sets(struct MP4AVCConfig *config, const RMuint8 *data, RMuint32 size, RMuint32 *pos, RMuint32 count)
+{
+	RMuint32 i;
+
+	for (i = 0; i < count; i++) {
+		RMuint32 length;
+
+		if ((*pos + 2) > size) {
+			return RM_ERROR;
+		}
+		length = (data[*pos] << 8) | data[*pos + 1];
+		*pos += 2;
+		if ((*pos + length) > size) {
+			return RM_ERROR;
+		}
+		if ((config->ParameterSetsSize + 4 + length) > sizeof(config->ParameterSets)) {
+			fprintf(stderr, "Error: AVC parameter sets are too large.\n");
+			return RM_INSUFFICIENT_SIZE;
+		}
+		config->ParameterSets[config->ParameterSetsSize++] = 0;
+		config->ParameterSets[config->ParameterSetsSize++] = 0;
+		config->ParameterSets[config->ParameterSetsSize++] = 0;
+		config->ParameterSets[config->ParameterSetsSize++] = 1;
+		memcpy(&config->ParameterSets[config->ParameterSetsSize], &data[*pos], length);
+		config->ParameterSetsSize += length;
+		*pos += length;
+	}
+	return RM_OK;
+}
+
+/** Parse the payload of the avcC box, see MP4TrackInfo.DecoderConfig. */
+RMstatus MP4ParseAVCConfig(const RMuint8 *avcc, RMuint32 size, struct MP4AVCConfig *config)
+{
+	RMuint32 pos;
+	RMstatus rv;
+
+	if ((avcc == NULL) || (config == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	memset(config, 0, sizeof(*config));
+	if ((size < 7) || (avcc[0] != 1)) {
+		fprintf(stderr, "Error: Invalid avcC.\n");
+		return RM_ERROR;
+	}
+	config->LengthSize = (avcc[4] & 0x03) + 1;
+
+	pos = 6;
+	rv = append_parameter_sets(config, avcc, size, &pos, avcc[5] & 0x1F);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	if (pos >= size) {
+		return RM_ERROR;
+	}
+	pos++;
+	return append_parameter_sets(config, avcc, size, &pos, avcc[pos - 1]);
+}
+
+/**
+ * Replace the NAL unit lengths of a sample with start codes.
+ *
+ * @param needs_parameter_sets Set to TRUE when the sample has an IDR picture
+ *                             without SPS in front, then
+ *                             config->ParameterSets must be sent before
+ *                             the sample.
+ * @retval RM_NOT_SUPPORTED Length fields with 1 or 2 bytes can't be
+ *                          converted in place.
+ */
+RMstatus MP4ConvertAVCSample(const struct MP4AVCConfig *config, RMuint8 *data, RMuint32 size, RMbool *needs_parameter_sets)
+{
+	RMuint32 pos = 0;
+	RMbool sps = FALSE;
+	RMbool idr = FALSE;
+
+	if ((config == NULL) || (data == NULL) || (needs_parameter_sets == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	*needs_parameter_sets = FALSE;
+	if (config->LengthSize < 3) {
+		return RM_NOT_SUPPORTED;
+	}
+
+	while ((pos + config->LengthSize) <= size) {
+		RMuint32 length;
+		RMuint8 type;
+
+		if (config->LengthSize == 4) {
+			length = (((RMuint32) data[pos]) << 24) | (data[pos + 1] << 16) | (data[pos + 2] << 8) | data[pos + 3];
+			data[pos] = 0;
+			data[pos + 1] = 0;
+			data[pos + 2] = 0;
+			data[pos + 3] = 1;
+		} else {
+			length = (data[pos] << 16) | (data[pos + 1] << 8) | data[pos + 2];
+			data[pos] = 0;
+			data[pos + 1] = 0;
+			data[pos + 2] = 1;
+		}
+		pos += config->LengthSize;
+		if ((length == 0) || (length > (size - pos))) {
+			fprintf(stderr, "Error: Invalid NAL unit length %u.\n", length);
+			return RM_ERROR;
+		}
+
+		type = data[pos] & 0x1F;
+		if (type == NAL_TYPE_SPS) {
+			sps = TRUE;
+		} else if ((type == NAL_TYPE_IDR) && !sps && !idr) {
+			idr = TRUE;
+			*needs_parameter_sets = TRUE;
+		}
+		pos += length;
+	}
+	return RM_OK;
+}
+
+/**
+ * Prepare the conversion of a sample with size bytes by
+ * MP4ConvertAVCData().
+ *
+ * @retval RM_NOT_SUPPORTED Length fields with 1 or 2 bytes can't be
+ *                          converted in place.
+ */
+RMstatus MP4StartAVCConversion(const struct MP4AVCConfig *config, RMuint32 size, struct MP4AVCConversion *conversion)
+{
+	if ((config == NULL) || (conversion == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (config->LengthSize < 3) {
+		return RM_NOT_SUPPORTED;
+	}
+	memset(conversion, 0, sizeof(*conversion));
+	conversion->SampleLeft = size;
+	return RM_OK;
+}
+
+/**
+ * Replace the NAL unit lengths of the next piece of a sample with start
+ * codes. Length fields can be split between pieces.
+ *
+ * Unlike MP4ConvertAVCSample() the NAL units in front of the IDR picture
+ * are not known, the caller sends config->ParameterSets in front of each
+ * key frame.
+ */
+RMstatus MP4ConvertAVCData(const struct MP4AVCConfig *config, struct MP4AVCConversion *conversion, RMuint8 *data, RMuint32 size)
+{
+	if ((config == NULL) || (conversion == NULL) || ((data == NULL) && (size > 0))) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (size > conversion->SampleLeft) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+
+	while (size > 0) {
+		RMuint32 len;
+
+		if (conversion->NALLeft == 0) {
+			if ((conversion->LengthPos == 0) && (conversion->SampleLeft < config->LengthSize)) {
+				/* Too short for a NAL unit, left unchanged like by MP4ConvertAVCSample(). */
+				conversion->NALLeft = conversion->SampleLeft;
+				continue;
+			}
+			conversion->Length = (conversion->Length << 8) | *data;
+			conversion->LengthPos++;
+			*data = (conversion->LengthPos == config->LengthSize) ? 1 : 0;
+			data++;
+			size--;
+			conversion->SampleLeft--;
+			if (conversion->LengthPos == config->LengthSize) {
+				if ((conversion->Length == 0) || (conversion->Length > conversion->SampleLeft)) {
+					fprintf(stderr, "Error: Invalid NAL unit length %u.\n", conversion->Length);
+					return RM_ERROR;
+				}
+				conversion->NALLeft = conversion->Length;
+				conversion->Length = 0;
+				conversion->LengthPos = 0;
+			}
+			continue;
+		}
+
+		len = (size < conversion->NALLeft) ? size : conversion->NALLeft;
+		data += len;
+		size -= len;
+		conversion->NALLeft -= len;
+		conversion->SampleLeft -= len;
+	}
+	return RM_OK;
+}
@@ -0,0 +1,944 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * Reader for MP4 (ISO base media) files.
+ *
+ * The moov box is read once. The sample tables are not expanded, they are
+ * used directly from the moov data and walked with a cursor per track, so
+ * each sample costs only a few table reads. The samples of all enabled
+ * tracks are returned in file order, so mdat is read sequentially and the
+ * sample data can be read directly into DMA buffers.
+ *
+ * Local files are read with pread(), other inputs can be passed as
+ * MP4Source with a read function.
+ *
+ * Fragmented files (moof) and edit lists are not supported.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "mp4.h"
+
+/** Print debug message. */
+#if 0
+#define DPRINTF(args...) printf(args)
+#else
+#define DPRINTF(args...) do { } while(0)
+#endif
+
+/** Limit for the size of the moov box. */
+#define MP4_MAX_MOOV_SIZE (64 * 1024 * 1024)
+
+#define BOX_FTYP MP4_FOURCC('f', 't', 'y', 'p')
+#define BOX_MOOV MP4_FOURCC('m', 'o', 'o', 'v')
+#define BOX_MVEX MP4_FOURCC('m', 'v', 'e', 'x')
+#define BOX_TRAK MP4_FOURCC('t', 'r', 'a', 'k')
+#define BOX_TKHD MP4_FOURCC('t', 'k', 'h', 'd')
+#define BOX_MDIA MP4_FOURCC('m', 'd', 'i', 'a')
+#define BOX_MDHD MP4_FOURCC('m', 'd', 'h', 'd')
+#define BOX_HDLR MP4_FOURCC('h', 'd', 'l', 'r')
+#define BOX_MINF MP4_FOURCC('m', 'i', 'n', 'f')
+#define BOX_STBL MP4_FOURCC('s', 't', 'b', 'l')
+#define BOX_STSD MP4_FOURCC('s', 't', 's', 'd')
+#define BOX_STTS MP4_FOURCC('s', 't', 't', 's')
+#define BOX_CTTS MP4_FOURCC('c', 't', 't', 's')
+#define BOX_STSC MP4_FOURCC('s', 't', 's', 'c')
+#define BOX_STSZ MP4_FOURCC('s', 't', 's', 'z')
+#define BOX_STCO MP4_FOURCC('s', 't', 'c', 'o')
+#define BOX_CO64 MP4_FOURCC('c', 'o', '6', '4')
+#define BOX_STSS MP4_FOURCC('s', 't', 's', 's')
+#define BOX_AVCC MP4_FOURCC('a', 'v', 'c', 'C')
+#define BOX_ESDS MP4_FOURCC('e', 's', 'd', 's')
+#define HANDLER_VIDE MP4_FOURCC('v', 'i', 'd', 'e')
+#define HANDLER_SOUN MP4_FOURCC('s', 'o', 'u', 'n')
+
+/** Table inside the moov data. */
+struct MP4Table {
+	const RMuint8 *data;
+	RMuint32 count;
+};
+
+struct MP4Track {
+	struct MP4TrackInfo info;
+	RMbool enabled;
+
+	struct MP4Table stts;
+	struct MP4Table ctts;
+	struct MP4Table stsc;
+	/** stco or co64. */
+	struct MP4Table chunks;
+	RMbool co64;
+	/** Size of all samples, 0 when stsz has a table. */
+	RMuint32 sample_size;
+	struct MP4Table stsz;
+	/** No stss means every sample is a key frame. */
+	struct MP4Table stss;
+
+	/* Cursor at the next sample. */
+	RMuint32 sample;
+	RMint64 dts;
+	RMuint32 stts_index;
+	RMuint32 stts_left;
+	RMuint32 ctts_index;
+	RMuint32 ctts_left;
+	RMuint32 stsc_index;
+	RMuint32 chunk;
+	RMuint32 chunk_left;
+	RMuint64 offset;
+	RMuint32 stss_index;
+};
+
+struct MP4Reader {
+	/** File opened by MP4Open(), -1 for MP4OpenSource(). */
+	int fd;
+	struct MP4Source source;
+	RMuint8 *moov;
+	RMuint32 moov_size;
+	RMuint32 track_count;
+	struct MP4Track tracks[MP4_MAX_TRACKS];
+};
+
+static inline RMuint32 read_be16(const RMuint8 *p)
+{
+	return (((RMuint32) p[0]) << 8) | p[1];
+}
+
+static inline RMuint32 read_be32(const RMuint8 *p)
+{
+	return (((RMuint32) p[0]) << 24) | (((RMuint32) p[1]) << 16) | (((RMuint32) p[2]) << 8) | p[3];
+}
+
+static inline RMuint64 read_be64(const RMuint8 *p)
+{
+	return (((RMuint64) read_be32(p)) << 32) | read_be32(&p[4]);
+}
+
+/** Read function of files opened by MP4Open(). */
+static RMstatus read_file(void *opaque, RMuint64 offset, RMuint8 *buffer, RMuint32 size)
+{
+	struct MP4Reader *pReader = opaque;
+	RMuint32 pos = 0;
+
+	while (pos < size) {
+		ssize_t len;
+
+		len = pread(pReader->fd, &buffer[pos], size - pos, offset + pos);
+		if (len < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "Error: Failed to read MP4 file (%s).\n", strerror(errno));
+			return RM_ERROR;
+		}
+		if (len == 0) {
+			return RM_ERRORENDOFFILE;
+		}
+		pos += len;
+	}
+	return RM_OK;
+}
+
+/**
+ * Get the next child box.
+ *
+ * @param pos Position in data, moved behind the box.
+ * @returns TRUE when a box was found.
+ */
+static RMbool next_box(const RMuint8 *data, RMuint32 size, RMuint32 *pos, RMuint32 *type, const RMuint8 **payload, RMuint32 *payload_size)
+{
+	RMuint64 boxsize;
+	RMuint32 header = 8;
+
+	if ((*pos + 8) > size) {
+		return FALSE;
+	}
+	boxsize = read_be32(&data[*pos]);
+	*type = read_be32(&data[*pos + 4]);
+	if (boxsize == 1) {
+		if ((*pos + 16) > size) {
+			return FALSE;
+		}
+		boxsize = read_be64(&data[*pos + 8]);
+		header = 16;
+	} else if (boxsize == 0) {
+		boxsize = size - *pos;
+	}
+	if ((boxsize < header) || (boxsize > (size - *pos))) {
+		return FALSE;
+	}
+	*payload = &data[*pos + header];
+	*payload_size = boxsize - header;
+	*pos += boxsize;
+	return TRUE;
+}
+
+static RMbool find_box(const RMuint8 *data, RMuint32 size, RMuint32 type, const RMuint8 **payload, RMuint32 *payload_size)
+{
+	RMuint32 pos = 0;
+	RMuint32 t;
+
+	while (next_box(data, size, &pos, &t, payload, payload_size)) {
+		if (t == type) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/** Get the table of a full box with entry count. */
+static RMbool get_table(const RMuint8 *stbl, RMuint32 stbl_size, RMuint32 type, RMuint32 header, RMuint32 entry_size, struct MP4Table *table)
+{
+	const RMuint8 *payload;
+	RMuint32 payload_size;
+
+	memset(table, 0, sizeof(*table));
+	if (!find_box(stbl, stbl_size, type, &payload, &payload_size)) {
+		return FALSE;
+	}
+	if (payload_size < (header + 4)) {
+		return FALSE;
+	}
+	table->count = read_be32(&payload[header]);
+	table->data = &payload[header + 4];
+	if (((RMuint64) table->count * entry_size) > (payload_size - header - 4)) {
+		fprintf(stderr, "Error: MP4 table is truncated.\n");
+		table->count = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Read the length of an MPEG-4 descriptor. */
+static RMuint32 read_descriptor_length(const RMuint8 *data, RMuint32 size, RMuint32 *pos)
+{
+	RMuint32 length = 0;
+	int i;
+
+	for (i = 0; (i < 4) && (*pos < size); i++) {
+		RMuint8 b = data[(*pos)++];
+
+		length = (length << 7) | (b & 0x7F);
+		if (!(b & 0x80)) {
+			break;
+		}
+	}
+	return length;
+}
+
+static void parse_esds(struct MP4Track *track, const RMuint8 *data, RMuint32 size)
+{
+	RMuint32 pos = 4;
+	RMuint32 length;
+	RMuint8 flags;
+
+	/* ES_Descriptor */
+	if ((pos >= size) || (data[pos++] != 0x03)) {
+		return;
+	}
+	read_descriptor_length(data, size, &pos);
+	if ((pos + 3) > size) {
+		return;
+	}
+	flags = data[pos + 2];
+	pos += 3;
+	if (flags & 0x80) {
+		pos += 2;
+	}
+	if ((flags & 0x40) && (pos < size)) {
+		pos += 1 + data[pos];
+	}
+	if (flags & 0x20) {
+		pos += 2;
+	}
+
+	/* DecoderConfigDescriptor */
+	if ((pos >= size) || (data[pos++] != 0x04)) {
+		return;
+	}
+	read_descriptor_length(data, size, &pos);
+	if ((pos + 13) > size) {
+		return;
+	}
+	track->info.ObjectType = data[pos];
+	pos += 13;
+
+	/* DecoderSpecificInfo */
+	if ((pos >= size) || (data[pos++] != 0x05)) {
+		return;
+	}
+	length = read_descriptor_length(data, size, &pos);
+	if ((pos + length) > size) {
+		return;
+	}
+	track->info.DecoderConfig = &data[pos];
+	track->info.DecoderConfigSize = length;
+}
+
+static void parse_stsd(struct MP4Track *track, const RMuint8 *data, RMuint32 size)
+{
+	const RMuint8 *entry;
+	RMuint32 entry_size;
+	RMuint32 pos = 8;
+	RMuint32 type;
+	const RMuint8 *payload;
+	RMuint32 payload_size;
+
+	/* Only the first sample description is used. */
+	if (!next_box(data, size, &pos, &type, &entry, &entry_size)) {
+		return;
+	}
+	track->info.Codec = type;
+
+	if ((track->info.Type == MP4TrackType_Video) && (entry_size >= 78)) {
+		track->info.Width = read_be16(&entry[24]);
+		track->info.Height = read_be16(&entry[26]);
+		if (find_box(&entry[78], entry_size - 78, BOX_AVCC, &payload, &payload_size)) {
+			track->info.DecoderConfig = payload;
+			track->info.DecoderConfigSize = payload_size;
+		}
+	} else if ((track->info.Type == MP4TrackType_Audio) && (entry_size >= 28)) {
+		track->info.ChannelCount = read_be16(&entry[16]);
+		track->info.SampleRate = read_be32(&entry[24]) >> 16;
+		if (find_box(&entry[28], entry_size - 28, BOX_ESDS, &payload, &payload_size)) {
+			parse_esds(track, payload, payload_size);
+		}
+	}
+}
+
+static void cursor_start_chunk(struct MP4Track *track)
+{
+	const RMuint8 *entry;
+
+	while (((track->stsc_index + 1) < track->stsc.count)
+		&& ((track->chunk + 1) >= read_be32(&track->stsc.data[(track->stsc_index + 1) * 12]))) {
+		track->stsc_index++;
+	}
+	entry = &track->stsc.data[track->stsc_index * 12];
+	track->chunk_left = read_be32(&entry[4]);
+	if (track->chunk < track->chunks.count) {
+		if (track->co64) {
+			track->offset = read_be64(&track->chunks.data[track->chunk * 8]);
+		} else {
+			track->offset = read_be32(&track->chunks.data[track->chunk * 4]);
+		}
+	} else {
+		/* Broken table, end the track. */
+		track->sample = track->info.SampleCount;
+	}
+}
+
+static RMuint32 cursor_sample_size(struct MP4Track *track)
+{
+	if (track->sample_size != 0) {
+		return track->sample_size;
+	}
+	return read_be32(&track->stsz.data[track->sample * 4]);
+}
+
+static void cursor_reset(struct MP4Track *track)
+{
+	track->sample = 0;
+	track->dts = 0;
+	track->stts_index = 0;
+	track->stts_left = (track->stts.count > 0) ? read_be32(&track->stts.data[0]) : 0;
+	track->ctts_index = 0;
+	track->ctts_left = (track->ctts.count > 0) ? read_be32(&track->ctts.data[0]) : 0;
+	track->stsc_index = 0;
+	track->chunk = 0;
+	track->stss_index = 0;
+	if (track->info.SampleCount > 0) {
+		cursor_start_chunk(track);
+	}
+}
+
+/** Move the cursor to the next sample. */
+static void cursor_advance(struct MP4Track *track)
+{
+	track->offset += cursor_sample_size(track);
+	track->sample++;
+
+	while ((track->stts_left == 0) && ((track->stts_index + 1) < track->stts.count)) {
+		track->stts_index++;
+		track->stts_left = read_be32(&track->stts.data[track->stts_index * 8]);
+	}
+	if (track->stts_index < track->stts.count) {
+		track->dts += read_be32(&track->stts.data[track->stts_index * 8 + 4]);
+		if (track->stts_left > 0) {
+			track->stts_left--;
+		}
+	}
+	while ((track->stts_left == 0) && ((track->stts_index + 1) < track->stts.count)) {
+		track->stts_index++;
+		track->stts_left = read_be32(&track->stts.data[track->stts_index * 8]);
+	}
+
+	if (track->ctts_left > 0) {
+		track->ctts_left--;
+	}
+	while ((track->ctts_left == 0) && ((track->ctts_index + 1) < track->ctts.count)) {
+		track->ctts_index++;
+		track->ctts_left = read_be32(&track->ctts.data[track->ctts_index * 8]);
+	}
+
+	while ((track->stss_index < track->stss.count) && (read_be32(&track->stss.data[track->stss_index * 4]) <= track->sample)) {
+		track->stss_index++;
+	}
+
+	if (track->chunk_left > 0) {
+		track->chunk_left--;
+	}
+	while ((track->chunk_left == 0) && (track->sample < track->info.SampleCount)) {
+		track->chunk++;
+		cursor_start_chunk(track);
+	}
+}
+
+/** Move the time cursor of a reset track over count samples, run by run. */
+static void cursor_skip_time(struct MP4Track *track, RMuint32 count)
+{
+	while ((count > 0) && (track->stts_index < track->stts.count)) {
+		RMuint32 step = (count < track->stts_left) ? count : track->stts_left;
+
+		track->dts += ((RMint64) step) * read_be32(&track->stts.data[track->stts_index * 8 + 4]);
+		track->stts_left -= step;
+		count -= step;
+		if (track->stts_left == 0) {
+			if ((track->stts_index + 1) >= track->stts.count) {
+				break;
+			}
+			track->stts_index++;
+			track->stts_left = read_be32(&track->stts.data[track->stts_index * 8]);
+		}
+	}
+}
+
+static void cursor_skip_composition(struct MP4Track *track, RMuint32 count)
+{
+	while ((count > 0) && (track->ctts_index < track->ctts.count)) {
+		RMuint32 step = (count < track->ctts_left) ? count : track->ctts_left;
+
+		track->ctts_left -= step;
+		count -= step;
+		if (track->ctts_left == 0) {
+			if ((track->ctts_index + 1) >= track->ctts.count) {
+				break;
+			}
+			track->ctts_index++;
+			track->ctts_left = read_be32(&track->ctts.data[track->ctts_index * 8]);
+		}
+	}
+}
+
+/** Move the cursor to a sample, whole chunks and table runs are skipped at once. */
+static void cursor_seek(struct MP4Track *track, RMuint32 sample)
+{
+	cursor_reset(track);
+	if (sample >= track->info.SampleCount) {
+		track->sample = track->info.SampleCount;
+		return;
+	}
+
+	while ((track->sample + track->chunk_left) <= sample) {
+		track->sample += track->chunk_left;
+		track->chunk++;
+		cursor_start_chunk(track);
+	}
+	cursor_skip_time(track, track->sample);
+	cursor_skip_composition(track, track->sample);
+	while ((track->stss_index < track->stss.count) && (read_be32(&track->stss.data[track->stss_index * 4]) <= track->sample)) {
+		track->stss_index++;
+	}
+
+	/* Single samples inside the chunk. */
+	while (track->sample < sample) {
+		cursor_advance(track);
+	}
+}
+
+/** Return the last sample with a DTS not after time (in track time scale). */
+static RMuint32 find_sample(struct MP4Track *track, RMint64 time)
+{
+	RMuint32 index;
+	RMuint32 sample = 0;
+	RMint64 dts = 0;
+
+	for (index = 0; index < track->stts.count; index++) {
+		RMuint32 count = read_be32(&track->stts.data[index * 8]);
+		RMuint32 delta = read_be32(&track->stts.data[index * 8 + 4]);
+
+		if ((delta > 0) && ((dts + ((RMint64) count) * delta) > time)) {
+			sample += (time - dts) / delta;
+			break;
+		}
+		dts += ((RMint64) count) * delta;
+		sample += count;
+	}
+	if (sample >= track->info.SampleCount) {
+		sample = (track->info.SampleCount > 0) ? (track->info.SampleCount - 1) : 0;
+	}
+	return sample;
+}
+
+/** Return the last key frame at or before sample. */
+static RMuint32 find_key_frame(struct MP4Track *track, RMuint32 sample)
+{
+	RMuint32 low = 0;
+	RMuint32 high = track->stss.count;
+
+	if (track->stss.count == 0) {
+		return sample;
+	}
+	/* stss has 1-based sample numbers. */
+	while ((high - low) > 1) {
+		RMuint32 mid = low + (high - low) / 2;
+
+		if ((read_be32(&track->stss.data[mid * 4]) - 1) <= sample) {
+			low = mid;
+		} else {
+			high = mid;
+		}
+	}
+	return read_be32(&track->stss.data[low * 4]) - 1;
+}
+
+static RMstatus parse_trak(struct MP4Reader *pReader, const RMuint8 *data, RMuint32 size)
+{
+	struct MP4Track *track;
+	const RMuint8 *mdia;
+	RMuint32 mdia_size;
+	const RMuint8 *minf;
+	RMuint32 minf_size;
+	const RMuint8 *stbl;
+	RMuint32 stbl_size;
+	const RMuint8 *payload;
+	RMuint32 payload_size;
+	RMuint32 i;
+
+	if (pReader->track_count >= MP4_MAX_TRACKS) {
+		DPRINTF("Too many tracks, track ignored.\n");
+		return RM_OK;
+	}
+	track = &pReader->tracks[pReader->track_count];
+	memset(track, 0, sizeof(*track));
+
+	if (find_box(data, size, BOX_TKHD, &payload, &payload_size) && (payload_size >= 24)) {
+		track->info.TrackID = read_be32(&payload[(payload[0] == 1) ? 20 : 12]);
+	}
+	if (!find_box(data, size, BOX_MDIA, &mdia, &mdia_size)) {
+		return RM_OK;
+	}
+	if (find_box(mdia, mdia_size, BOX_MDHD, &payload, &payload_size)) {
+		if ((payload[0] == 1) && (payload_size >= 32)) {
+			track->info.TimeScale = read_be32(&payload[20]);
+			track->info.Duration = read_be64(&payload[24]);
+		} else if (payload_size >= 20) {
+			track->info.TimeScale = read_be32(&payload[12]);
+			track->info.Duration = read_be32(&payload[16]);
+		}
+	}
+	if (find_box(mdia, mdia_size, BOX_HDLR, &payload, &payload_size) && (payload_size >= 12)) {
+		switch (read_be32(&payload[8])) {
+			case HANDLER_VIDE:
+				track->info.Type = MP4TrackType_Video;
+				break;
+
+			case HANDLER_SOUN:
+				track->info.Type = MP4TrackType_Audio;
+				break;
+
+			default:
+				track->info.Type = MP4TrackType_Other;
+				break;
+		}
+	}
+	if (!find_box(mdia, mdia_size, BOX_MINF, &minf, &minf_size)
+		|| !find_box(minf, minf_size, BOX_STBL, &stbl, &stbl_size)) {
+		return RM_OK;
+	}
+	if (track->info.TimeScale == 0) {
+		fprintf(stderr, "Error: MP4 track %u has no time scale.\n", track->info.TrackID);
+		return RM_OK;
+	}
+
+	if (find_box(stbl, stbl_size, BOX_STSD, &payload, &payload_size)) {
+		parse_stsd(track, payload, payload_size);
+	}
+	if (!find_box(stbl, stbl_size, BOX_STSZ, &payload, &payload_size) || (payload_size < 12)) {
+		/* stz2 is not supported. */
+		fprintf(stderr, "Error: MP4 track %u has no stsz.\n", track->info.TrackID);
+		return RM_OK;
+	}
+	track->sample_size = read_be32(&payload[4]);
+	track->info.SampleCount = read_be32(&payload[8]);
+	if (track->sample_size == 0) {
+		track->stsz.data = &payload[12];
+		track->stsz.count = track->info.SampleCount;
+		if (((RMuint64) track->stsz.count * 4) > (payload_size - 12)) {
+			fprintf(stderr, "Error: MP4 table is truncated.\n");
+			return RM_OK;
+		}
+	}
+	if (!get_table(stbl, stbl_size, BOX_STTS, 4, 8, &track->stts)
+		|| !get_table(stbl, stbl_size, BOX_STSC, 4, 12, &track->stsc)
+		|| (track->stsc.count == 0)) {
+		fprintf(stderr, "Error: MP4 track %u has no sample table.\n", track->info.TrackID);
+		return RM_OK;
+	}
+	if (!get_table(stbl, stbl_size, BOX_STCO, 4, 4, &track->chunks)) {
+		if (!get_table(stbl, stbl_size, BOX_CO64, 4, 8, &track->chunks)) {
+			fprintf(stderr, "Error: MP4 track %u has no chunk offsets.\n", track->info.TrackID);
+			return RM_OK;
+		}
+		track->co64 = TRUE;
+	}
+	get_table(stbl, stbl_size, BOX_CTTS, 4, 8, &track->ctts);
+	get_table(stbl, stbl_size, BOX_STSS, 4, 4, &track->stss);
+
+	if (track->info.Duration > 0) {
+		RMuint64 bytes = ((RMuint64) track->sample_size) * track->info.SampleCount;
+		RMuint64 bitrate;
+
+		for (i = 0; i < track->stsz.count; i++) {
+			bytes += read_be32(&track->stsz.data[i * 4]);
+		}
+		bitrate = (bytes * 8 * track->info.TimeScale) / track->info.Duration;
+		track->info.Bitrate = (bitrate > 0xFFFFFFFF) ? 0xFFFFFFFF : bitrate;
+	}
+
+	track->enabled = (track->info.Type != MP4TrackType_Other) ? TRUE : FALSE;
+	cursor_reset(track);
+	DPRINTF("Track %u type %u codec 0x%08x samples %u\n", track->info.TrackID, track->info.Type, track->info.Codec, track->info.SampleCount);
+	pReader->track_count++;
+	return RM_OK;
+}
+
+static RMstatus parse_moov(struct MP4Reader *pReader)
+{
+	const RMuint8 *payload;
+	RMuint32 payload_size;
+	RMuint32 pos = 0;
+	RMuint32 type;
+	RMstatus rv;
+
+	if (find_box(pReader->moov, pReader->moov_size, BOX_MVEX, &payload, &payload_size)) {
+		fprintf(stderr, "Error: Fragmented MP4 files are not supported.\n");
+		return RM_NOT_SUPPORTED;
+	}
+	while (next_box(pReader->moov, pReader->moov_size, &pos, &type, &payload, &payload_size)) {
+		if (type == BOX_TRAK) {
+			rv = parse_trak(pReader, payload, payload_size);
+			if (rv != RM_OK) {
+				return rv;
+			}
+		}
+	}
+	if (pReader->track_count == 0) {
+		fprintf(stderr, "Error: MP4 file has no tracks.\n");
+		return RM_NOT_FOUND;
+	}
+	return RM_OK;
+}
+
+/** Find the moov box in the file and read it. */
+static RMstatus read_moov(struct MP4Reader *pReader)
+{
+	struct MP4Source *source = &pReader->source;
+	RMuint64 offset = 0;
+	RMuint8 header[16];
+	RMstatus rv;
+
+	while ((offset + 8) <= source->Size) {
+		RMuint64 boxsize;
+		RMuint32 type;
+		RMuint32 header_size = 8;
+
+		rv = source->Read(source->opaque, offset, header, 8);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		boxsize = read_be32(header);
+		type = read_be32(&header[4]);
+		if (boxsize == 1) {
+			rv = source->Read(source->opaque, offset + 8, &header[8], 8);
+			if (rv != RM_OK) {
+				return rv;
+			}
+			boxsize = read_be64(&header[8]);
+			header_size = 16;
+		} else if (boxsize == 0) {
+			boxsize = source->Size - offset;
+		}
+		if (boxsize < header_size) {
+			break;
+		}
+		if (type == BOX_MOOV) {
+			if ((boxsize - header_size) > MP4_MAX_MOOV_SIZE) {
+				fprintf(stderr, "Error: MP4 moov box is too large.\n");
+				return RM_INSUFFICIENT_SIZE;
+			}
+			pReader->moov_size = boxsize - header_size;
+			pReader->moov = malloc(pReader->moov_size);
+			if (pReader->moov == NULL) {
+				fprintf(stderr, "Error: out of memory\n");
+
+				return RM_FATALOUTOFMEMORY;
+			}
+			return source->Read(source->opaque, offset + header_size, pReader->moov, pReader->moov_size);
+		}
+		offset += boxsize;
+	}
+	fprintf(stderr, "Error: MP4 file has no moov box.\n");
+	return RM_NOT_FOUND;
+}
+
+static RMstatus alloc_reader(struct MP4Reader **ppReader)
+{
+	struct MP4Reader *pReader;
+
+	pReader = malloc(sizeof(*pReader));
+	if (pReader == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pReader, 0, sizeof(*pReader));
+	pReader->fd = -1;
+	*ppReader = pReader;
+	return RM_OK;
+}
+
+static RMstatus start_reader(struct MP4Reader *pReader, struct MP4Reader **ppReader)
+{
+	RMstatus rv;
+
+	rv = read_moov(pReader);
+	if (rv == RM_OK) {
+		rv = parse_moov(pReader);
+	}
+	if (rv != RM_OK) {
+		MP4Close(pReader);
+		return rv;
+	}
+	*ppReader = pReader;
+	return RM_OK;
+}
+
+RMstatus MP4Open(const char *filename, struct MP4Reader **ppReader)
+{
+	struct MP4Reader *pReader;
+	struct stat st;
+	RMstatus rv;
+
+	if ((filename == NULL) || (ppReader == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	rv = alloc_reader(&pReader);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	pReader->fd = open(filename, O_RDONLY);
+	if ((pReader->fd < 0) || (fstat(pReader->fd, &st) < 0)) {
+		fprintf(stderr, "Error: Failed to open \"%s\".\n", filename);
+		MP4Close(pReader);
+		return RM_ERROR;
+	}
+	pReader->source.opaque = pReader;
+	pReader->source.Read = read_file;
+	pReader->source.Size = st.st_size;
+	return start_reader(pReader, ppReader);
+}
+
+/** Open a file which is read by source->Read(), e.g. over the network. */
+RMstatus MP4OpenSource(struct MP4Source *source, struct MP4Reader **ppReader)
+{
+	struct MP4Reader *pReader;
+	RMstatus rv;
+
+	if ((source == NULL) || (source->Read == NULL) || (ppReader == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	rv = alloc_reader(&pReader);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	pReader->source = *source;
+	return start_reader(pReader, ppReader);
+}
+
+RMstatus MP4Close(struct MP4Reader *pReader)
+{
+	if (pReader == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pReader->fd >= 0) {
+		close(pReader->fd);
+		pReader->fd = -1;
+	}
+	if (pReader->moov != NULL) {
+		free(pReader->moov);
+		pReader->moov = NULL;
+	}
+	free(pReader);
+	return RM_OK;
+}
+
+RMuint32 MP4GetTrackCount(struct MP4Reader *pReader)
+{
+	if (pReader == NULL) {
+		return 0;
+	}
+	return pReader->track_count;
+}
+
+RMstatus MP4GetTrackInfo(struct MP4Reader *pReader, RMuint32 track, struct MP4TrackInfo *info)
+{
+	if ((pReader == NULL) || (info == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (track >= pReader->track_count) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+	*info = pReader->tracks[track].info;
+	return RM_OK;
+}
+
+/** Select whether MP4NextSample() returns the samples of a track, audio and video tracks are enabled by default. */
+RMstatus MP4SetTrackEnabled(struct MP4Reader *pReader, RMuint32 track, RMbool enabled)
+{
+	if (pReader == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (track >= pReader->track_count) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+	pReader->tracks[track].enabled = enabled;
+	return RM_OK;
+}
+
+/**
+ * Get the next sample of the enabled tracks in file order.
+ *
+ * @retval RM_ERRORENDOFFILE All samples were returned.
+ */
+RMstatus MP4NextSample(struct MP4Reader *pReader, struct MP4Sample *sample)
+{
+	struct MP4Track *next = NULL;
+	RMuint32 i;
+
+	if ((pReader == NULL) || (sample == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	for (i = 0; i < pReader->track_count; i++) {
+		struct MP4Track *track = &pReader->tracks[i];
+
+		if (!track->enabled || (track->sample >= track->info.SampleCount)) {
+			continue;
+		}
+		if ((next == NULL) || (track->offset < next->offset)) {
+			next = track;
+		}
+	}
+	if (next == NULL) {
+		return RM_ERRORENDOFFILE;
+	}
+
+	sample->Track = next - pReader->tracks;
+	sample->Offset = next->offset;
+	sample->Size = cursor_sample_size(next);
+	sample->DTS = next->dts;
+	sample->PTS = next->dts;
+	sample->Duration = (next->stts_index < next->stts.count) ? read_be32(&next->stts.data[next->stts_index * 8 + 4]) : 0;
+	if (next->ctts_index < next->ctts.count) {
+		/* Version 1 has signed offsets, version 0 offsets fit into 31 bits in practice. */
+		sample->PTS += (RMint32) read_be32(&next->ctts.data[next->ctts_index * 8 + 4]);
+	}
+	sample->KeyFrame = (next->stss.count == 0)
+		|| ((next->stss_index < next->stss.count) && (read_be32(&next->stss.data[next->stss_index * 4]) == (next->sample + 1)));
+
+	cursor_advance(next);
+	return RM_OK;
+}
+
+/**
+ * Continue at the key frame before time.
+ *
+ * The first enabled video track selects the key frame, the other tracks
+ * continue at the same time.
+ */
+RMstatus MP4Seek(struct MP4Reader *pReader, RMuint64 time, RMuint32 time_resolution)
+{
+	struct MP4Track *master = NULL;
+	RMuint64 master_time;
+	RMuint32 i;
+
+	if (pReader == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (time_resolution == 0) {
+		return RM_INVALID_PARAMETER;
+	}
+	for (i = 0; i < pReader->track_count; i++) {
+		struct MP4Track *track = &pReader->tracks[i];
+
+		if (!track->enabled) {
+			continue;
+		}
+		if ((master == NULL) || ((track->info.Type == MP4TrackType_Video) && (master->info.Type != MP4TrackType_Video))) {
+			master = track;
+		}
+	}
+	if (master == NULL) {
+		return RM_NOT_FOUND;
+	}
+
+	cursor_seek(master, find_key_frame(master, find_sample(master, (time * master->info.TimeScale) / time_resolution)));
+	/* Time of the key frame in microseconds. */
+	master_time = (((RMuint64) master->dts) * 1000000) / master->info.TimeScale;
+
+	for (i = 0; i < pReader->track_count; i++) {
+		struct MP4Track *track = &pReader->tracks[i];
+		RMuint32 sample;
+
+		if (!track->enabled || (track == master)) {
+			continue;
+		}
+		sample = find_sample(track, (master_time * track->info.TimeScale) / 1000000);
+		cursor_seek(track, find_key_frame(track, sample));
+	}
+	return RM_OK;
+}
+
+/** Read data of a sample, e.g. directly into a DMA buffer. */
+RMstatus MP4Read(struct MP4Reader *pReader, RMuint64 offset, RMuint8 *buffer, RMuint32 size)
+{
+	if ((pReader == NULL) || (buffer == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	return pReader->source.Read(pReader->source.opaque, offset, buffer, size);
+}
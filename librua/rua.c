@@ -20,6 +20,7 @@
 #include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <errno.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -782,6 +783,70 @@ if ((ModuleID & 0xFF) == VideoDecoder) {
 	return rv;
 }
 
+/**
+ * Get a buffer filled by the module of a receive pool.
+ * The buffer must be given back with RUAReleaseBuffer().
+ *
+ * @retval RM_PENDING No data available.
+ * @retval RM_NOT_SUPPORTED Built without RUA_RECEIVE_DATA.
+ */
+RMstatus RUAReceiveData(struct RUA *pRua, RMuint32 ModuleID, struct RUABufferPool *pBufferPool, RMuint8 **ppData, RMuint32 *pDataSize, void *pInfo, RMuint32 *pInfoSize)
+{
+	RMuint32 iocmd[6];
+	RMuint8 *data;
+	int ret;
+
+	if ((ppData == NULL) || (pDataSize == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pBufferPool->direction != RUA_POOL_DIRECTION_RECEIVE) {
+		EPRINTF("RUAReceiveData(%p, (%u, %u), %p) rv = RM_INVALIDMODE\n", pRua, (ModuleID >> 8) & 0xFF, ModuleID & 0xFF, pBufferPool);
+		return RM_INVALIDMODE;
+	}
+	*ppData = NULL;
+	*pDataSize = 0;
+#ifndef RUA_RECEIVE_DATA
+	/* An unknown ioctl number could run another driver command, see RUARECEIVE in config.mk. */
+	return RM_NOT_SUPPORTED;
+#endif
+
+	/* TBD: Layout of the receive ioctl is not verified. */
+	iocmd[0] = ModuleID;
+	iocmd[1] = pBufferPool->poolid;
+	iocmd[2] = 0;
+	iocmd[3] = 0;
+	/* The kernel interface uses 32 bit addresses. */
+	iocmd[4] = (RMuint32) (unsigned long) pInfo;
+	iocmd[5] = (pInfoSize != NULL) ? *pInfoSize : 0;
+	/* TBD: The ioctl number is guessed as the read/write variant after the send ioctl 0x40184504. */
+	ret = ioctl(pRua->fd, 0xC0184505, iocmd);
+	if (ret < 0) {
+		if (errno == EAGAIN) {
+			return RM_PENDING;
+		}
+		EPRINTF("RUAReceiveData(%p, (%u, %u), %p) rv = RM_ERROR, ioctl failed with errno %d\n", pRua, (ModuleID >> 8) & 0xFF, ModuleID & 0xFF, pBufferPool, errno);
+		return RM_ERROR;
+	}
+	if (iocmd[2] == 0) {
+		/* No buffer was filled yet. */
+		return RM_PENDING;
+	}
+	data = dmapool_get_virtual_address(pBufferPool->pDmapool, iocmd[2]);
+	if (data == NULL) {
+		EPRINTF("RUAReceiveData(%p, (%u, %u), %p) rv = RM_ERROR, unknown address 0x%08x\n", pRua, (ModuleID >> 8) & 0xFF, ModuleID & 0xFF, pBufferPool, iocmd[2]);
+		return RM_ERROR;
+	}
+	/* The module wrote the data, old content must not be read from the cache. */
+	dmapool_invalidate_cache(pBufferPool->pDmapool, iocmd[2], iocmd[3]);
+	if (pInfoSize != NULL) {
+		*pInfoSize = iocmd[5];
+	}
+	*ppData = data;
+	*pDataSize = iocmd[3];
+	DPRINTF("RUAReceiveData(%p, (%u, %u), %p, *%p = %p, *%p = %u) rv = RM_OK\n", pRua, (ModuleID >> 8) & 0xFF, ModuleID & 0xFF, pBufferPool, ppData, data, pDataSize, iocmd[3]);
+	return RM_OK;
+}
+
 RMstatus RUAReleaseBuffer(struct RUABufferPool *pBufferPool, RMuint8 *pBuffer)
 {
 	RMuint32 physical_address;
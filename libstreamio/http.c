@@ -0,0 +1,1027 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * HTTP source for the read-ahead thread.
+ *
+ * The stream is fetched in chunks with range requests over persistent
+ * connections. A seek only changes the range of the next request, so no new
+ * connection is needed. Several chunks are requested in parallel over
+ * different connections and pipelined on each connection, so the read-ahead
+ * window is filled faster when the round trip time is long. How many chunks
+ * are requested ahead depends on the free space in the read-ahead window.
+ *
+ * When the server ignores the range request, the response is read as one
+ * stream which can't seek.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+
+#include "streamio.h"
+
+/** Print debug message. */
+#if 0
+#define DPRINTF(args...) printf(args)
+#else
+#define DPRINTF(args...) do { } while(0)
+#endif
+
+#define HTTP_DEFAULT_CHUNK_SIZE (256 * 1024)
+#define HTTP_DEFAULT_TIMEOUT_MS 10000
+/** Maximum number of requests sent on a connection before the response. */
+#define HTTP_PIPELINE_DEPTH 2
+/** Receive buffer for response headers, also the maximum header size. */
+#define HTTP_RECV_SIZE 4096
+#define HTTP_REQUEST_SIZE 1024
+/** Number of times a chunk is requested again after a connection failed. */
+#define HTTP_MAX_RETRIES 3
+/** Responses which are outdated by a seek are still received up to this size to keep the connection. */
+#define HTTP_DRAIN_SIZE (64 * 1024)
+/** Body length of a response without Content-Length, it ends when the connection is closed. */
+#define HTTP_UNKNOWN_LENGTH (~0ULL)
+
+struct http_connection;
+
+struct http_chunk {
+	RMuint8 *data;
+	/** Range of the stream. */
+	RMuint64 offset;
+	RMuint32 size;
+	RMuint32 received;
+	/** Connection which receives the chunk, NULL if it needs to be requested. */
+	struct http_connection *conn;
+	RMbool used;
+	/** Not needed anymore after a seek, but still received. */
+	RMbool dropped;
+	RMbool done;
+	RMuint32 retries;
+};
+
+struct http_connection {
+	int fd;
+	/** Requests which were sent, the first one is received. */
+	struct http_chunk *pending[HTTP_PIPELINE_DEPTH];
+	RMuint32 count;
+	RMbool header_done;
+	RMbool keep_alive;
+	/** The body is not stored, e.g. the message of a 416 response. */
+	RMbool discard;
+	/** The resource ends with the body of the response. */
+	RMbool resource_end;
+	RMuint64 body_left;
+	char rbuf[HTTP_RECV_SIZE];
+	RMuint32 rbuf_len;
+};
+
+struct StreamIOHTTP {
+	/** Value of the Host header. */
+	char *host;
+	char *path;
+	struct addrinfo *addr;
+	struct StreamIOHTTPProfile profile;
+
+	struct http_connection *connections;
+	struct pollfd *fds;
+	struct http_chunk *chunks;
+	RMuint32 chunk_count;
+	/** Requested chunks in stream order. */
+	struct http_chunk **queue;
+	RMuint32 queue_count;
+	/** Read position in the first chunk of the queue. */
+	RMuint32 pos;
+
+	/** Position of the next read. */
+	RMuint64 offset;
+	/** Position of the next chunk which is requested. */
+	RMuint64 request_offset;
+	/** Size of the resource, 0 if unknown. */
+	RMuint64 size;
+	/** False when the server ignores range requests. */
+	RMbool ranges;
+	/** False when the server closes connections after each response. */
+	RMbool pipelining;
+	/** True until the header of the first response was received. */
+	RMbool probing;
+	RMbool error;
+	/** Number of chunks which should be requested ahead. */
+	RMuint32 ahead;
+	/** The reader of the stream waits, return data as soon as there is some. */
+	RMbool starving;
+};
+
+static void release_chunk(struct http_chunk *chunk)
+{
+	chunk->used = FALSE;
+	chunk->dropped = FALSE;
+	chunk->done = FALSE;
+	chunk->conn = NULL;
+}
+
+/** Close the connection, chunks which were not received are requested again. */
+static RMstatus reset_connection(struct http_connection *conn)
+{
+	RMstatus rv = RM_OK;
+	RMuint32 i;
+
+	if (conn->fd >= 0) {
+		close(conn->fd);
+		conn->fd = -1;
+	}
+	for (i = 0; i < conn->count; i++) {
+		struct http_chunk *chunk = conn->pending[i];
+
+		chunk->conn = NULL;
+		if (chunk->dropped) {
+			release_chunk(chunk);
+		} else {
+			chunk->retries++;
+			if (chunk->retries > HTTP_MAX_RETRIES) {
+				fprintf(stderr, "Error: HTTP request for %llu failed.\n", (unsigned long long) chunk->offset);
+				rv = RM_ERROR;
+			}
+		}
+	}
+	conn->count = 0;
+	conn->rbuf_len = 0;
+	conn->header_done = FALSE;
+	conn->discard = FALSE;
+	conn->resource_end = FALSE;
+	return rv;
+}
+
+static RMstatus connect_server(struct StreamIOHTTP *pHTTP, struct http_connection *conn)
+{
+	struct addrinfo *ai;
+	struct timeval tv;
+	int fd = -1;
+	int one = 1;
+
+	tv.tv_sec = pHTTP->profile.Timeout_ms / 1000;
+	tv.tv_usec = (pHTTP->profile.Timeout_ms % 1000) * 1000;
+	for (ai = pHTTP->addr; ai != NULL; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0) {
+			continue;
+		}
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+		if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+			break;
+		}
+		close(fd);
+		fd = -1;
+	}
+	if (fd < 0) {
+		fprintf(stderr, "Error: Cannot connect to %s.\n", pHTTP->host);
+		return RM_ERROR;
+	}
+	/* Requests are small and must not wait for the response of the one before. */
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	DPRINTF("Connected to %s\n", pHTTP->host);
+
+	conn->fd = fd;
+	conn->keep_alive = TRUE;
+	return RM_OK;
+}
+
+static RMstatus send_request(struct StreamIOHTTP *pHTTP, struct http_connection *conn, struct http_chunk *chunk)
+{
+	char request[HTTP_REQUEST_SIZE];
+	RMuint32 pos = 0;
+	int len;
+	RMstatus rv;
+
+	if (conn->fd < 0) {
+		rv = connect_server(pHTTP, conn);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+	len = snprintf(request, sizeof(request),
+		"GET %s HTTP/1.1\r\n"
+		"Host: %s\r\n"
+		"Range: bytes=%llu-%llu\r\n"
+		"Connection: keep-alive\r\n"
+		"\r\n",
+		pHTTP->path, pHTTP->host,
+		(unsigned long long) (chunk->offset + chunk->received),
+		(unsigned long long) (chunk->offset + chunk->size - 1));
+	if ((len < 0) || (len >= (int) sizeof(request))) {
+		fprintf(stderr, "Error: URL is too long.\n");
+		return RM_INSUFFICIENT_SIZE;
+	}
+	DPRINTF("Request %llu - %llu on %d\n", chunk->offset + chunk->received, chunk->offset + chunk->size - 1, conn->fd);
+
+	conn->pending[conn->count] = chunk;
+	conn->count++;
+	chunk->conn = conn;
+	while (pos < (RMuint32) len) {
+		ssize_t sent;
+
+		sent = send(conn->fd, &request[pos], len - pos, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return reset_connection(conn);
+		}
+		pos += sent;
+	}
+	return RM_OK;
+}
+
+/**
+ * Select the connection for the next request.
+ *
+ * Idle connections which are open are preferred, then a new connection is
+ * opened. Requests are only pipelined when all connections are in use.
+ */
+static struct http_connection *select_connection(struct StreamIOHTTP *pHTTP)
+{
+	struct http_connection *best = NULL;
+	RMuint32 i;
+
+	for (i = 0; i < pHTTP->profile.Connections; i++) {
+		struct http_connection *conn = &pHTTP->connections[i];
+
+		if ((conn->count == 0) && (conn->fd >= 0)) {
+			return conn;
+		}
+	}
+	for (i = 0; i < pHTTP->profile.Connections; i++) {
+		struct http_connection *conn = &pHTTP->connections[i];
+
+		if (conn->count == 0) {
+			return conn;
+		}
+	}
+	for (i = 0; i < pHTTP->profile.Connections; i++) {
+		struct http_connection *conn = &pHTTP->connections[i];
+
+		if ((conn->count >= HTTP_PIPELINE_DEPTH) || !conn->keep_alive || !pHTTP->pipelining) {
+			continue;
+		}
+		if ((best == NULL) || (conn->count < best->count)) {
+			best = conn;
+		}
+	}
+	return best;
+}
+
+/** Queue the chunks ahead of the read position and send the requests. */
+static RMstatus schedule(struct StreamIOHTTP *pHTTP)
+{
+	RMuint32 i;
+	RMstatus rv;
+
+	while (pHTTP->queue_count < pHTTP->ahead) {
+		struct http_chunk *chunk = NULL;
+
+		if ((pHTTP->size > 0) && (pHTTP->request_offset >= pHTTP->size)) {
+			break;
+		}
+		for (i = 0; i < pHTTP->chunk_count; i++) {
+			if (!pHTTP->chunks[i].used) {
+				chunk = &pHTTP->chunks[i];
+				break;
+			}
+		}
+		if (chunk == NULL) {
+			break;
+		}
+		chunk->used = TRUE;
+		chunk->offset = pHTTP->request_offset;
+		chunk->size = pHTTP->profile.ChunkSize;
+		if ((pHTTP->size > 0) && (chunk->size > (pHTTP->size - chunk->offset))) {
+			chunk->size = pHTTP->size - chunk->offset;
+		}
+		chunk->received = 0;
+		chunk->retries = 0;
+		pHTTP->queue[pHTTP->queue_count] = chunk;
+		pHTTP->queue_count++;
+		pHTTP->request_offset += chunk->size;
+	}
+
+	/* New chunks and chunks of failed connections. */
+	for (i = 0; i < pHTTP->queue_count; i++) {
+		struct http_chunk *chunk = pHTTP->queue[i];
+		struct http_connection *conn;
+
+		if ((chunk->conn != NULL) || chunk->done) {
+			continue;
+		}
+		conn = select_connection(pHTTP);
+		if (conn == NULL) {
+			break;
+		}
+		rv = send_request(pHTTP, conn, chunk);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+	return RM_OK;
+}
+
+static RMstatus parse_header(struct StreamIOHTTP *pHTTP, struct http_connection *conn, char *header)
+{
+	struct http_chunk *chunk = conn->pending[0];
+	unsigned long long content_length = HTTP_UNKNOWN_LENGTH;
+	unsigned long long first = 0;
+	unsigned long long last = 0;
+	unsigned long long total = 0;
+	RMbool range = FALSE;
+	unsigned int major;
+	unsigned int minor;
+	unsigned int status;
+	char *line;
+
+	if (sscanf(header, "HTTP/%u.%u %u", &major, &minor, &status) != 3) {
+		fprintf(stderr, "Error: Invalid HTTP response.\n");
+		return RM_ERROR;
+	}
+	conn->keep_alive = (major > 1) || ((major == 1) && (minor >= 1));
+
+	line = strstr(header, "\r\n");
+	while (line != NULL) {
+		char *value;
+
+		line += 2;
+		value = strchr(line, ':');
+		if (value == NULL) {
+			break;
+		}
+		value++;
+		if (strncasecmp(line, "Content-Length:", 15) == 0) {
+			content_length = strtoull(value, NULL, 10);
+		} else if (strncasecmp(line, "Content-Range:", 14) == 0) {
+			if (sscanf(value, " bytes %llu-%llu/%llu", &first, &last, &total) >= 2) {
+				range = TRUE;
+			} else {
+				/* Size of the resource in a 416 response. */
+				sscanf(value, " bytes */%llu", &total);
+			}
+		} else if (strncasecmp(line, "Connection:", 11) == 0) {
+			if (strncasecmp(value + strspn(value, " "), "close", 5) == 0) {
+				conn->keep_alive = FALSE;
+			} else if (strncasecmp(value + strspn(value, " "), "keep-alive", 10) == 0) {
+				conn->keep_alive = TRUE;
+			}
+		} else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+			if (strncasecmp(value + strspn(value, " "), "identity", 8) != 0) {
+				fprintf(stderr, "Error: HTTP transfer encoding is not supported.\n");
+				return RM_NOT_SUPPORTED;
+			}
+		}
+		line = strstr(line, "\r\n");
+	}
+	DPRINTF("HTTP %u, length %llu, range %llu - %llu / %llu\n", status, content_length, first, last, total);
+
+	switch (status) {
+		case 206:
+			if (!range || (last < first) || (first != (chunk->offset + chunk->received))
+				|| ((last - first + 1) > (chunk->size - chunk->received))) {
+				fprintf(stderr, "Error: HTTP response has wrong range %llu - %llu.\n", first, last);
+				return RM_ERROR;
+			}
+			conn->body_left = last - first + 1;
+			if (total > 0) {
+				pHTTP->size = total;
+			}
+			/* Servers may send less than requested, only the total tells where the resource ends. */
+			conn->resource_end = (total > 0) && ((last + 1) >= total);
+			break;
+
+		case 200:
+			if (!pHTTP->probing) {
+				fprintf(stderr, "Error: HTTP server stopped to support ranges.\n");
+				return RM_ERROR;
+			}
+			/* Whole resource, it is read as one stream. */
+			pHTTP->ranges = FALSE;
+			conn->body_left = content_length;
+			if (content_length != HTTP_UNKNOWN_LENGTH) {
+				pHTTP->size = content_length;
+			}
+			break;
+
+		case 416:
+			/* Range is after the end of the resource. */
+			conn->discard = TRUE;
+			conn->resource_end = TRUE;
+			conn->body_left = (content_length != HTTP_UNKNOWN_LENGTH) ? content_length : 0;
+			if (total > 0) {
+				pHTTP->size = total;
+			}
+			break;
+
+		default:
+			fprintf(stderr, "Error: HTTP status %u for %s.\n", status, pHTTP->path);
+			return RM_ERROR;
+	}
+	return RM_OK;
+}
+
+/** The response of the first pending request was completely received. */
+static RMstatus complete_response(struct StreamIOHTTP *pHTTP, struct http_connection *conn)
+{
+	struct http_chunk *chunk = conn->pending[0];
+	RMbool resource_end = conn->resource_end;
+	RMuint32 i;
+
+	for (i = 1; i < conn->count; i++) {
+		conn->pending[i - 1] = conn->pending[i];
+	}
+	conn->count--;
+	conn->header_done = FALSE;
+	conn->discard = FALSE;
+	conn->resource_end = FALSE;
+
+	chunk->conn = NULL;
+	chunk->done = TRUE;
+	if (chunk->dropped) {
+		release_chunk(chunk);
+	} else if (chunk->received < chunk->size) {
+		if (resource_end) {
+			/* Resource ends here. */
+			chunk->size = chunk->received;
+			pHTTP->size = chunk->offset + chunk->size;
+		} else {
+			/* Server limits the size of ranges, the rest is requested again. */
+			DPRINTF("Short range for %llu, got %u of %u\n", chunk->offset, chunk->received, chunk->size);
+			chunk->done = FALSE;
+		}
+	}
+	if (!conn->keep_alive) {
+		pHTTP->pipelining = FALSE;
+		return reset_connection(conn);
+	}
+	return RM_OK;
+}
+
+static void consume(struct http_connection *conn, RMuint32 len)
+{
+	memmove(conn->rbuf, &conn->rbuf[len], conn->rbuf_len - len);
+	conn->rbuf_len -= len;
+}
+
+/** Process the data in the receive buffer of the connection. */
+static RMstatus process_data(struct StreamIOHTTP *pHTTP, struct http_connection *conn)
+{
+	RMstatus rv;
+
+	while (conn->rbuf_len > 0) {
+		struct http_chunk *chunk;
+		RMuint32 len;
+
+		if (conn->count == 0) {
+			fprintf(stderr, "Error: Unexpected data from HTTP server.\n");
+			return reset_connection(conn);
+		}
+		chunk = conn->pending[0];
+
+		if (!conn->header_done) {
+			char *end;
+
+			conn->rbuf[conn->rbuf_len] = 0;
+			end = strstr(conn->rbuf, "\r\n\r\n");
+			if (end == NULL) {
+				if (conn->rbuf_len >= (sizeof(conn->rbuf) - 1)) {
+					fprintf(stderr, "Error: HTTP response header is too large.\n");
+					return RM_ERROR;
+				}
+				return RM_OK;
+			}
+			end[2] = 0;
+			rv = parse_header(pHTTP, conn, conn->rbuf);
+			if (rv != RM_OK) {
+				return rv;
+			}
+			consume(conn, end + 4 - conn->rbuf);
+			conn->header_done = TRUE;
+			if (pHTTP->probing || !pHTTP->ranges) {
+				/* Caller decides how the body is read. */
+				return RM_OK;
+			}
+			if (conn->body_left == 0) {
+				rv = complete_response(pHTTP, conn);
+				if (rv != RM_OK) {
+					return rv;
+				}
+			}
+			continue;
+		}
+
+		len = conn->rbuf_len;
+		if (len > conn->body_left) {
+			len = conn->body_left;
+		}
+		if (!conn->discard) {
+			memcpy(&chunk->data[chunk->received], conn->rbuf, len);
+			chunk->received += len;
+		}
+		consume(conn, len);
+		conn->body_left -= len;
+		if (conn->body_left == 0) {
+			rv = complete_response(pHTTP, conn);
+			if (rv != RM_OK) {
+				return rv;
+			}
+		}
+	}
+	return RM_OK;
+}
+
+static RMstatus receive(struct StreamIOHTTP *pHTTP, struct http_connection *conn)
+{
+	ssize_t len;
+
+	if (conn->header_done && (conn->rbuf_len == 0) && !conn->discard) {
+		struct http_chunk *chunk = conn->pending[0];
+
+		/* Body goes directly into the chunk. */
+		len = recv(conn->fd, &chunk->data[chunk->received], conn->body_left, 0);
+		if (len > 0) {
+			chunk->received += len;
+			conn->body_left -= len;
+			if (conn->body_left == 0) {
+				return complete_response(pHTTP, conn);
+			}
+			return RM_OK;
+		}
+	} else {
+		len = recv(conn->fd, &conn->rbuf[conn->rbuf_len], sizeof(conn->rbuf) - 1 - conn->rbuf_len, 0);
+		if (len > 0) {
+			conn->rbuf_len += len;
+			return process_data(pHTTP, conn);
+		}
+	}
+	if ((len < 0) && (errno == EINTR)) {
+		return RM_OK;
+	}
+	/* Closed by the server, e.g. persistent connection timed out. */
+	DPRINTF("Connection %d closed, len %d\n", conn->fd, (int) len);
+	return reset_connection(conn);
+}
+
+/** Wait for data on the connections with pending requests. */
+static RMstatus wait_data(struct StreamIOHTTP *pHTTP)
+{
+	RMuint32 count = 0;
+	RMuint32 i;
+	RMstatus rv;
+	int ret;
+
+	for (i = 0; i < pHTTP->profile.Connections; i++) {
+		if (pHTTP->connections[i].count > 0) {
+			pHTTP->fds[count].fd = pHTTP->connections[i].fd;
+			pHTTP->fds[count].events = POLLIN;
+			pHTTP->fds[count].revents = 0;
+			count++;
+		}
+	}
+	if (count == 0) {
+		return RM_OK;
+	}
+	ret = poll(pHTTP->fds, count, pHTTP->profile.Timeout_ms);
+	if ((ret < 0) && (errno != EINTR)) {
+		return RM_ERROR;
+	}
+
+	count = 0;
+	for (i = 0; i < pHTTP->profile.Connections; i++) {
+		struct http_connection *conn = &pHTTP->connections[i];
+		struct pollfd *fd;
+
+		if (conn->count == 0) {
+			continue;
+		}
+		fd = &pHTTP->fds[count];
+		count++;
+		if (ret == 0) {
+			/* No data in time, request again. */
+			DPRINTF("Timeout on %d\n", conn->fd);
+			rv = reset_connection(conn);
+		} else if (fd->revents != 0) {
+			rv = receive(pHTTP, conn);
+		} else {
+			rv = RM_OK;
+		}
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+	return RM_OK;
+}
+
+/** Read the response of a server without range support. */
+static RMint32 read_stream(struct StreamIOHTTP *pHTTP, RMuint8 *buffer, RMuint32 size)
+{
+	struct http_connection *conn = &pHTTP->connections[0];
+	RMuint32 copied = 0;
+
+	while ((copied < size) && (conn->body_left > 0) && !((copied > 0) && pHTTP->starving)) {
+		RMuint32 len = size - copied;
+		ssize_t ret;
+
+		if (len > conn->body_left) {
+			len = conn->body_left;
+		}
+		if (conn->rbuf_len > 0) {
+			if (len > conn->rbuf_len) {
+				len = conn->rbuf_len;
+			}
+			memcpy(&buffer[copied], conn->rbuf, len);
+			consume(conn, len);
+		} else {
+			ret = recv(conn->fd, &buffer[copied], len, 0);
+			if ((ret < 0) && (errno == EINTR)) {
+				continue;
+			}
+			if (ret <= 0) {
+				if ((ret == 0) && (conn->body_left == HTTP_UNKNOWN_LENGTH)) {
+					conn->body_left = 0;
+					break;
+				}
+				fprintf(stderr, "Error: HTTP connection failed at %llu.\n", (unsigned long long) pHTTP->offset);
+				return (copied > 0) ? (RMint32) copied : -1;
+			}
+			len = ret;
+		}
+		copied += len;
+		pHTTP->offset += len;
+		if (conn->body_left != HTTP_UNKNOWN_LENGTH) {
+			conn->body_left -= len;
+		}
+	}
+	return copied;
+}
+
+static RMint32 http_read(void *opaque, RMuint8 *buffer, RMuint32 size)
+{
+	struct StreamIOHTTP *pHTTP = opaque;
+	RMuint32 copied = 0;
+	RMstatus rv;
+
+	if (!pHTTP->ranges) {
+		return read_stream(pHTTP, buffer, size);
+	}
+	if (pHTTP->error) {
+		return -1;
+	}
+
+	while (copied < size) {
+		struct http_chunk *chunk;
+
+		if ((pHTTP->size > 0) && (pHTTP->offset >= pHTTP->size)) {
+			break;
+		}
+		rv = schedule(pHTTP);
+		if (rv != RM_OK) {
+			pHTTP->error = TRUE;
+			break;
+		}
+		if (pHTTP->queue_count == 0) {
+			break;
+		}
+
+		chunk = pHTTP->queue[0];
+		if (chunk->received > pHTTP->pos) {
+			RMuint32 len = chunk->received - pHTTP->pos;
+
+			if (len > (size - copied)) {
+				len = size - copied;
+			}
+			memcpy(&buffer[copied], &chunk->data[pHTTP->pos], len);
+			copied += len;
+			pHTTP->pos += len;
+			pHTTP->offset += len;
+		}
+		if (chunk->done && (pHTTP->pos >= chunk->size)) {
+			/* Chunk is completely read, next one is at the read position. */
+			release_chunk(chunk);
+			pHTTP->queue_count--;
+			memmove(&pHTTP->queue[0], &pHTTP->queue[1], pHTTP->queue_count * sizeof(pHTTP->queue[0]));
+			pHTTP->pos = 0;
+			continue;
+		}
+		if ((copied >= size) || ((copied > 0) && pHTTP->starving)) {
+			break;
+		}
+		rv = wait_data(pHTTP);
+		if (rv != RM_OK) {
+			pHTTP->error = TRUE;
+			break;
+		}
+	}
+	if ((copied == 0) && pHTTP->error) {
+		return -1;
+	}
+	return copied;
+}
+
+/** Following reads start at offset, requests for the old position are dropped. */
+static RMstatus http_seek(void *opaque, RMuint64 offset)
+{
+	struct StreamIOHTTP *pHTTP = opaque;
+	RMuint32 i;
+	RMstatus rv;
+
+	DPRINTF("Seek to %llu\n", offset);
+	for (i = 0; i < pHTTP->queue_count; i++) {
+		struct http_chunk *chunk = pHTTP->queue[i];
+
+		if (chunk->conn == NULL) {
+			release_chunk(chunk);
+		} else {
+			chunk->dropped = TRUE;
+		}
+	}
+	pHTTP->queue_count = 0;
+	pHTTP->pos = 0;
+
+	/* A connection is kept when the rest of the old responses is small. */
+	for (i = 0; i < pHTTP->profile.Connections; i++) {
+		struct http_connection *conn = &pHTTP->connections[i];
+		RMuint64 left = 0;
+		RMuint32 j;
+
+		for (j = 0; j < conn->count; j++) {
+			left += conn->pending[j]->size - conn->pending[j]->received;
+		}
+		if (left > HTTP_DRAIN_SIZE) {
+			rv = reset_connection(conn);
+			if (rv != RM_OK) {
+				return rv;
+			}
+		}
+	}
+
+	pHTTP->offset = offset;
+	pHTTP->request_offset = offset;
+	pHTTP->error = FALSE;
+	return RM_OK;
+}
+
+static void http_level(void *opaque, RMuint64 buffered, RMuint64 window)
+{
+	struct StreamIOHTTP *pHTTP = opaque;
+	RMuint64 ahead = 1;
+
+	/* Request as much as fits into the window, in parallel when it is empty. */
+	if (window > buffered) {
+		ahead = (window - buffered + pHTTP->profile.ChunkSize - 1) / pHTTP->profile.ChunkSize;
+	}
+	if (ahead > pHTTP->chunk_count) {
+		ahead = pHTTP->chunk_count;
+	}
+	if (ahead < 1) {
+		ahead = 1;
+	}
+	pHTTP->ahead = ahead;
+	pHTTP->starving = (buffered == 0);
+}
+
+static void http_close(void *opaque)
+{
+	struct StreamIOHTTP *pHTTP = opaque;
+	RMuint32 i;
+
+	if (pHTTP->connections != NULL) {
+		for (i = 0; i < pHTTP->profile.Connections; i++) {
+			if (pHTTP->connections[i].fd >= 0) {
+				close(pHTTP->connections[i].fd);
+			}
+		}
+		free(pHTTP->connections);
+	}
+	if (pHTTP->chunks != NULL) {
+		for (i = 0; i < pHTTP->chunk_count; i++) {
+			free(pHTTP->chunks[i].data);
+		}
+		free(pHTTP->chunks);
+	}
+	if (pHTTP->addr != NULL) {
+		freeaddrinfo(pHTTP->addr);
+	}
+	free(pHTTP->fds);
+	free(pHTTP->queue);
+	free(pHTTP->host);
+	free(pHTTP->path);
+	free(pHTTP);
+}
+
+/** Split "http://host[:port]/path" and resolve the host. */
+static RMstatus parse_url(struct StreamIOHTTP *pHTTP, const char *url)
+{
+	struct addrinfo hints;
+	const char *start;
+	const char *slash;
+	const char *port = "80";
+	char *name;
+	char *colon;
+	int ret;
+
+	if (strncasecmp(url, "http://", 7) != 0) {
+		fprintf(stderr, "Error: Only http URLs are supported.\n");
+		return RM_NOT_SUPPORTED;
+	}
+	start = &url[7];
+	slash = strchr(start, '/');
+	if (slash == NULL) {
+		slash = &start[strlen(start)];
+	}
+	pHTTP->host = strndup(start, slash - start);
+	pHTTP->path = strdup((*slash != 0) ? slash : "/");
+	name = strndup(start, slash - start);
+	if ((pHTTP->host == NULL) || (pHTTP->path == NULL) || (name == NULL)) {
+		fprintf(stderr, "Error: out of memory\n");
+		free(name);
+		return RM_FATALOUTOFMEMORY;
+	}
+	colon = strrchr(name, ':');
+	if (colon != NULL) {
+		*colon = 0;
+		port = colon + 1;
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	ret = getaddrinfo(name, port, &hints, &pHTTP->addr);
+	if (ret != 0) {
+		fprintf(stderr, "Error: Cannot resolve '%s': %s\n", name, gai_strerror(ret));
+		pHTTP->addr = NULL;
+		free(name);
+		return RM_ERROR;
+	}
+	free(name);
+	return RM_OK;
+}
+
+/**
+ * Open a source which reads url over HTTP, for StreamIOOpen().
+ *
+ * The first range request is sent here to find out the size and whether
+ * the server supports ranges.
+ *
+ * @param http Connections and chunk size, NULL for one connection.
+ */
+RMstatus StreamIOHTTPOpen(const char *url, struct StreamIOHTTPProfile *http, struct StreamIOSource *source)
+{
+	struct StreamIOHTTP *pHTTP;
+	struct http_connection *conn;
+	RMuint32 i;
+	RMstatus rv;
+
+	if ((url == NULL) || (source == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	pHTTP = malloc(sizeof(*pHTTP));
+	if (pHTTP == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pHTTP, 0, sizeof(*pHTTP));
+	if (http != NULL) {
+		pHTTP->profile = *http;
+	}
+	if (pHTTP->profile.ChunkSize == 0) {
+		pHTTP->profile.ChunkSize = HTTP_DEFAULT_CHUNK_SIZE;
+	}
+	if (pHTTP->profile.Connections == 0) {
+		pHTTP->profile.Connections = 1;
+	}
+	if (pHTTP->profile.Timeout_ms == 0) {
+		pHTTP->profile.Timeout_ms = HTTP_DEFAULT_TIMEOUT_MS;
+	}
+
+	rv = parse_url(pHTTP, url);
+	if (rv != RM_OK) {
+		http_close(pHTTP);
+		return rv;
+	}
+
+	pHTTP->chunk_count = pHTTP->profile.Connections * HTTP_PIPELINE_DEPTH;
+	pHTTP->connections = malloc(pHTTP->profile.Connections * sizeof(pHTTP->connections[0]));
+	pHTTP->fds = malloc(pHTTP->profile.Connections * sizeof(pHTTP->fds[0]));
+	pHTTP->chunks = malloc(pHTTP->chunk_count * sizeof(pHTTP->chunks[0]));
+	pHTTP->queue = malloc(pHTTP->chunk_count * sizeof(pHTTP->queue[0]));
+	if ((pHTTP->connections == NULL) || (pHTTP->fds == NULL) || (pHTTP->chunks == NULL) || (pHTTP->queue == NULL)) {
+		fprintf(stderr, "Error: out of memory\n");
+		http_close(pHTTP);
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pHTTP->connections, 0, pHTTP->profile.Connections * sizeof(pHTTP->connections[0]));
+	for (i = 0; i < pHTTP->profile.Connections; i++) {
+		pHTTP->connections[i].fd = -1;
+	}
+	memset(pHTTP->chunks, 0, pHTTP->chunk_count * sizeof(pHTTP->chunks[0]));
+	for (i = 0; i < pHTTP->chunk_count; i++) {
+		pHTTP->chunks[i].data = malloc(pHTTP->profile.ChunkSize);
+		if (pHTTP->chunks[i].data == NULL) {
+			fprintf(stderr, "Error: out of memory\n");
+			http_close(pHTTP);
+			return RM_FATALOUTOFMEMORY;
+		}
+	}
+
+	/* Request the first chunk alone and look at the response. */
+	pHTTP->ranges = TRUE;
+	pHTTP->pipelining = TRUE;
+	pHTTP->probing = TRUE;
+	pHTTP->ahead = 1;
+	do {
+		rv = schedule(pHTTP);
+		if (rv == RM_OK) {
+			rv = wait_data(pHTTP);
+		}
+		conn = pHTTP->queue[0]->conn;
+	} while ((rv == RM_OK) && ((conn == NULL) || !conn->header_done));
+	pHTTP->probing = FALSE;
+	if (rv != RM_OK) {
+		fprintf(stderr, "Error: Cannot open '%s'.\n", url);
+		http_close(pHTTP);
+		return rv;
+	}
+
+	if (pHTTP->ranges) {
+		/* Continue with the body of the first chunk. */
+		if (conn->body_left == 0) {
+			rv = complete_response(pHTTP, conn);
+		} else {
+			rv = process_data(pHTTP, conn);
+		}
+		if (rv != RM_OK) {
+			http_close(pHTTP);
+			return rv;
+		}
+	} else {
+		/* Response is read by read_stream(). */
+		DPRINTF("Server doesn't support ranges\n");
+		release_chunk(pHTTP->queue[0]);
+		pHTTP->queue_count = 0;
+		conn->count = 0;
+	}
+	pHTTP->ahead = pHTTP->chunk_count;
+	DPRINTF("Opened %s, size %llu\n", url, pHTTP->size);
+
+	memset(source, 0, sizeof(*source));
+	source->opaque = pHTTP;
+	source->Read = http_read;
+	source->Seek = pHTTP->ranges ? http_seek : NULL;
+	source->Close = http_close;
+	source->Level = http_level;
+	source->Size = pHTTP->size;
+	return RM_OK;
+}
+
+/** Read ahead from an HTTP server. */
+RMstatus StreamIOOpenHTTP(const char *url, struct StreamIOHTTPProfile *http, struct StreamIOProfile *profile, struct StreamIO **ppStream)
+{
+	struct StreamIOSource source;
+	RMstatus rv;
+
+	if ((url == NULL) || (profile == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	rv = StreamIOHTTPOpen(url, http, &source);
+	if (rv != RM_OK) {
+		return rv;
+	}
+	rv = StreamIOOpen(&source, profile, ppStream);
+	if (rv != RM_OK) {
+		source.Close(source.opaque);
+		return rv;
+	}
+	return RM_OK;
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * Memory mapped file with bounded memory usage.
+ *
+ * Only a window of the file is mapped. Data ahead of the read position is
+ * requested from the kernel early, data behind it is dropped from the
+ * mapping and from the page cache. So a file which is played once from the
+ * start to the end doesn't push everything else out of memory.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "streamio.h"
+
+/** Print debug message. */
+#if 0
+#define DPRINTF(args...) printf(args)
+#else
+#define DPRINTF(args...) do { } while(0)
+#endif
+
+struct StreamIOMap {
+	int fd;
+	RMuint64 size;
+	RMuint64 page_size;
+	RMuint64 window_size;
+	/** Amount of data which is advised or dropped at once. */
+	RMuint64 step;
+
+	/** Mapped part of the file, NULL if nothing is mapped. */
+	RMuint8 *data;
+	RMuint64 base;
+	RMuint64 length;
+
+	/** File offset up to which data is requested with MADV_WILLNEED. */
+	RMuint64 advised;
+	/** File offset up to which data is dropped. */
+	RMuint64 dropped;
+};
+
+static RMuint64 page_down(struct StreamIOMap *pMap, RMuint64 offset)
+{
+	return offset - (offset % pMap->page_size);
+}
+
+/** Remove file data between dropped and offset from the mapping and the page cache. */
+static void drop_data(struct StreamIOMap *pMap, RMuint64 offset)
+{
+	if (offset <= pMap->dropped) {
+		return;
+	}
+	DPRINTF("Drop %llu - %llu\n", pMap->dropped, offset);
+	if ((pMap->data != NULL) && (pMap->dropped >= pMap->base) && (offset <= (pMap->base + pMap->length))) {
+		madvise(&pMap->data[pMap->dropped - pMap->base], offset - pMap->dropped, MADV_DONTNEED);
+	}
+	posix_fadvise(pMap->fd, pMap->dropped, offset - pMap->dropped, POSIX_FADV_DONTNEED);
+	pMap->dropped = offset;
+}
+
+static RMstatus map_window(struct StreamIOMap *pMap, RMuint64 offset)
+{
+	RMuint64 base = page_down(pMap, offset);
+	void *ptr;
+
+	if (pMap->data != NULL) {
+		if (offset >= pMap->base) {
+			/* Moving forward, data up to here was played. */
+			drop_data(pMap, page_down(pMap, offset));
+		}
+		munmap(pMap->data, pMap->length);
+		pMap->data = NULL;
+	}
+
+	pMap->length = pMap->size - base;
+	if (pMap->length > pMap->window_size) {
+		pMap->length = pMap->window_size;
+	}
+	DPRINTF("Map %llu - %llu\n", base, base + pMap->length);
+	ptr = mmap(NULL, pMap->length, PROT_READ, MAP_SHARED, pMap->fd, base);
+	if (ptr == MAP_FAILED) {
+		fprintf(stderr, "Error: Cannot map file at %llu.\n", (unsigned long long) base);
+		return RM_ERROR;
+	}
+	pMap->data = ptr;
+	pMap->base = base;
+	madvise(pMap->data, pMap->length, MADV_SEQUENTIAL);
+	pMap->advised = base;
+	pMap->dropped = base;
+	return RM_OK;
+}
+
+/**
+ * Open a file for mapped access.
+ *
+ * @param window_size Maximum size which is mapped, this is also the limit
+ *                    for the size passed to StreamIOMapGet().
+ */
+RMstatus StreamIOMapOpen(const char *filename, RMuint32 window_size, struct StreamIOMap **ppMap)
+{
+	struct StreamIOMap *pMap;
+	struct stat st;
+
+	if ((filename == NULL) || (ppMap == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	pMap = malloc(sizeof(*pMap));
+	if (pMap == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pMap, 0, sizeof(*pMap));
+	pMap->fd = open(filename, O_RDONLY);
+	if (pMap->fd < 0) {
+		fprintf(stderr, "Error: Failed to open \"%s\".\n", filename);
+		free(pMap);
+		return RM_ERROR;
+	}
+	if (fstat(pMap->fd, &st) != 0) {
+		close(pMap->fd);
+		free(pMap);
+		return RM_ERROR;
+	}
+	pMap->size = st.st_size;
+	pMap->page_size = sysconf(_SC_PAGESIZE);
+	/* Window must have space for the page offset of the first byte. */
+	pMap->window_size = page_down(pMap, window_size) + pMap->page_size;
+	pMap->step = page_down(pMap, window_size / 4);
+	if (pMap->step < pMap->page_size) {
+		pMap->step = pMap->page_size;
+	}
+	posix_fadvise(pMap->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	*ppMap = pMap;
+	return RM_OK;
+}
+
+RMstatus StreamIOMapClose(struct StreamIOMap *pMap)
+{
+	if (pMap == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pMap->data != NULL) {
+		munmap(pMap->data, pMap->length);
+	}
+	close(pMap->fd);
+	free(pMap);
+	return RM_OK;
+}
+
+RMuint64 StreamIOMapGetSize(struct StreamIOMap *pMap)
+{
+	return pMap->size;
+}
+
+/**
+ * Get a pointer to the file data at offset.
+ *
+ * The pointer is valid until the next call. Data before offset may be
+ * dropped from memory, because the file is expected to be read forward.
+ */
+RMstatus StreamIOMapGet(struct StreamIOMap *pMap, RMuint64 offset, RMuint32 size, RMuint8 **data)
+{
+	RMuint64 end;
+	RMstatus rv;
+
+	if ((pMap == NULL) || (data == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if ((offset > pMap->size) || (size > (pMap->size - offset))) {
+		return RM_INVALID_PARAMETER;
+	}
+	if ((size + (offset % pMap->page_size)) > pMap->window_size) {
+		return RM_INSUFFICIENT_SIZE;
+	}
+	if (size == 0) {
+		*data = NULL;
+		return RM_OK;
+	}
+
+	if ((pMap->data == NULL) || (offset < pMap->base) || ((offset + size) > (pMap->base + pMap->length))) {
+		rv = map_window(pMap, offset);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+
+	/* Request the data ahead of the read position. */
+	end = pMap->base + pMap->length;
+	if (((offset + size + pMap->step) > pMap->advised) && (pMap->advised < end)) {
+		RMuint64 start = pMap->advised;
+		RMuint64 stop;
+
+		if (start < page_down(pMap, offset)) {
+			start = page_down(pMap, offset);
+		}
+		stop = offset + size + pMap->step;
+		if (stop > end) {
+			stop = end;
+		}
+		if (stop > start) {
+			madvise(&pMap->data[start - pMap->base], stop - start, MADV_WILLNEED);
+			pMap->advised = stop;
+		}
+	}
+
+	/* Data behind the read position was played. */
+	if (page_down(pMap, offset) >= (pMap->dropped + pMap->step)) {
+		drop_data(pMap, page_down(pMap, offset));
+	}
+
+	*data = &pMap->data[offset - pMap->base];
+	return RM_OK;
+}
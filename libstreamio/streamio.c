@@ -0,0 +1,516 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * Read-ahead of input data in a separate thread.
+ *
+ * The reader thread fills a ring of large buffers from the source while the
+ * thread which feeds the decoders only copies from memory. A slow network or
+ * USB device then only stalls the feeding thread when the whole read-ahead
+ * window is used up.
+ *
+ * A seek inside the buffered data only drops buffers. Other seeks are done
+ * by the reader thread, data which it read for the old position is dropped.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "streamio.h"
+
+/** Print debug message. */
+#if 0
+#define DPRINTF(args...) printf(args)
+#else
+#define DPRINTF(args...) do { } while(0)
+#endif
+
+struct StreamIOBuffer {
+	RMuint8 *data;
+	/** Position of data in the stream. */
+	RMuint64 offset;
+	RMuint32 size;
+};
+
+struct StreamIO {
+	struct StreamIOSource source;
+	struct StreamIOProfile profile;
+	RMuint8 *memory;
+	struct StreamIOBuffer *buffers;
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	/** Signalled by the reader thread when a buffer was filled or a seek finished. */
+	pthread_cond_t filled;
+	/** Signalled when a buffer was consumed, a seek was requested or on close. */
+	pthread_cond_t consumed;
+
+	/** Filled buffers, starting at first. */
+	RMuint32 first;
+	RMuint32 count;
+	/** Read position in the first buffer. */
+	RMuint32 pos;
+	/** Position which is returned by StreamIOTell(). */
+	RMuint64 position;
+
+	/** Position of the next read from the source. */
+	RMuint64 read_offset;
+	/** Incremented by a seek, so the reader thread can drop data read before. */
+	RMuint32 generation;
+	RMbool seek_pending;
+	RMuint64 seek_offset;
+	RMbool eof;
+	RMbool error;
+	RMbool quit;
+	/** Set when StreamIORead() returned data, waiting before is the initial fill. */
+	RMbool started;
+
+	struct StreamIOStatistics stats;
+};
+
+struct StreamIOFile {
+	int fd;
+	RMuint64 offset;
+	/** Size of the read-ahead hint given to the kernel. */
+	RMuint32 hint_size;
+};
+
+static RMuint64 get_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((RMuint64) ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/** Bytes read ahead and not yet consumed, called with the mutex locked. */
+static RMuint64 get_buffered(struct StreamIO *pStream)
+{
+	RMuint64 buffered = 0;
+	RMuint32 i;
+
+	for (i = 0; i < pStream->count; i++) {
+		buffered += pStream->buffers[(pStream->first + i) % pStream->profile.BufferCount].size;
+	}
+	return buffered - pStream->pos;
+}
+
+static void *reader_thread(void *arg)
+{
+	struct StreamIO *pStream = arg;
+
+	pthread_mutex_lock(&pStream->mutex);
+	while (!pStream->quit) {
+		struct StreamIOBuffer *buffer;
+		RMuint32 generation;
+		RMuint64 offset;
+		RMuint64 buffered;
+		RMint32 len;
+
+		if (pStream->seek_pending) {
+			RMstatus rv;
+
+			generation = pStream->generation;
+			offset = pStream->seek_offset;
+			pStream->seek_pending = FALSE;
+			pthread_mutex_unlock(&pStream->mutex);
+			DPRINTF("Seek source to %llu\n", offset);
+			rv = pStream->source.Seek(pStream->source.opaque, offset);
+			pthread_mutex_lock(&pStream->mutex);
+			if (generation != pStream->generation) {
+				/* Seeked again in between. */
+				continue;
+			}
+			pStream->read_offset = offset;
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Error: Cannot seek input to %llu, rv = %d\n", (unsigned long long) offset, rv);
+				pStream->error = TRUE;
+			}
+			pthread_cond_broadcast(&pStream->filled);
+			continue;
+		}
+		if (pStream->eof || pStream->error || (pStream->count >= pStream->profile.BufferCount)) {
+			pthread_cond_wait(&pStream->consumed, &pStream->mutex);
+			continue;
+		}
+
+		buffer = &pStream->buffers[(pStream->first + pStream->count) % pStream->profile.BufferCount];
+		generation = pStream->generation;
+		offset = pStream->read_offset;
+		buffered = get_buffered(pStream);
+		pthread_mutex_unlock(&pStream->mutex);
+		if (pStream->source.Level != NULL) {
+			pStream->source.Level(pStream->source.opaque, buffered, ((RMuint64) pStream->profile.BufferSize) * pStream->profile.BufferCount);
+		}
+		len = pStream->source.Read(pStream->source.opaque, buffer->data, pStream->profile.BufferSize);
+		pthread_mutex_lock(&pStream->mutex);
+		if (generation != pStream->generation) {
+			/* Data is from before a seek. */
+			continue;
+		}
+		if (len < 0) {
+			fprintf(stderr, "Error: Cannot read input at %llu\n", (unsigned long long) offset);
+			pStream->error = TRUE;
+		} else if (len == 0) {
+			pStream->eof = TRUE;
+		} else {
+			buffer->offset = offset;
+			buffer->size = len;
+			pStream->count++;
+			pStream->read_offset += len;
+			pStream->stats.BytesRead += len;
+		}
+		pthread_cond_broadcast(&pStream->filled);
+	}
+	pthread_mutex_unlock(&pStream->mutex);
+	return NULL;
+}
+
+/**
+ * Start reading ahead from source.
+ *
+ * The source is closed by StreamIOClose(), but not when StreamIOOpen() fails.
+ */
+RMstatus StreamIOOpen(struct StreamIOSource *source, struct StreamIOProfile *profile, struct StreamIO **ppStream)
+{
+	struct StreamIO *pStream;
+	RMuint32 i;
+
+	if ((source == NULL) || (source->Read == NULL) || (profile == NULL) || (ppStream == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if ((profile->BufferSize == 0) || (profile->BufferCount == 0)) {
+		return RM_INVALID_PARAMETER;
+	}
+
+	pStream = malloc(sizeof(*pStream));
+	if (pStream == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pStream, 0, sizeof(*pStream));
+	pStream->source = *source;
+	pStream->profile = *profile;
+	pStream->memory = malloc(((size_t) profile->BufferSize) * profile->BufferCount);
+	pStream->buffers = malloc(sizeof(pStream->buffers[0]) * profile->BufferCount);
+	if ((pStream->memory == NULL) || (pStream->buffers == NULL)) {
+		fprintf(stderr, "Error: out of memory\n");
+		free(pStream->memory);
+		free(pStream->buffers);
+		free(pStream);
+		return RM_FATALOUTOFMEMORY;
+	}
+	for (i = 0; i < profile->BufferCount; i++) {
+		pStream->buffers[i].data = &pStream->memory[((size_t) i) * profile->BufferSize];
+		pStream->buffers[i].offset = 0;
+		pStream->buffers[i].size = 0;
+	}
+
+	pthread_mutex_init(&pStream->mutex, NULL);
+	pthread_cond_init(&pStream->filled, NULL);
+	pthread_cond_init(&pStream->consumed, NULL);
+	if (pthread_create(&pStream->thread, NULL, reader_thread, pStream) != 0) {
+		fprintf(stderr, "Error: Cannot create reader thread.\n");
+		pthread_cond_destroy(&pStream->consumed);
+		pthread_cond_destroy(&pStream->filled);
+		pthread_mutex_destroy(&pStream->mutex);
+		free(pStream->memory);
+		free(pStream->buffers);
+		free(pStream);
+		return RM_ERROR;
+	}
+
+	*ppStream = pStream;
+	return RM_OK;
+}
+
+static RMint32 file_read(void *opaque, RMuint8 *buffer, RMuint32 size)
+{
+	struct StreamIOFile *file = opaque;
+	ssize_t len;
+
+	/* Let the kernel fetch the next buffer while this one is used. */
+	posix_fadvise(file->fd, file->offset + size, file->hint_size, POSIX_FADV_WILLNEED);
+	do {
+		len = read(file->fd, buffer, size);
+	} while ((len < 0) && (errno == EINTR));
+	if (len > 0) {
+		file->offset += len;
+	}
+	return len;
+}
+
+static RMstatus file_seek(void *opaque, RMuint64 offset)
+{
+	struct StreamIOFile *file = opaque;
+
+	if (lseek(file->fd, offset, SEEK_SET) == (off_t) -1) {
+		return RM_ERROR;
+	}
+	file->offset = offset;
+	return RM_OK;
+}
+
+static void file_close(void *opaque)
+{
+	struct StreamIOFile *file = opaque;
+
+	close(file->fd);
+	free(file);
+}
+
+/** Read ahead from a local file, e.g. on USB or hard disk. */
+RMstatus StreamIOOpenFile(const char *filename, struct StreamIOProfile *profile, struct StreamIO **ppStream)
+{
+	struct StreamIOSource source;
+	struct StreamIOFile *file;
+	struct stat st;
+	RMstatus rv;
+
+	if ((filename == NULL) || (profile == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	file = malloc(sizeof(*file));
+	if (file == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+		return RM_FATALOUTOFMEMORY;
+	}
+	file->fd = open(filename, O_RDONLY);
+	if (file->fd < 0) {
+		fprintf(stderr, "Error: Cannot open '%s'.\n", filename);
+		free(file);
+		return RM_ERROR;
+	}
+	file->offset = 0;
+	file->hint_size = profile->BufferSize;
+	posix_fadvise(file->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	memset(&source, 0, sizeof(source));
+	source.opaque = file;
+	source.Read = file_read;
+	source.Seek = file_seek;
+	source.Close = file_close;
+	if (fstat(file->fd, &st) == 0) {
+		source.Size = st.st_size;
+	}
+
+	rv = StreamIOOpen(&source, profile, ppStream);
+	if (rv != RM_OK) {
+		file_close(file);
+		return rv;
+	}
+	return RM_OK;
+}
+
+RMstatus StreamIOClose(struct StreamIO *pStream)
+{
+	if (pStream == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	pthread_mutex_lock(&pStream->mutex);
+	pStream->quit = TRUE;
+	pthread_cond_broadcast(&pStream->consumed);
+	pthread_mutex_unlock(&pStream->mutex);
+	pthread_join(pStream->thread, NULL);
+
+	if (pStream->source.Close != NULL) {
+		pStream->source.Close(pStream->source.opaque);
+	}
+	pthread_cond_destroy(&pStream->consumed);
+	pthread_cond_destroy(&pStream->filled);
+	pthread_mutex_destroy(&pStream->mutex);
+	free(pStream->memory);
+	free(pStream->buffers);
+	free(pStream);
+	return RM_OK;
+}
+
+/**
+ * Copy data which was read ahead, like read() it only waits when no data is
+ * buffered.
+ *
+ * @retval RM_ERRORENDOFFILE No more data.
+ */
+RMstatus StreamIORead(struct StreamIO *pStream, RMuint8 *buffer, RMuint32 size, RMuint32 *read)
+{
+	RMstatus rv = RM_OK;
+
+	if ((pStream == NULL) || ((buffer == NULL) && (size > 0)) || (read == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	*read = 0;
+
+	pthread_mutex_lock(&pStream->mutex);
+	while (*read < size) {
+		struct StreamIOBuffer *current;
+		RMuint32 len;
+
+		if (pStream->count == 0) {
+			RMuint64 start;
+			RMuint64 stall;
+
+			if ((*read > 0) || pStream->error || pStream->eof) {
+				break;
+			}
+			start = get_time_us();
+			while ((pStream->count == 0) && !pStream->error && !pStream->eof) {
+				pthread_cond_wait(&pStream->filled, &pStream->mutex);
+			}
+			if (pStream->started) {
+				stall = get_time_us() - start;
+				pStream->stats.Stalls++;
+				pStream->stats.StallTime_us += stall;
+				if (stall > pStream->stats.MaxStallTime_us) {
+					pStream->stats.MaxStallTime_us = stall;
+				}
+			}
+			continue;
+		}
+
+		current = &pStream->buffers[pStream->first];
+		len = current->size - pStream->pos;
+		if (len > (size - *read)) {
+			len = size - *read;
+		}
+		memcpy(&buffer[*read], &current->data[pStream->pos], len);
+		pStream->pos += len;
+		pStream->started = TRUE;
+		pStream->position += len;
+		*read += len;
+		if (pStream->pos >= current->size) {
+			pStream->first = (pStream->first + 1) % pStream->profile.BufferCount;
+			pStream->count--;
+			pStream->pos = 0;
+			pthread_cond_broadcast(&pStream->consumed);
+		}
+	}
+	if (*read == 0) {
+		rv = pStream->error ? RM_ERROR : RM_ERRORENDOFFILE;
+	}
+	pthread_mutex_unlock(&pStream->mutex);
+	return rv;
+}
+
+/**
+ * Check whether offset is reached by dropping data read ahead, called with
+ * the mutex locked.
+ */
+static RMbool is_read_ahead(struct StreamIO *pStream, RMuint64 offset)
+{
+	RMuint32 i;
+
+	for (i = 0; i < pStream->count; i++) {
+		struct StreamIOBuffer *buffer = &pStream->buffers[(pStream->first + i) % pStream->profile.BufferCount];
+
+		if ((offset >= buffer->offset) && (offset < (buffer->offset + buffer->size))) {
+			return TRUE;
+		}
+	}
+	return !pStream->seek_pending && !pStream->error && (offset == pStream->read_offset);
+}
+
+/** Set the position of the next StreamIORead(). */
+RMstatus StreamIOSeek(struct StreamIO *pStream, RMuint64 offset)
+{
+	if (pStream == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+
+	pthread_mutex_lock(&pStream->mutex);
+	if ((pStream->source.Seek == NULL) && !is_read_ahead(pStream, offset)) {
+		/* Keep the buffered data, the source can't seek. */
+		pthread_mutex_unlock(&pStream->mutex);
+		return RM_NOT_SUPPORTED;
+	}
+	/* Drop buffers before offset, the data may already be read ahead. */
+	while (pStream->count > 0) {
+		struct StreamIOBuffer *current = &pStream->buffers[pStream->first];
+
+		if ((offset >= current->offset) && (offset < (current->offset + current->size))) {
+			pStream->pos = offset - current->offset;
+			pStream->position = offset;
+			pthread_mutex_unlock(&pStream->mutex);
+			return RM_OK;
+		}
+		if (offset < current->offset) {
+			break;
+		}
+		pStream->first = (pStream->first + 1) % pStream->profile.BufferCount;
+		pStream->count--;
+		pStream->pos = 0;
+		pthread_cond_broadcast(&pStream->consumed);
+	}
+	if ((pStream->count == 0) && !pStream->seek_pending && !pStream->error && (offset == pStream->read_offset)) {
+		/* Next read of the reader thread starts there. */
+		pStream->position = offset;
+		pthread_mutex_unlock(&pStream->mutex);
+		return RM_OK;
+	}
+	DPRINTF("Seek from %llu to %llu\n", pStream->position, offset);
+	pStream->count = 0;
+	pStream->pos = 0;
+	pStream->position = offset;
+	pStream->generation++;
+	pStream->seek_pending = TRUE;
+	pStream->seek_offset = offset;
+	pStream->eof = FALSE;
+	pStream->error = FALSE;
+	pStream->stats.Seeks++;
+	pthread_cond_broadcast(&pStream->consumed);
+	pthread_mutex_unlock(&pStream->mutex);
+	return RM_OK;
+}
+
+RMuint64 StreamIOTell(struct StreamIO *pStream)
+{
+	RMuint64 position;
+
+	pthread_mutex_lock(&pStream->mutex);
+	position = pStream->position;
+	pthread_mutex_unlock(&pStream->mutex);
+	return position;
+}
+
+/** Size of the stream, 0 if unknown. */
+RMuint64 StreamIOGetSize(struct StreamIO *pStream)
+{
+	return pStream->source.Size;
+}
+
+RMstatus StreamIOGetStatistics(struct StreamIO *pStream, struct StreamIOStatistics *stats)
+{
+	if ((pStream == NULL) || (stats == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	pthread_mutex_lock(&pStream->mutex);
+	*stats = pStream->stats;
+	stats->BytesBuffered = get_buffered(pStream);
+	pthread_mutex_unlock(&pStream->mutex);
+	return RM_OK;
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) Juergen Urban, All rights reserved.
+#
+# Local HTTP server for httptest. It serves one file with different range
+# behaviour:
+#   full     Range requests are answered as requested.
+#   capped   Ranges are cut to CAP bytes, like servers and CDNs which limit
+#            the size of a response.
+#   unknown  Like capped, but the total size is not sent ("bytes a-b/*").
+#   none     Ranges are ignored, the whole file is sent with status 200.
+#
+# Usage: httpserver.py <file> <portfile> <HTTP/1.0|HTTP/1.1> <mode>
+# The port is written to portfile when the server is ready.
+
+import http.server
+import re
+import socketserver
+import sys
+
+CAP = 100000
+
+filename, portfile, protocol, mode = sys.argv[1:5]
+data = open(filename, 'rb').read()
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = protocol
+
+    def log_message(self, *args):
+        pass
+
+    def do_GET(self):
+        match = re.match(r'bytes=(\d+)-(\d+)', self.headers.get('Range', ''))
+        if (match is None) or (mode == 'none'):
+            self.send_response(200)
+            self.send_header('Content-Length', str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+            return
+        first, last = int(match.group(1)), int(match.group(2))
+        total = str(len(data)) if mode != 'unknown' else '*'
+        if first >= len(data):
+            self.send_response(416)
+            self.send_header('Content-Range', 'bytes */' + total)
+            self.send_header('Content-Length', '0')
+            self.end_headers()
+            return
+        last = min(last, len(data) - 1)
+        if mode != 'full':
+            last = min(last, first + CAP - 1)
+        self.send_response(206)
+        self.send_header('Content-Range', 'bytes %d-%d/%s' % (first, last, total))
+        self.send_header('Content-Length', str(last - first + 1))
+        self.end_headers()
+        self.wfile.write(data[first:last + 1])
+
+
+class Server(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+
+    def handle_error(self, request, client_address):
+        # Connections with outdated responses are closed by the client after a seek.
+        pass
+
+
+server = Server(('127.0.0.1', 0), Handler)
+with open(portfile, 'w') as f:
+    f.write(str(server.server_address[1]))
+server.serve_forever()
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * Host test of the HTTP source. The URL is read completely and at some
+ * seek positions, the data is compared with the served file.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "streamio.h"
+
+/** Bytes compared after each seek. */
+#define SEEK_READ_SIZE 20000
+
+static RMuint8 *load_file(const char *filename, RMuint64 *size)
+{
+	RMuint8 *data;
+	FILE *fin;
+	long len;
+
+	fin = fopen(filename, "rb");
+	if (fin == NULL) {
+		return NULL;
+	}
+	fseek(fin, 0, SEEK_END);
+	len = ftell(fin);
+	fseek(fin, 0, SEEK_SET);
+	data = malloc(len);
+	if ((data != NULL) && (fread(data, 1, len, fin) != (size_t) len)) {
+		free(data);
+		data = NULL;
+	}
+	fclose(fin);
+	*size = len;
+	return data;
+}
+
+/** Read up to size bytes from the current position. */
+static RMuint64 read_data(struct StreamIO *pStream, RMuint8 *buffer, RMuint64 size)
+{
+	RMuint64 total = 0;
+	RMuint32 len;
+
+	while (total < size) {
+		RMuint32 part = ((size - total) > 100000) ? 100000 : (size - total);
+
+		if (StreamIORead(pStream, &buffer[total], part, &len) != RM_OK) {
+			break;
+		}
+		total += len;
+	}
+	return total;
+}
+
+int main(int argc, char *argv[])
+{
+	struct StreamIOHTTPProfile http;
+	struct StreamIOProfile profile;
+	struct StreamIO *pStream;
+	RMuint8 *expected;
+	RMuint8 *buffer;
+	RMuint64 size;
+	RMuint64 len;
+	RMuint64 offsets[5];
+	int failed = 0;
+	int i;
+	RMstatus rv;
+
+	if (argc < 3) {
+		fprintf(stderr, "%s [url] [served file] [seekable]\n", argv[0]);
+		return 1;
+	}
+	expected = load_file(argv[2], &size);
+	buffer = malloc(size + 1);
+	if ((expected == NULL) || (buffer == NULL)) {
+		fprintf(stderr, "Error: Cannot load '%s'.\n", argv[2]);
+		return 1;
+	}
+
+	memset(&http, 0, sizeof(http));
+	http.ChunkSize = 256 * 1024;
+	http.Connections = 2;
+	profile.BufferSize = 256 * 1024;
+	profile.BufferCount = 8;
+	rv = StreamIOOpenHTTP(argv[1], &http, &profile, &pStream);
+	if (rv != RM_OK) {
+		fprintf(stderr, "Error: Cannot open '%s', rv = %d\n", argv[1], rv);
+		return 1;
+	}
+
+	/* Read one byte more to see that the stream ends at the right place. */
+	len = read_data(pStream, buffer, size + 1);
+	if ((len != size) || (memcmp(buffer, expected, size) != 0)) {
+		printf("FAIL: read %llu of %llu bytes\n", (unsigned long long) len, (unsigned long long) size);
+		failed = 1;
+	}
+
+	if ((argc > 3) && (atoi(argv[3]) != 0)) {
+		offsets[0] = size - 100000;
+		offsets[1] = 100;
+		offsets[2] = size / 2;
+		offsets[3] = size - 10;
+		offsets[4] = 0;
+		for (i = 0; i < 5; i++) {
+			RMuint64 want = size - offsets[i];
+
+			if (want > SEEK_READ_SIZE) {
+				want = SEEK_READ_SIZE;
+			}
+			rv = StreamIOSeek(pStream, offsets[i]);
+			len = (rv == RM_OK) ? read_data(pStream, buffer, want) : 0;
+			if ((len != want) || (memcmp(buffer, &expected[offsets[i]], want) != 0)) {
+				printf("FAIL: seek to %llu, rv = %d, read %llu\n", (unsigned long long) offsets[i], rv, (unsigned long long) len);
+				failed = 1;
+			}
+		}
+	}
+
+	StreamIOClose(pStream);
+	free(buffer);
+	free(expected);
+	return failed;
+}
@@ -0,0 +1,805 @@
+/*
+ * Copyright (c) Juergen Urban, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library.
+ */
+
+/*
+ * Software MPEG transport stream demuxer.
+ *
+ * The payload of the selected elementary streams is copied from the TS
+ * packets directly into the DMA buffers of the decoders. Each packet header
+ * is read as one 32 bit word and the PID is looked up in a table, so a packet
+ * which is not needed is skipped after touching only its first cache line.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rua.h"
+#include "dcc.h"
+#include "tsdemux.h"
+
+/** Print debug message. */
+#if 0
+#define DPRINTF(args...) printf(args)
+#else
+#define DPRINTF(args...) do { } while(0)
+#endif
+
+#define TS_PACKET_SIZE 188
+/** M2TS packets with 4 byte time code in front of the TS packet. */
+#define M2TS_PACKET_SIZE 192
+#define TS_SYNC_BYTE 0x47
+#define TS_PID_COUNT 8192
+#define TS_PID_PAT 0x0000
+#define TS_PID_NULL 0x1FFF
+
+/** Entries of pid_map. */
+#define PID_MAP_NONE 0
+#define PID_MAP_PSI 0x80
+#define PID_MAP_INDEX_MASK 0x7F
+
+#define PSI_MAX_SECTION_SIZE 1024
+#define PSI_TABLE_PAT 0x00
+#define PSI_TABLE_PMT 0x02
+
+/** PES header: start code, stream id, length, flags, header length. */
+#define PES_FIXED_HEADER_SIZE 9
+#define PES_MAX_HEADER_SIZE (PES_FIXED_HEADER_SIZE + 255)
+
+/** Time to wait for a free DMA buffer, 0 to return RM_PENDING at once. */
+#define BUFFER_TIMEOUT_US 0
+
+struct TSDemuxSection {
+	RMuint32 pid;
+	RMbool started;
+	RMuint32 size;
+	RMuint8 data[PSI_MAX_SECTION_SIZE];
+	/** Version of the last handled table, -1 if none. */
+	RMint32 version;
+};
+
+struct TSDemuxStream {
+	RMbool used;
+	RMuint32 pid;
+	struct TSDemuxOutput output;
+	RMuint8 continuity;
+	RMbool continuity_valid;
+
+	/** DMA buffer which is filled at the moment. */
+	RMuint8 *buffer;
+	RMuint32 pos;
+	/** PTS of the PES starting at the beginning of buffer. */
+	RMbool pts_valid;
+	RMuint64 pts;
+
+	/** PES header which is split over several packets. */
+	RMbool in_header;
+	RMuint32 header_size;
+	RMuint8 header[PES_MAX_HEADER_SIZE];
+};
+
+struct TSDemux {
+	TSDemuxProgramFunc *program_func;
+	TSDemuxPCRFunc *pcr_func;
+	TSDemuxPESFunc *pes_func;
+	void *opaque;
+
+	/** 188 or 192, 0 while unknown. */
+	RMuint32 packet_size;
+	/** Offset of the TS header in a packet. */
+	RMuint32 header_offset;
+	/** Incomplete packet from the last TSDemuxFeed(). */
+	RMuint8 carry[M2TS_PACKET_SIZE];
+	RMuint32 carry_size;
+
+	RMuint8 pid_map[TS_PID_COUNT];
+	struct TSDemuxStream streams[TSDEMUX_MAX_STREAMS];
+	/** Slot 0 is the PAT, the others the PMTs. */
+	struct TSDemuxSection sections[TSDEMUX_MAX_PROGRAMS + 1];
+	RMuint32 section_count;
+
+	RMuint32 crc_table[256];
+};
+
+static void init_crc_table(struct TSDemux *pDemux)
+{
+	RMuint32 i;
+	RMuint32 j;
+
+	for (i = 0; i < 256; i++) {
+		RMuint32 crc = i << 24;
+
+		for (j = 0; j < 8; j++) {
+			crc = (crc & 0x80000000) ? ((crc << 1) ^ 0x04C11DB7) : (crc << 1);
+		}
+		pDemux->crc_table[i] = crc;
+	}
+}
+
+static RMuint32 crc32_mpeg(struct TSDemux *pDemux, const RMuint8 *data, RMuint32 size)
+{
+	RMuint32 crc = 0xFFFFFFFF;
+	RMuint32 i;
+
+	for (i = 0; i < size; i++) {
+		crc = (crc << 8) ^ pDemux->crc_table[((crc >> 24) ^ data[i]) & 0xFF];
+	}
+	return crc;
+}
+
+static inline RMuint32 read_be32(const RMuint8 *p)
+{
+	return (((RMuint32) p[0]) << 24) | (((RMuint32) p[1]) << 16) | (((RMuint32) p[2]) << 8) | p[3];
+}
+
+static RMuint64 read_timestamp(const RMuint8 *p)
+{
+	return ((((RMuint64) p[0]) >> 1) & 0x07) << 30
+		| ((RMuint64) p[1]) << 22
+		| (((RMuint64) p[2]) >> 1) << 15
+		| ((RMuint64) p[3]) << 7
+		| (((RMuint64) p[4]) >> 1);
+}
+
+/**
+ * Check whether the data is a transport stream.
+ *
+ * @param packet_size Returns 188 or 192 when the data is a transport stream.
+ */
+RMbool TSDemuxProbe(const RMuint8 *data, RMuint32 size, RMuint32 *packet_size)
+{
+	RMuint32 i;
+
+	for (i = 0; (i + 2 * M2TS_PACKET_SIZE) < size && i < TS_PACKET_SIZE; i++) {
+		if (data[i] != TS_SYNC_BYTE) {
+			continue;
+		}
+		if ((data[i + TS_PACKET_SIZE] == TS_SYNC_BYTE) && (data[i + 2 * TS_PACKET_SIZE] == TS_SYNC_BYTE)) {
+			if (packet_size != NULL) {
+				*packet_size = TS_PACKET_SIZE;
+			}
+			return TRUE;
+		}
+		if ((data[i + M2TS_PACKET_SIZE] == TS_SYNC_BYTE) && (data[i + 2 * M2TS_PACKET_SIZE] == TS_SYNC_BYTE)) {
+			if (packet_size != NULL) {
+				*packet_size = M2TS_PACKET_SIZE;
+			}
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+RMstatus TSDemuxOpen(struct TSDemux **ppDemux)
+{
+	struct TSDemux *pDemux;
+
+	if (ppDemux == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	pDemux = malloc(sizeof(*pDemux));
+	if (pDemux == NULL) {
+		fprintf(stderr, "Error: out of memory\n");
+
+		return RM_FATALOUTOFMEMORY;
+	}
+	memset(pDemux, 0, sizeof(*pDemux));
+	init_crc_table(pDemux);
+
+	pDemux->sections[0].pid = TS_PID_PAT;
+	pDemux->sections[0].version = -1;
+	pDemux->section_count = 1;
+	pDemux->pid_map[TS_PID_PAT] = PID_MAP_PSI | 0;
+
+	*ppDemux = pDemux;
+	return RM_OK;
+}
+
+/** Close the demuxer, buffers which are not sent yet are given back to the pools. */
+RMstatus TSDemuxClose(struct TSDemux *pDemux)
+{
+	RMuint32 i;
+
+	if (pDemux == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	for (i = 0; i < TSDEMUX_MAX_STREAMS; i++) {
+		struct TSDemuxStream *stream = &pDemux->streams[i];
+
+		if (stream->used && (stream->buffer != NULL)) {
+			RUAReleaseBuffer(stream->output.pPool, stream->buffer);
+			stream->buffer = NULL;
+		}
+	}
+	free(pDemux);
+	return RM_OK;
+}
+
+RMstatus TSDemuxSetCallbacks(struct TSDemux *pDemux, TSDemuxProgramFunc *program, TSDemuxPCRFunc *pcr, void *opaque)
+{
+	if (pDemux == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	pDemux->program_func = program;
+	pDemux->pcr_func = pcr;
+	pDemux->opaque = opaque;
+	return RM_OK;
+}
+
+/** Report the time stamps of the PES headers, the opaque of TSDemuxSetCallbacks() is passed. */
+RMstatus TSDemuxSetPESCallback(struct TSDemux *pDemux, TSDemuxPESFunc *pes)
+{
+	if (pDemux == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	pDemux->pes_func = pes;
+	return RM_OK;
+}
+
+/** Send the payload of pid to a decoder. */
+RMstatus TSDemuxAddStream(struct TSDemux *pDemux, RMuint32 pid, struct TSDemuxOutput *output)
+{
+	struct TSDemuxStream *stream;
+	RMuint32 i;
+
+	if ((pDemux == NULL) || (output == NULL) || (output->pRua == NULL) || (output->pPool == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if ((pid >= TS_PID_NULL) || (output->BufferSize < TS_PACKET_SIZE)) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+	if (pDemux->pid_map[pid] != PID_MAP_NONE) {
+		return RM_INVALIDMODE;
+	}
+	for (i = 0; i < TSDEMUX_MAX_STREAMS; i++) {
+		if (!pDemux->streams[i].used) {
+			break;
+		}
+	}
+	if (i >= TSDEMUX_MAX_STREAMS) {
+		return RM_FATALOUTOFMEMORY;
+	}
+	stream = &pDemux->streams[i];
+	memset(stream, 0, sizeof(*stream));
+	stream->used = TRUE;
+	stream->pid = pid;
+	stream->output = *output;
+	pDemux->pid_map[pid] = i + 1;
+	return RM_OK;
+}
+
+RMstatus TSDemuxRemoveStream(struct TSDemux *pDemux, RMuint32 pid)
+{
+	struct TSDemuxStream *stream;
+	RMuint8 entry;
+
+	if (pDemux == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	if (pid >= TS_PID_COUNT) {
+		return RM_PARAMETER_OUT_OF_RANGE;
+	}
+	entry = pDemux->pid_map[pid];
+	if ((entry == PID_MAP_NONE) || (entry & PID_MAP_PSI)) {
+		return RM_NOT_FOUND;
+	}
+	stream = &pDemux->streams[entry - 1];
+	if (stream->buffer != NULL) {
+		RUAReleaseBuffer(stream->output.pPool, stream->buffer);
+		stream->buffer = NULL;
+	}
+	stream->used = FALSE;
+	pDemux->pid_map[pid] = PID_MAP_NONE;
+	return RM_OK;
+}
+
+static void handle_pat(struct TSDemux *pDemux, const RMuint8 *data, RMuint32 size)
+{
+	RMuint32 pos;
+
+	/* Forget the old PMTs, the PAT is always slot 0. */
+	for (pos = 1; pos < pDemux->section_count; pos++) {
+		if (pDemux->pid_map[pDemux->sections[pos].pid] & PID_MAP_PSI) {
+			pDemux->pid_map[pDemux->sections[pos].pid] = PID_MAP_NONE;
+		}
+	}
+	pDemux->section_count = 1;
+
+	for (pos = 8; (pos + 4) <= (size - 4); pos += 4) {
+		RMuint32 program_number = (data[pos] << 8) | data[pos + 1];
+		RMuint32 pid = ((data[pos + 2] & 0x1F) << 8) | data[pos + 3];
+		struct TSDemuxSection *section;
+
+		if (program_number == 0) {
+			/* Network information table. */
+			continue;
+		}
+		if (pDemux->section_count > TSDEMUX_MAX_PROGRAMS) {
+			break;
+		}
+		if (pDemux->pid_map[pid] != PID_MAP_NONE) {
+			/* PID is already used by a stream. */
+			continue;
+		}
+		section = &pDemux->sections[pDemux->section_count];
+		memset(section, 0, sizeof(*section));
+		section->pid = pid;
+		section->version = -1;
+		pDemux->pid_map[pid] = PID_MAP_PSI | pDemux->section_count;
+		pDemux->section_count++;
+		DPRINTF("Program %u PMT PID 0x%04x\n", program_number, pid);
+	}
+}
+
+static void handle_pmt(struct TSDemux *pDemux, struct TSDemuxSection *section, const RMuint8 *data, RMuint32 size)
+{
+	struct TSDemuxProgram program;
+	RMuint32 program_info_length;
+	RMuint32 pos;
+
+	if (size < 16) {
+		return;
+	}
+	memset(&program, 0, sizeof(program));
+	program.ProgramNumber = (data[3] << 8) | data[4];
+	program.PmtPID = section->pid;
+	program.PcrPID = ((data[8] & 0x1F) << 8) | data[9];
+	program_info_length = ((data[10] & 0x0F) << 8) | data[11];
+
+	pos = 12 + program_info_length;
+	while (((pos + 5) <= (size - 4)) && (program.StreamCount < TSDEMUX_MAX_PROGRAM_STREAMS)) {
+		struct TSDemuxStreamInfo *info = &program.Streams[program.StreamCount];
+		RMuint32 es_info_length;
+
+		info->StreamType = data[pos];
+		info->PID = ((data[pos + 1] & 0x1F) << 8) | data[pos + 2];
+		es_info_length = ((data[pos + 3] & 0x0F) << 8) | data[pos + 4];
+		program.StreamCount++;
+		pos += 5 + es_info_length;
+	}
+	DPRINTF("Program %u with %u streams\n", program.ProgramNumber, program.StreamCount);
+
+	if (pDemux->program_func != NULL) {
+		pDemux->program_func(pDemux->opaque, &program);
+	}
+}
+
+static void handle_section(struct TSDemux *pDemux, struct TSDemuxSection *section)
+{
+	RMuint8 *data = section->data;
+	RMuint32 size = section->size;
+	RMint32 version;
+
+	if ((size < 12) || !(data[1] & 0x80)) {
+		/* Only long sections are used for PAT and PMT. */
+		return;
+	}
+	if (crc32_mpeg(pDemux, data, size) != 0) {
+		DPRINTF("CRC error in section of PID 0x%04x\n", section->pid);
+		return;
+	}
+	if (!(data[5] & 0x01)) {
+		/* Not yet valid (current_next_indicator). */
+		return;
+	}
+	version = (data[5] >> 1) & 0x1F;
+	if (version == section->version) {
+		return;
+	}
+
+	if ((section->pid == TS_PID_PAT) && (data[0] == PSI_TABLE_PAT)) {
+		section->version = version;
+		handle_pat(pDemux, data, size);
+	} else if (data[0] == PSI_TABLE_PMT) {
+		section->version = version;
+		handle_pmt(pDemux, section, data, size);
+	}
+}
+
+/** Add payload to a section, complete sections are handled. */
+static void append_section(struct TSDemux *pDemux, RMuint32 slot, const RMuint8 *data, RMuint32 size)
+{
+	struct TSDemuxSection *section = &pDemux->sections[slot];
+
+	while ((size > 0) && section->started) {
+		RMuint32 needed;
+		RMuint32 len;
+
+		if (section->size < 3) {
+			needed = 3;
+		} else {
+			needed = 3 + (((section->data[1] & 0x0F) << 8) | section->data[2]);
+			if (needed > PSI_MAX_SECTION_SIZE) {
+				section->started = FALSE;
+				return;
+			}
+		}
+		len = needed - section->size;
+		if (len > size) {
+			len = size;
+		}
+		memcpy(&section->data[section->size], data, len);
+		section->size += len;
+		data += len;
+		size -= len;
+
+		if ((section->size >= 3) && (section->size == (3 + (RMuint32) (((section->data[1] & 0x0F) << 8) | section->data[2])))) {
+			handle_section(pDemux, section);
+			if (slot >= pDemux->section_count) {
+				/* The PAT removed this PMT. */
+				return;
+			}
+			/* Another section can follow, 0xFF is stuffing. */
+			section->size = 0;
+			if ((size == 0) || (data[0] == 0xFF)) {
+				section->started = FALSE;
+			}
+		}
+	}
+}
+
+static void handle_psi(struct TSDemux *pDemux, RMuint32 slot, RMbool pusi, const RMuint8 *payload, RMuint32 size)
+{
+	struct TSDemuxSection *section = &pDemux->sections[slot];
+	RMuint32 pointer;
+
+	if (!pusi) {
+		append_section(pDemux, slot, payload, size);
+		return;
+	}
+	if (size < 1) {
+		return;
+	}
+	pointer = payload[0];
+	if ((pointer + 1) > size) {
+		section->started = FALSE;
+		return;
+	}
+	/* End of the previous section. */
+	append_section(pDemux, slot, &payload[1], pointer);
+	if (slot >= pDemux->section_count) {
+		return;
+	}
+	section->started = TRUE;
+	section->size = 0;
+	append_section(pDemux, slot, &payload[1 + pointer], size - 1 - pointer);
+}
+
+/** Send the filled DMA buffer of a stream to the decoder. */
+static RMstatus send_buffer(struct TSDemuxStream *stream)
+{
+	struct emhwlib_info info;
+	RMstatus rv;
+
+	if ((stream->buffer == NULL) || (stream->pos == 0)) {
+		return RM_OK;
+	}
+	memset(&info, 0, sizeof(info));
+	if (stream->pts_valid) {
+		info.ValidFields = TIME_STAMP_INFO;
+		info.TimeStamp = stream->pts;
+	}
+	rv = RUASendData(stream->output.pRua, stream->output.ModuleID, stream->output.pPool, stream->buffer, stream->pos, &info, sizeof(info));
+	if (rv != RM_OK) {
+		return rv;
+	}
+	do {
+		rv = RUAReleaseBuffer(stream->output.pPool, stream->buffer);
+	} while (rv == RM_PENDING);
+	stream->buffer = NULL;
+	stream->pos = 0;
+	stream->pts_valid = FALSE;
+	return rv;
+}
+
+/** Make sure there is a DMA buffer with space for size bytes. */
+static RMstatus reserve_buffer(struct TSDemuxStream *stream, RMuint32 size)
+{
+	RMstatus rv;
+
+	if ((stream->buffer != NULL) && ((stream->pos + size) > stream->output.BufferSize)) {
+		rv = send_buffer(stream);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+	if (stream->buffer == NULL) {
+		rv = RUAGetBuffer(stream->output.pPool, &stream->buffer, BUFFER_TIMEOUT_US);
+		if (rv != RM_OK) {
+			stream->buffer = NULL;
+			return rv;
+		}
+		stream->pos = 0;
+		stream->pts_valid = FALSE;
+	}
+	return RM_OK;
+}
+
+/** Parse the PES header in stream->header, returns the header size or 0 if more data is needed. */
+static RMuint32 parse_pes_header(struct TSDemux *pDemux, struct TSDemuxStream *stream)
+{
+	RMuint8 *h = stream->header;
+	RMuint32 header_size;
+	struct TSDemuxPESInfo info;
+
+	if (stream->header_size < PES_FIXED_HEADER_SIZE) {
+		return 0;
+	}
+	if ((h[0] != 0x00) || (h[1] != 0x00) || (h[2] != 0x01)) {
+		return PES_FIXED_HEADER_SIZE;
+	}
+	header_size = PES_FIXED_HEADER_SIZE + h[8];
+	if (stream->header_size < header_size) {
+		return 0;
+	}
+	memset(&info, 0, sizeof(info));
+	info.PID = stream->pid;
+	if ((h[7] & 0x80) && (header_size >= 14)) {
+		stream->pts = read_timestamp(&h[9]);
+		stream->pts_valid = TRUE;
+		info.PTSValid = TRUE;
+		info.PTS = stream->pts;
+		if (((h[7] & 0xC0) == 0xC0) && (header_size >= 19)) {
+			/* Only the PTS is sent to the decoder, it reorders the frames itself. */
+			info.DTSValid = TRUE;
+			info.DTS = read_timestamp(&h[14]);
+		}
+	}
+	if (info.PTSValid && (pDemux->pes_func != NULL)) {
+		pDemux->pes_func(pDemux->opaque, &info);
+	}
+	return header_size;
+}
+
+static RMstatus handle_pes(struct TSDemux *pDemux, struct TSDemuxStream *stream, RMbool pusi, const RMuint8 *payload, RMuint32 size)
+{
+	RMstatus rv;
+
+	if (pusi) {
+		/* A buffer starts with the PES, so that the PTS belongs to it. */
+		rv = send_buffer(stream);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		rv = reserve_buffer(stream, size);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		stream->in_header = TRUE;
+		stream->header_size = 0;
+	} else if (!stream->in_header) {
+		rv = reserve_buffer(stream, size);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+
+	if (stream->in_header) {
+		RMuint32 len = size;
+		RMuint32 previous = stream->header_size;
+		RMuint32 header_size;
+
+		if (len > (PES_MAX_HEADER_SIZE - previous)) {
+			len = PES_MAX_HEADER_SIZE - previous;
+		}
+		memcpy(&stream->header[previous], payload, len);
+		stream->header_size += len;
+		header_size = parse_pes_header(pDemux, stream);
+		if (header_size == 0) {
+			return RM_OK;
+		}
+		stream->in_header = FALSE;
+		payload += header_size - previous;
+		size -= header_size - previous;
+		if (stream->buffer == NULL) {
+			/* Header was split, the buffer is needed now. */
+			rv = reserve_buffer(stream, size);
+			if (rv != RM_OK) {
+				return rv;
+			}
+		}
+	}
+
+	memcpy(&stream->buffer[stream->pos], payload, size);
+	stream->pos += size;
+	return RM_OK;
+}
+
+/** Handle one packet, RM_PENDING when a decoder has no free buffer. */
+static RMstatus handle_packet(struct TSDemux *pDemux, const RMuint8 *packet)
+{
+	RMuint32 header = read_be32(packet);
+	RMuint32 pid = (header >> 8) & 0x1FFF;
+	RMuint8 entry = pDemux->pid_map[pid];
+	RMbool pusi = (header & 0x00400000) ? TRUE : FALSE;
+	RMuint32 afc = (header >> 4) & 0x3;
+	RMuint32 pos = 4;
+
+	if ((header & 0x00800000) || ((header >> 24) != TS_SYNC_BYTE)) {
+		/* Transport error indicator. */
+		return RM_OK;
+	}
+	if ((entry == PID_MAP_NONE) && (pDemux->pcr_func == NULL)) {
+		return RM_OK;
+	}
+
+	if (afc & 0x2) {
+		RMuint32 length = packet[4];
+
+		if ((length > 0) && (packet[5] & 0x10) && (length >= 7) && (pDemux->pcr_func != NULL)) {
+			RMuint64 base = (((RMuint64) read_be32(&packet[6])) << 1) | (packet[10] >> 7);
+			RMuint32 ext = ((packet[10] & 0x01) << 8) | packet[11];
+
+			pDemux->pcr_func(pDemux->opaque, pid, base * 300 + ext);
+		}
+		pos += 1 + length;
+	}
+	if (!(afc & 0x1) || (pos >= TS_PACKET_SIZE) || (entry == PID_MAP_NONE)) {
+		return RM_OK;
+	}
+
+	if (entry & PID_MAP_PSI) {
+		handle_psi(pDemux, entry & PID_MAP_INDEX_MASK, pusi, &packet[pos], TS_PACKET_SIZE - pos);
+		return RM_OK;
+	} else {
+		struct TSDemuxStream *stream = &pDemux->streams[entry - 1];
+		RMuint8 continuity = header & 0xF;
+		RMstatus rv;
+
+		if (!pusi && !stream->continuity_valid) {
+			/* Wait for the start of a PES packet. */
+			return RM_OK;
+		}
+		if (stream->continuity_valid && (continuity == stream->continuity)) {
+			/* Duplicate packet. */
+			return RM_OK;
+		}
+		if (!pusi && stream->continuity_valid && (continuity != ((stream->continuity + 1) & 0xF))) {
+			DPRINTF("Continuity error on PID 0x%04x\n", pid);
+		}
+		rv = handle_pes(pDemux, stream, pusi, &packet[pos], TS_PACKET_SIZE - pos);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		stream->continuity = continuity;
+		stream->continuity_valid = TRUE;
+		return RM_OK;
+	}
+}
+
+/** Find the next packet start after a lost sync, returns size if none was found. */
+static RMuint32 resync(struct TSDemux *pDemux, const RMuint8 *data, RMuint32 size, RMuint32 pos)
+{
+	while ((pos + pDemux->header_offset) < size) {
+		const RMuint8 *p = memchr(&data[pos + pDemux->header_offset], TS_SYNC_BYTE, size - pos - pDemux->header_offset);
+		RMuint32 candidate;
+
+		if (p == NULL) {
+			return size;
+		}
+		candidate = (p - data) - pDemux->header_offset;
+		if ((candidate + pDemux->packet_size + pDemux->header_offset) >= size) {
+			/* Can't confirm, handle it as packet start. */
+			return candidate;
+		}
+		if (data[candidate + pDemux->packet_size + pDemux->header_offset] == TS_SYNC_BYTE) {
+			return candidate;
+		}
+		pos = candidate + 1;
+	}
+	return size;
+}
+
+/**
+ * Demux data from a transport stream.
+ *
+ * @param consumed Number of bytes used, the rest must be passed again.
+ * @retval RM_PENDING A decoder has no free buffer, try again later.
+ * @retval RM_INSUFFICIENT_SIZE Less than TSDEMUX_PROBE_SIZE for the first call.
+ */
+RMstatus TSDemuxFeed(struct TSDemux *pDemux, const RMuint8 *data, RMuint32 size, RMuint32 *consumed)
+{
+	RMuint32 pos = 0;
+	RMstatus rv;
+
+	if ((pDemux == NULL) || (data == NULL) || (consumed == NULL)) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	*consumed = 0;
+
+	if (pDemux->packet_size == 0) {
+		if (size < TSDEMUX_PROBE_SIZE) {
+			return RM_INSUFFICIENT_SIZE;
+		}
+		if (!TSDemuxProbe(data, size, &pDemux->packet_size)) {
+			fprintf(stderr, "Error: Data is not a transport stream.\n");
+			return RM_ERROR;
+		}
+		pDemux->header_offset = pDemux->packet_size - TS_PACKET_SIZE;
+	}
+
+	if (pDemux->carry_size > 0) {
+		RMuint32 len = pDemux->packet_size - pDemux->carry_size;
+
+		if (len > size) {
+			len = size;
+		}
+		memcpy(&pDemux->carry[pDemux->carry_size], data, len);
+		pDemux->carry_size += len;
+		pos = len;
+		*consumed = pos;
+		if (pDemux->carry_size < pDemux->packet_size) {
+			return RM_OK;
+		}
+		rv = handle_packet(pDemux, &pDemux->carry[pDemux->header_offset]);
+		if (rv != RM_OK) {
+			/* The carried packet is handled again in the next call. */
+			return rv;
+		}
+		pDemux->carry_size = 0;
+	}
+
+	while ((pos + pDemux->packet_size) <= size) {
+		if (data[pos + pDemux->header_offset] != TS_SYNC_BYTE) {
+			pos = resync(pDemux, data, size, pos);
+			*consumed = pos;
+			continue;
+		}
+		rv = handle_packet(pDemux, &data[pos + pDemux->header_offset]);
+		if (rv != RM_OK) {
+			return rv;
+		}
+		pos += pDemux->packet_size;
+		*consumed = pos;
+	}
+
+	if (pos < size) {
+		/* A broken packet is dropped by handle_packet(). */
+		memcpy(pDemux->carry, &data[pos], size - pos);
+		pDemux->carry_size = size - pos;
+		*consumed = size;
+	}
+	return RM_OK;
+}
+
+/**
+ * Send the data which is still in the DMA buffers, e.g. at the end of the
+ * stream.
+ *
+ * @retval RM_PENDING A decoder has no free buffer, try again later.
+ */
+RMstatus TSDemuxFlush(struct TSDemux *pDemux)
+{
+	RMuint32 i;
+	RMstatus rv;
+
+	if (pDemux == NULL) {
+		return RM_FATALINVALIDPOINTER;
+	}
+	for (i = 0; i < TSDEMUX_MAX_STREAMS; i++) {
+		struct TSDemuxStream *stream = &pDemux->streams[i];
+
+		if (!stream->used) {
+			continue;
+		}
+		rv = send_buffer(stream);
+		if (rv != RM_OK) {
+			return rv;
+		}
+	}
+	return RM_OK;
+}
@@ -10,6 +10,8 @@
  * of the License, or (at your option) any later version.
  */
 
+#define _GNU_SOURCE
+
 #include <sys/mman.h>
 
 #include <stdio.h>
@@ -20,14 +22,15 @@
 #include <signal.h>
 #include <limits.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <getopt.h>
-
-#include <libavutil/timestamp.h>
-#include <libavformat/avformat.h>
+#include <time.h>
 
 #include <rua.h>
 #include <dcc.h>
 #include <rcc.h>
+#include <mp4.h>
+#include <streamio.h>
 
 /** Define to play audio also. */
 #define PLAY_AUDIO
@@ -64,6 +67,34 @@
 #define MIN_BUFFER_TIME (10 * VIDEO_TIME_RES)
 #define REBUFFER_TIME (1 * VIDEO_TIME_RES)
 #define JUMP_TIME 60
+/** Speed of trick play when it is started. */
+#define TRICK_MIN_SPEED 8
+/** Maximum speed of trick play. */
+#define TRICK_MAX_SPEED 64
+/** How often the STC clock reads the hardware STC. */
+#define STC_RESYNC_INTERVAL_MS 100
+/** Maximum error of the interpolated STC (10 ms). */
+#define STC_MAX_DRIFT (VIDEO_TIME_RES / 100)
+/** Size of the video bitstream FIFO. */
+#define VIDEO_FIFO_SIZE (8 * 1024 * 1024)
+/** Stop feeding when the video FIFO is fuller than this. */
+#define VIDEO_FIFO_HIGH_LEVEL (VIDEO_FIFO_SIZE / 8 * 7)
+/** Continue feeding when the video FIFO dropped below this. */
+#define VIDEO_FIFO_LOW_LEVEL (VIDEO_FIFO_SIZE / 2)
+/** Only rebuffer when the video FIFO is really running empty. */
+#define VIDEO_FIFO_REBUFFER_LEVEL (VIDEO_FIFO_SIZE / 32)
+/** Maximum time to sleep on the video FIFO before checking the remote control. */
+#define VIDEO_FIFO_WAIT_US 100000
+/** Minimum time between two queries of the decoder FIFO levels. */
+#define FIFO_LEVEL_INTERVAL_US 20000
+/** Number of samples which are looked up ahead per stream. */
+#define SAMPLE_QUEUE_SIZE 64
+/** Size of the reads done by the input thread. */
+#define INPUT_BUFFER_SIZE (256 * 1024)
+/** How much of the input is read ahead by default. */
+#define READ_AHEAD_SIZE (8 * 1024 * 1024)
+/** Default number of HTTP connections. */
+#define HTTP_CONNECTIONS 2
 
 typedef struct {
 	int64_t max_buffer_time;
@@ -72,13 +103,32 @@ typedef struct {
 	int start_minute;
 	int start_second;
 	int jump_time;
+	/** Bytes of http input which are read ahead by the input thread. */
+	RMuint32 read_ahead_size;
+	/** Connections which fetch ranges of http URLs in parallel. */
+	RMuint32 http_connections;
 } play_config_t;
 
+typedef struct {
+	struct MP4Sample sample;
+	/** Data of http input, read in file order. NULL when the data is read into the DMA buffers. */
+	RMuint8 *data;
+} queued_sample_t;
+
+/** Samples of one stream which are looked up, but not yet sent. */
+typedef struct {
+	queued_sample_t entry[SAMPLE_QUEUE_SIZE];
+	unsigned int first;
+	unsigned int count;
+} sample_queue_t;
+
 typedef struct {
 	struct RUA *pRUA;
 	struct DCC *pDCC;
 	struct RUABufferPool *pDMA;
 	struct DCCSTCSource *pStcSource;
+	/** Interpolated STC used for buffering decisions. */
+	struct DCCSTCClock *pStcClock;
 	struct DCCVideoSource *pVideoSource;
 #ifdef PLAY_AUDIO
 	struct DCCAudioSource *pAudioSource;
@@ -87,12 +137,37 @@ typedef struct {
 	RMuint32 video_decoder;
 	RMuint32 spu_decoder;
 	RMuint32 video_timer;
-	RMuint8 *videobuffer;
+	/** Packs video access units with their PTS into the DMA buffers. */
+	struct DCCPacketizer *pVideoPacketizer;
 	RMuint32 videotransferred;
 #ifdef PLAY_AUDIO
 	RMuint32 audio_decoder;
-	RMuint8 *audiobuffer;
+	/** Packs several AAC frames with ADTS header into each DMA buffer. */
+	struct DCCPacketizer *pAudioPacketizer;
+	/** Track of the played audio stream, -1 if none. */
+	int audio_index;
+	RMuint32 audio_timescale;
+	struct MP4AACConfig aac_config;
+	sample_queue_t audio_queue;
+#endif
+	/** Track of the played video stream, -1 if none. */
+	int video_index;
+	RMuint32 video_timescale;
+	/** Samples are sent by need of the decoder FIFOs, not in file order. */
+	sample_queue_t video_queue;
+	/** Decoder FIFO levels, queried at most every FIFO_LEVEL_INTERVAL_US. */
+	struct DCCFIFOLevel video_level;
+#ifdef PLAY_AUDIO
+	struct DCCFIFOLevel audio_level;
 #endif
+	RMuint64 fifo_level_us;
+	RMbool fifo_level_valid;
+	/** Result of MP4NextSample() which stopped reading. */
+	RMstatus read_result;
+	/** Sample tables of the input, the sample data is read into the DMA buffers. */
+	struct MP4Reader *pReader;
+	/** http input is read by a separate thread, the reader only reads from memory. */
+	struct StreamIO *pInput;
 	RMuint32 audio_engine;
 	RMuint32 audio_timer;
 	/** True when video engine plays video. */
@@ -119,14 +194,32 @@ typedef struct {
 	int64_t startplaypts;
 	/** True when the player should jump to some position. */
 	int jump;
-	/** Time base of video. */
-	AVRational time_base;
+	/** True when a jump was requested by the remote control. */
+	volatile int jump_request;
 
 	/** PTS of first video frame. */
 	int64_t startpts;
 	/** Found first video frame which should be played after jump. */
 	int started;
 
+	/** Key frames of the video, used for jumps and trick play. */
+	struct DCCSeekIndex *pSeekIndex;
+
+	/* Trick play */
+	struct DCCTrickPlay *pTrick;
+	/** Requested trick play speed, 0 for normal playback. */
+	volatile int trick_speed;
+	/** True when trick_speed was changed by the remote control. */
+	volatile int trick_request;
+	/** True while the video decoder is in I-frame mode. */
+	int trick_active;
+	uint8_t *trick_buffer;
+	RMuint32 trick_buffer_size;
+
+	/** SPS and PPS of the video stream for conversion to byte stream format. */
+	struct MP4AVCConfig avc_config;
+	RMbool avc_config_valid;
+
 	/* Configuration parameters. */
 	play_config_t cfg;
 } app_rua_context_t;
@@ -143,6 +236,17 @@ static void cleanup(app_rua_context_t *context)
 		return;
 	}
 
+	if (context->pVideoPacketizer != NULL) {
+		DCCClosePacketizer(context->pVideoPacketizer);
+		context->pVideoPacketizer = NULL;
+	}
+#ifdef PLAY_AUDIO
+	if (context->pAudioPacketizer != NULL) {
+		DCCClosePacketizer(context->pAudioPacketizer);
+		context->pAudioPacketizer = NULL;
+	}
+#endif
+
 	if (context->pDMA != NULL) {
 		rv = RUAClosePool(context->pDMA);
 		if (RMFAILED(rv)) {
@@ -169,6 +273,14 @@ static void cleanup(app_rua_context_t *context)
 		context->pVideoSource = NULL;
 	}
 
+	if (context->pStcClock != NULL) {
+		rv = DCCSTCClockClose(context->pStcClock);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot close STC clock, rv = %d\n", rv); 
+		}
+		context->pStcClock = NULL;
+	}
+
 	if (context->pStcSource != NULL) {
 		rv = DCCSTCClose(context->pStcSource);
 		if (RMFAILED(rv)) {
@@ -228,7 +340,35 @@ static unsigned int get_key(app_rua_context_t *context, int usec)
 				context->stopped = 1;
 				break;
 
+			case RC_NEXT:
+				if (context->play_started) {
+					if (context->trick_speed <= 0) {
+						context->trick_speed = TRICK_MIN_SPEED;
+					} else if (context->trick_speed < TRICK_MAX_SPEED) {
+						context->trick_speed *= 2;
+					}
+					context->trick_request = 1;
+				}
+				break;
+
+			case RC_PREV:
+				if (context->play_started) {
+					if (context->trick_speed >= 0) {
+						context->trick_speed = -TRICK_MIN_SPEED;
+					} else if (context->trick_speed > -TRICK_MAX_SPEED) {
+						context->trick_speed *= 2;
+					}
+					context->trick_request = 1;
+				}
+				break;
+
 			case RC_OK:
+				if (context->trick_speed != 0) {
+					/* Continue normal playback at the shown frame. */
+					context->trick_speed = 0;
+					context->trick_request = 1;
+					break;
+				}
 				if (context->paused) {
 					context->paused = 0;
 					if (context->playing) {
@@ -286,17 +426,7 @@ static unsigned int get_key(app_rua_context_t *context, int usec)
 
 			case RC_UP:
 				if (context->playing) {
-					context->startplaypts =
-						context->time +
-						context->cfg.jump_time *
-						context->time_base.den/
-						context->time_base.num;
-					printf("Set startplaypts %s (%s) buffer until %s (%s)\n",
-						av_ts2timestr(context->startplaypts, &context->time_base),
-						av_ts2str(context->startplaypts),
-						av_ts2timestr(context->last_time, &context->time_base),
-						av_ts2str(context->last_time));
-					context->jump = 1;
+					context->jump_request = 1;
 				}
 				break;
 
@@ -402,9 +532,16 @@ static RMstatus configure_video(app_rua_context_t *context)
 		cleanup(context);
 		return rv;
 	}
+
+	rv = DCCSTCClockOpen(context->pStcSource, VIDEO_TIME_RES, STC_RESYNC_INTERVAL_MS, STC_MAX_DRIFT, &context->pStcClock);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot open STC clock, rv = %d\n", rv);
+		cleanup(context);
+		return rv;
+	}
 	memset(&video_profile, 0, sizeof(video_profile));
 
-	video_profile.BitstreamFIFOSize = 8 * 1024 * 1024;
+	video_profile.BitstreamFIFOSize = VIDEO_FIFO_SIZE;
 	video_profile.XferFIFOCount = 1024;
 	video_profile.MpegEngineID = DEFAULT_DRAM_CONTROLLER;
 	video_profile.VideoDecoderID = 0;
@@ -503,61 +640,54 @@ static RMstatus configure_video(app_rua_context_t *context)
 	return RM_OK;
 }
 
-static RMstatus transfer_data(app_rua_context_t *context, RMuint8 *data, RMuint32 datasize, RMuint32 decoder, RMuint8 **pbuffer, RMuint32 *bufpos)
+static RMstatus transfer_data(app_rua_context_t *context, struct DCCPacketizer *pPacketizer, RMuint8 *data, RMuint32 datasize, RMuint32 *bufpos)
 {
 	RMstatus rv;
-	struct emhwlib_info video_info;
-	RMuint32 size;
-
-	size = datasize - *bufpos;
-	if (size > DMA_BUFFER_SIZE) {
-		size = DMA_BUFFER_SIZE;
-	}
-
-	if (*pbuffer == NULL) {
-		rv = RUAGetBuffer(context->pDMA, pbuffer, 0);
-		if (RMFAILED(rv)) {
-			*pbuffer = NULL;
-			DPRINTF("Cannot get buffer, rv = %d\n", rv);
-			if (rv != RM_PENDING) {
-				fprintf(stderr, "Cannot get buffer, rv = %d\n", rv);
-				cleanup(context);
-			}
-			return rv;
-		}
-		memcpy(*pbuffer, &data[*bufpos], size);
-	}
+	RMuint32 written = 0;
 
-	memset(&video_info, 0, sizeof(video_info));
-	DPRINTF("RUASendData(%p, (%u, %u), %p, %p, %u, %p, %u)\n", context->pRUA, (decoder >> 16) & 0xFF, decoder & 0xFF, context->pDMA, *pbuffer, size, &video_info, sizeof(video_info));
-	rv = RUASendData(context->pRUA, decoder, context->pDMA, *pbuffer, size, &video_info, sizeof(video_info));
-	DPRINTF("RUASendData rv = %d\n", rv);
+	rv = DCCPacketizerWrite(pPacketizer, &data[*bufpos], datasize - *bufpos, &written);
+	*bufpos += written;
 	if (RMFAILED(rv)) {
 		if (rv != RM_PENDING) {
-			fprintf(stderr, "Cannot send buffer %p, rv = %d\n", *pbuffer, rv);
+			fprintf(stderr, "Cannot send data, rv = %d\n", rv);
 			cleanup(context);
 		}
 		return rv;
 	}
-	/* printf("video_info.ValidFields %lu\n", video_info.ValidFields); */
+	*bufpos = 0;
+	return RM_OK;
+}
 
-	do {
-		rv = RUAReleaseBuffer(context->pDMA, *pbuffer);
-	} while(rv == RM_PENDING);
-	if (RMFAILED(rv)) {
-		fprintf(stderr, "Cannot release buffer %p, rv = %d\n", *pbuffer, rv);
-		cleanup(context);
-		*pbuffer = NULL; /* TBD: How to free this? */
-		return rv;
+/** Send the data which is still held by a packetizer. */
+static RMstatus flush_data(app_rua_context_t *context, struct DCCPacketizer *pPacketizer)
+{
+	RMstatus rv;
+
+	if (pPacketizer == NULL) {
+		return RM_OK;
 	}
-	*pbuffer = NULL;
-	*bufpos += size;
-	if (*bufpos == datasize) {
-		*bufpos = 0;
+	do {
+		rv = DCCPacketizerFlush(pPacketizer);
+	} while ((rv == RM_PENDING) && !context->stopped);
+	if (rv == RM_PENDING) {
 		return RM_OK;
-	} else {
-		return RM_PENDING;
 	}
+	return rv;
+}
+
+static RMstatus open_packetizer(app_rua_context_t *context, RMuint32 decoder, RMuint32 timescale, RMuint32 time_resolution, RMbool pack_units, struct DCCPacketizer **ppPacketizer)
+{
+	struct DCCPacketizerProfile profile;
+
+	memset(&profile, 0, sizeof(profile));
+	profile.ModuleID = decoder;
+	profile.pPool = context->pDMA;
+	profile.BufferSize = DMA_BUFFER_SIZE;
+	profile.TimeBaseNum = 1;
+	profile.TimeBaseDen = timescale;
+	profile.TimeResolution = time_resolution;
+	profile.PackUnits = pack_units;
+	return DCCOpenPacketizer(context->pRUA, &profile, ppPacketizer);
 }
 
 static RMstatus start_play(app_rua_context_t *context)
@@ -565,31 +695,80 @@ static RMstatus start_play(app_rua_context_t *context)
 	RMstatus rv;
 
 	printf("Start play\n");
-	rv = DCCSTCPlay(context->pStcSource);
-	if (RMFAILED(rv)) {
-		fprintf(stderr, "Cannot set play mode, rv = %d\n", rv);
-		return rv;
-	}
 	if (!context->play_started) {
-		rv = DCCPlayVideoSource(context->pVideoSource, DCCVideoPlayFwd);
+		/* Command all decoders, then start the STC as the last step. */
+#ifdef PLAY_AUDIO
+		rv = DCCPlaySynchronized(context->pStcSource, context->pVideoSource, DCCVideoPlayFwd, &context->pAudioSource, 1);
+#else
+		rv = DCCPlaySynchronized(context->pStcSource, context->pVideoSource, DCCVideoPlayFwd, NULL, 0);
+#endif
 		if (RMFAILED(rv)) {
-			fprintf(stderr, "Cannot play video source, rv = %d\n", rv);
+			fprintf(stderr, "Cannot start synchronized play, rv = %d\n", rv);
 			return rv;
 		}
-#ifdef PLAY_AUDIO
-		/* TBD: Use DCCPlayMultipleAudioSource() instead. */
-		rv = DCCPlayAudioSource(context->pAudioSource);
+	} else {
+		rv = DCCSTCPlay(context->pStcSource);
 		if (RMFAILED(rv)) {
-			fprintf(stderr, "Cannot play video source, rv = %d\n", rv);
+			fprintf(stderr, "Cannot set play mode, rv = %d\n", rv);
 			return rv;
 		}
-#endif
 	}
 	context->playing = 1;
 	context->play_started = 1;
 	return RM_OK;
 }
 
+static RMuint64 get_monotonic_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((RMuint64) ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/**
+ * Query the decoder FIFO levels. The ioctls are only done every
+ * FIFO_LEVEL_INTERVAL_US, in between the sent data is added to the
+ * cached levels.
+ */
+static RMstatus update_fifo_levels(app_rua_context_t *context)
+{
+	RMuint64 now;
+	RMstatus rv;
+
+	now = get_monotonic_us();
+	if (context->fifo_level_valid && ((now - context->fifo_level_us) < FIFO_LEVEL_INTERVAL_US)) {
+		return RM_OK;
+	}
+	rv = DCCGetVideoFIFOLevel(context->pVideoSource, VIDEO_TIME_RES, &context->video_level);
+	if (RMFAILED(rv)) {
+		return rv;
+	}
+#ifdef PLAY_AUDIO
+	if (context->audio_index >= 0) {
+		rv = DCCGetAudioFIFOLevel(context->pAudioSource, VIDEO_TIME_RES, &context->audio_level);
+		if (RMFAILED(rv)) {
+			return rv;
+		}
+	}
+#endif
+	context->fifo_level_us = now;
+	context->fifo_level_valid = TRUE;
+	return RM_OK;
+}
+
+/** Account data sent to a decoder since its FIFO level was queried. */
+static void add_fifo_level(struct DCCFIFOLevel *level, RMuint32 size)
+{
+	if (level->BitstreamFullness != 0) {
+		level->PlayTime += ((RMuint64) size) * level->PlayTime / level->BitstreamFullness;
+	}
+	level->BitstreamFullness += size;
+	if (level->BitstreamFullness > level->BitstreamSize) {
+		level->BitstreamFullness = level->BitstreamSize;
+	}
+}
+
 static int write_video_packet(void *opaque, uint8_t *buf, int buf_size)
 {
 	app_rua_context_t *context = opaque;
@@ -597,12 +776,13 @@ static int write_video_packet(void *opaque, uint8_t *buf, int buf_size)
 	RMuint32 bufpos = 0;
 
 	do {
-		rv = transfer_data(context, buf, buf_size, context->video_decoder, &context->videobuffer, &bufpos);
+		rv = transfer_data(context, context->pVideoPacketizer, buf, buf_size, &bufpos);
 	} while (rv == RM_PENDING);
 	if (rv == RM_ERROR) {
 		return -1;
 	}
 	context->videotransferred += buf_size;
+	add_fifo_level(&context->video_level, buf_size);
 #ifdef VID_PRE_BUFFER_SIZE
 	if (!context->play_started && (context->videotransferred > VID_PRE_BUFFER_SIZE)) {
 		rv = start_play(context);
@@ -616,6 +796,107 @@ static int write_video_packet(void *opaque, uint8_t *buf, int buf_size)
 	return buf_size;
 }
 
+/** Convert time from the time scale of a track into another time resolution. */
+static RMint64 rescale_time(RMint64 time, RMuint32 from, RMuint32 to)
+{
+	/* Split to avoid an overflow of time * to. */
+	return (time / from) * to + ((time % from) * to) / from;
+}
+
+/**
+ * Read the data of a sample directly into the DMA buffers of a packetizer.
+ * Data of http input was already read and is copied.
+ *
+ * @param conversion Converts H.264 samples to byte stream format, NULL for
+ *                   other samples.
+ */
+static RMstatus read_sample(app_rua_context_t *context, struct DCCPacketizer *pPacketizer, queued_sample_t *queued, struct MP4AVCConversion *conversion)
+{
+	struct MP4Sample *sample = &queued->sample;
+	RMuint32 pos = 0;
+	int printed = 0;
+	RMstatus rv;
+
+	if ((queued->data != NULL) && (conversion != NULL)) {
+		rv = MP4ConvertAVCData(&context->avc_config, conversion, queued->data, sample->Size);
+		if (RMFAILED(rv)) {
+			return rv;
+		}
+	}
+	while (pos < sample->Size) {
+		RMuint8 *buffer;
+		RMuint32 len;
+
+		rv = DCCPacketizerGetBuffer(pPacketizer, &buffer, &len);
+		if (rv == RM_PENDING) {
+			if (context->stopped) {
+				fprintf(stderr, "Buffer overrun while stopped.\n");
+				return rv;
+			}
+			if (context->paused) {
+				if (!printed) {
+					fprintf(stderr, "Buffer overrun while pausing.\n");
+					printed = 1;
+				}
+				get_key(context, 10000);
+			}
+			continue;
+		}
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot send data, rv = %d\n", rv);
+			return rv;
+		}
+		if (len > (sample->Size - pos)) {
+			len = sample->Size - pos;
+		}
+		if (queued->data != NULL) {
+			memcpy(buffer, &queued->data[pos], len);
+		} else {
+			rv = MP4Read(context->pReader, sample->Offset + pos, buffer, len);
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Cannot read sample at %llu, rv = %d\n", (unsigned long long) (sample->Offset + pos), rv);
+				return rv;
+			}
+			if (conversion != NULL) {
+				rv = MP4ConvertAVCData(&context->avc_config, conversion, buffer, len);
+				if (RMFAILED(rv)) {
+					return rv;
+				}
+			}
+		}
+		DCCPacketizerCommit(pPacketizer, len);
+		pos += len;
+	}
+	return RM_OK;
+}
+
+/** Send an H.264 sample, it is converted to byte stream format in the DMA buffers. */
+static RMstatus write_video_sample(app_rua_context_t *context, queued_sample_t *queued)
+{
+	struct MP4AVCConversion conversion;
+	RMstatus rv;
+
+	rv = MP4StartAVCConversion(&context->avc_config, queued->sample.Size, &conversion);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot convert video sample, rv = %d\n", rv);
+		return rv;
+	}
+	DCCPacketizerStartUnit(context->pVideoPacketizer, TRUE, queued->sample.PTS);
+	if (queued->sample.KeyFrame) {
+		/* SPS and PPS in front of each key frame, decoding can start at each of them. */
+		if (write_video_packet(context, context->avc_config.ParameterSets, context->avc_config.ParameterSetsSize) < 0) {
+			return RM_ERROR;
+		}
+	}
+	rv = read_sample(context, context->pVideoPacketizer, queued, &conversion);
+	if (RMFAILED(rv)) {
+		return rv;
+	}
+	context->videotransferred += queued->sample.Size;
+	add_fifo_level(&context->video_level, queued->sample.Size);
+	return RM_OK;
+}
+
 #ifdef PLAY_AUDIO
 static int write_audio_packet(void *opaque, uint8_t *buf, int buf_size)
 {
@@ -625,7 +906,7 @@ static int write_audio_packet(void *opaque, uint8_t *buf, int buf_size)
 	int printed = 0;
 
 	do {
-		rv = transfer_data(context, buf, buf_size, context->audio_decoder, &context->audiobuffer, &bufpos);
+		rv = transfer_data(context, context->pAudioPacketizer, buf, buf_size, &bufpos);
 		if (rv == RM_PENDING) {
 			if (context->stopped) {
 				fprintf(stderr, "Buffer overrun while stopped.\n");
@@ -643,284 +924,791 @@ static int write_audio_packet(void *opaque, uint8_t *buf, int buf_size)
 	if (rv == RM_ERROR) {
 		return -1;
 	}
+	add_fifo_level(&context->audio_level, buf_size);
 
 	return buf_size;
 }
-#endif
 
-#ifdef TIMEDEBUG
-static void log_packet(const AVFormatContext *fmt_ctx, const AVPacket *pkt,
-	const char *tag, const char *type)
+/** Prepare ADTS framing and the packetizer for an AAC track. */
+static RMstatus open_audio_stream(app_rua_context_t *context, RMuint32 track, struct MP4TrackInfo *info)
 {
-	AVRational *time_base = &fmt_ctx->streams[pkt->stream_index]->time_base;
+	RMstatus rv;
 
-	printf("%s:%s: pts:%llu %s pts_time:%s dts:%s dts_time:%s duration:%s duration_time:%s stream_index:%d\n",
-		tag, type, pkt->pts, av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, time_base),
-		av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, time_base),
-		av_ts2str(pkt->duration), av_ts2timestr(pkt->duration, time_base),
-		pkt->stream_index);
+	/* MPEG-4 audio and the MPEG-2 AAC profiles. */
+	if ((info->Codec != MP4_FOURCC('m', 'p', '4', 'a'))
+		|| ((info->ObjectType != 0x40) && ((info->ObjectType < 0x66) || (info->ObjectType > 0x68)))) {
+		return RM_NOT_SUPPORTED;
+	}
+	rv = MP4ParseAACConfig(info->DecoderConfig, info->DecoderConfigSize, &context->aac_config);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot get AAC configuration of audio stream, rv = %d\n", rv);
+		return rv;
+	}
+	rv = DCCSetAudioSourceBitrate(context->pAudioSource, info->Bitrate);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot set audio bitrate, rv = %d\n", rv);
+	}
+	if (context->pAudioPacketizer == NULL) {
+		rv = open_packetizer(context, context->audio_decoder, info->TimeScale, AUDIO_TIME_RES, TRUE, &context->pAudioPacketizer);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot open audio packetizer, rv = %d\n", rv);
+			return rv;
+		}
+	}
+	printf("time scale audio %u\n", info->TimeScale);
+	context->audio_index = track;
+	context->audio_timescale = info->TimeScale;
+	return RM_OK;
 }
-#endif
 
-static RMstatus check_jump(app_rua_context_t *context)
+/** Send AAC frame with ADTS header to the audio decoder. */
+static RMstatus write_aac_frame(app_rua_context_t *context, queued_sample_t *queued)
 {
+	uint8_t header[MP4_ADTS_HEADER_SIZE];
 	RMstatus rv;
 
-	if (!context->started || context->jump) {
-		if ((context->startplaypts == 0) || (context->cur_time >= (context->startplaypts - context->startpts))) {
-			printf("start_time %s %lld (%llds)\n", av_ts2timestr(context->startplaypts, &context->time_base), context->startplaypts, context->startplaypts/VIDEO_TIME_RES);
-			if (context->started) {
-				if ((context->last_time > 0)
-					&& (((uint64_t) context->last_time) > (context->time + context->cfg.min_buffer_time))) {
-					if (context->playing) {
-						if (!context->paused && !context->ending) {
-							printf("Stop play\n");
-							rv = DCCSTCStop(context->pStcSource);
-							if (RMFAILED(rv)) {
-								fprintf(stderr, "Cannot stop, rv = %d\n", rv);
-								cleanup(context);
-								return rv;
-							}
-						} else {
-							context->paused = 0;
-						}
-						context->playing = 0;
-					}
-				}
-			}
-			rv = DCCSTCSetTime(context->pStcSource, context->startplaypts, VIDEO_TIME_RES);
-			if (RMFAILED(rv)) {
-				fprintf(stderr, "Cannot set time, rv = %d\n", rv);
-			}
-			context->started = 1;
-			context->jump = 0;
-		}
+	rv = MP4MakeADTSHeader(&context->aac_config, queued->sample.Size, header);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot frame audio sample with %u bytes, rv = %d\n", queued->sample.Size, rv);
+		return rv;
+	}
+	DCCPacketizerStartUnit(context->pAudioPacketizer, TRUE, queued->sample.PTS);
+	if (write_audio_packet(context, header, sizeof(header)) < 0) {
+		return RM_ERROR;
+	}
+	rv = read_sample(context, context->pAudioPacketizer, queued, NULL);
+	if (RMFAILED(rv)) {
+		return rv;
 	}
+	add_fifo_level(&context->audio_level, queued->sample.Size);
 	return RM_OK;
 }
 
 /**
- * Play mp4 video
- *
- * @param context Context of hardware
- * @param videofile Path to video file to play.
- * @param minutes Time at which playing should start (minutes)
- * @param seconds Time at which playing should start (seconds)
- *
- * @returns Result of operation
- * @retval 0 on success
- * @retval 1 on error
+ * Check whether the video decoder needs data more urgently than the audio
+ * decoder. The play time in the FIFOs is compared, the fill level when a
+ * bitrate is not known. The cached FIFO levels are used.
  */
-static int play_mp4_video(app_rua_context_t *context, const char *videofile, int minutes, int seconds)
+static RMstatus video_needs_data(app_rua_context_t *context, RMbool *video)
 {
-	AVFormatContext *ifmt_ctx = NULL;
-	AVFormatContext *vidfmt_ctx = NULL;
-#ifdef PLAY_AUDIO
-	AVFormatContext *audfmt_ctx = NULL;
-#endif
-	AVBitStreamFilterContext *bsf = NULL;
-	AVPacket pkt;
-	int ret;
-	unsigned int i;
-	int buffersize = DMA_BUFFER_SIZE;
-	int *streamidxmap = NULL;
-	int64_t print_time;
+	struct DCCFIFOLevel *video_level = &context->video_level;
+	struct DCCFIFOLevel *audio_level = &context->audio_level;
+	RMstatus rv;
 
-	context->time_base.num = 1;
-	context->time_base.den = VIDEO_TIME_RES;
-	context->startpts = LLONG_MAX;
-	context->started = 0;
+	rv = update_fifo_levels(context);
+	if (RMFAILED(rv)) {
+		return rv;
+	}
+	if ((video_level->PlayTime != 0) && (audio_level->PlayTime != 0)) {
+		*video = (video_level->PlayTime <= audio_level->PlayTime);
+	} else {
+		*video = ((((RMuint64) video_level->BitstreamFullness) * audio_level->BitstreamSize)
+			<= (((RMuint64) audio_level->BitstreamFullness) * video_level->BitstreamSize));
+	}
+	return RM_OK;
+}
+#endif
 
-	context->last_time = -1;
+static void queue_put(sample_queue_t *queue, queued_sample_t *queued)
+{
+	queue->entry[(queue->first + queue->count) % SAMPLE_QUEUE_SIZE] = *queued;
+	queue->count++;
+}
 
-	/* Start at a specific time to play. */
-	context->startplaypts = ((minutes * 60) + seconds) * context->time_base.den/context->time_base.num;
+static void queue_get(sample_queue_t *queue, queued_sample_t *queued)
+{
+	*queued = queue->entry[queue->first];
+	queue->first = (queue->first + 1) % SAMPLE_QUEUE_SIZE;
+	queue->count--;
+}
 
-	context->videobuffer = NULL;
-	context->videotransferred = 0;
+/** Drop samples which are looked up ahead, e.g. after a jump. */
+static void queue_flush(sample_queue_t *queue)
+{
+	queued_sample_t queued;
 
-	av_register_all();
-	if ((ret = avformat_open_input(&ifmt_ctx, videofile, 0, 0)) < 0) {
-		fprintf(stderr, "Could not open input file '%s'", videofile);
-		goto end;
-	}
-	if ((ret = avformat_find_stream_info(ifmt_ctx, 0)) < 0) {
-		fprintf(stderr, "Failed to retrieve input stream information");
-		goto end;
+	while (queue->count > 0) {
+		queue_get(queue, &queued);
+		free(queued.data);
 	}
-	av_dump_format(ifmt_ctx, 0, videofile, 0);
+	queue->first = 0;
+}
 
-	avformat_alloc_output_context2(&vidfmt_ctx, NULL, "rawvideo", NULL);
-	if (!vidfmt_ctx) {
-		fprintf(stderr, "Could not create video output context\n");
-		ret = AVERROR_UNKNOWN;
-		goto end;
-	}
+static void flush_packets(app_rua_context_t *context)
+{
+	queue_flush(&context->video_queue);
 #ifdef PLAY_AUDIO
-	avformat_alloc_output_context2(&audfmt_ctx, NULL, "adts", NULL);
-	if (!audfmt_ctx) {
-		fprintf(stderr, "Could not create audio output context\n");
-		ret = AVERROR_UNKNOWN;
-		goto end;
-	}
+	queue_flush(&context->audio_queue);
 #endif
-	streamidxmap = malloc(sizeof(streamidxmap[0]) * ifmt_ctx->nb_streams);
-	if (streamidxmap == NULL) {
-		fprintf(stderr, "out of memory\n");
-		goto end;
-	}
-	for (i = 0; i < ifmt_ctx->nb_streams; i++) {
-		AVStream *in_stream = ifmt_ctx->streams[i];
-		AVStream *out_stream;
-		AVFormatContext *ofmt_ctx;
-		const char *type;
-
-		streamidxmap[i] = -1;
+	context->read_result = RM_OK;
+	context->fifo_level_valid = FALSE;
+}
 
-		if (in_stream->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-			ofmt_ctx = vidfmt_ctx;
-			type = "video";
-		} else if (in_stream->codec->codec_type == AVMEDIA_TYPE_AUDIO) {
-#ifdef PLAY_AUDIO
-			ofmt_ctx = audfmt_ctx;
-			type = "audio";
-#else
-			fprintf(stderr, "Ignoring audio streams\n");
-#endif
+/**
+ * Get the next sample to send. Samples are looked up ahead per stream and
+ * the stream whose decoder has less data buffered is served first.
+ *
+ * Local files are read when the sample is sent, the data of http input is
+ * read here in file order, so the read-ahead of the input isn't dropped.
+ *
+ * @retval RM_ERRORENDOFFILE All samples were sent.
+ */
+static RMstatus next_sample(app_rua_context_t *context, queued_sample_t *queued)
+{
+	sample_queue_t *queue = &context->video_queue;
+	RMstatus rv;
+
+	while (context->read_result == RM_OK) {
+		sample_queue_t *target;
+		RMbool empty = FALSE;
+
+		/* A full queue must be served before reading further. */
+		if (context->video_queue.count >= SAMPLE_QUEUE_SIZE) {
+			break;
+		}
+		if ((context->video_index >= 0) && (context->video_queue.count == 0)) {
+			empty = TRUE;
+		}
+#ifdef PLAY_AUDIO
+		if (context->audio_queue.count >= SAMPLE_QUEUE_SIZE) {
+			break;
+		}
+		if ((context->audio_index >= 0) && (context->audio_queue.count == 0)) {
+			empty = TRUE;
+		}
+#endif
+		if (!empty) {
+			/* Every stream has a sample to choose from. */
+			break;
+		}
+
+		context->read_result = MP4NextSample(context->pReader, &queued->sample);
+		if (context->read_result != RM_OK) {
+			break;
+		}
+		if ((int) queued->sample.Track == context->video_index) {
+			target = &context->video_queue;
+#ifdef PLAY_AUDIO
+		} else if ((int) queued->sample.Track == context->audio_index) {
+			target = &context->audio_queue;
+#endif
 		} else {
-			fprintf(stderr, "Neither video nor audio stream ignoring\n");
 			continue;
 		}
-		out_stream = avformat_new_stream(ofmt_ctx, in_stream->codec->codec);
-
-		if (!out_stream) {
-			fprintf(stderr, "Failed allocating output stream\n");
-			ret = AVERROR_UNKNOWN;
-			goto end;
+		queued->data = NULL;
+		if (context->pInput != NULL) {
+			queued->data = malloc(queued->sample.Size);
+			if (queued->data == NULL) {
+				fprintf(stderr, "Out of memory\n");
+				return RM_FATALOUTOFMEMORY;
+			}
+			rv = MP4Read(context->pReader, queued->sample.Offset, queued->data, queued->sample.Size);
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Cannot read sample at %llu, rv = %d\n", (unsigned long long) queued->sample.Offset, rv);
+				free(queued->data);
+				return rv;
+			}
 		}
-		streamidxmap[i] = out_stream->index;
-		ret = avcodec_copy_context(out_stream->codec, in_stream->codec);
-		if (ret < 0) {
-			fprintf(stderr,
-				"Failed to copy context from input to output stream codec context\n");
-			goto end;
+		queue_put(target, queued);
+	}
+
+#ifdef PLAY_AUDIO
+	if (context->video_queue.count == 0) {
+		queue = &context->audio_queue;
+	} else if (context->audio_queue.count > 0) {
+		RMbool video;
+
+		rv = video_needs_data(context, &video);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot get FIFO levels, rv = %d\n", rv);
+			return rv;
 		}
-		out_stream->codec->codec_tag = 0;
-		if (ofmt_ctx->oformat->flags & AVFMT_GLOBALHEADER)
-			out_stream->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
-#ifdef CONVERT_TIME
-		out_stream->time_base.num = 1;
-		if (in_stream->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-			out_stream->time_base.den = VIDEO_TIME_RES;
-		} else if (in_stream->codec->codec_type == AVMEDIA_TYPE_AUDIO) {
-			out_stream->time_base.den = AUDIO_TIME_RES;
+		if (!video) {
+			queue = &context->audio_queue;
 		}
-#else
-		out_stream->codec->time_base = in_stream->time_base;
-		out_stream->time_base = in_stream->time_base;
+	}
 #endif
-		printf("time_base %s num %u den %u\n", type, out_stream->time_base.num, out_stream->time_base.den);
-		out_stream->codec->bit_rate = in_stream->codec->bit_rate;
-		out_stream->codec->codec_id = in_stream->codec->codec_id;
-		out_stream->codec->codec_type = in_stream->codec->codec_type;
-		out_stream->codec->rc_max_rate = in_stream->codec->rc_max_rate;
-		out_stream->codec->rc_buffer_size = in_stream->codec->rc_buffer_size;
-		out_stream->codec->field_order = in_stream->codec->field_order;
-		if (out_stream->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-#ifdef CONVERT_TIME
-			RMstatus rv;
-			RMuint32 timeres;
+	if (queue->count == 0) {
+		return (context->read_result != RM_OK) ? context->read_result : RM_ERRORENDOFFILE;
+	}
+	queue_get(queue, queued);
+	return RM_OK;
+}
+
+#ifdef TIMEDEBUG
+static void log_sample(const struct MP4Sample *sample, const char *tag, const char *type)
+{
+	printf("%s:%s: pts:%lld dts:%lld duration:%u offset:%llu size:%u key:%d track:%u\n",
+		tag, type, (long long) sample->PTS, (long long) sample->DTS, sample->Duration,
+		(unsigned long long) sample->Offset, sample->Size, sample->KeyFrame,
+		sample->Track);
+}
 #endif
 
-			out_stream->codec->pix_fmt = in_stream->codec->pix_fmt;
-			out_stream->codec->width = in_stream->codec->width;
-			out_stream->codec->height = in_stream->codec->height;
-			out_stream->codec->has_b_frames = in_stream->codec->has_b_frames;
-			out_stream->codec->sample_aspect_ratio = in_stream->sample_aspect_ratio;
+static RMstatus check_jump(app_rua_context_t *context)
+{
+	RMstatus rv;
 
-#ifdef CONVERT_TIME
-			timeres = out_stream->time_base.den / out_stream->time_base.num;
-			printf("Set video time resolution to %u\n", timeres);
-			rv = DCCSTCSetTimeResolution(context->pStcSource, DCC_Video, timeres);
+	if (!context->started || context->jump) {
+		if ((context->startplaypts == 0) || (context->cur_time >= (context->startplaypts - context->startpts))) {
+			printf("start_time %lld (%llds)\n", (long long) context->startplaypts, (long long) (context->startplaypts / VIDEO_TIME_RES));
+			if (context->started) {
+				if ((context->last_time > 0)
+					&& (((uint64_t) context->last_time) > (context->time + context->cfg.min_buffer_time))) {
+					if (context->playing) {
+						if (!context->paused && !context->ending) {
+							printf("Stop play\n");
+							rv = DCCSTCStop(context->pStcSource);
+							if (RMFAILED(rv)) {
+								fprintf(stderr, "Cannot stop, rv = %d\n", rv);
+								cleanup(context);
+								return rv;
+							}
+						} else {
+							context->paused = 0;
+						}
+						context->playing = 0;
+					}
+				}
+			}
+			rv = DCCSTCSetTime(context->pStcSource, context->startplaypts, VIDEO_TIME_RES);
 			if (RMFAILED(rv)) {
-				fprintf(stderr, "Cannot set time resolution for video, rv = %d\n", rv);
-				ret = AVERROR_UNKNOWN;
-				goto end;
+				fprintf(stderr, "Cannot set time, rv = %d\n", rv);
 			}
+			context->started = 1;
+			context->jump = 0;
+		}
+	}
+	return RM_OK;
+}
+
+static RMstatus read_key_frame(void *opaque, struct DCCTrickPlayEntry *entry, RMuint8 **data, RMuint32 *size)
+{
+	app_rua_context_t *context = opaque;
+	RMuint32 header = context->avc_config.ParameterSetsSize;
+	RMbool parameter_sets;
+	RMstatus rv;
+
+	/* Space for SPS and PPS in front of the key frame. */
+	if ((header + entry->size) > context->trick_buffer_size) {
+		uint8_t *buffer;
+
+		buffer = realloc(context->trick_buffer, header + entry->size);
+		if (buffer == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			return RM_FATALOUTOFMEMORY;
+		}
+		context->trick_buffer = buffer;
+		context->trick_buffer_size = header + entry->size;
+	}
+	rv = MP4Read(context->pReader, entry->offset, &context->trick_buffer[header], entry->size);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot read key frame at %llu\n", (unsigned long long) entry->offset);
+		return rv;
+	}
+
+	/* Convert from mp4 to byte stream format. */
+	rv = MP4ConvertAVCSample(&context->avc_config, &context->trick_buffer[header], entry->size, &parameter_sets);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot convert key frame\n");
+		return rv;
+	}
+	if (parameter_sets) {
+		memcpy(context->trick_buffer, context->avc_config.ParameterSets, header);
+		*data = context->trick_buffer;
+		*size = header + entry->size;
+	} else {
+		*data = &context->trick_buffer[header];
+		*size = entry->size;
+	}
+	return RM_OK;
+}
+
+/** Load the key frame index saved for videofile or build it from the sample tables. */
+static RMstatus open_seek_index(app_rua_context_t *context, const char *videofile)
+{
+	int local = (strstr(videofile, "://") == NULL);
+	struct DCCTrickPlayEntry *entries;
+	struct MP4Sample sample;
+	RMuint32 count;
+	RMstatus rv;
+
+	rv = DCCSeekIndexOpen(VIDEO_TIME_RES, &context->pSeekIndex);
+	if (RMFAILED(rv)) {
+		return rv;
+	}
+	if (local && (DCCSeekIndexLoad(context->pSeekIndex, videofile) == RM_OK)) {
+		DCCSeekIndexGetEntries(context->pSeekIndex, &entries, &count);
+		printf("Loaded seek index with %u key frames\n", count);
+		return RM_OK;
+	}
+
+	/* Only the sample tables are walked, no sample data is read. */
+#ifdef PLAY_AUDIO
+	if (context->audio_index >= 0) {
+		MP4SetTrackEnabled(context->pReader, context->audio_index, FALSE);
+	}
+#endif
+	while ((rv = MP4NextSample(context->pReader, &sample)) == RM_OK) {
+		if (!sample.KeyFrame) {
+			continue;
+		}
+		rv = DCCSeekIndexAdd(context->pSeekIndex, rescale_time(sample.PTS, context->video_timescale, VIDEO_TIME_RES), sample.Offset, sample.Size);
+		if (RMFAILED(rv)) {
+			break;
+		}
+	}
+#ifdef PLAY_AUDIO
+	if (context->audio_index >= 0) {
+		MP4SetTrackEnabled(context->pReader, context->audio_index, TRUE);
+	}
 #endif
+	MP4Seek(context->pReader, 0, VIDEO_TIME_RES);
+	if (rv != RM_ERRORENDOFFILE) {
+		return rv;
+	}
+
+	DCCSeekIndexGetEntries(context->pSeekIndex, &entries, &count);
+	if (count == 0) {
+		printf("No key frame index, jumps read through the data.\n");
+		return RM_NOT_FOUND;
+	}
+	if (local) {
+		/* Next time the index is available without walking the sample tables. */
+		rv = DCCSeekIndexSave(context->pSeekIndex, videofile);
+		if (RMFAILED(rv)) {
+			printf("Seek index is not saved, rv = %d\n", rv);
+		}
+	}
+	return RM_OK;
+}
+
+static void close_seek_index(app_rua_context_t *context)
+{
+	if (context->pSeekIndex != NULL) {
+		DCCSeekIndexClose(context->pSeekIndex);
+		context->pSeekIndex = NULL;
+	}
+}
 
-		} else if (out_stream->codec->codec_type == AVMEDIA_TYPE_AUDIO) {
-#ifdef CONVERT_TIME
-			RMstatus rv;
-			RMuint32 timeres;
+/** Open trick play with the key frames of the seek index. */
+static RMstatus open_trick_play(app_rua_context_t *context)
+{
+	struct DCCTrickPlayEntry *entries;
+	RMuint32 count;
+	RMstatus rv;
+
+	if (context->pSeekIndex == NULL) {
+		return RM_NOT_FOUND;
+	}
+	DCCSeekIndexGetEntries(context->pSeekIndex, &entries, &count);
+
+	if (!context->avc_config_valid) {
+		return RM_NOT_SUPPORTED;
+	}
+
+	rv = DCCTrickPlayOpen(context->pRUA, context->pVideoSource, context->pDMA, DMA_BUFFER_SIZE,
+		entries, count, VIDEO_TIME_RES, read_key_frame, context, &context->pTrick);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot open trick play, rv = %d\n", rv);
+		return rv;
+	}
+	printf("Trick play index with %u key frames\n", count);
+	return RM_OK;
+}
+
+static void close_trick_play(app_rua_context_t *context)
+{
+	if (context->pTrick != NULL) {
+		DCCTrickPlayClose(context->pTrick);
+		context->pTrick = NULL;
+	}
+	if (context->trick_buffer != NULL) {
+		free(context->trick_buffer);
+		context->trick_buffer = NULL;
+		context->trick_buffer_size = 0;
+	}
+	context->trick_active = 0;
+}
+
+/** Read from the key frame at pts with the decoders stopped and restart playback there. */
+static RMstatus restart_at(app_rua_context_t *context, RMuint64 pts)
+{
+	RMstatus rv;
+
+	rv = MP4Seek(context->pReader, pts, VIDEO_TIME_RES);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot seek to %llu (%llus), rv = %d\n", (unsigned long long) pts, (unsigned long long) (pts / VIDEO_TIME_RES), rv);
+		return rv;
+	}
+	/* Data from before the jump must not be sent with the new timestamps. */
+	flush_packets(context);
+	DCCPacketizerReset(context->pVideoPacketizer);
+#ifdef PLAY_AUDIO
+	DCCPacketizerReset(context->pAudioPacketizer);
 #endif
+#ifdef PLAY_AUDIO
+	rv = DCCPlaySynchronized(NULL, context->pVideoSource, DCCVideoPlayFwd, &context->pAudioSource, 1);
+#else
+	rv = DCCPlaySynchronized(NULL, context->pVideoSource, DCCVideoPlayFwd, NULL, 0);
+#endif
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot play video and audio source, rv = %d\n", rv);
+		return rv;
+	}
+	context->startplaypts = pts;
+	context->jump = 1;
+	context->last_time = -1;
+	context->play_started = 0;
+	return RM_OK;
+}
+
+/** Enter, change or leave trick play after a key on the remote control. */
+static RMstatus handle_trick_request(app_rua_context_t *context)
+{
+	RMuint64 pts;
+	RMstatus rv;
+
+	context->trick_request = 0;
+	if (context->pTrick == NULL) {
+		context->trick_speed = 0;
+		return RM_OK;
+	}
 
-			out_stream->codec->channel_layout = in_stream->codec->channel_layout;
-			out_stream->codec->sample_rate = in_stream->codec->sample_rate;
-			out_stream->codec->channels = in_stream->codec->channels;
-			out_stream->codec->frame_size = in_stream->codec->frame_size;
-			out_stream->codec->audio_service_type = in_stream->codec->audio_service_type;
-			out_stream->codec->block_align = in_stream->codec->block_align;
-
-#ifdef CONVERT_TIME
-			timeres = out_stream->time_base.den / out_stream->time_base.num;
-			printf("Set audio time resolution to %u\n", timeres);
-			rv = DCCSTCSetTimeResolution(context->pStcSource, DCC_Audio, timeres);
+	if (context->trick_speed != 0) {
+		if (!context->trick_active) {
+			if (context->playing && !context->paused) {
+				rv = DCCSTCStop(context->pStcSource);
+				if (RMFAILED(rv)) {
+					fprintf(stderr, "Cannot stop, rv = %d\n", rv);
+					return rv;
+				}
+			}
+#ifdef PLAY_AUDIO
+			rv = DCCStopAudioSource(context->pAudioSource);
 			if (RMFAILED(rv)) {
-				fprintf(stderr, "Cannot set time resolution for audio, rv = %d\n", rv);
-				ret = AVERROR_UNKNOWN;
-				goto end;
+				fprintf(stderr, "Cannot stop audio source, rv = %d\n", rv);
+				return rv;
 			}
 #endif
+			context->playing = 0;
+			context->paused = 0;
+			context->trick_active = 1;
 		}
+		printf("Trick play speed %dx\n", context->trick_speed);
+		return DCCTrickPlayStart(context->pTrick, context->trick_speed, context->time);
+	}
 
-		av_dump_format(ofmt_ctx, 0, type, 1);
+	if (!context->trick_active) {
+		return RM_OK;
+	}
+	rv = DCCTrickPlayGetPosition(context->pTrick, &pts);
+	if (RMFAILED(rv)) {
+		return rv;
 	}
+	rv = DCCTrickPlayStop(context->pTrick);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot stop trick play, rv = %d\n", rv);
+		return rv;
+	}
+	context->trick_active = 0;
 
-	vidfmt_ctx->pb = avio_alloc_context(NULL, buffersize, 1, context, NULL, write_video_packet, NULL);
-	if (vidfmt_ctx->pb == NULL) {
-		ret = AVERROR_UNKNOWN;
-		goto end;
+	/* Continue normal playback at the key frame shown last. */
+	printf("Continue playing at %llu (%llus)\n", (unsigned long long) pts, (unsigned long long) (pts / VIDEO_TIME_RES));
+	return restart_at(context, pts);
+}
+
+/**
+ * Jump forward by the configured time.
+ *
+ * The reader continues at the key frame before the target, so only the
+ * data from there is read. Without index or when the target is already
+ * buffered or close to the read position, the data is played through
+ * instead.
+ */
+static RMstatus handle_jump_request(app_rua_context_t *context)
+{
+	struct DCCTrickPlayEntry entry;
+	int64_t target;
+	RMstatus rv;
+
+	context->jump_request = 0;
+	if (!context->playing) {
+		return RM_OK;
 	}
-	vidfmt_ctx->pb->direct = AVIO_FLAG_DIRECT;
-	vidfmt_ctx->pb->seekable = 0;
-	vidfmt_ctx->pb->max_packet_size = DMA_BUFFER_SIZE;
+	target = context->time + context->cfg.jump_time * VIDEO_TIME_RES;
+	printf("Jump to %lld (%llds) buffer until %lld (%llds)\n",
+		(long long) target, (long long) (target / VIDEO_TIME_RES),
+		(long long) context->last_time, (long long) (context->last_time / VIDEO_TIME_RES));
 
+	if ((context->pReader == NULL) || (context->pSeekIndex == NULL)
+		|| (DCCSeekIndexFind(context->pSeekIndex, target, &entry) != RM_OK)
+		|| (((int64_t) entry.pts) <= context->cur_time)) {
+		context->startplaypts = target;
+		context->jump = 1;
+		return RM_OK;
+	}
+
+	/* Drop the buffered data, it is before the target. */
+	if (!context->paused) {
+		rv = DCCSTCStop(context->pStcSource);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot stop, rv = %d\n", rv);
+			return rv;
+		}
+	}
+	rv = DCCStopVideoSource(context->pVideoSource, DCCStopMode_LastFrame);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot stop video source, rv = %d\n", rv);
+		return rv;
+	}
 #ifdef PLAY_AUDIO
-	audfmt_ctx->pb = avio_alloc_context(NULL, buffersize, 1, context, NULL, write_audio_packet, NULL);
-	if (audfmt_ctx->pb == NULL) {
-		fprintf(stderr, "Out of memory\n");
-		ret = AVERROR_UNKNOWN;
-		goto end;
+	rv = DCCStopAudioSource(context->pAudioSource);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot stop audio source, rv = %d\n", rv);
+		return rv;
 	}
-	audfmt_ctx->pb->direct = AVIO_FLAG_DIRECT;
-	audfmt_ctx->pb->seekable = 0;
-	audfmt_ctx->pb->max_packet_size = DMA_BUFFER_SIZE;
 #endif
+	context->playing = 0;
+	context->paused = 0;
 
-	bsf = av_bitstream_filter_init("h264_mp4toannexb");
-	if (bsf == NULL) {
-		fprintf(stderr, "Error occurred when getting filter\n");
-		goto end;
+	printf("Seek to key frame at %llu (%llus) offset %llu\n", (unsigned long long) entry.pts,
+		(unsigned long long) (entry.pts / VIDEO_TIME_RES), (unsigned long long) entry.offset);
+	return restart_at(context, entry.pts);
+}
+
+/** Read function of the MP4 reader for http input, the data comes from the read-ahead buffers. */
+static RMstatus input_read(void *opaque, RMuint64 offset, RMuint8 *buffer, RMuint32 size)
+{
+	RMuint32 pos = 0;
+	RMstatus rv;
+
+	if (StreamIOTell(opaque) != offset) {
+		rv = StreamIOSeek(opaque, offset);
+		if (RMFAILED(rv)) {
+			return rv;
+		}
 	}
-	ret = avformat_write_header(vidfmt_ctx, NULL);
-	if (ret < 0) {
-		fprintf(stderr, "Error occurred when opening output file\n");
-		goto end;
+	while (pos < size) {
+		RMuint32 len;
+
+		rv = StreamIORead(opaque, &buffer[pos], size - pos, &len);
+		if (RMFAILED(rv)) {
+			return rv;
+		}
+		if (len == 0) {
+			return RM_ERRORENDOFFILE;
+		}
+		pos += len;
+	}
+	return RM_OK;
+}
+
+/**
+ * Open the sample tables of the input. Local files are read with pread()
+ * when the samples are sent, http input with read-ahead in a separate
+ * thread.
+ */
+static RMstatus open_input(app_rua_context_t *context, const char *videofile)
+{
+	struct StreamIOProfile profile;
+	struct StreamIOHTTPProfile http;
+	struct MP4Source source;
+	RMstatus rv;
+
+	if (strncmp(videofile, "http://", 7) != 0) {
+		if (strstr(videofile, "://") != NULL) {
+			fprintf(stderr, "Only local files and http URLs are supported.\n");
+			return RM_NOT_SUPPORTED;
+		}
+		return MP4Open(videofile, &context->pReader);
+	}
+
+	profile.BufferSize = INPUT_BUFFER_SIZE;
+	profile.BufferCount = (context->cfg.read_ahead_size + INPUT_BUFFER_SIZE - 1) / INPUT_BUFFER_SIZE;
+	if (profile.BufferCount < 2) {
+		profile.BufferCount = 2;
+	}
+	/* Range requests over persistent connections, one chunk fills one input buffer. */
+	memset(&http, 0, sizeof(http));
+	http.ChunkSize = INPUT_BUFFER_SIZE;
+	http.Connections = context->cfg.http_connections;
+	rv = StreamIOOpenHTTP(videofile, &http, &profile, &context->pInput);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot start reading '%s', rv = %d\n", videofile, rv);
+		return rv;
+	}
+
+	memset(&source, 0, sizeof(source));
+	source.opaque = context->pInput;
+	source.Read = input_read;
+	source.Size = StreamIOGetSize(context->pInput);
+	return MP4OpenSource(&source, &context->pReader);
+}
+
+static void close_input(app_rua_context_t *context)
+{
+	if (context->pReader != NULL) {
+		MP4Close(context->pReader);
+		context->pReader = NULL;
+	}
+	if (context->pInput != NULL) {
+		struct StreamIOStatistics stats;
+
+		if (StreamIOGetStatistics(context->pInput, &stats) == RM_OK) {
+			printf("Input: %llu bytes read, %u stalls, %llu ms waited, longest %llu ms\n",
+				(unsigned long long) stats.BytesRead, stats.Stalls,
+				(unsigned long long) (stats.StallTime_us / 1000),
+				(unsigned long long) (stats.MaxStallTime_us / 1000));
+		}
+		StreamIOClose(context->pInput);
+		context->pInput = NULL;
+	}
+}
+
+/** Select the first H.264 and the first AAC track, the other tracks are not read. */
+static RMstatus open_tracks(app_rua_context_t *context)
+{
+	RMuint32 count = MP4GetTrackCount(context->pReader);
+	RMuint32 i;
+	RMstatus rv;
+
+	for (i = 0; i < count; i++) {
+		struct MP4TrackInfo info;
+		RMbool enabled = FALSE;
+
+		rv = MP4GetTrackInfo(context->pReader, i, &info);
+		if (RMFAILED(rv)) {
+			return rv;
+		}
+		if (info.Type == MP4TrackType_Video) {
+			if (context->video_index >= 0) {
+				fprintf(stderr, "Ignoring video track %u\n", i);
+			} else if (info.Codec != MP4_FOURCC('a', 'v', 'c', '1')) {
+				fprintf(stderr, "Ignoring video track %u, codec 0x%08x is not supported\n", i, info.Codec);
+			} else {
+				rv = MP4ParseAVCConfig(info.DecoderConfig, info.DecoderConfigSize, &context->avc_config);
+				if (RMFAILED(rv)) {
+					fprintf(stderr, "Cannot get SPS and PPS of video stream, rv = %d\n", rv);
+					return rv;
+				}
+				context->avc_config_valid = TRUE;
+				printf("time scale video %u, %ux%u\n", info.TimeScale, info.Width, info.Height);
+				rv = DCCSetVideoSourceBitrate(context->pVideoSource, info.Bitrate);
+				if (RMFAILED(rv)) {
+					fprintf(stderr, "Cannot set video bitrate, rv = %d\n", rv);
+				}
+				if (context->pVideoPacketizer == NULL) {
+					rv = open_packetizer(context, context->video_decoder, info.TimeScale, VIDEO_TIME_RES, FALSE, &context->pVideoPacketizer);
+					if (RMFAILED(rv)) {
+						fprintf(stderr, "Cannot open video packetizer, rv = %d\n", rv);
+						return rv;
+					}
+				}
+				context->video_index = i;
+				context->video_timescale = info.TimeScale;
+				enabled = TRUE;
+			}
+		} else if (info.Type == MP4TrackType_Audio) {
+#ifdef PLAY_AUDIO
+			/* AAC frames are sent with ADTS header, they don't need a muxer. */
+			if (context->audio_index < 0) {
+				rv = open_audio_stream(context, i, &info);
+				if (RMFAILED(rv)) {
+					fprintf(stderr, "Ignoring audio track %u, rv = %d\n", i, rv);
+				} else {
+					enabled = TRUE;
+				}
+			}
+#else
+			fprintf(stderr, "Ignoring audio tracks\n");
+#endif
+		} else {
+			fprintf(stderr, "Neither video nor audio track ignoring\n");
+		}
+		MP4SetTrackEnabled(context->pReader, i, enabled);
 	}
+	if (context->video_index < 0) {
+		fprintf(stderr, "No H.264 video track found\n");
+		return RM_NOT_FOUND;
+	}
+	return RM_OK;
+}
+
+/**
+ * Play mp4 video
+ *
+ * @param context Context of hardware
+ * @param videofile Path to video file to play.
+ * @param minutes Time at which playing should start (minutes)
+ * @param seconds Time at which playing should start (seconds)
+ *
+ * @returns Result of operation
+ * @retval 0 on success
+ * @retval 1 on error
+ */
+static int play_mp4_video(app_rua_context_t *context, const char *videofile, int minutes, int seconds)
+{
+	queued_sample_t queued;
+	RMstatus rv;
+	int64_t print_time;
+
+	context->startpts = LLONG_MAX;
+	context->started = 0;
+
+	context->last_time = -1;
+
+	/* Start at a specific time to play. */
+	context->startplaypts = ((minutes * 60) + seconds) * VIDEO_TIME_RES;
+
+	context->videotransferred = 0;
+	context->video_index = -1;
 #ifdef PLAY_AUDIO
-	ret = avformat_write_header(audfmt_ctx, NULL);
-	if (ret < 0) {
-		fprintf(stderr, "Error occurred when opening output file\n");
+	context->audio_index = -1;
+#endif
+	context->avc_config_valid = FALSE;
+	flush_packets(context);
+
+	rv = open_input(context, videofile);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Could not open input file '%s'\n", videofile);
 		goto end;
 	}
-#endif
+	/* Samples go directly from the file to the packetizers, timestamps stay in the time scale of the track. */
+	rv = open_tracks(context);
+	if (RMFAILED(rv)) {
+		goto end;
+	}
+
+	rv = open_seek_index(context, videofile);
+	if (RMFAILED(rv)) {
+		close_seek_index(context);
+	}
+	rv = open_trick_play(context);
+	if (RMFAILED(rv)) {
+		printf("Trick play is disabled, rv = %d\n", rv);
+		close_trick_play(context);
+	}
+
+	if ((context->startplaypts > 0) && (context->pSeekIndex != NULL)) {
+		struct DCCTrickPlayEntry entry;
+
+		/* Start reading at the key frame before the start position. */
+		if ((DCCSeekIndexFind(context->pSeekIndex, context->startplaypts, &entry) == RM_OK) && (entry.pts > 0)) {
+			rv = MP4Seek(context->pReader, entry.pts, VIDEO_TIME_RES);
+			if (rv == RM_OK) {
+				context->startplaypts = entry.pts;
+			} else {
+				fprintf(stderr, "Cannot seek to %llu (%llus), rv = %d\n", (unsigned long long) entry.pts,
+					(unsigned long long) (entry.pts / VIDEO_TIME_RES), rv);
+			}
+		}
+	}
+
 	print_time = 0;
 	while (1) {
-		AVStream *in_stream, *out_stream;
-		AVFormatContext *ofmt_ctx;
-		const char *type;
-		RMstatus rv;
+		RMbool video;
+		RMuint32 timescale;
 #ifdef TIMEDEBUG
 		RMuint64 time;
 #endif
@@ -931,12 +1719,42 @@ static int play_mp4_video(app_rua_context_t *context, const char *videofile, int
 			printf("Received signal, stopping...\n");
 			break;
 		}
-		rv = DCCSTCGetTime(context->pStcSource, &context->time, VIDEO_TIME_RES);
+		rv = DCCSTCClockGetTime(context->pStcClock, &context->time, VIDEO_TIME_RES);
 		if (RMFAILED(rv)) {
 			fprintf(stderr, "Cannot get time, rv = %d\n", rv);
 			cleanup(context);
 			return rv;
 		}
+		if (context->jump_request) {
+			rv = handle_jump_request(context);
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Jump failed, rv = %d\n", rv);
+				cleanup(context);
+				return rv;
+			}
+		}
+		if (context->trick_request) {
+			rv = handle_trick_request(context);
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Trick play failed, rv = %d\n", rv);
+				cleanup(context);
+				return rv;
+			}
+		}
+		if (context->trick_active) {
+			rv = DCCTrickPlayFeed(context->pTrick);
+			if (rv == RM_EOS) {
+				/* Continue normal playback at the start or end of the video. */
+				context->trick_speed = 0;
+				context->trick_request = 1;
+			} else if (RMFAILED(rv) && (rv != RM_PENDING)) {
+				fprintf(stderr, "Cannot feed trick play, rv = %d\n", rv);
+				cleanup(context);
+				return rv;
+			}
+			get_key(context, 10000);
+			continue;
+		}
 		if (context->paused) {
 			if ((context->last_time > 0)
 				&& (((uint64_t) context->last_time) > (context->time + context->cfg.max_buffer_time))) {
@@ -956,9 +1774,29 @@ static int play_mp4_video(app_rua_context_t *context, const char *videofile, int
 				}
 			}
 		}
-		if (context->playing) {
+		if (context->playing && !context->paused) {
+			rv = update_fifo_levels(context);
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Cannot get video FIFO level, rv = %d\n", rv);
+				cleanup(context);
+				return rv;
+			}
+			if (context->video_level.BitstreamFullness > VIDEO_FIFO_HIGH_LEVEL) {
+				/* Sleep until the decoder consumed data. */
+				rv = DCCWaitVideoFIFOLevel(context->pVideoSource, VIDEO_FIFO_LOW_LEVEL, VIDEO_FIFO_WAIT_US);
+				context->fifo_level_valid = FALSE;
+				if (rv == RM_PENDING) {
+					continue;
+				}
+				if (RMFAILED(rv)) {
+					fprintf(stderr, "Cannot wait for video FIFO, rv = %d\n", rv);
+					cleanup(context);
+					return rv;
+				}
+			}
 			if ((context->last_time > 0)
-				&& (((uint64_t) context->last_time) < (context->time + context->cfg.rebuffer_time))) {
+				&& (((uint64_t) context->last_time) < (context->time + context->cfg.rebuffer_time))
+				&& (context->video_level.BitstreamFullness < VIDEO_FIFO_REBUFFER_LEVEL)) {
 				printf("Rebuffering...\n");
 				rv = DCCSTCStop(context->pStcSource);
 				if (RMFAILED(rv)) {
@@ -970,183 +1808,104 @@ static int play_mp4_video(app_rua_context_t *context, const char *videofile, int
 			}
 		}
 
-		ret = av_read_frame(ifmt_ctx, &pkt);
-		if (ret < 0)
+		rv = next_sample(context, &queued);
+		if (RMFAILED(rv))
 			break;
-		in_stream = ifmt_ctx->streams[pkt.stream_index];
-		if (in_stream->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-			ofmt_ctx = vidfmt_ctx;
-			type = "video";
+		video = ((int) queued.sample.Track == context->video_index);
 #ifdef PLAY_AUDIO
-		} else if (in_stream->codec->codec_type == AVMEDIA_TYPE_AUDIO) {
-			ofmt_ctx = audfmt_ctx;
-			type = "audio";
+		timescale = video ? context->video_timescale : context->audio_timescale;
+#else
+		timescale = context->video_timescale;
 #endif
-		} else {
-			av_free_packet(&pkt);
-			continue;
-		}
 #ifdef TIMEDEBUG
-		rv = DCCSTCGetTime(context->pStcSource, &time, out_stream->time_base.den/out_stream->time_base.num);
+		rv = DCCSTCGetTime(context->pStcSource, &time, timescale);
 		if (RMFAILED(rv)) {
 			fprintf(stderr, "Cannot get time, rv = %d\n", rv);
-			ret = AVERROR_UNKNOWN;
+			free(queued.data);
 			goto end;
 		}
-		printf("Current time: %llu %s\n", time, av_ts2timestr(time, &out_stream->time_base));
-		log_packet(ifmt_ctx, &pkt, "in", type);
+		printf("Current time: %llu (%llus)\n", (unsigned long long) time, (unsigned long long) (time / timescale));
+		log_sample(&queued.sample, "in", video ? "video" : "audio");
 #endif
-		/* Convert input stream index into output stream index. */
-		if ((pkt.stream_index < 0) || (((unsigned int) pkt.stream_index) >= ifmt_ctx->nb_streams)) {
-			av_free_packet(&pkt);
-			printf("Stream index %u out of range\n", pkt.stream_index);
-			continue;
-		}
-		pkt.stream_index = streamidxmap[pkt.stream_index];
-		out_stream = ofmt_ctx->streams[pkt.stream_index];
-		/* copy packet */
-		if (pkt.pts != AV_NOPTS_VALUE) {
-			pkt.pts = av_rescale_q(pkt.pts, in_stream->time_base, out_stream->time_base);
-		}
-		if (pkt.dts != AV_NOPTS_VALUE) {
-			pkt.dts = av_rescale_q(pkt.dts, in_stream->time_base, out_stream->time_base);
-		}
-		if (pkt.duration > 0) {
-			pkt.duration = av_rescale_q(pkt.duration, in_stream->time_base, out_stream->time_base);
-		}
-		pkt.pos = -1;
 
-		if ((in_stream->codec->codec_type == AVMEDIA_TYPE_VIDEO) && (bsf != NULL)) {
-			if (pkt.pts < context->startpts) {
+		context->cur_time = rescale_time(queued.sample.PTS, timescale, VIDEO_TIME_RES);
+		if (video) {
+			if (context->cur_time < context->startpts) {
 				if (!context->playing) {
-					context->startpts = pkt.pts;
+					context->startpts = context->cur_time;
 				}
 			}
-		}
-
-		if ((in_stream->codec->codec_type == AVMEDIA_TYPE_VIDEO) && (bsf != NULL)) {
-			AVPacket new_pkt = pkt;
-
-			context->last_time = av_rescale_q(pkt.pts + pkt.duration, out_stream->time_base, context->time_base);
+			context->last_time = rescale_time(queued.sample.PTS + queued.sample.Duration, timescale, VIDEO_TIME_RES);
 #ifdef TIMEDEBUG
-			printf("last_time %lld (%llds)\n", context->last_time, context->last_time/VIDEO_TIME_RES);
+			printf("last_time %lld (%llds)\n", (long long) context->last_time, (long long) (context->last_time / VIDEO_TIME_RES));
 #endif
-
-			int a = av_bitstream_filter_filter(bsf, out_stream->codec, NULL,
-					&new_pkt.data, &new_pkt.size,
-					pkt.data, pkt.size,
-					pkt.flags & AV_PKT_FLAG_KEY);
-			if (a == 0 && new_pkt.data != pkt.data && new_pkt.destruct) {
-				uint8_t *t = av_malloc(new_pkt.size + FF_INPUT_BUFFER_PADDING_SIZE); //the new should be a subset of the old so cannot overflow
-				if(t) {
-					memcpy(t, new_pkt.data, new_pkt.size);
-					memset(t + new_pkt.size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
-					new_pkt.data = t;
-					a = 1;
-				} else {
-					a = AVERROR(ENOMEM);
-				}
-			}
-			if (a > 0) {
-				av_free_packet(&pkt);
-				new_pkt.destruct = av_destruct_packet;
-			} else if (a < 0) {
-				av_log(NULL, AV_LOG_ERROR, "Failed to open bitstream filter %s for stream %d with codec %s",
-						bsf->filter->name, pkt.stream_index,
-						out_stream->codec->codec ? out_stream->codec->codec->name : "copy");
-				goto end;
-			}
-			pkt = new_pkt;
 		}
-#ifdef TIMEDEBUG
-		log_packet(ofmt_ctx, &pkt, "out", type);
-#endif
-		context->cur_time = av_rescale_q(pkt.pts, out_stream->time_base, context->time_base);
-		if (in_stream->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-			if ((print_time + 30 * context->time_base.den/context->time_base.num) <= context->cur_time) {
-				printf("cur_time %s (%s) startplaypts %s (%s) buffer until %s (%s) started %d\n",
-					av_ts2timestr(context->cur_time, &context->time_base),
-					av_ts2str(context->cur_time),
-					av_ts2timestr(context->startplaypts, &context->time_base),
-					av_ts2str(context->startplaypts),
-					av_ts2timestr(context->last_time, &context->time_base),
-					av_ts2str(context->last_time),
+		if (video) {
+			if ((print_time + 30 * VIDEO_TIME_RES) <= context->cur_time) {
+				printf("cur_time %lld (%llds) startplaypts %lld (%llds) buffer until %lld (%llds) started %d\n",
+					(long long) context->cur_time, (long long) (context->cur_time / VIDEO_TIME_RES),
+					(long long) context->startplaypts, (long long) (context->startplaypts / VIDEO_TIME_RES),
+					(long long) context->last_time, (long long) (context->last_time / VIDEO_TIME_RES),
 					context->started);
 				print_time = context->cur_time;
 			}
 		}
-		if ((context->startplaypts == 0) || (in_stream->codec->codec_type == AVMEDIA_TYPE_VIDEO)) {
+		if ((context->startplaypts == 0) || video) {
 			rv = check_jump(context);
 			if (RMFAILED(rv)) {
+				free(queued.data);
 				return rv;
 			}
 		}
-		if (context->started) {
-			ret = av_interleaved_write_frame(ofmt_ctx, &pkt);
-			if (ret < 0) {
-				fprintf(stderr, "Error muxing packet\n");
+#ifdef PLAY_AUDIO
+		if (context->started && ((int) queued.sample.Track == context->audio_index)) {
+			rv = write_aac_frame(context, &queued);
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Error writing audio frame\n");
+				free(queued.data);
+				break;
+			}
+		}
+#endif
+		if (context->started && video) {
+			rv = write_video_sample(context, &queued);
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Error writing video sample\n");
+				free(queued.data);
 				break;
 			}
 		}
-		av_free_packet(&pkt);
+		free(queued.data);
+	}
+	if (RMFAILED(flush_data(context, context->pVideoPacketizer))) {
+		rv = RM_ERROR;
+		goto end;
 	}
-	av_write_trailer(vidfmt_ctx);
 #ifdef PLAY_AUDIO
-	av_write_trailer(audfmt_ctx);
+	if (RMFAILED(flush_data(context, context->pAudioPacketizer))) {
+		rv = RM_ERROR;
+		goto end;
+	}
 #endif
 	if (context->started && !context->play_started) {
 		/* Wait until enough frames are buffered then start playing. */
 		if (context->last_time > 0) {
-			RMstatus rv;
-
 			printf("Playing very small video.\n");
-			rv = start_play(context);
-			if (RMFAILED(rv)) {
-				fprintf(stderr, "Cannot start to play video, rv = %d\n", rv);
+			if (RMFAILED(start_play(context))) {
+				fprintf(stderr, "Cannot start to play video\n");
 				cleanup(context);
-				return rv;
+				return 1;
 			}
 		}
 	}
 end:
-	if (ifmt_ctx != NULL) {
-		avformat_close_input(&ifmt_ctx);
-	}
-
-	/* close output */
-	if ((vidfmt_ctx != NULL) && (vidfmt_ctx->pb != NULL)) {
-		av_free(vidfmt_ctx->pb);
-		vidfmt_ctx->pb = NULL;
-	}
-
-#ifdef PLAY_AUDIO
-	if ((audfmt_ctx != NULL) && (audfmt_ctx->pb != NULL)) {
-		av_free(audfmt_ctx->pb);
-		audfmt_ctx->pb = NULL;
-	}
-#endif
-
-	if (bsf != NULL) {
-		av_bitstream_filter_close(bsf);
-		bsf = NULL;
-	}
-
-	if (vidfmt_ctx != NULL) {
-		avformat_free_context(vidfmt_ctx);
-	}
+	close_trick_play(context);
+	close_seek_index(context);
+	flush_packets(context);
+	close_input(context);
 
-#ifdef PLAY_AUDIO
-	if (audfmt_ctx != NULL) {
-		avformat_free_context(audfmt_ctx);
-	}
-#endif
-	if (streamidxmap != NULL) {
-		free(streamidxmap);
-		streamidxmap = NULL;
-	}
-
-	if (ret < 0 && ret != AVERROR_EOF) {
-		fprintf(stderr, "Error occurred: %s\n", av_err2str(ret));
+	if (RMFAILED(rv) && (rv != RM_ERRORENDOFFILE)) {
+		fprintf(stderr, "Error occurred, rv = %d\n", rv);
 		return 1;
 	}
 	return 0;
@@ -1220,42 +1979,31 @@ static RMstatus play_video(app_rua_context_t *context, const char *videofile)
 		return rv;
 	}
 
-	rv = DCCPlayVideoSource(context->pVideoSource, DCCVideoPlayFwd);
-	if (RMFAILED(rv)) {
-		fprintf(stderr, "Cannot play video source, rv = %d\n", rv);
-		cleanup(context);
-		return rv;
-	}
-
+	/* Arm the decoders, the STC is started by start_play(). */
 #ifdef PLAY_AUDIO
-	/* TBD: Use DCCPlayMultipleAudioSource(). */
-	rv = DCCPlayAudioSource(context->pAudioSource);
+	rv = DCCPlaySynchronized(NULL, context->pVideoSource, DCCVideoPlayFwd, &context->pAudioSource, 1);
+#else
+	rv = DCCPlaySynchronized(NULL, context->pVideoSource, DCCVideoPlayFwd, NULL, 0);
+#endif
 	if (RMFAILED(rv)) {
-		fprintf(stderr, "Cannot play audio source, rv = %d\n", rv);
+		fprintf(stderr, "Cannot play video and audio source, rv = %d\n", rv);
 		cleanup(context);
 		return rv;
 	}
-#endif
 
 	ret = play_mp4_video(context, videofile, context->cfg.start_minute, context->cfg.start_second);
 	if (ret != 0) {
 		fprintf(stderr, "Failed play_mp4_video with %d\n", ret);
 	}
 
-	if (context->videobuffer != NULL) {
-		rv = RUAReleaseBuffer(context->pDMA, context->videobuffer);
-		if (RMFAILED(rv)) {
-			fprintf(stderr, "Failed to release buffer, rv = %d\n", rv);
-		}
-		context->videobuffer = NULL;
+	if (context->pVideoPacketizer != NULL) {
+		DCCClosePacketizer(context->pVideoPacketizer);
+		context->pVideoPacketizer = NULL;
 	}
 #ifdef PLAY_AUDIO
-	if (context->audiobuffer != NULL) {
-		rv = RUAReleaseBuffer(context->pDMA, context->audiobuffer);
-		if (RMFAILED(rv)) {
-			fprintf(stderr, "Failed to release buffer, rv = %d\n", rv);
-		}
-		context->audiobuffer = NULL;
+	if (context->pAudioPacketizer != NULL) {
+		DCCClosePacketizer(context->pAudioPacketizer);
+		context->pAudioPacketizer = NULL;
 	}
 #endif
 	context->ending = 1;
@@ -1266,6 +2014,14 @@ static RMstatus play_video(app_rua_context_t *context, const char *videofile)
 			printf("All data buffered, waiting until playing finished at %lld (%llds)\n", context->last_time, context->last_time / VIDEO_TIME_RES);
 
 			do {
+				if (context->jump_request) {
+					rv = handle_jump_request(context);
+					if (RMFAILED(rv)) {
+						fprintf(stderr, "Failed jump, rv = %d\n", rv);
+						cleanup(context);
+						return rv;
+					}
+				}
 				rv = check_jump(context);
 				if (RMFAILED(rv)) {
 					fprintf(stderr, "Failed jump, rv = %d\n", rv);
@@ -1332,6 +2088,8 @@ static void usage(char *argv[])
 	fprintf(stderr, "-S SECOND             Second were to start playing\n");
 	fprintf(stderr, "-d                    Enable debug output\n");
 	fprintf(stderr, "-j SECOND             How much to jump in seconds\n");
+	fprintf(stderr, "-a BYTES              Read-ahead of http input, default: %u\n", READ_AHEAD_SIZE);
+	fprintf(stderr, "-c CONNECTIONS        Parallel HTTP connections, default: %u\n", HTTP_CONNECTIONS);
 	fprintf(stderr, "\n");
 	fprintf(stderr, "This program plays mp4 videos on the Zyxel DMA-2500.\n");
 	fprintf(stderr, "Time: %lld is 1 second.\n", VIDEO_TIME_RES);
@@ -1353,10 +2111,10 @@ int main(int argc, char *argv[])
 	cfg.start_minute = 0;
 	cfg.start_second = 0;
 	cfg.jump_time = JUMP_TIME;
+	cfg.read_ahead_size = READ_AHEAD_SIZE;
+	cfg.http_connections = HTTP_CONNECTIONS;
 
-	avformat_network_init();
-
-	while((c = getopt (argc, argv, "x:m:r:S:M:dj:")) != -1) {
+	while((c = getopt (argc, argv, "x:m:r:S:M:dj:a:c:")) != -1) {
 		switch(c) {
 			case 'x':
 				cfg.max_buffer_time = strtoull(optarg, NULL, 0);
@@ -1382,6 +2140,14 @@ int main(int argc, char *argv[])
 				cfg.jump_time = strtoul(optarg, NULL, 0);
 				break;
 
+			case 'a':
+				cfg.read_ahead_size = strtoul(optarg, NULL, 0);
+				break;
+
+			case 'c':
+				cfg.http_connections = strtoul(optarg, NULL, 0);
+				break;
+
 			case 'd':
 				debug = 1;
 				break;
@@ -7,9 +7,10 @@
  * TBD: Example is not working.
  */
 
+#define _GNU_SOURCE
+
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/mman.h>
 
 #include <stdio.h>
 #include <stdint.h>
@@ -19,9 +20,13 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <ctype.h>
+#include <time.h>
 
 #include "rua.h"
 #include "dcc.h"
+#include "streamio.h"
+#include "tsdemux.h"
 
 /** Define to play audio also. */
 #define PLAY_AUDIO
@@ -34,8 +39,32 @@
 #define DMA_BUFFER_SIZE_LOG2 16
 /** Size of buffers used to transfer audio and video data. */
 #define DMA_BUFFER_SIZE (1 << DMA_BUFFER_SIZE_LOG2)
+/** Size of the part of an input file which is mapped at once. */
+#define MAP_WINDOW_SIZE (4 * 1024 * 1024)
 /** How many video stream data to buffer until playing should start. */
 #define VID_PRE_BUFFER_SIZE 48704
+/** Number of buffers for audio data when the transport stream is demuxed by software. */
+#define AUDIO_BUFFER_COUNT 32
+/** DemuxOutput connected to the video decoder. */
+#define VIDEO_OUTPUT 0
+/** DemuxOutput used for recording. */
+#define RECORD_OUTPUT 1
+/** DemuxOutput connected to the audio decoder when a transport stream is recorded. */
+#define AUDIO_OUTPUT 2
+/** PAT, PMT, PCR, video and audio PID. */
+#define MAX_RECORD_PIDS 5
+/** Number of receive buffers for recording. */
+#define RECORD_BUFFER_COUNT 32
+/** Size of the video bitstream FIFO. */
+#define VIDEO_FIFO_SIZE (4 * 1024 * 1024)
+/** Video FIFO fullness held by the clock recovery of live streams. */
+#define LIVE_TARGET_FULLNESS (VIDEO_FIFO_SIZE / 4)
+/** How often the clock recovery is updated with the video FIFO fullness. */
+#define LIVE_UPDATE_INTERVAL_US 100000
+/** How far the input of a live stream is fed ahead of its PCRs. */
+#define LIVE_LEAD_US 1000000
+/** Time to sleep when a live stream is fed ahead of its PCRs. */
+#define LIVE_WAIT_US 10000
 /** Print debug message. */
 #define DPRINTF(args...) \
 	do { \
@@ -66,14 +95,53 @@ typedef struct {
 	RMuint32 audio_timer; // 0
 	struct DCCDemuxTask *pDemuxTask;
 	RMuint32 ciphers[NUMCIPHERS];
+	/** Key entry with aeskey, valid if key_valid is set. */
+	RMuint32 key;
+	RMbool key_valid;
+	struct DCCDemuxRecorder *pRecorder;
+	int record_fd;
+	/** Software demuxer for transport streams. */
+	struct TSDemux *pTSDemux;
+	struct RUABufferPool *pAudioDMA;
+	RMbool video_stream;
+	RMbool audio_stream;
+	/** PID with the PCRs of the played program, valid when video_stream is set. */
+	RMuint32 pcr_pid;
+	RMuint32 video_pid;
+	RMuint32 audio_pid;
+	/** PIDs routed to RECORD_OUTPUT, 0 when the recording was not started. */
+	RMuint32 record_pids[MAX_RECORD_PIDS];
+	RMuint32 record_pid_count;
+	/** Position up to which the PAT and PMT were parsed. */
+	RMuint32 parsed;
+	/** Trims the STC to the encoder clock of live streams. */
+	struct DCCClockRecovery *pRecovery;
+	RMuint64 recovery_update_us;
+	/** First PCR and its arrival time, arrival time is 0 before the first PCR. */
+	RMuint64 live_start_pcr;
+	RMuint64 live_start_us;
+	RMuint64 live_pcr;
 } app_rua_context_t;
 
 /** Set to 1 to enable debug output. */
 static int debug = 0;
 /** Raw video stream data. */
-static uint8_t *videodata;
+static struct StreamIOMap *videomap;
 static size_t videosize;
 static volatile int stopped = 0;
+/** Set by SIGUSR1 to stop the recording while playing continues. */
+static volatile int record_stopped = 0;
+/** File where the demuxed stream is recorded, NULL to disable. */
+static const char *recordfile = NULL;
+/** Set when the file is a transport stream, which is demuxed by software. */
+static int use_tsdemux = 0;
+/** Set when a transport stream is recorded or descrambled, it is demuxed by the demux task. */
+static int ts_demuxtask = 0;
+/** AES key to descramble the transport stream, NULL for clear streams. */
+static RMuint8 *aeskey = NULL;
+static RMuint8 aeskey_buffer[16];
+/** Feed the transport stream in the pace of its PCRs like a broadcast and recover the clock. */
+static int live = 0;
 static app_rua_context_t context_g;
 
 static void cleanup(app_rua_context_t *context)
@@ -85,6 +153,30 @@ static void cleanup(app_rua_context_t *context)
 		return;
 	}
 
+	if (context->pTSDemux != NULL) {
+		rv = TSDemuxClose(context->pTSDemux);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot close TS demuxer, rv = %d\n", rv); 
+		}
+		context->pTSDemux = NULL;
+	}
+
+	if (context->pAudioDMA != NULL) {
+		rv = RUAClosePool(context->pAudioDMA);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot close pool, rv = %d\n", rv); 
+		}
+		context->pAudioDMA = NULL;
+	}
+
+	if (context->pRecovery != NULL) {
+		rv = DCCClockRecoveryClose(context->pRecovery);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot close clock recovery, rv = %d\n", rv); 
+		}
+		context->pRecovery = NULL;
+	}
+
 	if (context->pDMA != NULL) {
 		rv = RUAClosePool(context->pDMA);
 		if (RMFAILED(rv)) {
@@ -93,6 +185,42 @@ static void cleanup(app_rua_context_t *context)
 		context->pDMA = NULL;
 	}
 
+	if (context->pRecorder != NULL) {
+		rv = DCCCloseDemuxRecorder(context->pRecorder);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot close recorder, rv = %d\n", rv); 
+		}
+		context->pRecorder = NULL;
+	}
+	if (context->record_fd >= 0) {
+		close(context->record_fd);
+		context->record_fd = -1;
+	}
+
+	/* The demux task sends to the decoders, close it first. */
+	if (context->pDemuxTask) {
+		if (context->key_valid) {
+			rv = DCCFreeDemuxTaskKeyEntry(context->pDemuxTask, context->key);
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Cannot free key entry, rv = %d\n", rv); 
+			}
+			context->key_valid = FALSE;
+		}
+		for (i = 0; i < NUMCIPHERS; i++) {
+			rv = DCCFreeDemuxTaskCipherEntry(context->pDemuxTask, context->ciphers[i]);
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Cannot free cipher DemuxTask, rv = %d\n", rv); 
+			}
+			context->ciphers[i] = 0;
+		}
+
+		rv = DCCCloseDemuxTask(context->pDemuxTask);
+		if (RMFAILED(rv))  {
+			fprintf(stderr, "Cannot close DemuxTask, rv = %d\n", rv); 
+		}
+		context->pDemuxTask = NULL;
+	}
+
 #ifdef PLAY_AUDIO
 	if (context->pAudioSource != NULL) {
 		rv = DCCCloseAudioSource(context->pAudioSource);
@@ -111,22 +239,6 @@ static void cleanup(app_rua_context_t *context)
 		context->pVideoSource = NULL;
 	}
 
-	for (i = 0; i < NUMCIPHERS; i++) {
-		rv = RUASetProperty(context->pRUA, context->demux_decoder, RMDemuxTaskPropertyID_FreeCipherEntry, &context->ciphers[i], sizeof(context->ciphers[i]), 0);
-		if (RMFAILED(rv)) {
-			fprintf(stderr, "Cannot free cipher DemuxTask, rv = %d\n", rv); 
-		}
-		context->ciphers[i] = 0;
-	}
-
-	if (context->pDemuxTask) {
-		DCCCloseDemuxTask(context->pDemuxTask);
-		if (RMFAILED(rv))  {
-			fprintf(stderr, "Cannot close DemuxTask, rv = %d\n", rv); 
-		}
-		context->pDemuxTask = NULL;
-	}
-
 	if (context->pStcSource != NULL) {
 		rv = DCCSTCClose(context->pStcSource);
 		if (RMFAILED(rv))  {
@@ -161,6 +273,13 @@ static void signalhandler(int sig)
 	stopped = 1;
 }
 
+static void recordhandler(int sig)
+{
+	(void) sig;
+
+	record_stopped = 1;
+}
+
 static void signalcleanup(int sig)
 {
 	printf("Signal %d received, cleanup.\n", sig);
@@ -182,6 +301,7 @@ static RMstatus video_init(app_rua_context_t *context)
 	RMstatus rv;
 
 	memset(context, 0, sizeof(*context));
+	context->record_fd = -1;
 
 	rv = RUACreateInstance(&context->pRUA, DEFAULT_CHIP);
 	if (RMFAILED(rv)) {
@@ -213,21 +333,115 @@ static RMstatus video_init(app_rua_context_t *context)
 	return RM_OK;
 }
 
-static RMstatus configure_video(app_rua_context_t *context)
+/** Select the streams of the program stream. */
+static RMstatus set_pes_entries(app_rua_context_t *context)
+{
+	struct DCCDemuxPesEntry pes_entry;
+	RMstatus rv;
+
+	memset(&pes_entry, 0, sizeof(pes_entry));
+	pes_entry.Index = 0;
+	pes_entry.StreamID = 0x012a00e0; /* TBD: stream id */
+	pes_entry.SubStreamID = 0;
+	pes_entry.Input = 0x1001;
+	pes_entry.Enable = 1;
+	pes_entry.CipherMask = 0;
+	pes_entry.CipherIndex = 0;
+	rv = DCCSetDemuxTaskPesEntry(context->pDemuxTask, &pes_entry);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Failed RMDemuxTaskPropertyID_PesEntry, rv = %d\n", rv);
+		cleanup(context);
+		return rv;
+	}
+
+	memset(&pes_entry, 0, sizeof(pes_entry));
+	pes_entry.Index = 1;
+	pes_entry.StreamID = 0x012a00c0;
+	pes_entry.SubStreamID = 0;
+	pes_entry.Input = 0x1001;
+	pes_entry.Enable = 10;
+	pes_entry.CipherMask = 0;
+	pes_entry.CipherIndex = 0;
+	rv = DCCSetDemuxTaskPesEntry(context->pDemuxTask, &pes_entry);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Failed RMDemuxTaskPropertyID_PesEntry, rv = %d\n", rv);
+		cleanup(context);
+		return rv;
+	}
+
+	memset(&pes_entry, 0, sizeof(pes_entry));
+	pes_entry.Index = 2;
+	pes_entry.StreamID = 0x012a0000;
+	pes_entry.SubStreamID = 0;
+	pes_entry.Input = 0x1001;
+	pes_entry.Enable = 4;
+	pes_entry.CipherMask = 0;
+	pes_entry.CipherIndex = 0;
+	rv = DCCSetDemuxTaskPesEntry(context->pDemuxTask, &pes_entry);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Failed RMDemuxTaskPropertyID_PesEntry, rv = %d\n", rv);
+		cleanup(context);
+		return rv;
+	}
+
+	memset(&pes_entry, 0, sizeof(pes_entry));
+	pes_entry.Index = 3;
+	pes_entry.StreamID = 0x012a0000;
+	pes_entry.SubStreamID = 0;
+	pes_entry.Input = 0x1000;
+	pes_entry.Enable = 10;
+	pes_entry.CipherMask = 0;
+	pes_entry.CipherIndex = 0;
+	rv = DCCSetDemuxTaskPesEntry(context->pDemuxTask, &pes_entry);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Failed RMDemuxTaskPropertyID_PesEntry, rv = %d\n", rv);
+		cleanup(context);
+		return rv;
+	}
+	return RM_OK;
+}
+
+/** Load the AES key and select it in the first cipher, which is used by the scrambled PIDs. */
+static RMstatus set_aes_key(app_rua_context_t *context)
+{
+	struct DCCDemuxAESKey aes;
+	RMstatus rv;
+
+	rv = DCCAllocateDemuxTaskKeyEntry(context->pDemuxTask, &context->key);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot allocate key entry, rv = %d\n", rv);
+		cleanup(context);
+		return rv;
+	}
+	context->key_valid = TRUE;
+
+	memset(&aes, 0, sizeof(aes));
+	aes.Mode = DCCDemuxAESMode_ECB;
+	memcpy(aes.Key, aeskey, sizeof(aes.Key));
+	rv = DCCSetDemuxTaskAESKey(context->pDemuxTask, context->key, &aes);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot set AES key, rv = %d\n", rv);
+		cleanup(context);
+		return rv;
+	}
+
+	/* The key is fixed, so the scrambling control bits of the packets are not used. */
+	rv = DCCSetDemuxTaskOutbandKeyChange(context->pDemuxTask, context->ciphers[0], context->key);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot select AES key, rv = %d\n", rv);
+		cleanup(context);
+		return rv;
+	}
+	return RM_OK;
+}
+
+/** Configure the demux task which splits the program stream or the recorded transport stream. */
+static RMstatus configure_demux(app_rua_context_t *context)
 {
-	struct DCCStcProfile stc_profile;
 	RMstatus rv;
-	RMint32 video_delay_ms = 0;
-	RMint32 audio_delay_ms = 0;
-	struct DCCXVideoProfile video_profile;
-#ifdef PLAY_AUDIO
-	struct DCCAudioProfile audio_profile;
-	struct AudioDecoder_MpegParameters_type mp2_parameters;
-#endif
 	struct DCCDemuxTaskProfile demux_profile;
 	RMuint32 buffer_param[2];
 	RMuint32 buffer[1];
-	RMuint32 buffer_pes[7];
 	int i;
 
 	memset(&demux_profile, 0, sizeof(demux_profile));
@@ -254,26 +468,7 @@ static RMstatus configure_video(app_rua_context_t *context)
 		return rv;
 	}
 
-	memset(&stc_profile, 0, sizeof(stc_profile));
-	stc_profile.STCID = 0;
-	stc_profile.master = Master_STC;
-	stc_profile.stc_timer_id = 3 * stc_profile.STCID + 0;
-	stc_profile.stc_time_resolution = 90000;
-	stc_profile.video_timer_id = 3 * stc_profile.STCID + 1;
-	stc_profile.video_time_resolution = 90000;
-	stc_profile.video_offset = -(video_delay_ms * (RMint32)stc_profile.video_time_resolution / 1000);
-	stc_profile.audio_timer_id = 3 * stc_profile.STCID + 2;
-	stc_profile.audio_time_resolution = 90000;
-	stc_profile.audio_offset = -(audio_delay_ms * (RMint32)stc_profile.audio_time_resolution / 1000);
-
-	rv = DCCSTCOpen(context->pDCC, &stc_profile, &context->pStcSource);
-	if (RMFAILED(rv)) {
-		fprintf(stderr, "Cannot open STC, rv = %d\n", rv);
-		cleanup(context);
-		return rv;
-	}
-	memset(&video_profile, 0, sizeof(video_profile));
-
+	/* TBD: Not known whether transport streams need other input parameters. */
 	buffer_param[0] = 0;
 	buffer_param[1] = 3;
 	rv = RUASetProperty(context->pRUA, context->demux_decoder, RMDemuxTaskPropertyID_InputParameters, buffer_param, sizeof(buffer_param), 0);
@@ -351,74 +546,140 @@ static RMstatus configure_video(app_rua_context_t *context)
 
 	for (i = 0; i < NUMCIPHERS; i++) {
 		context->ciphers[i] = 0;
-		rv = RUAGetProperty(context->pRUA, context->demux_decoder, RMDemuxTaskPropertyID_AllocateCipherEntry, &context->ciphers[i], sizeof(context->ciphers[i]));
+		rv = DCCAllocateDemuxTaskCipherEntry(context->pDemuxTask, &context->ciphers[i]);
 		if (RMFAILED(rv)) {
 			cleanup(context);
 			return rv;
 		}
 	}
 
-	memset(buffer_pes, 0, sizeof(buffer_pes));
-	buffer_pes[0] = 0; /* index */
-	buffer_pes[1] = 0x012a00e0; /* TBD: stream id */
-	buffer_pes[2] = 0; /* sub stream id */
-	buffer_pes[3] = 0x1001; /* input */
-	buffer_pes[4] = 1; /* enable */
-	buffer_pes[5] = 0; /* cipher mask */
-	buffer_pes[6] = 0; /* cipher index */
-	rv = RUASetProperty(context->pRUA, context->demux_decoder, RMDemuxTaskPropertyID_PesEntry, buffer_pes, sizeof(buffer_pes), 0);
+	if (aeskey != NULL) {
+		rv = set_aes_key(context);
+		if (RMFAILED(rv)) {
+			return rv;
+		}
+	}
+
+	if (!ts_demuxtask) {
+		rv = set_pes_entries(context);
+		if (RMFAILED(rv)) {
+			return rv;
+		}
+	}
+
+	if (recordfile != NULL) {
+		struct DCCDemuxRecorderProfile record_profile;
+
+		context->record_fd = open(recordfile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (context->record_fd < 0) {
+			fprintf(stderr, "Error: Failed to open \"%s\".\n", recordfile);
+			cleanup(context);
+			return RM_ERROR;
+		}
+
+		memset(&record_profile, 0, sizeof(record_profile));
+		record_profile.Output = RECORD_OUTPUT;
+		record_profile.DataType = DCCDemuxDataType_TS;
+		record_profile.BufferCount = RECORD_BUFFER_COUNT;
+		record_profile.log2BufferSize = DMA_BUFFER_SIZE_LOG2;
+		rv = DCCOpenDemuxRecorder(context->pRUA, context->pDemuxTask, &record_profile, &context->pRecorder);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot open recorder, rv = %d\n", rv);
+			cleanup(context);
+			return rv;
+		}
+	}
+
+	buffer[0] = 8;
+	rv = RUASetProperty(context->pRUA, DemuxOutput, RMDemuxOutputPropertyID_Enable, buffer, sizeof(buffer), 0);
 	if (RMFAILED(rv)) {
-		fprintf(stderr, "Failed RMDemuxTaskPropertyID_PesEntry, rv = %d\n", rv);
+		fprintf(stderr, "Failed RMDemuxOutputPropertyID_Enable, rv = %d\n", rv);
 		cleanup(context);
 		return rv;
 	}
 
-	memset(buffer_pes, 0, sizeof(buffer_pes));
-	buffer_pes[0] = 1;
-	buffer_pes[1] = 0x012a00c0;
-	buffer_pes[2] = 0;
-	buffer_pes[3] = 0x1001;
-	buffer_pes[4] = 10;
-	buffer_pes[5] = 0;
-	buffer_pes[6] = 0;
-	rv = RUASetProperty(context->pRUA, context->demux_decoder, RMDemuxTaskPropertyID_PesEntry, buffer_pes, sizeof(buffer_pes), 0);
+	buffer[0] = 7;
+	rv = RUASetProperty(context->pRUA, DemuxOutput, RMDemuxOutputPropertyID_DataType, buffer, sizeof(buffer), 0);
 	if (RMFAILED(rv)) {
-		fprintf(stderr, "Failed RMDemuxTaskPropertyID_PesEntry, rv = %d\n", rv);
+		fprintf(stderr, "Failed line %u, rv = %d\n", __LINE__, rv);
 		cleanup(context);
 		return rv;
 	}
 
-	memset(buffer_pes, 0, sizeof(buffer_pes));
-	buffer_pes[0] = 2;
-	buffer_pes[1] = 0x012a0000;
-	buffer_pes[2] = 0;
-	buffer_pes[3] = 0x1001;
-	buffer_pes[4] = 4;
-	buffer_pes[5] = 0;
-	buffer_pes[6] = 0;
-	rv = RUASetProperty(context->pRUA, context->demux_decoder, RMDemuxTaskPropertyID_PesEntry, buffer_pes, sizeof(buffer_pes), 0);
+	if (ts_demuxtask) {
+		/* TBD: Same settings as for the video output, not verified for audio. */
+		buffer[0] = 8;
+		rv = RUASetProperty(context->pRUA, EMHWLIB_MODULE(DemuxOutput, AUDIO_OUTPUT), RMDemuxOutputPropertyID_Enable, buffer, sizeof(buffer), 0);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Failed RMDemuxOutputPropertyID_Enable, rv = %d\n", rv);
+			cleanup(context);
+			return rv;
+		}
+
+		buffer[0] = DCCDemuxDataType_ES;
+		rv = RUASetProperty(context->pRUA, EMHWLIB_MODULE(DemuxOutput, AUDIO_OUTPUT), RMDemuxOutputPropertyID_DataType, buffer, sizeof(buffer), 0);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Failed line %u, rv = %d\n", __LINE__, rv);
+			cleanup(context);
+			return rv;
+		}
+	}
+
+#if 1
+	buffer_param[0] = 0; // partial read
+	buffer_param[1] = 0; // size
+	rv = RUASetProperty(context->pRUA, DemuxOutput, RMGenericPropertyID_Threshold, buffer_param, sizeof(buffer_param), 0);
 	if (RMFAILED(rv)) {
-		fprintf(stderr, "Failed RMDemuxTaskPropertyID_PesEntry, rv = %d\n", rv);
+		fprintf(stderr, "Failed line %u, rv = %d\n", __LINE__, rv);
+#if 0 // TBD: Fix
 		cleanup(context);
 		return rv;
+#endif
+	}
+#endif
+	return RM_OK;
+}
+
+static RMstatus configure_video(app_rua_context_t *context)
+{
+	struct DCCStcProfile stc_profile;
+	RMstatus rv;
+	RMint32 video_delay_ms = 0;
+	RMint32 audio_delay_ms = 0;
+	struct DCCXVideoProfile video_profile;
+#ifdef PLAY_AUDIO
+	struct DCCAudioProfile audio_profile;
+	struct AudioDecoder_MpegParameters_type mp2_parameters;
+#endif
+
+	if (!use_tsdemux) {
+		rv = configure_demux(context);
+		if (RMFAILED(rv)) {
+			return rv;
+		}
 	}
 
-	memset(buffer_pes, 0, sizeof(buffer_pes));
-	buffer_pes[0] = 3;
-	buffer_pes[1] = 0x012a0000;
-	buffer_pes[2] = 0;
-	buffer_pes[3] = 0x1000;
-	buffer_pes[4] = 10;
-	buffer_pes[5] = 0;
-	buffer_pes[6] = 0;
-	rv = RUASetProperty(context->pRUA, context->demux_decoder, RMDemuxTaskPropertyID_PesEntry, buffer_pes, sizeof(buffer_pes), 0);
+	memset(&stc_profile, 0, sizeof(stc_profile));
+	stc_profile.STCID = 0;
+	stc_profile.master = Master_STC;
+	stc_profile.stc_timer_id = 3 * stc_profile.STCID + 0;
+	stc_profile.stc_time_resolution = 90000;
+	stc_profile.video_timer_id = 3 * stc_profile.STCID + 1;
+	stc_profile.video_time_resolution = 90000;
+	stc_profile.video_offset = -(video_delay_ms * (RMint32)stc_profile.video_time_resolution / 1000);
+	stc_profile.audio_timer_id = 3 * stc_profile.STCID + 2;
+	stc_profile.audio_time_resolution = 90000;
+	stc_profile.audio_offset = -(audio_delay_ms * (RMint32)stc_profile.audio_time_resolution / 1000);
+
+	rv = DCCSTCOpen(context->pDCC, &stc_profile, &context->pStcSource);
 	if (RMFAILED(rv)) {
-		fprintf(stderr, "Failed RMDemuxTaskPropertyID_PesEntry, rv = %d\n", rv);
+		fprintf(stderr, "Cannot open STC, rv = %d\n", rv);
 		cleanup(context);
 		return rv;
 	}
+	memset(&video_profile, 0, sizeof(video_profile));
 
-	video_profile.BitstreamFIFOSize = 4 * 1024 * 1024;
+	video_profile.BitstreamFIFOSize = VIDEO_FIFO_SIZE;
 	video_profile.XferFIFOCount = 0;
 	video_profile.MpegEngineID = DEFAULT_DRAM_CONTROLLER;
 	video_profile.VideoDecoderID = 0;
@@ -467,35 +728,6 @@ static RMstatus configure_video(app_rua_context_t *context)
 		return rv;
 	}
 
-	buffer[0] = 8;
-	rv = RUASetProperty(context->pRUA, DemuxOutput, RMDemuxOutputPropertyID_Enable, buffer, sizeof(buffer), 0);
-	if (RMFAILED(rv)) {
-		fprintf(stderr, "Failed RMDemuxOutputPropertyID_Enable, rv = %d\n", rv);
-		cleanup(context);
-		return rv;
-	}
-
-	buffer[0] = 7;
-	rv = RUASetProperty(context->pRUA, DemuxOutput, RMDemuxOutputPropertyID_DataType, buffer, sizeof(buffer), 0);
-	if (RMFAILED(rv)) {
-		fprintf(stderr, "Failed line %u, rv = %d\n", __LINE__, rv);
-		cleanup(context);
-		return rv;
-	}
-
-#if 1
-	buffer_param[0] = 0; // partial read
-	buffer_param[1] = 0; // size
-	rv = RUASetProperty(context->pRUA, DemuxOutput, RMGenericPropertyID_Threshold, buffer_param, sizeof(buffer_param), 0);
-	if (RMFAILED(rv)) {
-		fprintf(stderr, "Failed line %u, rv = %d\n", __LINE__, rv);
-#if 0 // TBD: Fix
-		cleanup(context);
-		return rv;
-#endif
-	}
-#endif
-
 #ifdef PLAY_AUDIO
 	audio_profile.BitstreamFIFOSize = 512 * 1024;
 	audio_profile.XferFIFOCount = 0;
@@ -555,7 +787,7 @@ static RMstatus configure_video(app_rua_context_t *context)
 	return RM_OK;
 }
 
-static RMstatus transfer_data(app_rua_context_t *context, RMuint32 *transferred, RMuint8 *data, RMuint32 datasize, RMuint32 decoder, RMuint8 **pbuffer)
+static RMstatus transfer_data(app_rua_context_t *context, RMuint32 *transferred, struct StreamIOMap *map, RMuint32 datasize, RMuint32 decoder, RMuint8 **pbuffer)
 {
 	RMuint32 size;
 	RMstatus rv;
@@ -571,6 +803,14 @@ static RMstatus transfer_data(app_rua_context_t *context, RMuint32 *transferred,
 	}
 
 	if (*pbuffer == NULL) {
+		RMuint8 *data;
+
+		rv = StreamIOMapGet(map, *transferred, size, &data);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot read data at %u, rv = %d\n", *transferred, rv);
+			cleanup(context);
+			return rv;
+		}
 		rv = RUAGetBuffer(context->pDMA, pbuffer, 0);
 		if (RMFAILED(rv)) {
 			*pbuffer = NULL;
@@ -581,7 +821,7 @@ static RMstatus transfer_data(app_rua_context_t *context, RMuint32 *transferred,
 			}
 			return rv;
 		}
-		memcpy(*pbuffer, &data[*transferred], size);
+		memcpy(*pbuffer, data, size);
 	}
 
 	memset(&video_info, 0, sizeof(video_info));
@@ -611,60 +851,388 @@ static RMstatus transfer_data(app_rua_context_t *context, RMuint32 *transferred,
 	return RM_OK;
 }
 
-static RMstatus play_video(app_rua_context_t *context)
+/** Write all data which was received for the recording. */
+static RMstatus write_recording(app_rua_context_t *context, RMuint32 TimeOut_us)
 {
 	RMstatus rv;
-	RMuint32 demuxtransferred;
-	int playing = 0;
-	RMuint64 time;
-	RMuint8 *demuxbuffer = NULL;
-	RMuint32 buffer[1];
-	RMuint32 buffer_param[2];
 
-	if (stopped) {
-		printf("Received signal, stopping...\n");
+	if (context->pRecorder == NULL) {
 		return RM_OK;
 	}
+	do {
+		rv = DCCDemuxRecorderWrite(context->pRecorder, context->record_fd, TimeOut_us, NULL);
+	} while (rv == RM_OK);
+	if (rv != RM_PENDING) {
+		fprintf(stderr, "Failed to record, rv = %d\n", rv);
+		return rv;
+	}
+	return RM_OK;
+}
+
+/** Send an elementary stream to a decoder, by the demux task when recording, else by the software demuxer. */
+static RMstatus add_ts_stream(app_rua_context_t *context, RMuint32 pid, RMuint32 output, RMuint32 moduleid, struct RUABufferPool *pPool)
+{
+	struct TSDemuxOutput ts_output;
+
+	if (ts_demuxtask) {
+		if (aeskey != NULL) {
+			struct DCCDemuxPidEntry entry;
+
+			/* The entries of the decoder outputs are set first, so their index is free. */
+			memset(&entry, 0, sizeof(entry));
+			entry.Index = output;
+			entry.PID = pid;
+			entry.OutputMask = 1 << output;
+			entry.CipherMask = 1;
+			entry.CipherIndex = context->ciphers[0];
+			return DCCSetDemuxTaskPidEntry(context->pDemuxTask, &entry);
+		}
+		/* The PID entry is shared with the recording, the packets are demuxed once. */
+		return DCCAddDemuxTaskPidOutputs(context->pDemuxTask, pid, 1 << output);
+	}
+	memset(&ts_output, 0, sizeof(ts_output));
+	ts_output.pRua = context->pRUA;
+	ts_output.ModuleID = moduleid;
+	ts_output.pPool = pPool;
+	ts_output.BufferSize = DMA_BUFFER_SIZE;
+	return TSDemuxAddStream(context->pTSDemux, pid, &ts_output);
+}
+
+static void add_record_pid(app_rua_context_t *context, RMuint32 *count, RMuint32 pid)
+{
+	RMuint32 i;
+
+	for (i = 0; i < *count; i++) {
+		if (context->record_pids[i] == pid) {
+			return;
+		}
+	}
+	context->record_pids[(*count)++] = pid;
+}
+
+/** Route the PIDs of the played program also to the record output. */
+static RMstatus start_recording(app_rua_context_t *context, struct TSDemuxProgram *program)
+{
+	RMuint32 count = 0;
+	RMstatus rv;
+
+	add_record_pid(context, &count, 0); /* PAT */
+	add_record_pid(context, &count, program->PmtPID);
+	add_record_pid(context, &count, program->PcrPID);
+	add_record_pid(context, &count, context->video_pid);
+	if (context->audio_stream) {
+		add_record_pid(context, &count, context->audio_pid);
+	}
+	rv = DCCAddDemuxTaskProgram(context->pDemuxTask, context->record_pids, count, 1 << RECORD_OUTPUT);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot route program to the record output, rv = %d\n", rv);
+		return rv;
+	}
+	DPRINTF("Recording %u PIDs\n", count);
+	context->record_pid_count = count;
+	return RM_OK;
+}
+
+/** Stop recording, the played PIDs stay routed to the decoders. */
+static RMstatus stop_recording(app_rua_context_t *context)
+{
+	RMstatus rv;
+
+	if (context->record_pid_count == 0) {
+		return RM_OK;
+	}
+	rv = DCCRemoveDemuxTaskProgram(context->pDemuxTask, context->record_pids, context->record_pid_count, 1 << RECORD_OUTPUT);
+	context->record_pid_count = 0;
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot stop recording, rv = %d\n", rv);
+	}
+	return rv;
+}
+
+/** Select the first video and audio stream of the transport stream. */
+static void ts_program(void *opaque, struct TSDemuxProgram *program)
+{
+	app_rua_context_t *context = opaque;
+	RMuint32 i;
+	RMstatus rv;
+
+	for (i = 0; i < program->StreamCount; i++) {
+		struct TSDemuxStreamInfo *info = &program->Streams[i];
+
+		switch (info->StreamType) {
+			case 0x01: /* MPEG-1 video */
+			case 0x02: /* MPEG-2 video */
+				if (context->video_stream) {
+					continue;
+				}
+				rv = add_ts_stream(context, info->PID, VIDEO_OUTPUT, context->video_decoder, context->pDMA);
+				if (rv == RM_OK) {
+					DPRINTF("Video PID 0x%04x\n", info->PID);
+					context->video_stream = TRUE;
+					context->video_pid = info->PID;
+					context->pcr_pid = program->PcrPID;
+				}
+				break;
+
+#ifdef PLAY_AUDIO
+			case 0x03: /* MPEG-1 audio */
+			case 0x04: /* MPEG-2 audio */
+				if (context->audio_stream) {
+					continue;
+				}
+				rv = add_ts_stream(context, info->PID, AUDIO_OUTPUT, context->audio_decoder, context->pAudioDMA);
+				if (rv == RM_OK) {
+					DPRINTF("Audio PID 0x%04x\n", info->PID);
+					context->audio_stream = TRUE;
+					context->audio_pid = info->PID;
+				}
+				break;
+#endif
+
+			default:
+				break;
+		}
+	}
+	if (ts_demuxtask && context->video_stream && (context->pRecorder != NULL) && (context->record_pid_count == 0) && !record_stopped) {
+		start_recording(context, program);
+	}
+}
+
+static RMuint64 get_monotonic_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((RMuint64) ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/** PCR of the played program, pcr is in 27 MHz. */
+static void ts_pcr(void *opaque, RMuint32 pid, RMuint64 pcr)
+{
+	app_rua_context_t *context = opaque;
+	RMuint64 now;
+	RMstatus rv;
+
+	if ((context->pRecovery == NULL) || !context->video_stream || (pid != context->pcr_pid)) {
+		return;
+	}
+	now = get_monotonic_us();
+	rv = DCCClockRecoveryAddPCR(context->pRecovery, pcr, 27000000, now);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot add PCR, rv = %d\n", rv);
+	}
+	if ((context->live_start_us == 0) || (pcr < context->live_pcr)) {
+		/* Start or discontinuity, pace the input from here. */
+		context->live_start_pcr = pcr;
+		context->live_start_us = now;
+	}
+	context->live_pcr = pcr;
+}
+
+/** Time stamps of the PES headers sent to the decoders. */
+static void ts_pes(void *opaque, struct TSDemuxPESInfo *info)
+{
+	(void) opaque;
+
+	if (info->DTSValid) {
+		DPRINTF("PID 0x%04x PTS %llu DTS %llu\n", info->PID, (unsigned long long) info->PTS, (unsigned long long) info->DTS);
+	} else {
+		DPRINTF("PID 0x%04x PTS %llu\n", info->PID, (unsigned long long) info->PTS);
+	}
+}
+
+/**
+ * Update the clock recovery with the video FIFO fullness and hold back
+ * the input of a live stream until its PCRs are due.
+ *
+ * @returns RM_PENDING when no data should be fed yet.
+ */
+static RMstatus update_live(app_rua_context_t *context)
+{
+	struct DCCFIFOLevel level;
+	RMuint64 now;
+	RMstatus rv;
+
+	now = get_monotonic_us();
+	if ((now - context->recovery_update_us) >= LIVE_UPDATE_INTERVAL_US) {
+		context->recovery_update_us = now;
+		rv = DCCGetVideoFIFOLevel(context->pVideoSource, 90000, &level);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot get video FIFO level, rv = %d\n", rv);
+			return rv;
+		}
+		rv = DCCClockRecoveryUpdate(context->pRecovery, level.BitstreamFullness);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot update clock recovery, rv = %d\n", rv);
+			return rv;
+		}
+	}
+	if ((context->live_start_us != 0)
+		&& (((context->live_pcr - context->live_start_pcr) / 27) > (now - context->live_start_us + LIVE_LEAD_US))) {
+		return RM_PENDING;
+	}
+	return RM_OK;
+}
 
-	rv = RUAOpenPool(context->pRUA, context->demux_decoder, 96, DMA_BUFFER_SIZE_LOG2, RUA_POOL_DIRECTION_SEND, &context->pDMA);
+/**
+ * Parse the PAT and PMT in the data which is sent next to the demux task,
+ * so that the PIDs are routed before the demux task gets the packets.
+ */
+static RMstatus parse_tables(app_rua_context_t *context, RMuint32 transferred)
+{
+	RMuint32 end;
+	RMuint32 consumed;
+	RMuint8 *data;
+	RMstatus rv;
+
+	end = transferred + DMA_BUFFER_SIZE;
+	if (end > videosize) {
+		end = videosize;
+	}
+	while (context->parsed < end) {
+		rv = StreamIOMapGet(videomap, context->parsed, end - context->parsed, &data);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot read data at %u, rv = %d\n", context->parsed, rv);
+			return rv;
+		}
+		rv = TSDemuxFeed(context->pTSDemux, data, end - context->parsed, &consumed);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot parse transport stream, rv = %d\n", rv);
+			return rv;
+		}
+		if (consumed == 0) {
+			break;
+		}
+		context->parsed += consumed;
+	}
+	return RM_OK;
+}
+
+/** Set up the software demuxer which sends the elementary streams to the decoders. */
+static RMstatus open_tsdemux(app_rua_context_t *context)
+{
+	RMstatus rv;
+
+	rv = RUAOpenPool(context->pRUA, context->video_decoder, 96, DMA_BUFFER_SIZE_LOG2, RUA_POOL_DIRECTION_SEND, &context->pDMA);
 	if (RMFAILED(rv)) {
 		fprintf(stderr, "Cannot open RUA pool, rv = %d\n", rv);
 		cleanup(context);
 		return rv;
 	}
 
-	buffer_param[0] = context->demux_decoder;
-	buffer_param[1] = context->video_decoder;
-	rv = RUASetProperty(context->pRUA, DemuxOutput, RMDemuxOutputPropertyID_Connect, buffer_param, sizeof(buffer_param), 0);
+#ifdef PLAY_AUDIO
+	rv = RUAOpenPool(context->pRUA, context->audio_decoder, AUDIO_BUFFER_COUNT, DMA_BUFFER_SIZE_LOG2, RUA_POOL_DIRECTION_SEND, &context->pAudioDMA);
 	if (RMFAILED(rv)) {
-		fprintf(stderr, "Failed RMDemuxOutputPropertyID_Connect, rv = %d\n", rv);
+		fprintf(stderr, "Cannot open RUA pool, rv = %d\n", rv);
 		cleanup(context);
 		return rv;
 	}
+#endif
 
-	buffer[0] = 0;
-	rv = RUASetProperty(context->pRUA, DemuxOutput, RMDemuxOutputPropertyID_Trigger, buffer, sizeof(buffer), 0);
+	rv = TSDemuxOpen(&context->pTSDemux);
 	if (RMFAILED(rv)) {
-		fprintf(stderr, "Failed line %u, rv = %d\n", __LINE__, rv);
+		fprintf(stderr, "Cannot open TS demuxer, rv = %d\n", rv);
 		cleanup(context);
 		return rv;
 	}
 
-	buffer[0] = 0;
-	rv = RUASetProperty(context->pRUA, DemuxOutput, RMDemuxOutputPropertyID_TransportPriority, buffer, sizeof(buffer), 0);
+	rv = TSDemuxSetCallbacks(context->pTSDemux, ts_program, ts_pcr, context);
 	if (RMFAILED(rv)) {
-		fprintf(stderr, "Failed line %u, rv = %d\n", __LINE__, rv);
 		cleanup(context);
 		return rv;
 	}
+	if (debug) {
+		rv = TSDemuxSetPESCallback(context->pTSDemux, ts_pes);
+		if (RMFAILED(rv)) {
+			cleanup(context);
+			return rv;
+		}
+	}
+	return RM_OK;
+}
 
-	buffer[0] = 1;
-	rv = RUASetProperty(context->pRUA, DemuxOutput, RMDemuxOutputPropertyID_Trigger, buffer, sizeof(buffer), 0);
+/** Demux the next part of the transport stream. */
+static RMstatus feed_tsdemux(app_rua_context_t *context, RMuint32 *transferred)
+{
+	RMuint32 size;
+	RMuint32 consumed = 0;
+	RMuint8 *data;
+	RMstatus rv;
+
+	size = videosize - *transferred;
+	if (size > DMA_BUFFER_SIZE) {
+		size = DMA_BUFFER_SIZE;
+	}
+	rv = StreamIOMapGet(videomap, *transferred, size, &data);
 	if (RMFAILED(rv)) {
-		fprintf(stderr, "Failed line %u, rv = %d\n", __LINE__, rv);
+		fprintf(stderr, "Cannot read data at %u, rv = %d\n", *transferred, rv);
 		cleanup(context);
 		return rv;
 	}
+	rv = TSDemuxFeed(context->pTSDemux, data, size, &consumed);
+	*transferred += consumed;
+	if (RMFAILED(rv) && (rv != RM_PENDING)) {
+		fprintf(stderr, "Cannot demux transport stream, rv = %d\n", rv);
+		cleanup(context);
+	}
+	return rv;
+}
+
+static RMstatus play_video(app_rua_context_t *context)
+{
+	RMstatus rv;
+	RMuint32 demuxtransferred;
+	int playing = 0;
+	RMuint64 time;
+	RMuint8 *demuxbuffer = NULL;
+
+	if (stopped) {
+		printf("Received signal, stopping...\n");
+		return RM_OK;
+	}
+
+	if (use_tsdemux) {
+		rv = open_tsdemux(context);
+		if (RMFAILED(rv)) {
+			return rv;
+		}
+	} else {
+		rv = RUAOpenPool(context->pRUA, context->demux_decoder, 96, DMA_BUFFER_SIZE_LOG2, RUA_POOL_DIRECTION_SEND, &context->pDMA);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot open RUA pool, rv = %d\n", rv);
+			cleanup(context);
+			return rv;
+		}
+
+		rv = DCCConnectDemuxOutputToVideoSource(context->pDemuxTask, VIDEO_OUTPUT, context->pVideoSource);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Failed RMDemuxOutputPropertyID_Connect, rv = %d\n", rv);
+			cleanup(context);
+			return rv;
+		}
+	}
+	if (ts_demuxtask) {
+#ifdef PLAY_AUDIO
+		rv = DCCConnectDemuxOutputToAudioSource(context->pDemuxTask, AUDIO_OUTPUT, context->pAudioSource);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Failed RMDemuxOutputPropertyID_Connect, rv = %d\n", rv);
+			cleanup(context);
+			return rv;
+		}
+#endif
+		/* The software demuxer only parses the PAT and PMT to find the PIDs. */
+		rv = TSDemuxOpen(&context->pTSDemux);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot open TS demuxer, rv = %d\n", rv);
+			cleanup(context);
+			return rv;
+		}
+		rv = TSDemuxSetCallbacks(context->pTSDemux, ts_program, ts_pcr, context);
+		if (RMFAILED(rv)) {
+			cleanup(context);
+			return rv;
+		}
+	}
 
 	rv = DCCSTCSetTimeResolution(context->pStcSource, DCC_Stc, 24000);
 	if (RMFAILED(rv)) {
@@ -715,6 +1283,23 @@ static RMstatus play_video(app_rua_context_t *context)
 		return rv;
 	}
 
+	if ((use_tsdemux || ts_demuxtask) && live) {
+		struct DCCClockRecoveryProfile recovery_profile;
+
+		memset(&recovery_profile, 0, sizeof(recovery_profile));
+		recovery_profile.target_fullness = LIVE_TARGET_FULLNESS;
+		recovery_profile.kp = 50;
+		recovery_profile.ki = 5;
+		recovery_profile.max_ppm = 300;
+		recovery_profile.min_step_ppm = 2;
+		rv = DCCClockRecoveryOpen(context->pStcSource, &recovery_profile, &context->pRecovery);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot open clock recovery, rv = %d\n", rv);
+			cleanup(context);
+			return rv;
+		}
+	}
+
 	/* Call DCCPlayMultipleAudioSource() instead. */
 	rv = DCCPlayVideoSource(context->pVideoSource, DCCVideoPlayFwd);
 	if (RMFAILED(rv)) {
@@ -731,11 +1316,13 @@ static RMstatus play_video(app_rua_context_t *context)
 		return rv;
 	}
 #endif
-	rv = DCCPlayDemuxTask(context->pDemuxTask);
-	if (RMFAILED(rv)) {
-		fprintf(stderr, "Cannot play demux task, rv = %d\n", rv);
-		cleanup(context);
-		return rv;
+	if (!use_tsdemux) {
+		rv = DCCPlayDemuxTask(context->pDemuxTask);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot play demux task, rv = %d\n", rv);
+			cleanup(context);
+			return rv;
+		}
 	}
 
 	rv = DCCSTCGetTime(context->pStcSource, &time, 90000); // TBD Use this to synchronize?
@@ -752,13 +1339,44 @@ static RMstatus play_video(app_rua_context_t *context)
 			printf("Received signal, stopping...\n");
 			break;
 		}
-		if (demuxtransferred < videosize) {
+		if (context->pRecovery != NULL) {
+			rv = update_live(context);
+			if (rv == RM_PENDING) {
+				usleep(LIVE_WAIT_US);
+				continue;
+			}
+			if (RMFAILED(rv)) {
+				cleanup(context);
+				return rv;
+			}
+		}
+		if (use_tsdemux) {
+			rv = feed_tsdemux(context, &demuxtransferred);
+			if ((rv != RM_OK) && (rv != RM_PENDING)) {
+				return rv;
+			}
+		} else if (demuxtransferred < videosize) {
+			if (ts_demuxtask) {
+				rv = parse_tables(context, demuxtransferred);
+				if (RMFAILED(rv)) {
+					cleanup(context);
+					return rv;
+				}
+			}
 			/* Send video stream data which should be played. */
-			rv = transfer_data(context, &demuxtransferred, videodata, videosize, context->demux_decoder, &demuxbuffer);
+			rv = transfer_data(context, &demuxtransferred, videomap, videosize, context->demux_decoder, &demuxbuffer);
 			if ((rv != RM_OK) && (rv != RM_PENDING)) {
 				return rv;
 			}
 		}
+		if (record_stopped && (context->record_pid_count != 0)) {
+			printf("Stop recording\n");
+			stop_recording(context);
+		}
+		rv = write_recording(context, 0);
+		if (rv != RM_OK) {
+			return rv;
+		}
 		if (stopped) {
 			printf("Received signal, stopping...\n");
 			break;
@@ -791,6 +1409,13 @@ static RMstatus play_video(app_rua_context_t *context)
 		}
 	}
 
+	if (use_tsdemux) {
+		/* Send the last partially filled buffers. */
+		do {
+			rv = TSDemuxFlush(context->pTSDemux);
+		} while ((rv == RM_PENDING) && !stopped);
+	}
+
 	if (demuxbuffer != NULL) {
 		rv = RUAReleaseBuffer(context->pDMA, demuxbuffer);
 		if (RMFAILED(rv)) {
@@ -803,14 +1428,20 @@ static RMstatus play_video(app_rua_context_t *context)
 		if (!stopped) {
 			sleep(3); /* TBD: Find a better way to detect if playing of the video finished. */
 		}
+		write_recording(context, 0);
+		/* Data which is still in the receive pool is written below. */
+		stop_recording(context);
+		write_recording(context, 0);
 
 		printf("Stop play\n");
 
-		rv = DCCStopDemuxTask(context->pDemuxTask);
-		if (RMFAILED(rv)) {
-			fprintf(stderr, "Cannot stop demux task, rv = %d\n", rv);
-			cleanup(context);
-			return rv;
+		if (!use_tsdemux) {
+			rv = DCCStopDemuxTask(context->pDemuxTask);
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Cannot stop demux task, rv = %d\n", rv);
+				cleanup(context);
+				return rv;
+			}
 		}
 		rv = DCCSTCStop(context->pStcSource);
 		if (RMFAILED(rv)) {
@@ -835,6 +1466,21 @@ static RMstatus play_video(app_rua_context_t *context)
 		playing = 0;
 	}
 
+	if (context->pTSDemux != NULL) {
+		rv = TSDemuxClose(context->pTSDemux);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot close TS demuxer, rv = %d\n", rv); 
+		}
+		context->pTSDemux = NULL;
+	}
+	if (context->pAudioDMA != NULL) {
+		rv = RUAClosePool(context->pAudioDMA);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot close pool, rv = %d\n", rv); 
+		}
+		context->pAudioDMA = NULL;
+	}
+
 	rv = RUAClosePool(context->pDMA);
 	if (RMFAILED(rv)) {
 		fprintf(stderr, "Cannot close pool, rv = %d\n", rv); 
@@ -843,39 +1489,47 @@ static RMstatus play_video(app_rua_context_t *context)
 	return RM_OK;
 }
 
-static int read_file(const char *filename, uint8_t **data, size_t *size)
+/** Convert a key given as 32 hex digits. */
+static int parse_key(const char *text, RMuint8 *key, RMuint32 size)
 {
-	int fd;
-	off_t offset;
-	int rv = -1;
+	RMuint32 i;
 
-	fd = open(filename, O_RDONLY);
-	if (fd < 0) {
-		fprintf(stderr, "Error: Failed to open \"%s\".\n", filename);
+	if (strlen(text) != (2 * size)) {
 		return -1;
 	}
-	offset = lseek(fd, 0, SEEK_END);
-	if (offset != -1) {
-		void *ptr;
+	for (i = 0; i < size; i++) {
+		unsigned int value;
 
-		ptr = mmap(NULL, offset, PROT_READ, MAP_SHARED, fd, 0);
-		if (ptr == MAP_FAILED) {
-			rv = -1;
-		} else {
-			rv = 0;
-			*data = ptr;
-			*size = offset;
+		if (!isxdigit((unsigned char) text[2 * i]) || !isxdigit((unsigned char) text[2 * i + 1])
+			|| (sscanf(&text[2 * i], "%2x", &value) != 1)) {
+			return -1;
 		}
+		key[i] = value;
 	}
-	close(fd);
-	return rv;
+	return 0;
+}
+
+/** Map the file in a window, so played data doesn't fill the memory. */
+static int read_file(const char *filename, struct StreamIOMap **map, size_t *size)
+{
+	RMstatus rv;
+
+	rv = StreamIOMapOpen(filename, MAP_WINDOW_SIZE, map);
+	if (RMFAILED(rv)) {
+		return -1;
+	}
+	*size = StreamIOMapGetSize(*map);
+	return 0;
 }
 
 static void usage(char *argv[])
 {
-	fprintf(stderr, "%s [video file] [audio file]\n", argv[0]);
+	fprintf(stderr, "%s [-l] [-k AES key] [-r record file] [video file]\n", argv[0]);
 	fprintf(stderr, "\n");
-	fprintf(stderr, "This program plays mpeg1 videos.\n");
+	fprintf(stderr, "This program plays mpeg1 videos and MPEG transport streams.\n");
+	fprintf(stderr, "-k Descramble the video and audio of a transport stream with an AES key of 32 hex digits.\n");
+	fprintf(stderr, "-l Feed a transport stream in the pace of its PCRs and recover the clock like for a broadcast.\n");
+	fprintf(stderr, "-r Record the played program of a transport stream to a file, SIGUSR1 stops the recording.\n");
 	fprintf(stderr, "\n");
 }
 
@@ -885,22 +1539,60 @@ int main(int argc, char *argv[])
 	int ret;
 	const char *videofile;
 	app_rua_context_t *context = &context_g;
-
-	if (argc < 2) {
+	RMuint8 *probedata;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "k:lr:")) != -1) {
+		switch (opt) {
+			case 'k':
+				if (parse_key(optarg, aeskey_buffer, sizeof(aeskey_buffer)) < 0) {
+					fprintf(stderr, "Error: AES key must have 32 hex digits.\n");
+					exit(1);
+				}
+				aeskey = aeskey_buffer;
+				break;
+
+			case 'l':
+				live = 1;
+				break;
+
+			case 'r':
+				recordfile = optarg;
+				break;
+
+			default:
+				usage(argv);
+				exit(1);
+		}
+	}
+	if (optind >= argc) {
 		fprintf(stderr, "Error: Parameter missing.\n");
 
 		usage(argv);
 		exit(1);
 	}
-	videofile = argv[1];
+	videofile = argv[optind];
 
-	videodata = NULL;
+	videomap = NULL;
 	videosize = 0;
-	ret = read_file(videofile, &videodata, &videosize);
+	ret = read_file(videofile, &videomap, &videosize);
 	if (ret < 0) {
 		fprintf(stderr, "Error failed to read \"%s\".\n", videofile);
 		return ret;
 	}
+	if ((videosize >= TSDEMUX_PROBE_SIZE)
+		&& (StreamIOMapGet(videomap, 0, TSDEMUX_PROBE_SIZE, &probedata) == RM_OK)
+		&& TSDemuxProbe(probedata, TSDEMUX_PROBE_SIZE, NULL)) {
+		DPRINTF("Transport stream detected\n");
+		if ((recordfile != NULL) || (aeskey != NULL)) {
+			ts_demuxtask = 1;
+		} else {
+			use_tsdemux = 1;
+		}
+	} else if ((recordfile != NULL) || (aeskey != NULL)) {
+		fprintf(stderr, "Error: Recording and descrambling are only possible with transport streams.\n");
+		exit(1);
+	}
 
 	signal(SIGPIPE, SIG_IGN);
 	signal(SIGHUP, SIG_IGN);
@@ -911,7 +1603,7 @@ int main(int argc, char *argv[])
 	signal(SIGBUS, signalcleanup);
 	signal(SIGQUIT, signalhandler);
 	signal(SIGINT, signalhandler);
-	signal(SIGUSR1, signalhandler);
+	signal(SIGUSR1, recordhandler);
 	signal(SIGUSR2, signalhandler);
 	signal(SIGKILL, signalhandler);
 	signal(SIGTERM, signalhandler);
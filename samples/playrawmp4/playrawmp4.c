@@ -3,11 +3,14 @@
  * All rights reserved.
  *
  * The test play mp4 video from the raw video and audio stream.
+ * A second raw video stream can be shown as picture in picture. It is decoded
+ * by the second MPEG engine.
  */
 
+#define _GNU_SOURCE
+
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/mman.h>
 
 #include <stdio.h>
 #include <stdint.h>
@@ -20,6 +23,7 @@
 
 #include "rua.h"
 #include "dcc.h"
+#include "streamio.h"
 
 /** Define to play audio also. */
 #define PLAY_AUDIO
@@ -32,8 +36,22 @@
 #define DMA_BUFFER_SIZE_LOG2 14
 /** Size of buffers used to transfer audio and video data. */
 #define DMA_BUFFER_SIZE (1 << DMA_BUFFER_SIZE_LOG2)
+/** Size of the part of an input file which is mapped at once. */
+#define MAP_WINDOW_SIZE (4 * 1024 * 1024)
 /** How many video stream data to buffer until playing should start. */
 #define VID_PRE_BUFFER_SIZE 48704
+/** Maximum DRAM used by the picture in picture decoder. */
+#define PIP_DRAM_BUDGET (32 * 1024 * 1024)
+/** Maximum size of a SPS which is parsed. */
+#define MAX_SPS_SIZE 256
+/** Frame rate assumed for the raw video, the byte stream has no timestamps. */
+#define DEFAULT_FRAME_RATE 25
+/** Size of the parts passed to the key frame scanner. */
+#define SCAN_SIZE (64 * 1024)
+/** Size of the ADTS header without CRC. */
+#define ADTS_HEADER_SIZE 7
+/** Samples in each AAC frame. */
+#define AAC_FRAME_SAMPLES 1024
 /** Print debug message. */
 #define DPRINTF(args...) \
 	do { \
@@ -48,11 +66,14 @@ typedef struct {
 	struct RUABufferPool *pDMA;
 	struct DCCSTCSource *pStcSource;
 	struct DCCVideoSource *pVideoSource;
+	struct DCCVideoSource *pPipVideoSource;
 #ifdef PLAY_AUDIO
 	struct DCCAudioSource *pAudioSource;
 #endif
 	RMuint32 SurfaceID;
+	RMuint32 PipSurfaceID;
 	RMuint32 video_decoder;
+	RMuint32 pip_decoder;
 	RMuint32 spu_decoder;
 	RMuint32 video_timer;
 #ifdef PLAY_AUDIO
@@ -65,11 +86,22 @@ typedef struct {
 /** Set to 1 to enable debug output. */
 static int debug = 0;
 /** Raw video stream data. */
-static uint8_t *videodata;
+static struct StreamIOMap *videomap;
 static size_t videosize;
 /** Raw audio stream data. */
-static uint8_t *audiodata;
+static struct StreamIOMap *audiomap;
 static size_t audiosize;
+/** Raw video stream data shown as picture in picture. */
+static struct StreamIOMap *pipmap;
+static size_t pipsize;
+/** Time in seconds where playing starts. */
+static RMuint32 start_time = 0;
+/** Frames per second of the raw video streams. */
+static RMuint32 frame_rate = DEFAULT_FRAME_RATE;
+/** Positions in the files where playing starts. */
+static RMuint32 videostart = 0;
+static RMuint32 audiostart = 0;
+static RMuint32 pipstart = 0;
 static volatile int stopped = 0;
 static app_rua_context_t context_g;
 
@@ -99,6 +131,14 @@ static void cleanup(app_rua_context_t *context)
 	}
 #endif
 
+	if (context->pPipVideoSource != NULL) {
+		rv = DCCCloseVideoSource(context->pPipVideoSource);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot close pip video source, rv = %d\n", rv); 
+		}
+		context->pPipVideoSource = NULL;
+	}
+
 	if (context->pVideoSource != NULL) {
 		rv = DCCCloseVideoSource(context->pVideoSource);
 		if (RMFAILED(rv)) {
@@ -193,6 +233,245 @@ static RMstatus video_init(app_rua_context_t *context)
 	return RM_OK;
 }
 
+static uint32_t read_bits(const uint8_t *buf, size_t size, size_t *pos, int n)
+{
+	uint32_t v = 0;
+
+	while (n-- > 0) {
+		v <<= 1;
+		if ((*pos >> 3) < size) {
+			v |= (buf[*pos >> 3] >> (7 - (*pos & 7))) & 1;
+		}
+		(*pos)++;
+	}
+	return v;
+}
+
+/** Read unsigned Exp-Golomb code. */
+static uint32_t read_ue(const uint8_t *buf, size_t size, size_t *pos)
+{
+	int zeros = 0;
+
+	while ((read_bits(buf, size, pos, 1) == 0) && (zeros < 31)) {
+		zeros++;
+	}
+	return ((1 << zeros) - 1) + read_bits(buf, size, pos, zeros);
+}
+
+/** Read signed Exp-Golomb code. */
+static int32_t read_se(const uint8_t *buf, size_t size, size_t *pos)
+{
+	uint32_t v;
+
+	v = read_ue(buf, size, pos);
+	if (v & 1) {
+		return (v + 1) / 2;
+	} else {
+		return -(int32_t)(v / 2);
+	}
+}
+
+/** Get the size in macroblocks from the first SPS in a H.264 byte stream. */
+static int get_h264_resolution(const uint8_t *data, size_t size, uint32_t *width, uint32_t *height)
+{
+	uint8_t sps[MAX_SPS_SIZE];
+	size_t spssize;
+	size_t pos;
+	size_t i;
+	uint32_t profile_idc;
+	uint32_t poc_type;
+	uint32_t frame_mbs_only;
+
+	/* Find SPS NAL unit. */
+	for (i = 0; (i + 3) < size; i++) {
+		if ((data[i] == 0) && (data[i + 1] == 0) && (data[i + 2] == 1) && ((data[i + 3] & 0x1F) == 7)) {
+			break;
+		}
+	}
+	if ((i + 3) >= size) {
+		return -1;
+	}
+
+	/* Remove emulation prevention bytes. */
+	spssize = 0;
+	for (i += 4; (i < size) && (spssize < sizeof(sps)); i++) {
+		if ((i + 2 < size) && (data[i] == 0) && (data[i + 1] == 0) && (data[i + 2] <= 1)) {
+			break;
+		}
+		if ((spssize >= 2) && (sps[spssize - 1] == 0) && (sps[spssize - 2] == 0) && (data[i] == 3)) {
+			continue;
+		}
+		sps[spssize++] = data[i];
+	}
+
+	pos = 0;
+	profile_idc = read_bits(sps, spssize, &pos, 8);
+	read_bits(sps, spssize, &pos, 16); /* constraint flags and level_idc */
+	read_ue(sps, spssize, &pos); /* seq_parameter_set_id */
+	if ((profile_idc == 100) || (profile_idc == 110) || (profile_idc == 122) || (profile_idc == 244)
+		|| (profile_idc == 44) || (profile_idc == 83) || (profile_idc == 86) || (profile_idc == 118)
+		|| (profile_idc == 128)) {
+		uint32_t chroma_format_idc;
+
+		chroma_format_idc = read_ue(sps, spssize, &pos);
+		if (chroma_format_idc == 3) {
+			read_bits(sps, spssize, &pos, 1); /* separate_colour_plane_flag */
+		}
+		read_ue(sps, spssize, &pos); /* bit_depth_luma_minus8 */
+		read_ue(sps, spssize, &pos); /* bit_depth_chroma_minus8 */
+		read_bits(sps, spssize, &pos, 1); /* qpprime_y_zero_transform_bypass_flag */
+		if (read_bits(sps, spssize, &pos, 1)) {
+			int lists;
+			int n;
+
+			lists = (chroma_format_idc != 3) ? 8 : 12;
+			for (n = 0; n < lists; n++) {
+				if (read_bits(sps, spssize, &pos, 1)) {
+					int entries;
+					int last = 8;
+					int next = 8;
+					int j;
+
+					entries = (n < 6) ? 16 : 64;
+					for (j = 0; (j < entries) && (next != 0); j++) {
+						next = (last + read_se(sps, spssize, &pos) + 256) % 256;
+						if (next != 0) {
+							last = next;
+						}
+					}
+				}
+			}
+		}
+	}
+	read_ue(sps, spssize, &pos); /* log2_max_frame_num_minus4 */
+	poc_type = read_ue(sps, spssize, &pos);
+	if (poc_type == 0) {
+		read_ue(sps, spssize, &pos); /* log2_max_pic_order_cnt_lsb_minus4 */
+	} else if (poc_type == 1) {
+		uint32_t cycle;
+
+		read_bits(sps, spssize, &pos, 1); /* delta_pic_order_always_zero_flag */
+		read_se(sps, spssize, &pos); /* offset_for_non_ref_pic */
+		read_se(sps, spssize, &pos); /* offset_for_top_to_bottom_field */
+		cycle = read_ue(sps, spssize, &pos);
+		while ((cycle-- > 0) && ((pos >> 3) < spssize)) {
+			read_se(sps, spssize, &pos);
+		}
+	}
+	read_ue(sps, spssize, &pos); /* max_num_ref_frames */
+	read_bits(sps, spssize, &pos, 1); /* gaps_in_frame_num_value_allowed_flag */
+	*width = (read_ue(sps, spssize, &pos) + 1) * 16;
+	*height = read_ue(sps, spssize, &pos) + 1;
+	frame_mbs_only = read_bits(sps, spssize, &pos, 1);
+	*height *= (2 - frame_mbs_only) * 16;
+
+	if ((pos >> 3) >= spssize) {
+		return -1;
+	}
+	return 0;
+}
+
+/** Open the decoder for the picture in picture on the MPEG engine which is not used by the main video. */
+static RMstatus configure_pip(app_rua_context_t *context)
+{
+	RMstatus rv;
+	struct DCCXVideoProfile video_profile;
+	struct EMhwlibWindow output;
+	RMuint32 dramsize;
+	uint32_t width;
+	uint32_t height;
+	RMuint8 *data;
+
+	/* SPS is expected at the start of the file. */
+	rv = StreamIOMapGet(pipmap, 0, (pipsize < MAP_WINDOW_SIZE) ? pipsize : MAP_WINDOW_SIZE, &data);
+	if (RMFAILED(rv) || (get_h264_resolution(data, (pipsize < MAP_WINDOW_SIZE) ? pipsize : MAP_WINDOW_SIZE, &width, &height) < 0)) {
+		fprintf(stderr, "Cannot get resolution of pip video.\n");
+		return RM_ERROR;
+	}
+	printf("PIP video resolution %ux%u\n", width, height);
+
+	memset(&video_profile, 0, sizeof(video_profile));
+	video_profile.BitstreamFIFOSize = 2 * 1024 * 1024;
+	video_profile.XferFIFOCount = 512;
+	video_profile.MpegEngineID = 1 - DEFAULT_DRAM_CONTROLLER;
+	video_profile.VideoDecoderID = 0;
+	video_profile.ProtectedFlags = 0;
+	video_profile.PtsFIFOCount = 600;
+	video_profile.InbandFIFOCount = 16;
+	video_profile.STCID = 0;
+	video_profile.Codec = EMhwlibVideoCodec_H264;
+	video_profile.Profile = 0;
+	video_profile.Level = 10;
+	video_profile.ExtraPictureBufferCount = 0;
+	/* Picture buffers are allocated for the real resolution and not for 1920x1080. */
+	video_profile.MaxWidth = width;
+	video_profile.MaxHeight = height;
+
+	rv = DCCGetVideoDecoderSourceDRAMSize(context->pDCC, &video_profile, &dramsize);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot get DRAM size of pip decoder, rv = %d\n", rv);
+		return rv;
+	}
+	printf("PIP decoder needs %u bytes DRAM\n", dramsize);
+	if (dramsize > PIP_DRAM_BUDGET) {
+		fprintf(stderr, "PIP decoder needs more than %u bytes DRAM.\n", PIP_DRAM_BUDGET);
+		return RM_FATALOUTOFMEMORY;
+	}
+
+	rv = DCCXOpenVideoDecoderSource(context->pDCC, &video_profile, &context->pPipVideoSource);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot open pip video decoder source, rv = %d\n", rv);
+		return rv;
+	}
+
+	rv = DCCXSetVideoDecoderSourceCodec(context->pPipVideoSource, video_profile.Codec);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot set pip video decoder codec, rv =%d\n", rv);
+		return rv;
+	}
+
+	rv = DCCGetScalerModuleID(context->pDCC, DCCRoute_Main, DCCSurface_Video, 1, &context->PipSurfaceID);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot get pip surface id, rv = %d\n", rv);
+		return rv;
+	}
+
+	/* Show it in the lower right quarter of the screen. */
+	memset(&output, 0, sizeof(output));
+	output.X = EMHWLIB_WINDOW_RELATIVE_MAX / 2;
+	output.Y = EMHWLIB_WINDOW_RELATIVE_MAX / 2;
+	output.Width = EMHWLIB_WINDOW_RELATIVE_MAX / 2 - EMHWLIB_WINDOW_RELATIVE_MAX / 32;
+	output.Height = EMHWLIB_WINDOW_RELATIVE_MAX / 2 - EMHWLIB_WINDOW_RELATIVE_MAX / 32;
+	output.XMode = EMhwlibDisplayWindowValueMode_Relative;
+	output.YMode = EMhwlibDisplayWindowValueMode_Relative;
+	output.WidthMode = EMhwlibDisplayWindowValueMode_Relative;
+	output.HeightMode = EMhwlibDisplayWindowValueMode_Relative;
+	rv = DCCSetVideoSourceWindows(context->pPipVideoSource, NULL, &output);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot set pip window, rv = %d\n", rv);
+		return rv;
+	}
+
+	rv = DCCSetSurfaceSource(context->pDCC, context->PipSurfaceID, context->pPipVideoSource);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot set pip surface id, rv = %d\n", rv);
+		return rv;
+	}
+
+	rv = DCCEnableVideoSource(context->pPipVideoSource, TRUE);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot enable pip surface, rv = %d\n", rv);
+		return rv;
+	}
+
+	rv = DCCGetVideoDecoderSourceInfo(context->pPipVideoSource, &context->pip_decoder, NULL, NULL);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Cannot get pip video decoder source info, rv = %d\n", rv);
+		return rv;
+	}
+	return RM_OK;
+}
+
 static RMstatus configure_video(app_rua_context_t *context)
 {
 	struct DCCStcProfile stc_profile;
@@ -321,10 +600,18 @@ static RMstatus configure_video(app_rua_context_t *context)
 		cleanup(context);
 		return rv;
 	}
+
+	if (pipmap != NULL) {
+		rv = configure_pip(context);
+		if (RMFAILED(rv)) {
+			cleanup(context);
+			return rv;
+		}
+	}
 	return RM_OK;
 }
 
-static RMstatus transfer_data(app_rua_context_t *context, RMuint32 *transferred, RMuint8 *data, RMuint32 datasize, RMuint32 decoder, RMuint8 **pbuffer)
+static RMstatus transfer_data(app_rua_context_t *context, RMuint32 *transferred, struct StreamIOMap *map, RMuint32 datasize, RMuint32 decoder, RMuint8 **pbuffer)
 {
 	RMuint32 size;
 	RMstatus rv;
@@ -340,6 +627,14 @@ static RMstatus transfer_data(app_rua_context_t *context, RMuint32 *transferred,
 	}
 
 	if (*pbuffer == NULL) {
+		RMuint8 *data;
+
+		rv = StreamIOMapGet(map, *transferred, size, &data);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot read data at %u, rv = %d\n", *transferred, rv);
+			cleanup(context);
+			return rv;
+		}
 		rv = RUAGetBuffer(context->pDMA, pbuffer, 0);
 		if (RMFAILED(rv)) {
 			*pbuffer = NULL;
@@ -350,7 +645,7 @@ static RMstatus transfer_data(app_rua_context_t *context, RMuint32 *transferred,
 			}
 			return rv;
 		}
-		memcpy(*pbuffer, &data[*transferred], size);
+		memcpy(*pbuffer, data, size);
 	}
 
 	memset(&video_info, 0, sizeof(video_info));
@@ -387,6 +682,8 @@ static RMstatus play_video(app_rua_context_t *context)
 	int playing = 0;
 	RMuint64 time;
 	RMuint8 *videobuffer = NULL;
+	RMuint32 piptransferred;
+	RMuint8 *pipbuffer = NULL;
 	RMuint32 videonumbuffers;
 	RMuint32 audionumbuffers;
 #ifdef PLAY_AUDIO
@@ -485,9 +782,10 @@ static RMstatus play_video(app_rua_context_t *context)
 		return rv;
 	}
 
-	videotransferred = 0;
+	videotransferred = videostart;
+	piptransferred = pipstart;
 #ifdef PLAY_AUDIO
-	audiotransferred = 0;
+	audiotransferred = audiostart;
 #endif
 	videonumbuffers = videosize / DMA_BUFFER_SIZE;
 	audionumbuffers = audiosize / DMA_BUFFER_SIZE;
@@ -495,8 +793,8 @@ static RMstatus play_video(app_rua_context_t *context)
 #ifdef PLAY_AUDIO
 	/* Calculate how many bytes need to be transferred until the next audiodata can be transferred. */
 	vafactor = (((RMuint64) DMA_BUFFER_SIZE) * ((RMuint64) videosize)) / ((RMuint64) audiosize);
-	vvalue = 0;
-	avalue = 0;
+	vvalue = videostart;
+	avalue = audiostart;
 #endif
 	while (videotransferred < videosize) {
 		if (stopped) {
@@ -505,11 +803,20 @@ static RMstatus play_video(app_rua_context_t *context)
 		}
 		if (videotransferred < videosize) {
 			/* Send video stream data which should be played. */
-			rv = transfer_data(context, &videotransferred, videodata, videosize, context->video_decoder, &videobuffer);
+			rv = transfer_data(context, &videotransferred, videomap, videosize, context->video_decoder, &videobuffer);
 			if ((rv != RM_OK) && (rv != RM_PENDING)) {
 				return rv;
 			}
 		}
+		if ((context->pPipVideoSource != NULL) && (piptransferred < pipsize)) {
+			/* Keep the picture in picture video at the same position as the main video. */
+			if ((((RMuint64) piptransferred) * videosize) <= (((RMuint64) videotransferred) * pipsize)) {
+				rv = transfer_data(context, &piptransferred, pipmap, pipsize, context->pip_decoder, &pipbuffer);
+				if ((rv != RM_OK) && (rv != RM_PENDING)) {
+					return rv;
+				}
+			}
+		}
 #ifdef PLAY_AUDIO
 		if (stopped) {
 			printf("Received signal, stopping...\n");
@@ -519,7 +826,7 @@ static RMstatus play_video(app_rua_context_t *context)
 			/* Audio should not use all buffers, so only transfer audio when already enough video data were transferred. */
 			if (videotransferred >= vvalue) {
 				/* Send audio stream data which should be played. */
-				rv = transfer_data(context, &audiotransferred, audiodata, audiosize, context->audio_decoder, &audiobuffer);
+				rv = transfer_data(context, &audiotransferred, audiomap, audiosize, context->audio_decoder, &audiobuffer);
 				if ((rv != RM_OK) && (rv != RM_PENDING)) {
 					return rv;
 				}
@@ -540,7 +847,7 @@ static RMstatus play_video(app_rua_context_t *context)
 			printf("Received signal, stopping...\n");
 			break;
 		}
-		if (!playing && (videotransferred > VID_PRE_BUFFER_SIZE)) {
+		if (!playing && ((videotransferred - videostart) > VID_PRE_BUFFER_SIZE)) {
 			printf("Start play\n");
 			rv = DCCSTCPlay(context->pStcSource);
 			if (RMFAILED(rv)) {
@@ -554,6 +861,14 @@ static RMstatus play_video(app_rua_context_t *context)
 				cleanup(context);
 				return rv;
 			}
+			if (context->pPipVideoSource != NULL) {
+				rv = DCCPlayVideoSource(context->pPipVideoSource, DCCVideoPlayFwd);
+				if (RMFAILED(rv)) {
+					fprintf(stderr, "Cannot play pip video source, rv = %d\n", rv);
+					cleanup(context);
+					return rv;
+				}
+			}
 #ifdef PLAY_AUDIO
 			/* TBD: Use DCCPlayMultipleAudioSource() instead. */
 			rv = DCCPlayAudioSource(context->pAudioSource);
@@ -574,6 +889,13 @@ static RMstatus play_video(app_rua_context_t *context)
 		}
 		videobuffer = NULL;
 	}
+	if (pipbuffer != NULL) {
+		rv = RUAReleaseBuffer(context->pDMA, pipbuffer);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Failed to release buffer, rv = %d\n", rv);
+		}
+		pipbuffer = NULL;
+	}
 #ifdef PLAY_AUDIO
 	if (audiobuffer != NULL) {
 		rv = RUAReleaseBuffer(context->pDMA, audiobuffer);
@@ -602,6 +924,14 @@ static RMstatus play_video(app_rua_context_t *context)
 			cleanup(context);
 			return rv;
 		}
+		if (context->pPipVideoSource != NULL) {
+			rv = DCCStopVideoSource(context->pPipVideoSource, DCCStopMode_BlackFrame);
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Cannot stop pip video source, rv = %d\n", rv);
+				cleanup(context);
+				return rv;
+			}
+		}
 #ifdef PLAY_AUDIO
 		rv = DCCStopAudioSource(context->pAudioSource);
 		if (RMFAILED(rv)) {
@@ -621,37 +951,115 @@ static RMstatus play_video(app_rua_context_t *context)
 	return RM_OK;
 }
 
-static int read_file(const char *filename, uint8_t **data, size_t *size)
+/** Map the file in a window, so played data doesn't fill the memory. */
+static int read_file(const char *filename, struct StreamIOMap **map, size_t *size)
 {
-	int fd;
-	off_t offset;
-	int rv = -1;
+	RMstatus rv;
 
-	fd = open(filename, O_RDONLY);
-	if (fd < 0) {
-		fprintf(stderr, "Error: Failed to open \"%s\".\n", filename);
+	rv = StreamIOMapOpen(filename, MAP_WINDOW_SIZE, map);
+	if (RMFAILED(rv)) {
 		return -1;
 	}
-	offset = lseek(fd, 0, SEEK_END);
-	if (offset != -1) {
-		void *ptr;
+	*size = StreamIOMapGetSize(*map);
+	return 0;
+}
 
-		ptr = mmap(NULL, offset, PROT_READ, MAP_SHARED, fd, 0);
-		if (ptr == MAP_FAILED) {
-			rv = -1;
-		} else {
-			rv = 0;
-			*data = ptr;
-			*size = offset;
+/**
+ * Find the key frame of a raw video file at start_time. The key frames are
+ * found by scanning the byte stream once, the index is saved next to the
+ * file for the next start.
+ *
+ * @param pts Returns the frame number of the key frame.
+ */
+static RMstatus find_video_start(const char *filename, struct StreamIOMap *map, size_t size, RMuint32 *offset, RMuint64 *pts)
+{
+	struct DCCSeekIndex *pIndex;
+	struct DCCTrickPlayEntry entry;
+	RMuint32 pos;
+	RMstatus rv;
+
+	/* The time resolution is the frame rate, so the PTS counts frames. */
+	rv = DCCSeekIndexOpen(frame_rate, &pIndex);
+	if (RMFAILED(rv)) {
+		return rv;
+	}
+	if (DCCSeekIndexLoad(pIndex, filename) != RM_OK) {
+		printf("Scanning key frames of \"%s\"\n", filename);
+		for (pos = 0; pos < size; pos += SCAN_SIZE) {
+			RMuint32 len = size - pos;
+			RMuint8 *data;
+
+			if (len > SCAN_SIZE) {
+				len = SCAN_SIZE;
+			}
+			rv = StreamIOMapGet(map, pos, len, &data);
+			if (RMFAILED(rv)) {
+				fprintf(stderr, "Cannot read data at %u, rv = %d\n", pos, rv);
+				goto out;
+			}
+			rv = DCCSeekIndexScanAnnexB(pIndex, data, len, 1);
+			if (RMFAILED(rv)) {
+				goto out;
+			}
+		}
+		DCCSeekIndexScanEnd(pIndex);
+		rv = DCCSeekIndexSave(pIndex, filename);
+		if (RMFAILED(rv)) {
+			printf("Seek index is not saved, rv = %d\n", rv);
 		}
 	}
-	close(fd);
+	rv = DCCSeekIndexFind(pIndex, ((RMuint64) start_time) * frame_rate, &entry);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "No key frame found in \"%s\".\n", filename);
+		goto out;
+	}
+	*offset = entry.offset;
+	*pts = entry.pts;
+out:
+	DCCSeekIndexClose(pIndex);
 	return rv;
 }
 
+/** Find the first ADTS frame of the audio file which is played at the video frame pts. */
+static RMstatus find_audio_start(RMuint64 pts, RMuint32 *offset)
+{
+	static const RMuint32 sample_rates[16] = {
+		96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050,
+		16000, 12000, 11025, 8000, 7350, 0, 0, 0
+	};
+	RMuint64 samples = 0;
+	RMuint32 pos = 0;
+	RMstatus rv;
+
+	while ((pos + ADTS_HEADER_SIZE) <= audiosize) {
+		RMuint8 *h;
+		RMuint32 rate;
+		RMuint32 length;
+
+		rv = StreamIOMapGet(audiomap, pos, ADTS_HEADER_SIZE, &h);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Cannot read data at %u, rv = %d\n", pos, rv);
+			return rv;
+		}
+		rate = sample_rates[(h[2] >> 2) & 0x0F];
+		length = ((h[3] & 0x03) << 11) | (h[4] << 3) | (h[5] >> 5);
+		if ((h[0] != 0xFF) || ((h[1] & 0xF6) != 0xF0) || (rate == 0) || (length < ADTS_HEADER_SIZE)) {
+			fprintf(stderr, "Error: No ADTS frame at %u in audio file.\n", pos);
+			return RM_ERROR;
+		}
+		if ((samples * frame_rate) >= (pts * rate)) {
+			break;
+		}
+		samples += AAC_FRAME_SAMPLES * ((h[6] & 0x03) + 1);
+		pos += length;
+	}
+	*offset = pos;
+	return RM_OK;
+}
+
 static void usage(char *argv[])
 {
-	fprintf(stderr, "%s [video file] [audio file]\n", argv[0]);
+	fprintf(stderr, "%s [-s start time] [-f frame rate] [video file] [audio file] [pip video file]\n", argv[0]);
 	fprintf(stderr, "\n");
 	fprintf(stderr, "This program plays mp4 videos from raw video and audio stream.\n");
 	fprintf(stderr, "\n");
@@ -662,6 +1070,12 @@ static void usage(char *argv[])
 	fprintf(stderr, "Audio file must be in format MPEG ADTS, AAC.\n");
 	fprintf(stderr, "A file with the name video.mp4 can be converted by the following command:\n");
 	fprintf(stderr, "ffmpeg -i video.mp4 -vn -sn -f adts -acodec copy audio.raw\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "The optional pip video file is shown as picture in picture. It must have\n");
+	fprintf(stderr, "the same format as the video file.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "-s Start playing at the key frame before the time in seconds.\n");
+	fprintf(stderr, "-f Frame rate of the video files, default is %u.\n", DEFAULT_FRAME_RATE);
 }
 
 int main(int argc, char *argv[])
@@ -670,33 +1084,86 @@ int main(int argc, char *argv[])
 	int ret;
 	const char *videofile;
 	const char *audiofile;
+	const char *pipfile;
 	app_rua_context_t *context = &context_g;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:s:")) != -1) {
+		switch (opt) {
+			case 'f':
+				frame_rate = strtoul(optarg, NULL, 0);
+				if (frame_rate == 0) {
+					fprintf(stderr, "Error: Frame rate must not be 0.\n");
+					exit(1);
+				}
+				break;
 
-	if (argc < 3) {
+			case 's':
+				start_time = strtoul(optarg, NULL, 0);
+				break;
+
+			default:
+				usage(argv);
+				exit(1);
+		}
+	}
+	if ((argc - optind) < 2) {
 		fprintf(stderr, "Error: Paremeter missing.\n");
 
 		usage(argv);
 		exit(1);
 	}
-	videofile = argv[1];
-	audiofile = argv[2];
+	videofile = argv[optind];
+	audiofile = argv[optind + 1];
+	pipfile = ((argc - optind) > 2) ? argv[optind + 2] : NULL;
 
-	videodata = NULL;
+	videomap = NULL;
 	videosize = 0;
-	ret = read_file(videofile, &videodata, &videosize);
+	ret = read_file(videofile, &videomap, &videosize);
 	if (ret < 0) {
 		fprintf(stderr, "Error failed to read \"%s\".\n", videofile);
 		return ret;
 	}
 
-	audiodata = NULL;
+	audiomap = NULL;
 	audiosize = 0;
-	ret = read_file(audiofile, &audiodata, &audiosize);
+	ret = read_file(audiofile, &audiomap, &audiosize);
 	if (ret < 0) {
 		fprintf(stderr, "Error failed to read \"%s\".\n", audiofile);
 		return ret;
 	}
 
+	pipmap = NULL;
+	pipsize = 0;
+	if (pipfile != NULL) {
+		ret = read_file(pipfile, &pipmap, &pipsize);
+		if (ret < 0) {
+			fprintf(stderr, "Error failed to read \"%s\".\n", pipfile);
+			return ret;
+		}
+	}
+
+	if (start_time > 0) {
+		RMuint64 pts;
+		RMuint64 pippts;
+
+		rv = find_video_start(videofile, videomap, videosize, &videostart, &pts);
+		if (RMFAILED(rv)) {
+			return rv;
+		}
+		rv = find_audio_start(pts, &audiostart);
+		if (RMFAILED(rv)) {
+			return rv;
+		}
+		if (pipfile != NULL) {
+			rv = find_video_start(pipfile, pipmap, pipsize, &pipstart, &pippts);
+			if (RMFAILED(rv)) {
+				return rv;
+			}
+		}
+		printf("Start at frame %llu, video at %u, audio at %u\n", (unsigned long long) pts, videostart, audiostart);
+	}
+
 	signal(SIGPIPE, SIG_IGN);
 	signal(SIGHUP, SIG_IGN);
 	signal(SIGSEGV, signalcleanup);
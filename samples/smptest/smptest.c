@@ -3,10 +3,17 @@
  * All rights reserved.
  *
  * The test just shows some colored lines on a black screen.
+ * With parameter -p a palettised 8 bpp picture is used instead of 32 bpp.
+ * With parameter -s the picture has a lower resolution and is scaled up to the
+ * full screen by the OSD scaler.
+ * With parameter -c a hardware cursor is moved over the screen.
  */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "rua.h"
 #include "dcc.h"
@@ -18,8 +25,30 @@ typedef struct {
 	struct DCC *pDCC;
 	RMuint32 osd_scaler;
 	RMuint32 LumaAddr;
+	RMbool palette;
+	RMbool scaled;
+	RMbool cursor;
 } app_rua_context_t;
 
+#define CURSOR_SIZE 16
+
+enum color_index {
+	COLOR_BLACK = 0,
+	COLOR_RED,
+	COLOR_GREEN,
+	COLOR_BLUE,
+	COLOR_WHITE,
+	COLOR_COUNT
+};
+
+static const uint8_t colors[COLOR_COUNT][3] = {
+	{ 0x00, 0x00, 0x00 },
+	{ 0xff, 0x00, 0x00 },
+	{ 0x00, 0xff, 0x00 },
+	{ 0x00, 0x00, 0xff },
+	{ 0xff, 0xff, 0xff },
+};
+
 static void cleanup(app_rua_context_t *context)
 {
 	RMstatus rv;
@@ -85,17 +114,12 @@ static RMstatus osd_init(app_rua_context_t *context)
 }
 
 /** The color space seems to be YUV also when we specify RGB. */
-static void set_pixel(struct DCCOSDProfile *profile, uint8_t *BaseAddr, uint32_t x, uint32_t line, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+static RMuint32 rgb_to_ayuv(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
 {
-	int pos;
 	int y;
 	int u;
 	int v;
 
-	pos = line * profile->Width;
-	pos += x;
-	pos *= 4;
-
 	y = (int)(0.299 * r + 0.587 * g + 0.114 * b);
 	u = (int)((b - y) * 0.565 + 128);
 	v = (int)((r - y) * 0.713 + 128);
@@ -119,10 +143,93 @@ static void set_pixel(struct DCCOSDProfile *profile, uint8_t *BaseAddr, uint32_t
 		v = 0;
 	}
 
-	BaseAddr[pos + 0] = u;
-	BaseAddr[pos + 1] = y;
-	BaseAddr[pos + 2] = v;
-	BaseAddr[pos + 3] = a;
+	return (a << 24) | (v << 16) | (y << 8) | u;
+}
+
+static void set_pixel(struct DCCOSDProfile *profile, uint8_t *BaseAddr, uint32_t x, uint32_t line, enum color_index color)
+{
+	int pos;
+	RMuint32 ayuv;
+
+	pos = line * profile->Width;
+	pos += x;
+
+	if (profile->ColorMode == EMhwlibColorMode_LUT_8BPP) {
+		BaseAddr[pos] = color;
+		return;
+	}
+
+	pos *= 4;
+	ayuv = rgb_to_ayuv(colors[color][0], colors[color][1], colors[color][2], 0xff);
+	BaseAddr[pos + 0] = ayuv;
+	BaseAddr[pos + 1] = ayuv >> 8;
+	BaseAddr[pos + 2] = ayuv >> 16;
+	BaseAddr[pos + 3] = ayuv >> 24;
+}
+
+/** Show a white square with black border as hardware cursor and move it. */
+static RMstatus move_cursor(app_rua_context_t *context)
+{
+	RMstatus rv;
+	struct DCCOSDProfile profile;
+	struct DCCCursor *pCursor;
+	RMuint8 image[CURSOR_SIZE * CURSOR_SIZE];
+	RMuint32 palette[COLOR_COUNT];
+	unsigned int x;
+	unsigned int y;
+	unsigned int i;
+
+	memset(&profile, 0, sizeof(profile));
+	profile.SamplingMode = EMhwlibSamplingMode_444;
+	profile.ColorMode = EMhwlibColorMode_LUT_8BPP;
+	profile.ColorFormat = EMhwlibColorFormat_32BPP;
+	profile.Width = CURSOR_SIZE;
+	profile.Height = CURSOR_SIZE;
+	profile.ColorSpace = EMhwlibColorSpace_RGB_0_255;
+	profile.PixelAspectRatio.X = 1;
+	profile.PixelAspectRatio.Y = 1;
+
+	rv = DCCOpenCursor(context->pDCC, &profile, &pCursor);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Error DCCOpenCursor! %d\n", rv);
+		return rv;
+	}
+
+	for (y = 0; y < CURSOR_SIZE; y++) {
+		for (x = 0; x < CURSOR_SIZE; x++) {
+			if ((x == 0) || (y == 0) || (x == (CURSOR_SIZE - 1)) || (y == (CURSOR_SIZE - 1))) {
+				image[y * CURSOR_SIZE + x] = COLOR_BLACK;
+			} else {
+				image[y * CURSOR_SIZE + x] = COLOR_WHITE;
+			}
+		}
+	}
+	for (i = 0; i < COLOR_COUNT; i++) {
+		palette[i] = rgb_to_ayuv(colors[i][0], colors[i][1], colors[i][2], 0xff);
+	}
+	rv = DCCSetCursorImage(pCursor, image, sizeof(image), palette, COLOR_COUNT, CURSOR_SIZE / 2, CURSOR_SIZE / 2);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Error DCCSetCursorImage! %d\n", rv);
+		DCCCloseCursor(pCursor);
+		return rv;
+	}
+	rv = DCCEnableCursor(pCursor, TRUE);
+	if (RMFAILED(rv)) {
+		fprintf(stderr, "Error DCCEnableCursor! %d\n", rv);
+		DCCCloseCursor(pCursor);
+		return rv;
+	}
+
+	printf("Moving cursor\n");
+	for (i = 0; i < 400; i++) {
+		rv = DCCMoveCursor(pCursor, 100 + i, 100 + i / 2);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Error DCCMoveCursor! %d\n", rv);
+			break;
+		}
+		usleep(20000);
+	}
+	return rv;
 }
 
 static RMstatus create_osd_buffer(app_rua_context_t *context)
@@ -138,10 +245,20 @@ static RMstatus create_osd_buffer(app_rua_context_t *context)
 	uint8_t *BaseAddr;
 
 	profile.SamplingMode = EMhwlibSamplingMode_444;
-	profile.ColorMode = EMhwlibColorMode_TrueColor;
+	if (context->palette) {
+		/* Palette entries are stored in 32 bpp format. */
+		profile.ColorMode = EMhwlibColorMode_LUT_8BPP;
+	} else {
+		profile.ColorMode = EMhwlibColorMode_TrueColor;
+	}
 	profile.ColorFormat = EMhwlibColorFormat_32BPP;
-	profile.Width = 1024;
-	profile.Height = 768;
+	if (context->scaled) {
+		profile.Width = 640;
+		profile.Height = 360;
+	} else {
+		profile.Width = 1024;
+		profile.Height = 768;
+	}
 	profile.ColorSpace = EMhwlibColorSpace_RGB_0_255;
 	profile.PixelAspectRatio.X = 1;
 	profile.PixelAspectRatio.Y = 1;
@@ -204,6 +321,43 @@ static RMstatus create_osd_buffer(app_rua_context_t *context)
 		return rv;
 	}
 
+	if (context->palette) {
+		RMuint32 palette[COLOR_COUNT];
+		unsigned int i;
+
+		for (i = 0; i < COLOR_COUNT; i++) {
+			palette[i] = rgb_to_ayuv(colors[i][0], colors[i][1], colors[i][2], 0xff);
+		}
+		rv = DCCSetOSDPalette(pVideoSource, 0, palette, 0, COLOR_COUNT);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Error DCCSetOSDPalette! %d\n", rv);
+			return rv;
+		}
+	}
+
+	if (context->scaled) {
+		struct EMhwlibWindow input;
+		struct EMhwlibWindow output;
+
+		memset(&input, 0, sizeof(input));
+		input.Width = profile.Width;
+		input.Height = profile.Height;
+
+		memset(&output, 0, sizeof(output));
+		output.Width = EMHWLIB_WINDOW_RELATIVE_MAX;
+		output.Height = EMHWLIB_WINDOW_RELATIVE_MAX;
+		output.XMode = EMhwlibDisplayWindowValueMode_Relative;
+		output.YMode = EMhwlibDisplayWindowValueMode_Relative;
+		output.WidthMode = EMhwlibDisplayWindowValueMode_Relative;
+		output.HeightMode = EMhwlibDisplayWindowValueMode_Relative;
+
+		rv = DCCSetVideoSourceWindows(pVideoSource, &input, &output);
+		if (RMFAILED(rv)) {
+			fprintf(stderr, "Error DCCSetVideoSourceWindows! %d\n", rv);
+			return rv;
+		}
+	}
+
 	rv = DCCInsertPictureInMultiplePictureOSDVideoSource(pVideoSource, 0, 0);
 	if (RMFAILED(rv)) {
 		fprintf(stderr, "Error DCCInsertPictureInMultiplePictureOSDVideoSource! %d\n", rv);
@@ -238,21 +392,21 @@ static RMstatus create_osd_buffer(app_rua_context_t *context)
 
 		for (y = 0; y < profile.Height; y++) {
 			for (x = 0; x < profile.Width; x++) {
-				set_pixel(&profile, BaseAddr, x, y, 0x00, 0x00, 0x00, 0xff);
+				set_pixel(&profile, BaseAddr, x, y, COLOR_BLACK);
 			}
 		}
 
 		for (i = 0; i < profile.Width; i++) {
-			set_pixel(&profile, BaseAddr, i, 100, 0xff, 0x00, 0x00, 0xff);
+			set_pixel(&profile, BaseAddr, i, 100, COLOR_RED);
 		}
 		for (i = 0; i < profile.Width; i++) {
-			set_pixel(&profile, BaseAddr, i, 105, 0x00, 0xff, 0x00, 0xff);
+			set_pixel(&profile, BaseAddr, i, 105, COLOR_GREEN);
 		}
 		for (i = 0; i < profile.Width; i++) {
-			set_pixel(&profile, BaseAddr, i, 110, 0x00, 0x00, 0xff, 0xff);
+			set_pixel(&profile, BaseAddr, i, 110, COLOR_BLUE);
 		}
 		for (i = 0; i < profile.Width; i++) {
-			set_pixel(&profile, BaseAddr, i, 130, 0xff, 0xff, 0xff, 0xff);
+			set_pixel(&profile, BaseAddr, i, 130, COLOR_WHITE);
 		}
 
 	} else {
@@ -263,16 +417,23 @@ static RMstatus create_osd_buffer(app_rua_context_t *context)
 		fprintf(stderr, "Error RUAUnLock! %d\n", rv);
 		return rv;
 	}
+	if (context->cursor) {
+		rv = move_cursor(context);
+		if (RMFAILED(rv)) {
+			return rv;
+		}
+	}
 	printf("Waiting\n");
 	while(1);
 
 	return RM_OK;
 }
 
-int main(void)
+int main(int argc, char *argv[])
 {
 	app_rua_context_t context;
 	RMstatus rv;
+	int i;
 
 	printf("smptest\n");
 
@@ -281,6 +442,15 @@ int main(void)
 		fprintf(stderr, "Error failed osd_init! %d\n", rv);
 		return rv;
 	}
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-p") == 0) {
+			context.palette = TRUE;
+		} else if (strcmp(argv[i], "-s") == 0) {
+			context.scaled = TRUE;
+		} else if (strcmp(argv[i], "-c") == 0) {
+			context.cursor = TRUE;
+		}
+	}
 
 	printf("Init Success\n");
 